@@ -38,6 +38,9 @@ LOCAL_CFLAGS        += -D_GNU_SOURCE
 LOCAL_CFLAGS        += -DPAL_SP_I_TEMP_PATH=\"/data/vendor/audio/audio_sp1.cal\"
 LOCAL_CFLAGS        += -DPAL_SP_II_TEMP_PATH=\"/data/vendor/audio/audio_sp2.cal\"
 LOCAL_CFLAGS        += -DACD_SM_FILEPATH=\"/vendor/etc/models/acd/\"
+ifeq ($(AUDIO_FEATURE_ENABLED_PAL_API_RECORDER), true)
+LOCAL_CFLAGS        += -DPAL_API_RECORDER
+endif
 ifeq ($(TARGET_BOARD_PLATFORM), kalama)
 LOCAL_CFLAGS        += -DSOC_PERIPHERAL_PROT
 endif
@@ -92,6 +95,7 @@ LOCAL_SRC_FILES := \
     stream/src/StreamContextProxy.cpp \
     stream/src/StreamUltraSound.cpp \
     stream/src/StreamSensorPCMData.cpp\
+    stream/src/SensorCaptureSource.cpp \
     device/src/Headphone.cpp \
     device/src/USBAudio.cpp \
     device/src/Device.cpp \
@@ -125,11 +129,17 @@ LOCAL_SRC_FILES := \
     context_manager/src/ContextManager.cpp \
     session/src/ACDEngine.cpp \
     resource_manager/src/ResourceManager.cpp \
+    resource_manager/src/FrontEndIdPool.cpp \
     resource_manager/src/SndCardMonitor.cpp \
     utils/src/SoundTriggerPlatformInfo.cpp \
     utils/src/ACDPlatformInfo.cpp \
     utils/src/VoiceUIPlatformInfo.cpp \
     utils/src/PalRingBuffer.cpp \
+    utils/src/PalEventLoop.cpp \
+    utils/src/PalClockModel.cpp \
+    utils/src/PalThreadPolicy.cpp \
+    utils/src/PalApiRecorder.cpp \
+    utils/src/PalLazyInit.cpp \
     utils/src/SoundTriggerUtils.cpp \
     utils/src/VoiceUIInterface.cpp \
     utils/src/SVAInterface.cpp \
@@ -219,6 +229,30 @@ LOCAL_VENDOR_MODULE := true
 
 include $(BUILD_EXECUTABLE)
 
+ifeq ($(AUDIO_FEATURE_ENABLED_PAL_API_RECORDER), true)
+include $(CLEAR_VARS)
+LOCAL_USE_VNDK := true
+
+LOCAL_CFLAGS += -Wall -Werror -Wno-unused-parameter
+
+LOCAL_SRC_FILES  := test/PalReplay.cpp
+
+LOCAL_MODULE               := PalReplay
+LOCAL_MODULE_OWNER         := qti
+LOCAL_MODULE_TAGS          := optional
+
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/utils/inc
+
+LOCAL_HEADER_LIBRARIES := \
+    libarpal_headers
+
+LOCAL_SHARED_LIBRARIES := \
+                          libar-pal
+LOCAL_VENDOR_MODULE := true
+
+include $(BUILD_EXECUTABLE)
+endif
+
 include $(CLEAR_VARS)
 
 include $(PAL_BASE_PATH)/plugins/Android.mk
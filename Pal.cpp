@@ -72,6 +72,8 @@
 #include "Device.h"
 #include "ResourceManager.h"
 #include "PalCommon.h"
+#include "PalApiRecorder.h"
+#include "PayloadBuilder.h"
 class Stream;
 
 /**
@@ -145,6 +147,10 @@ int32_t pal_init(void)
         goto exit;
     }
 
+#ifdef PAL_API_RECORDER
+    PalApiRecorder::start(PAL_API_TRACE_PATH);
+#endif
+
 exit:
     pal_mutex.unlock();
     PAL_DBG(LOG_TAG, "Exit. exit status : %d ", ret);
@@ -179,6 +185,9 @@ void pal_deinit(void)
     } catch (const std::exception& e) {
         PAL_ERR(LOG_TAG, "ResourceManager::getInstance() failed: %s", e.what());
     }
+#ifdef PAL_API_RECORDER
+    PalApiRecorder::stop();
+#endif
     ri->deInitContextManager();
 
     ResourceManager::deinit();
@@ -201,6 +210,7 @@ int32_t pal_stream_open(struct pal_stream_attributes *attributes,
     int status;
     struct pal_stream_attributes sAttr;
     std::shared_ptr<ResourceManager> rm = NULL;
+    PAL_API_RECORD(PAL_API_STREAM_OPEN, NULL, status);
 
     rm = ResourceManager::getInstance();
     if (!rm) {
@@ -216,6 +226,13 @@ int32_t pal_stream_open(struct pal_stream_attributes *attributes,
     }
 
     PAL_INFO(LOG_TAG, "Enter, stream type:%d", attributes->type);
+    PAL_API_RECORD_ARG(no_of_devices);
+    PAL_API_RECORD_ARG2(no_of_modifiers);
+    PAL_API_RECORD_BLOB(attributes, sizeof(*attributes));
+    if (devices)
+        PAL_API_RECORD_BLOB(devices, no_of_devices * sizeof(*devices));
+    if (modifiers)
+        PAL_API_RECORD_BLOB(modifiers, no_of_modifiers * sizeof(*modifiers));
 #ifdef SOC_PERIPHERAL_PROT
     if (ResourceManager::isTZSecureZone) {
         PAL_DBG(LOG_TAG, "In secure zone, so stop the usecase");
@@ -224,6 +241,8 @@ int32_t pal_stream_open(struct pal_stream_attributes *attributes,
     }
 #endif
 
+    rm->initSubsystemsForStream(attributes);
+
     try {
         s = Stream::create(attributes, devices, no_of_devices, modifiers,
                            no_of_modifiers);
@@ -257,6 +276,7 @@ int32_t pal_stream_open(struct pal_stream_attributes *attributes,
     rm->initStreamUserCounter(s);
     stream = reinterpret_cast<uint64_t *>(s);
     *stream_handle = stream;
+    PAL_API_RECORD_RESULT(stream);
 exit:
     PAL_INFO(LOG_TAG, "Exit. Value of stream_handle %pK, status %d", stream, status);
     return status;
@@ -268,6 +288,7 @@ int32_t pal_stream_close(pal_stream_handle_t *stream_handle)
     int status;
     struct pal_stream_attributes sAttr;
     std::shared_ptr<ResourceManager> rm = NULL;
+    PAL_API_RECORD(PAL_API_STREAM_CLOSE, stream_handle, status);
     if (!stream_handle) {
         status = -EINVAL;
         PAL_ERR(LOG_TAG, "Invalid stream handle status %d", status);
@@ -319,6 +340,7 @@ int32_t pal_stream_start(pal_stream_handle_t *stream_handle)
     struct pal_stream_attributes sAttr;
     std::shared_ptr<ResourceManager> rm = NULL;
     int status;
+    PAL_API_RECORD(PAL_API_STREAM_START, stream_handle, status);
     if (!stream_handle) {
         status = -EINVAL;
         PAL_ERR(LOG_TAG, "Invalid stream handle status %d", status);
@@ -380,6 +402,7 @@ int32_t pal_stream_stop(pal_stream_handle_t *stream_handle)
     Stream *s = NULL;
     std::shared_ptr<ResourceManager> rm = NULL;
     int status;
+    PAL_API_RECORD(PAL_API_STREAM_STOP, stream_handle, status);
 
     if (!stream_handle) {
         status = -EINVAL;
@@ -430,6 +453,9 @@ ssize_t pal_stream_write(pal_stream_handle_t *stream_handle, struct pal_buffer *
 {
     Stream *s = NULL;
     int status;
+    PAL_API_RECORD(PAL_API_STREAM_WRITE, stream_handle, status);
+    if (buf)
+        PAL_API_RECORD_ARG(buf->size);
     if (!stream_handle || !buf) {
         status = -EINVAL;
         PAL_ERR(LOG_TAG, "Invalid input parameters status %d", status);
@@ -450,6 +476,9 @@ ssize_t pal_stream_read(pal_stream_handle_t *stream_handle, struct pal_buffer *b
 {
     Stream *s = NULL;
     int status;
+    PAL_API_RECORD(PAL_API_STREAM_READ, stream_handle, status);
+    if (buf)
+        PAL_API_RECORD_ARG(buf->size);
     if (!stream_handle || !buf) {
         status = -EINVAL;
         PAL_ERR(LOG_TAG, "Invalid input parameters status %d", status);
@@ -466,11 +495,67 @@ ssize_t pal_stream_read(pal_stream_handle_t *stream_handle, struct pal_buffer *b
     return status;
 }
 
+ssize_t pal_stream_write_batch(pal_stream_handle_t *stream_handle,
+                               struct pal_buffer *bufs, uint32_t num_bufs)
+{
+    Stream *s = NULL;
+    int status;
+    PAL_API_RECORD(PAL_API_STREAM_WRITE_BATCH, stream_handle, status);
+    PAL_API_RECORD_ARG(num_bufs);
+    for (uint32_t i = 0; bufs && i < num_bufs; i++)
+        PAL_API_RECORD_BLOB(&bufs[i].size, sizeof(bufs[i].size));
+    if (!stream_handle || !bufs || !num_bufs) {
+        status = -EINVAL;
+        PAL_ERR(LOG_TAG, "Invalid input parameters status %d", status);
+        return status;
+    }
+    PAL_VERBOSE(LOG_TAG, "Enter. Stream handle :%pK num_bufs %u", stream_handle, num_bufs);
+    s =  reinterpret_cast<Stream *>(stream_handle);
+    status = s->writeBatch(bufs, num_bufs);
+    if (status < 0) {
+        PAL_ERR(LOG_TAG, "stream batch write failed status %d", status);
+        return status;
+    }
+    PAL_VERBOSE(LOG_TAG, "Exit. status %d", status);
+    return status;
+}
+
+ssize_t pal_stream_read_batch(pal_stream_handle_t *stream_handle,
+                              struct pal_buffer *bufs, uint32_t num_bufs)
+{
+    Stream *s = NULL;
+    int status;
+    PAL_API_RECORD(PAL_API_STREAM_READ_BATCH, stream_handle, status);
+    PAL_API_RECORD_ARG(num_bufs);
+    for (uint32_t i = 0; bufs && i < num_bufs; i++)
+        PAL_API_RECORD_BLOB(&bufs[i].size, sizeof(bufs[i].size));
+    if (!stream_handle || !bufs || !num_bufs) {
+        status = -EINVAL;
+        PAL_ERR(LOG_TAG, "Invalid input parameters status %d", status);
+        return status;
+    }
+    PAL_VERBOSE(LOG_TAG, "Enter. Stream handle :%pK num_bufs %u", stream_handle, num_bufs);
+    s =  reinterpret_cast<Stream *>(stream_handle);
+    status = s->readBatch(bufs, num_bufs);
+    if (status < 0) {
+        PAL_ERR(LOG_TAG, "stream batch read failed status %d", status);
+        return status;
+    }
+    PAL_VERBOSE(LOG_TAG, "Exit. status %d", status);
+    return status;
+}
+
 int32_t pal_stream_get_param(pal_stream_handle_t *stream_handle,
                              uint32_t param_id, pal_param_payload **param_payload)
 {
     Stream *s = NULL;
     int status;
+    PAL_API_RECORD(PAL_API_STREAM_GET_PARAM, stream_handle, status);
+    PAL_API_RECORD_ARG(param_id);
+    /* some params are queried with a caller filled payload */
+    if (param_payload && *param_payload)
+        PAL_API_RECORD_BLOB(*param_payload,
+                            sizeof(pal_param_payload) + (*param_payload)->payload_size);
 
     if (!stream_handle) {
         status = -EINVAL;
@@ -495,6 +580,10 @@ int32_t pal_stream_set_param(pal_stream_handle_t *stream_handle, uint32_t param_
     Stream *s = NULL;
     int status;
     std::shared_ptr<ResourceManager> rm = NULL;
+    PAL_API_RECORD(PAL_API_STREAM_SET_PARAM, stream_handle, status);
+    PAL_API_RECORD_ARG(param_id);
+    if (param_payload)
+        PAL_API_RECORD_BLOB(param_payload->payload, param_payload->payload_size);
 
     if (!stream_handle) {
         status = -EINVAL;
@@ -528,12 +617,26 @@ int32_t pal_stream_set_param(pal_stream_handle_t *stream_handle, uint32_t param_
     return status;
 }
 
+pal_param_payload *pal_param_payload_alloc(uint32_t size)
+{
+    return PayloadBuilder::allocParamPayload(size);
+}
+
+void pal_param_payload_free(pal_param_payload *param_payload)
+{
+    PayloadBuilder::freeParamPayload(param_payload);
+}
+
 int32_t pal_stream_set_volume(pal_stream_handle_t *stream_handle,
                               struct pal_volume_data *volume)
 {
     Stream *s = NULL;
     int status;
     std::shared_ptr<ResourceManager> rm = NULL;
+    PAL_API_RECORD(PAL_API_STREAM_SET_VOLUME, stream_handle, status);
+    if (volume)
+        PAL_API_RECORD_BLOB(volume, sizeof(struct pal_volume_data) +
+                            volume->no_of_volpair * sizeof(struct pal_channel_vol_kv));
     rm = ResourceManager::getInstance();
     if (!rm) {
         PAL_ERR(LOG_TAG, "Invalid resource manager");
@@ -564,6 +667,7 @@ int32_t pal_stream_set_volume(pal_stream_handle_t *stream_handle,
     }
     rm->unlockActiveStream();
 
+    s->dropAsyncUpdate(false);
     s->lockStreamMutex();
     status = s->setVolume(volume);
     s->unlockStreamMutex();
@@ -585,6 +689,8 @@ int32_t pal_stream_set_mute(pal_stream_handle_t *stream_handle, bool state)
     Stream *s = NULL;
     std::shared_ptr<ResourceManager> rm = NULL;
     int status = 0;
+    PAL_API_RECORD(PAL_API_STREAM_SET_MUTE, stream_handle, status);
+    PAL_API_RECORD_ARG(state);
 
     if (!stream_handle) {
         status = -EINVAL;
@@ -616,6 +722,7 @@ int32_t pal_stream_set_mute(pal_stream_handle_t *stream_handle, bool state)
         goto exit;
     }
     rm->unlockActiveStream();
+    s->dropAsyncUpdate(true);
     status = s->mute(state);
 
     rm->lockActiveStream();
@@ -632,10 +739,113 @@ exit:
     return status;
 }
 
+int32_t pal_stream_set_volume_async(pal_stream_handle_t *stream_handle,
+                                    struct pal_volume_data *volume,
+                                    uint32_t ramp_period_ms)
+{
+    Stream *s = NULL;
+    int status;
+    std::shared_ptr<ResourceManager> rm = NULL;
+    PAL_API_RECORD(PAL_API_STREAM_SET_VOLUME_ASYNC, stream_handle, status);
+    PAL_API_RECORD_ARG(ramp_period_ms);
+    if (volume)
+        PAL_API_RECORD_BLOB(volume, sizeof(struct pal_volume_data) +
+                            volume->no_of_volpair * sizeof(struct pal_channel_vol_kv));
+    rm = ResourceManager::getInstance();
+    if (!rm) {
+        PAL_ERR(LOG_TAG, "Invalid resource manager");
+        status = -EINVAL;
+        return status;
+    }
+
+    if (!stream_handle || !volume) {
+        status = -EINVAL;
+        PAL_ERR(LOG_TAG,"Invalid input parameters status %d", status);
+        return status;
+    }
+    PAL_VERBOSE(LOG_TAG, "Enter. Stream handle :%pK", stream_handle);
+
+    rm->lockActiveStream();
+    if (!rm->isActiveStream(stream_handle)) {
+        rm->unlockActiveStream();
+        status = -EINVAL;
+        return status;
+    }
+
+    s =  reinterpret_cast<Stream *>(stream_handle);
+    status = rm->increaseStreamUserCounter(s);
+    if (0 != status) {
+        rm->unlockActiveStream();
+        PAL_ERR(LOG_TAG, "failed to increase stream user count");
+        return status;
+    }
+    rm->unlockActiveStream();
+
+    status = s->setVolumeAsync(volume, ramp_period_ms);
+
+    rm->lockActiveStream();
+    rm->decreaseStreamUserCounter(s);
+    rm->unlockActiveStream();
+
+    if (0 != status)
+        PAL_ERR(LOG_TAG, "setVolumeAsync failed with status %d", status);
+    PAL_VERBOSE(LOG_TAG, "Exit. status %d", status);
+    return status;
+}
+
+int32_t pal_stream_set_mute_async(pal_stream_handle_t *stream_handle, bool state)
+{
+    Stream *s = NULL;
+    std::shared_ptr<ResourceManager> rm = NULL;
+    int status = 0;
+    PAL_API_RECORD(PAL_API_STREAM_SET_MUTE_ASYNC, stream_handle, status);
+    PAL_API_RECORD_ARG(state);
+
+    if (!stream_handle) {
+        status = -EINVAL;
+        PAL_ERR(LOG_TAG, "Invalid stream handle status %d", status);
+        return status;
+    }
+
+    rm = ResourceManager::getInstance();
+    if (!rm) {
+        status = -EINVAL;
+        PAL_ERR(LOG_TAG, "Invalid resource manager");
+        return status;
+    }
+
+    rm->lockActiveStream();
+    if (!rm->isActiveStream(stream_handle)) {
+        rm->unlockActiveStream();
+        status = -EINVAL;
+        return status;
+    }
+
+    s =  reinterpret_cast<Stream *>(stream_handle);
+    status = rm->increaseStreamUserCounter(s);
+    if (0 != status) {
+        rm->unlockActiveStream();
+        PAL_ERR(LOG_TAG, "failed to increase stream user count");
+        return status;
+    }
+    rm->unlockActiveStream();
+
+    status = s->setMuteAsync(state);
+
+    rm->lockActiveStream();
+    rm->decreaseStreamUserCounter(s);
+    rm->unlockActiveStream();
+
+    if (0 != status)
+        PAL_ERR(LOG_TAG, "setMuteAsync failed with status %d", status);
+    return status;
+}
+
 int32_t pal_stream_pause(pal_stream_handle_t *stream_handle)
 {
     Stream *s = NULL;
     int status;
+    PAL_API_RECORD(PAL_API_STREAM_PAUSE, stream_handle, status);
 
     if (!stream_handle) {
         status = -EINVAL;
@@ -658,6 +868,7 @@ int32_t pal_stream_resume(pal_stream_handle_t *stream_handle)
 {
     Stream *s = NULL;
     int status;
+    PAL_API_RECORD(PAL_API_STREAM_RESUME, stream_handle, status);
 
     if (!stream_handle) {
         status = -EINVAL;
@@ -683,6 +894,8 @@ int32_t pal_stream_drain(pal_stream_handle_t *stream_handle, pal_drain_type_t ty
     Stream *s = NULL;
     int status;
     std::shared_ptr<ResourceManager> rm = NULL;
+    PAL_API_RECORD(PAL_API_STREAM_DRAIN, stream_handle, status);
+    PAL_API_RECORD_ARG(type);
 
     if (!stream_handle) {
         status = -EINVAL;
@@ -736,6 +949,7 @@ int32_t pal_stream_flush(pal_stream_handle_t *stream_handle)
 {
     Stream *s = NULL;
     int status;
+    PAL_API_RECORD(PAL_API_STREAM_FLUSH, stream_handle, status);
 
     if (!stream_handle) {
         status = -EINVAL;
@@ -760,6 +974,7 @@ int32_t pal_stream_suspend(pal_stream_handle_t *stream_handle)
 {
     Stream *s = NULL;
     int status;
+    PAL_API_RECORD(PAL_API_STREAM_SUSPEND, stream_handle, status);
 
     if (!stream_handle) {
         status = -EINVAL;
@@ -810,6 +1025,7 @@ int32_t pal_get_timestamp(pal_stream_handle_t *stream_handle,
     Stream *s = NULL;
     int status = -EINVAL;
     std::shared_ptr<ResourceManager> rm = NULL;
+    PAL_API_RECORD(PAL_API_GET_TIMESTAMP, stream_handle, status);
     PAL_DBG(LOG_TAG, "Enter. Stream handle :%pK\n", stream_handle);
 
     if (!stream_handle) {
@@ -847,11 +1063,46 @@ int32_t pal_get_timestamp(pal_stream_handle_t *stream_handle,
     return status;
 }
 
+int32_t pal_stream_get_timestamp_drift(pal_stream_handle_t *stream_handle, int32_t *drift_ppm)
+{
+    Stream *s = NULL;
+    int status = -EINVAL;
+    std::shared_ptr<ResourceManager> rm = NULL;
+    PAL_API_RECORD(PAL_API_GET_TIMESTAMP_DRIFT, stream_handle, status);
+
+    if (!stream_handle || !drift_ppm) {
+        PAL_ERR(LOG_TAG, "Invalid input parameters status %d", status);
+        return status;
+    }
+
+    rm = ResourceManager::getInstance();
+    if (!rm) {
+        PAL_ERR(LOG_TAG, "Invalid resource manager");
+        return status;
+    }
+
+    PAL_DBG(LOG_TAG, "Enter. Stream handle :%pK", stream_handle);
+    rm->lockActiveStream();
+    if (rm->isActiveStream(stream_handle)) {
+        s =  reinterpret_cast<Stream *>(stream_handle);
+        status = s->getTimestampDrift(drift_ppm);
+    } else {
+        PAL_ERR(LOG_TAG, "stream handle in stale state.");
+    }
+    rm->unlockActiveStream();
+
+    PAL_DBG(LOG_TAG, "Exit. status %d", status);
+    return status;
+}
+
 int32_t pal_add_remove_effect(pal_stream_handle_t *stream_handle,
                        pal_audio_effect_t effect, bool enable)
 {
     Stream *s = NULL;
     int status = 0;
+    PAL_API_RECORD(PAL_API_ADD_REMOVE_EFFECT, stream_handle, status);
+    PAL_API_RECORD_ARG(effect);
+    PAL_API_RECORD_ARG2(enable);
 
     if (!stream_handle) {
         status = -EINVAL;
@@ -882,6 +1133,10 @@ int32_t pal_stream_set_device(pal_stream_handle_t *stream_handle,
     struct pal_device *pDevices = NULL;
     struct pal_device curPalDevAttr;
     std::vector <std::shared_ptr<Device>> aDevices, palDevices;
+    PAL_API_RECORD(PAL_API_STREAM_SET_DEVICE, stream_handle, status);
+    PAL_API_RECORD_ARG(no_of_devices);
+    if (devices)
+        PAL_API_RECORD_BLOB(devices, no_of_devices * sizeof(*devices));
 
     if (!stream_handle) {
         status = -EINVAL;
@@ -1060,6 +1315,8 @@ int32_t pal_stream_get_tags_with_module_info(pal_stream_handle_t *stream_handle,
 {
     int status = 0;
     Stream *s = NULL;
+    PAL_API_RECORD(PAL_API_GET_TAGS_WITH_MODULE_INFO, stream_handle, status);
+    PAL_API_RECORD_ARG(size ? (uint32_t)*size : 0);
 
     if (!stream_handle) {
         status = -EINVAL;
@@ -1082,6 +1339,10 @@ int32_t pal_set_param(uint32_t param_id, void *param_payload,
     PAL_DBG(LOG_TAG, "Enter: param id %d", param_id);
     int status = 0;
     std::shared_ptr<ResourceManager> rm = NULL;
+    PAL_API_RECORD(PAL_API_SET_PARAM, NULL, status);
+    PAL_API_RECORD_ARG(param_id);
+    if (param_payload)
+        PAL_API_RECORD_BLOB(param_payload, payload_size);
 
     rm = ResourceManager::getInstance();
     if (rm) {
@@ -1103,6 +1364,13 @@ int32_t pal_get_param(uint32_t param_id, void **param_payload,
 {
     int status = 0;
     std::shared_ptr<ResourceManager> rm = NULL;
+    PAL_API_RECORD(PAL_API_GET_PARAM, NULL, status);
+    PAL_API_RECORD_ARG(param_id);
+    if (payload_size) {
+        PAL_API_RECORD_ARG2((uint32_t)*payload_size);
+        if (param_payload && *param_payload && *payload_size)
+            PAL_API_RECORD_BLOB(*param_payload, *payload_size);
+    }
 
     rm = ResourceManager::getInstance();
 
@@ -1127,6 +1395,7 @@ int32_t pal_stream_get_mmap_position(pal_stream_handle_t *stream_handle,
 {
     Stream *s = NULL;
     int status;
+    PAL_API_RECORD(PAL_API_GET_MMAP_POSITION, stream_handle, status);
 
     if (!stream_handle) {
         status = -EINVAL;
@@ -1145,12 +1414,34 @@ int32_t pal_stream_get_mmap_position(pal_stream_handle_t *stream_handle,
     return status;
 }
 
+int32_t pal_dump_state(int fd, pal_dump_format_t format)
+{
+    std::shared_ptr<ResourceManager> rm = NULL;
+    int status = 0;
+    PAL_API_RECORD(PAL_API_DUMP_STATE, NULL, status);
+    PAL_API_RECORD_ARG(format);
+
+    PAL_DBG(LOG_TAG, "Enter. fd %d format %d", fd, format);
+    rm = ResourceManager::getInstance();
+    if (!rm) {
+        PAL_ERR(LOG_TAG, "Pal has not been initialized yet");
+        status = -EINVAL;
+        return status;
+    }
+
+    status = rm->dumpState(fd, format);
+    PAL_DBG(LOG_TAG, "Exit. status %d", status);
+    return status;
+}
+
 int32_t pal_stream_create_mmap_buffer(pal_stream_handle_t *stream_handle,
                               int32_t min_size_frames,
                               struct pal_mmap_buffer *info)
 {
     Stream *s = NULL;
     int status;
+    PAL_API_RECORD(PAL_API_CREATE_MMAP_BUFFER, stream_handle, status);
+    PAL_API_RECORD_ARG(min_size_frames);
 
     if (!stream_handle) {
         status = -EINVAL;
@@ -1172,6 +1463,9 @@ int32_t pal_stream_create_mmap_buffer(pal_stream_handle_t *stream_handle,
 int32_t pal_register_global_callback(pal_global_callback cb, uint64_t cookie)
 {
     std::shared_ptr<ResourceManager> rm = NULL;
+    int status = 0;
+    PAL_API_RECORD(PAL_API_REGISTER_GLOBAL_CALLBACK, NULL, status);
+    PAL_API_RECORD_ARG(cb != NULL);
 
     PAL_DBG(LOG_TAG, "Enter. global callback %pK", cb);
     rm = ResourceManager::getInstance();
@@ -1181,7 +1475,7 @@ int32_t pal_register_global_callback(pal_global_callback cb, uint64_t cookie)
         rm->cookie = cookie;
     }
     PAL_DBG(LOG_TAG, "Exit");
-    return 0;
+    return status;
 }
 
 int32_t pal_gef_rw_param(uint32_t param_id, void *param_payload,
@@ -1190,6 +1484,15 @@ int32_t pal_gef_rw_param(uint32_t param_id, void *param_payload,
 {
     int status = 0;
     std::shared_ptr<ResourceManager> rm = NULL;
+    PAL_API_RECORD(PAL_API_GEF_RW_PARAM, NULL, status);
+    PAL_API_RECORD_ARG(param_id);
+    PAL_API_RECORD_ARG2(dir);
+#ifdef PAL_API_RECORDER
+    uint32_t target[2] = {(uint32_t)pal_device_id, (uint32_t)pal_stream_type};
+    PAL_API_RECORD_BLOB(target, sizeof(target));
+    if (GEF_PARAM_WRITE == dir && param_payload)
+        PAL_API_RECORD_BLOB(param_payload, payload_size);
+#endif
 
     rm = ResourceManager::getInstance();
 
@@ -1227,6 +1530,9 @@ int32_t pal_gef_rw_param_acdb(uint32_t param_id __unused, void *param_payload,
 {
     int status = 0;
     std::shared_ptr<ResourceManager> rm = NULL;
+    PAL_API_RECORD(PAL_API_GEF_RW_PARAM_ACDB, NULL, status);
+    PAL_API_RECORD_ARG(param_id);
+    PAL_API_RECORD_ARG2(dir);
     rm = ResourceManager::getInstance();
 
     PAL_DBG(LOG_TAG, "Enter.");
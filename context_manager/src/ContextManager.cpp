@@ -63,6 +63,7 @@
 #include <iostream>
 #include <chrono>
 #include "ContextManager.h"
+#include "PalThreadPolicy.h"
 #include <asps/asps_acm_api.h>
 #include "apm_api.h"
 
@@ -517,6 +518,7 @@ int32_t ContextManager::StopAndCloseProxyStream()
 
 void ContextManager::CommandThreadRunner(ContextManager& cm)
 {
+    PalThreadScope threadScope(PAL_THREAD_CLASS_EVENT, "ctx_mgr_cmd");
     RequestCommand *request_command;
     int32_t rc = 0;
 
@@ -36,6 +36,8 @@
 #include <bt_ble.h>
 #include <vector>
 #include <mutex>
+#include <map>
+#include <string>
 #include <system/audio.h>
 
 #define DISALLOW_COPY_AND_ASSIGN(name) \
@@ -78,6 +80,16 @@ typedef enum {
     LE_AUDIO_BROADCAST_HARDWARE_OFFLOAD_ENCODING_DATAPATH,
 }tSESSION_TYPE;
 
+#define BT_PLUGIN_PAYLOAD_CACHE_SIZE 8
+
+/* Plugin codec kept open so its packed payload can be reused */
+typedef struct bt_plugin_cache_entry {
+    bt_codec_t        *codec;
+    bt_enc_payload_t  *payload;
+    int               refCnt;
+    uint64_t          lastUsed;
+} bt_plugin_cache_entry_t;
+
 typedef void (*bt_audio_pre_init_t)(void);
 typedef int (*audio_source_open_api_t)(tSESSION_TYPE session_type);
 typedef int (*audio_source_close_api_t)(tSESSION_TYPE session_type);
@@ -128,7 +140,6 @@ protected:
     struct pal_media_config    codecConfig;
     codec_format_t             codecFormat;
     void                       *codecInfo;
-    void                       *pluginHandler;
     bt_codec_t                 *pluginCodec;
     bool                       isAbrEnabled;
     bool                       isConfigured;
@@ -144,9 +155,18 @@ protected:
     std::mutex                 mAbrMutex;
     int                        totalActiveSessionRequests;
 
-    int getPluginPayload(void **handle, bt_codec_t **btCodec,
+    /* Codec plugin registry, shared by all BT devices of the process */
+    static std::mutex                                      pluginMutex;
+    static std::map<std::string, void *>                   pluginLibs;
+    static std::map<std::string, bt_plugin_cache_entry_t>  pluginPayloadCache;
+    static uint64_t                                        pluginCacheTick;
+
+    static void *getPluginLib(const std::string &libPath);
+    bool getPluginCacheKey(codec_type codecType, std::string &key);
+    int getPluginPayload(bt_codec_t **btCodec,
                          bt_enc_payload_t **out_buf,
                          codec_type codecType);
+    static void releasePluginPayload(bt_codec_t *codec);
     int configureA2dpEncoderDecoder();
     int configureNrecParameters(bool isNrecEnabled);
     int updateDeviceMetadata();
@@ -169,6 +189,7 @@ protected:
     static std::shared_ptr<Device> objBleRx;
     static std::shared_ptr<Device> objBleTx;
     static std::shared_ptr<Device> objBleBroadcastRx;
+    static std::mutex mInstanceMutex;
     BtA2dp(struct pal_device *device, std::shared_ptr<ResourceManager> Rm);
     pal_param_bta2dp_t param_bt_a2dp;
 
@@ -257,6 +278,7 @@ class BtSco : public Bluetooth
 protected:
     static std::shared_ptr<Device> objRx;
     static std::shared_ptr<Device> objTx;
+    static std::mutex mInstanceMutex;
     BtSco(struct pal_device *device, std::shared_ptr<ResourceManager> Rm);
     static bool isScoOn;
     static bool isWbSpeechEnabled;
@@ -132,6 +132,7 @@ protected:
     int configureDpEndpoint();
     static std::shared_ptr<Device> objRx;
     static std::shared_ptr<Device> objTx;
+    static std::mutex mInstanceMutex;
     DisplayPort(struct pal_device *device, std::shared_ptr<ResourceManager> Rm);
 public:
     int start();
@@ -40,6 +40,7 @@ class ECRefDevice : public Device
 {
 protected:
     static std::shared_ptr<Device> obj;
+    static std::mutex mInstanceMutex;
     ECRefDevice(struct pal_device *device, std::shared_ptr<ResourceManager> Rm);
 
     struct pal_device mDeviceAttr;
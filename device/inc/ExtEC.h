@@ -37,6 +37,7 @@ class ExtEC : public Device
 {
 protected:
     static std::shared_ptr<Device> obj;
+    static std::mutex mInstanceMutex;
     ExtEC(struct pal_device *device, std::shared_ptr<ResourceManager> Rm);
 public:
     static std::shared_ptr<Device> getInstance(struct pal_device *device,
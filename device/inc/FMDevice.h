@@ -37,6 +37,7 @@ class FMDevice : public Device
 {
 protected:
     static std::shared_ptr<Device> obj;
+    static std::mutex mInstanceMutex;
     FMDevice(struct pal_device *device, std::shared_ptr<ResourceManager> rm) : Device(device, rm) {};
 public:
     static std::shared_ptr<Device> getInstance(struct pal_device*, std::shared_ptr<ResourceManager>);
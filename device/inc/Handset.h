@@ -36,6 +36,7 @@ class Handset : public Device
 {
 protected:
     static std::shared_ptr<Device> obj;
+    static std::mutex mInstanceMutex;
     Handset(struct pal_device *device, std::shared_ptr<ResourceManager> Rm);
 public:
     static std::shared_ptr<Device> getInstance(struct pal_device *device,
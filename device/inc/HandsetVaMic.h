@@ -36,6 +36,7 @@
 class HandsetVaMic : public Device {
 protected:
     static std::shared_ptr<Device> obj;
+    static std::mutex mInstanceMutex;
     HandsetVaMic(struct pal_device *device,
         std::shared_ptr<ResourceManager> Rm);
 public:
@@ -36,6 +36,7 @@
 class HeadsetVaMic : public Device {
 protected:
     static std::shared_ptr<Device> obj;
+    static std::mutex mInstanceMutex;
     HeadsetVaMic(struct pal_device *device,
         std::shared_ptr<ResourceManager> Rm);
 public:
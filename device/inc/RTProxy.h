@@ -37,6 +37,7 @@ class RTProxy : public Device
 {
 protected:
     static std::shared_ptr<Device> obj;
+    static std::mutex mInstanceMutex;
     RTProxy(struct pal_device *device, std::shared_ptr<ResourceManager> Rm);
 	struct pal_device mDeviceAttr;
     std::shared_ptr<ResourceManager> rm;
@@ -55,6 +56,7 @@ class RTProxyOut : public Device
 {
     protected:
         static std::shared_ptr<Device> obj;
+        static std::mutex mInstanceMutex;
         RTProxyOut(struct pal_device *device, std::shared_ptr<ResourceManager> Rm);
         struct pal_device mDeviceAttr;
         std::shared_ptr<ResourceManager> rm;
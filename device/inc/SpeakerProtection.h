@@ -86,6 +86,27 @@ class Device;
 #define WSA2_REGISTER_ADD 1
 #define WSA_REGISTER_ADD 0
 
+#define SP_CAL_RECORD_MAGIC 0x4C414353 /* "SCAL" */
+#define SP_CAL_RECORD_VERSION 1
+/* one cal file per VI module, each covering up to two speakers */
+#define SP_CAL_RECORD_MAX_CH 2
+
+/*
+ * Content of a speaker calibration file. Files without the magic are the
+ * older raw R0/T0 dumps, their values are still used but they never count
+ * as a valid calibration.
+ */
+struct sp_cal_record {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_ch;
+    int32_t dev_num[SP_CAL_RECORD_MAX_CH];     /* WSA device numbers, <= 0 if unknown */
+    int64_t cal_time;                          /* CLOCK_REALTIME seconds */
+    int32_t r0_cali_q24[SP_CAL_RECORD_MAX_CH];
+    int16_t t0_cali_q6[SP_CAL_RECORD_MAX_CH];
+    uint32_t checksum;                         /* over everything above */
+};
+
 typedef enum speaker_prot_cal_state {
     SPKR_NOT_CALIBRATED,     /* Speaker not calibrated  */
     SPKR_CALIBRATED,         /* Speaker calibrated  */
@@ -135,6 +156,9 @@ protected :
     static bool calThrdCreated;
     static bool isDynamicCalTriggered;
     static struct timespec spkrLastTimeUsed;
+    static int calTimer;
+    static bool calDue;
+    static uint32_t calIdleMs;
     static struct mixer *virtMixer;
     static struct mixer *hwMixer;
     static struct pcm *rxPcm;
@@ -146,6 +170,7 @@ protected :
     static uint32_t source_miid, vi_miid_I, vi_miid_II;
     static bool mDspCallbackRcvd;
     static param_id_sp_th_vi_calib_res_cfg_t *callback_data;
+    std::vector<struct mixer_ctl *> spkrTempCtls;
     struct pal_device mDeviceAttr;
     std::vector<int> pcmDevIdTx;
     std::vector<int> pcmDevIdCPS;
@@ -162,12 +187,16 @@ public:
     static std::thread XmaxTmaxLogThread;
     static std::condition_variable cv;
     static std::mutex cvMutex;
+    static std::condition_variable calCv;
     std::mutex deviceMutex;
     static std::mutex calibrationMutex;
     void spkrCalibrationThread();
     void startSpkrXmaxTmaxLogging();
+    struct mixer_ctl *getSpeakerTempCtl(int spkr_pos);
     int getSpeakerTemperature(int spkr_pos);
     void spkrCalibrateWait();
+    static void spkrScheduleCalibration(uint32_t delayMs);
+    static void spkrCancelCalibration();
     int spkrStartCalibration();
     void speakerProtectionInit();
     void speakerProtectionDeinit();
@@ -175,6 +204,12 @@ public:
     static void spkrProtSetSpkrStatus(bool enable);
     static int setConfig(int type, int tag, int tagValue, int devId, const char *aif);
     bool isSpeakerInUse(unsigned long *sec);
+    static int readCalRecord(const char *path, struct sp_cal_record *rec);
+    static int readCalibration(const char *path, struct vi_r0t0_cfg_t *r0t0, int numCh);
+    int writeCalRecord(const char *path, bool secondModule, const int32_t *r0Q24,
+                       const int *t0Q6, int numCh);
+    void getSpkrDevNums(bool secondModule, int32_t *devNum);
+    bool isCalRecordValid(const char *path, bool secondModule, int tempIndex);
 
     SpeakerProtection(struct pal_device *device,
                       std::shared_ptr<ResourceManager> Rm);
@@ -206,6 +241,7 @@ class SpeakerFeedback : public Device
     protected :
     struct pal_device mDeviceAttr;
     static std::shared_ptr<Device> obj;
+    static std::mutex mInstanceMutex;
     static int numSpeaker;
     public :
     int32_t start();
@@ -72,6 +72,9 @@
 #include <vector>
 #include <system/audio.h>
 #include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
 
 #define USB_BUFF_SIZE           4096
 #define CHANNEL_NUMBER_STR      "Channels: "
@@ -96,12 +99,49 @@ typedef enum usb_usecase_type{
     USB_PLAYBACK,
 } usb_usecase_type_t;
 
+/* Capabilities of one direction of a card, built once after parsing */
+typedef struct usb_capability_table {
+    bool valid;
+    uint32_t num_formats;
+    uint32_t format[MAX_SUPPORTED_FORMATS + 1];
+    uint32_t num_sample_rates;
+    uint32_t sample_rate[MAX_SUPPORTED_SAMPLE_RATES + 1];
+    uint32_t channel_mask;
+    uint32_t max_channels;
+    uint32_t max_bit_width;
+} usb_capability_table_t;
+
+/* Inputs of readBestConfig which determine the selected config */
+typedef struct usb_best_config_key {
+    bool is_playback;
+    bool uhqa;
+    uint32_t target_bit_width;
+    uint32_t target_sample_rate;
+    uint32_t requested_sample_rate;
+    uint32_t requested_channels;
+    bool operator<(const usb_best_config_key &rhs) const {
+        return std::tie(is_playback, uhqa, target_bit_width, target_sample_rate,
+                        requested_sample_rate, requested_channels) <
+               std::tie(rhs.is_playback, rhs.uhqa, rhs.target_bit_width,
+                        rhs.target_sample_rate, rhs.requested_sample_rate,
+                        rhs.requested_channels);
+    }
+} usb_best_config_key_t;
+
+typedef struct usb_best_config {
+    uint32_t bit_width;
+    uint32_t sample_rate;
+    bool ch_info_valid;
+    struct pal_channel_info ch_info;
+} usb_best_config_t;
+
 // one card supports multiple devices
 class USBDeviceConfig {
 protected:
     unsigned int bit_width_;
     unsigned int channels_;
     std::vector <unsigned int> rates_;
+    std::vector <unsigned int> sorted_rates_;
     unsigned long service_interval_us_;
     usb_usecase_type_t type_;
     unsigned int supported_sample_rates_mask_[2] = {0};
@@ -137,7 +177,15 @@ protected:
     std::multimap<uint32_t, std::shared_ptr<USBDeviceConfig>> format_list_map;
     std::vector <std::shared_ptr<USBDeviceConfig>> usb_device_config_list_;
     unsigned int usb_supported_sample_rates_mask_[2] = {0};
+    usb_capability_table_t cap_table_[2] = {};
+    std::map<usb_best_config_key_t, usb_best_config_t> best_config_cache_;
+    std::mutex best_config_mutex_;
+    static std::map<std::pair<int, int>, std::string> stream_desc_cache_;
+    static std::mutex stream_desc_mutex_;
     void usb_info_dump(char* read_buf, int type);
+    static int readStreamDescriptor(struct pal_usb_device_address addr,
+                                    std::string &desc);
+    void buildCapabilityTable(usb_usecase_type_t type);
 public:
     USBCardConfig(struct pal_usb_device_address address);
     bool isConfigCached(struct pal_usb_device_address addr);
@@ -161,6 +209,7 @@ public:
     bool isCaptureProfileSupported();
     bool readDefaultJackStatus(bool is_playback);
     bool getJackConnectionStatus (int usb_card, const char* suffix);
+    static void invalidateStreamDescriptor(struct pal_usb_device_address addr);
 };
 
 class USB : public Device
@@ -168,6 +217,7 @@ class USB : public Device
 protected:
     static std::shared_ptr<Device> objRx;
     static std::shared_ptr<Device> objTx;
+    static std::mutex mInstanceMutex;
     std::vector <std::shared_ptr<USBCardConfig>> usb_card_config_list_;
     int configureUsb();
     USB(struct pal_device *device, std::shared_ptr<ResourceManager> Rm);
@@ -38,6 +38,7 @@ class UltrasoundDevice : public Device
 protected:
     static std::shared_ptr<Device> objRx;
     static std::shared_ptr<Device> objTx;
+    static std::mutex mInstanceMutex;
     UltrasoundDevice(struct pal_device *device, std::shared_ptr<ResourceManager> Rm);
 public:
     static std::shared_ptr<Device> getInstance(struct pal_device *device,
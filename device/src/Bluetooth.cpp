@@ -29,6 +29,8 @@
 
 #define LOG_TAG "PAL: Bluetooth"
 #include "Bluetooth.h"
+#include "bt_aptx.h"
+#include "bt_bundle.h"
 #include "ResourceManager.h"
 #include "PayloadBuilder.h"
 #include "Stream.h"
@@ -135,14 +137,141 @@ bool Bluetooth::isPlaceholderEncoder()
     }
 }
 
-int Bluetooth::getPluginPayload(void **libHandle, bt_codec_t **btCodec,
+std::mutex Bluetooth::pluginMutex;
+std::map<std::string, void *> Bluetooth::pluginLibs;
+std::map<std::string, bt_plugin_cache_entry_t> Bluetooth::pluginPayloadCache;
+uint64_t Bluetooth::pluginCacheTick = 0;
+
+/* called with pluginMutex held, libraries stay loaded for process lifetime */
+void *Bluetooth::getPluginLib(const std::string &libPath)
+{
+    void *handle = NULL;
+    auto it = pluginLibs.find(libPath);
+
+    if (it != pluginLibs.end())
+        return it->second;
+
+    handle = dlopen(libPath.c_str(), RTLD_NOW);
+    if (handle == NULL) {
+        PAL_ERR(LOG_TAG, "failed to dlopen lib %s", libPath.c_str());
+        return NULL;
+    }
+    pluginLibs[libPath] = handle;
+    PAL_INFO(LOG_TAG, "loaded BT codec lib %s", libPath.c_str());
+
+    return handle;
+}
+
+/*
+ * Serialize the codec config which determines the packed payload.
+ * Pointer members are replaced by the data they point to. Returns
+ * false for configs whose layout is not known here, those payloads
+ * are packed on every configure.
+ */
+bool Bluetooth::getPluginCacheKey(codec_type type, std::string &key)
+{
+    if (!codecInfo)
+        return false;
+
+    key.assign((const char *)&codecFormat, sizeof(codecFormat));
+    key.append((const char *)&type, sizeof(type));
+
+    switch (codecFormat) {
+    case CODEC_TYPE_LC3:
+    case CODEC_TYPE_APTX_AD_QLEA:
+    {
+        audio_lc3_codec_cfg_t cfg = *(audio_lc3_codec_cfg_t *)codecInfo;
+        lc3_stream_map_t *mapOut = cfg.enc_cfg.streamMapOut;
+        lc3_stream_map_t *mapIn = cfg.dec_cfg.streamMapIn;
+
+        cfg.enc_cfg.streamMapOut = NULL;
+        cfg.dec_cfg.streamMapIn = NULL;
+        key.append((const char *)&cfg, sizeof(cfg));
+        if (mapOut)
+            key.append((const char *)mapOut,
+                       cfg.enc_cfg.stream_map_size * sizeof(lc3_stream_map_t));
+        if (mapIn)
+            key.append((const char *)mapIn,
+                       cfg.dec_cfg.stream_map_size * sizeof(lc3_stream_map_t));
+        return true;
+    }
+    case CODEC_TYPE_APTX_AD_SPEECH:
+        key.append((const char *)codecInfo, sizeof(int));
+        return true;
+    default:
+        break;
+    }
+
+    /* A2DP sink decoder configs are opaque to PAL */
+    if (type != ENC)
+        return false;
+
+    switch (codecFormat) {
+    case CODEC_TYPE_SBC:
+        key.append((const char *)codecInfo, sizeof(audio_sbc_encoder_config_t));
+        return true;
+    case CODEC_TYPE_CELT:
+        key.append((const char *)codecInfo, sizeof(audio_celt_encoder_config_t));
+        return true;
+    case CODEC_TYPE_LDAC:
+        key.append((const char *)codecInfo, sizeof(audio_ldac_encoder_config_t));
+        return true;
+    case CODEC_TYPE_APTX:
+        key.append((const char *)codecInfo, sizeof(audio_aptx_encoder_config_t));
+        return true;
+    case CODEC_TYPE_APTX_HD:
+        key.append((const char *)codecInfo, sizeof(audio_aptx_hd_encoder_config_t));
+        return true;
+    case CODEC_TYPE_APTX_DUAL_MONO:
+        key.append((const char *)codecInfo, sizeof(audio_aptx_dual_mono_config_t));
+        return true;
+    case CODEC_TYPE_APTX_AD:
+        key.append((const char *)codecInfo, sizeof(audio_aptx_ad_encoder_config_t));
+        return true;
+    case CODEC_TYPE_AAC:
+    {
+        audio_aac_encoder_config_t cfg = *(audio_aac_encoder_config_t *)codecInfo;
+        struct aac_frame_size_control_t *frameCtl = cfg.frame_ctl_ptr;
+        struct aac_abr_control_t *abrCtl = cfg.abr_ctl_ptr;
+
+        cfg.frame_ctl_ptr = NULL;
+        cfg.abr_ctl_ptr = NULL;
+        key.append((const char *)&cfg, sizeof(cfg));
+        if (frameCtl)
+            key.append((const char *)frameCtl, sizeof(*frameCtl));
+        if (abrCtl)
+            key.append((const char *)abrCtl, sizeof(*abrCtl));
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+int Bluetooth::getPluginPayload(bt_codec_t **btCodec,
               bt_enc_payload_t **out_buf, codec_type codecType)
 {
     std::string lib_path;
+    std::string cacheKey;
     open_fn_t plugin_open_fn = NULL;
     int status = 0;
     bt_codec_t *codec = NULL;
     void *handle = NULL;
+    bool cacheable = false;
+    std::lock_guard<std::mutex> lock(pluginMutex);
+
+    cacheable = getPluginCacheKey(codecType, cacheKey);
+    if (cacheable) {
+        auto it = pluginPayloadCache.find(cacheKey);
+        if (it != pluginPayloadCache.end()) {
+            it->second.refCnt++;
+            it->second.lastUsed = ++pluginCacheTick;
+            *btCodec = it->second.codec;
+            *out_buf = it->second.payload;
+            PAL_DBG(LOG_TAG, "reuse packed payload of codec format %x", codecFormat);
+            return 0;
+        }
+    }
 
     lib_path = rm->getBtCodecLib(codecFormat, (codecType == ENC ? "enc" : "dec"));
     if (lib_path.empty()) {
@@ -150,43 +279,77 @@ int Bluetooth::getPluginPayload(void **libHandle, bt_codec_t **btCodec,
         return -ENOSYS;
     }
 
-    handle = dlopen(lib_path.c_str(), RTLD_NOW);
-    if (handle == NULL) {
-        PAL_ERR(LOG_TAG, "failed to dlopen lib %s", lib_path.c_str());
+    handle = getPluginLib(lib_path);
+    if (handle == NULL)
         return -EINVAL;
-    }
 
     dlerror();
     plugin_open_fn = (open_fn_t)dlsym(handle, "plugin_open");
     if (!plugin_open_fn) {
         PAL_ERR(LOG_TAG, "dlsym to open fn failed, err = '%s'", dlerror());
-        status = -EINVAL;
-        goto error;
+        return -EINVAL;
     }
 
     status = plugin_open_fn(&codec, codecFormat, codecType);
     if (status) {
         PAL_ERR(LOG_TAG, "failed to open plugin %d", status);
-        goto error;
+        return status;
     }
 
     status = codec->plugin_populate_payload(codec, codecInfo, (void **)out_buf);
     if (status != 0) {
         PAL_ERR(LOG_TAG, "fail to pack the encoder config %d", status);
-        goto error;
+        codec->close_plugin(codec);
+        return status;
     }
     *btCodec = codec;
-    *libHandle = handle;
-    goto done;
 
-error:
-    if (codec)
-        codec->close_plugin(codec);
+    if (!cacheable)
+        return 0;
 
-    if (handle)
-        dlclose(handle);
-done:
-    return status;
+    /* make room by dropping the least recently used idle payload */
+    if (pluginPayloadCache.size() >= BT_PLUGIN_PAYLOAD_CACHE_SIZE) {
+        auto victim = pluginPayloadCache.end();
+        for (auto it = pluginPayloadCache.begin(); it != pluginPayloadCache.end(); it++) {
+            if (it->second.refCnt == 0 &&
+                (victim == pluginPayloadCache.end() ||
+                 it->second.lastUsed < victim->second.lastUsed))
+                victim = it;
+        }
+        if (victim == pluginPayloadCache.end()) {
+            PAL_DBG(LOG_TAG, "payload cache full, codec format %x not cached",
+                    codecFormat);
+            return 0;
+        }
+        victim->second.codec->close_plugin(victim->second.codec);
+        pluginPayloadCache.erase(victim);
+    }
+
+    bt_plugin_cache_entry_t entry;
+    entry.codec = codec;
+    entry.payload = *out_buf;
+    entry.refCnt = 1;
+    entry.lastUsed = ++pluginCacheTick;
+    pluginPayloadCache[cacheKey] = entry;
+
+    return 0;
+}
+
+void Bluetooth::releasePluginPayload(bt_codec_t *codec)
+{
+    std::lock_guard<std::mutex> lock(pluginMutex);
+
+    if (!codec)
+        return;
+
+    for (auto it = pluginPayloadCache.begin(); it != pluginPayloadCache.end(); it++) {
+        if (it->second.codec == codec) {
+            if (it->second.refCnt > 0)
+                it->second.refCnt--;
+            return;
+        }
+    }
+    codec->close_plugin(codec);
 }
 
 int Bluetooth::configureA2dpEncoderDecoder()
@@ -226,7 +389,11 @@ int Bluetooth::configureA2dpEncoderDecoder()
     /* Retrieve plugin library from resource manager.
      * Map to interested symbols.
      */
-    status = getPluginPayload(&pluginHandler, &pluginCodec, &out_buf, codecType);
+    if (pluginCodec) {
+        releasePluginPayload(pluginCodec);
+        pluginCodec = NULL;
+    }
+    status = getPluginPayload(&pluginCodec, &out_buf, codecType);
     if (status) {
         PAL_ERR(LOG_TAG, "failed to payload from plugin");
         goto error;
@@ -663,7 +830,6 @@ void Bluetooth::startAbr()
     std::ostringstream disconnectCtrlName;
     unsigned int flags;
     uint32_t codecTagId = 0, miid = 0;
-    void *pluginLibHandle = NULL;
     bt_codec_t *codec = NULL;
     bt_enc_payload_t *out_buf = NULL;
     custom_block_t *blk = NULL;
@@ -814,7 +980,7 @@ void Bluetooth::startAbr()
             goto disconnect_fe;
         }
 
-        ret = getPluginPayload(&pluginLibHandle, &codec, &out_buf, (codecType == DEC ? ENC : DEC));
+        ret = getPluginPayload(&codec, &out_buf, (codecType == DEC ? ENC : DEC));
         if (ret) {
             PAL_ERR(LOG_TAG, "getPluginPayload failed");
             goto disconnect_fe;
@@ -834,8 +1000,8 @@ void Bluetooth::startAbr()
         builder->payloadCustomParam(&paramData, &paramSize,
                   (uint32_t *)blk->payload, blk->payload_sz, miid, blk->param_id);
 
-        codec->close_plugin(codec);
-        dlclose(pluginLibHandle);
+        releasePluginPayload(codec);
+        codec = NULL;
 
         if (!paramData) {
             PAL_ERR(LOG_TAG, "Failed to populateAPMHeader");
@@ -926,7 +1092,7 @@ void Bluetooth::startAbr()
             }
 
             if (isEncDecConfigured) {
-                ret = getPluginPayload(&pluginLibHandle, &codec, &out_buf,
+                ret = getPluginPayload(&codec, &out_buf,
                                       (codecType == DEC ? ENC : DEC));
                 if (ret) {
                     PAL_ERR(LOG_TAG, "getPluginPayload failed");
@@ -941,7 +1107,7 @@ void Bluetooth::startAbr()
                 memcpy(&bt_ble_codec->enc_cfg.toAirConfig, &bt_ble_codec->dec_cfg.fromAirConfig,
                        sizeof(lc3_cfg_t));
 
-                ret = getPluginPayload(&pluginLibHandle, &codec, &out_buf,
+                ret = getPluginPayload(&codec, &out_buf,
                                        (codecType == DEC ? ENC : DEC));
                 if (ret) {
                     PAL_ERR(LOG_TAG, "getPluginPayload failed");
@@ -972,8 +1138,8 @@ void Bluetooth::startAbr()
                 goto disconnect_fe;
             }
 
-            codec->close_plugin(codec);
-            dlclose(pluginLibHandle);
+            releasePluginPayload(codec);
+            codec = NULL;
 
             if (fbDevice.id == PAL_DEVICE_IN_BLUETOOTH_SCO_HEADSET) {
                 /* COP v2 DEPACKETIZER Module Configuration */
@@ -1165,6 +1331,8 @@ free_fe:
     rm->freeFrontEndIds(fbpcmDevIds, sAttr, dir);
     fbpcmDevIds.clear();
 done:
+    if (codec)
+        releasePluginPayload(codec);
     if (isDeviceLocked) {
         isDeviceLocked = false;
         fbDev->unlockDeviceMutex();
@@ -1293,6 +1461,7 @@ std::shared_ptr<Device> BtA2dp::objTx = nullptr;
 std::shared_ptr<Device> BtA2dp::objBleRx = nullptr;
 std::shared_ptr<Device> BtA2dp::objBleTx = nullptr;
 std::shared_ptr<Device> BtA2dp::objBleBroadcastRx = nullptr;
+std::mutex BtA2dp::mInstanceMutex;
 void *BtA2dp::bt_lib_source_handle = nullptr;
 void *BtA2dp::bt_lib_sink_handle = nullptr;
 bt_audio_pre_init_t BtA2dp::bt_audio_pre_init = nullptr;
@@ -1338,7 +1507,6 @@ BtA2dp::BtA2dp(struct pal_device *device, std::shared_ptr<ResourceManager> Rm)
 {
     a2dpRole = ((device->id == PAL_DEVICE_IN_BLUETOOTH_A2DP) || (device->id == PAL_DEVICE_IN_BLUETOOTH_BLE)) ? SINK : SOURCE;
     codecType = ((device->id == PAL_DEVICE_IN_BLUETOOTH_A2DP) || (device->id == PAL_DEVICE_IN_BLUETOOTH_BLE)) ? DEC : ENC;
-    pluginHandler = NULL;
     pluginCodec = NULL;
 
     param_bt_a2dp.reconfig = false;
@@ -1871,13 +2039,9 @@ int BtA2dp::stopPlayback()
         }
 
         if (pluginCodec) {
-            pluginCodec->close_plugin(pluginCodec);
+            releasePluginPayload(pluginCodec);
             pluginCodec = NULL;
         }
-        if (pluginHandler) {
-            dlclose(pluginHandler);
-            pluginHandler = NULL;
-        }
     }
 
     PAL_DBG(LOG_TAG, "Stop A2DP playback, total active sessions :%d",
@@ -2061,13 +2225,9 @@ int BtA2dp::stopCapture()
             a2dpState = A2DP_STATE_STOPPED;
 
         if (pluginCodec) {
-            pluginCodec->close_plugin(pluginCodec);
+            releasePluginPayload(pluginCodec);
             pluginCodec = NULL;
         }
-        if (pluginHandler) {
-            dlclose(pluginHandler);
-            pluginHandler = NULL;
-        }
     }
     PAL_DBG(LOG_TAG, "Stop A2DP capture, total active sessions :%d",
             totalActiveSessionRequests);
@@ -2342,6 +2502,8 @@ std::shared_ptr<Device> BtA2dp::getObject(pal_device_id_t id)
 std::shared_ptr<Device>
 BtA2dp::getInstance(struct pal_device *device, std::shared_ptr<ResourceManager> Rm)
 {
+    std::lock_guard<std::mutex> lock(mInstanceMutex);
+
     if (device->id == PAL_DEVICE_OUT_BLUETOOTH_A2DP) {
         if (!objRx) {
             PAL_INFO(LOG_TAG, "creating instance for  %d", device->id);
@@ -2384,6 +2546,7 @@ BtA2dp::getInstance(struct pal_device *device, std::shared_ptr<ResourceManager>
 // definition of static BtSco member variables
 std::shared_ptr<Device> BtSco::objRx = nullptr;
 std::shared_ptr<Device> BtSco::objTx = nullptr;
+std::mutex BtSco::mInstanceMutex;
 bool BtSco::isScoOn = false;
 bool BtSco::isWbSpeechEnabled = false;
 int  BtSco::swbSpeechMode = SPEECH_MODE_INVALID;
@@ -2395,7 +2558,6 @@ BtSco::BtSco(struct pal_device *device, std::shared_ptr<ResourceManager> Rm)
     : Bluetooth(device, Rm)
 {
     codecType = (device->id == PAL_DEVICE_OUT_BLUETOOTH_SCO) ? ENC : DEC;
-    pluginHandler = NULL;
     pluginCodec = NULL;
 }
 
@@ -2668,13 +2830,9 @@ int BtSco::stop()
         stopAbr();
 
     if (pluginCodec) {
-        pluginCodec->close_plugin(pluginCodec);
+        releasePluginPayload(pluginCodec);
         pluginCodec = NULL;
     }
-    if (pluginHandler) {
-        dlclose(pluginHandler);
-        pluginHandler = NULL;
-    }
 
     Device::stop_l();
     if (isAbrEnabled == false)
@@ -2697,6 +2855,8 @@ std::shared_ptr<Device> BtSco::getObject(pal_device_id_t id)
 std::shared_ptr<Device> BtSco::getInstance(struct pal_device *device,
                                            std::shared_ptr<ResourceManager> Rm)
 {
+    std::lock_guard<std::mutex> lock(mInstanceMutex);
+
     if (device->id == PAL_DEVICE_OUT_BLUETOOTH_SCO) {
         if (!objRx) {
             std::shared_ptr<Device> sp(new BtSco(device, Rm));
@@ -67,10 +67,13 @@ static struct extDispState {
 
 std::shared_ptr<Device> DisplayPort::objRx = nullptr;
 std::shared_ptr<Device> DisplayPort::objTx = nullptr;
+std::mutex DisplayPort::mInstanceMutex;
 
 std::shared_ptr<Device> DisplayPort::getInstance(struct pal_device *device,
                                              std::shared_ptr<ResourceManager> Rm)
 {
+    std::lock_guard<std::mutex> lock(mInstanceMutex);
+
     if (!device)
        return NULL;
 
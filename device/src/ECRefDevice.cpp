@@ -42,6 +42,7 @@
 
 
 std::shared_ptr<Device> ECRefDevice::obj = nullptr;
+std::mutex ECRefDevice::mInstanceMutex;
 
 std::shared_ptr<Device> ECRefDevice::getObject()
 {
@@ -51,6 +52,8 @@ std::shared_ptr<Device> ECRefDevice::getObject()
 std::shared_ptr<Device> ECRefDevice::getInstance(struct pal_device *device,
                                              std::shared_ptr<ResourceManager> Rm)
 {
+    std::lock_guard<std::mutex> lock(mInstanceMutex);
+
     if (!obj) {
         std::shared_ptr<Device> sp(new ECRefDevice(device, Rm));
         obj = sp;
@@ -34,6 +34,7 @@
 #include "kvh2xml.h"
 
 std::shared_ptr<Device> ExtEC::obj = nullptr;
+std::mutex ExtEC::mInstanceMutex;
 
 std::shared_ptr<Device> ExtEC::getObject()
 {
@@ -44,6 +45,8 @@ std::shared_ptr<Device> ExtEC::getObject()
 std::shared_ptr<Device> ExtEC::getInstance(struct pal_device *device,
                                              std::shared_ptr<ResourceManager> Rm)
 {
+    std::lock_guard<std::mutex> lock(mInstanceMutex);
+
     if (!obj) {
 
         std::shared_ptr<Device> sp(new ExtEC(device, Rm));
@@ -69,6 +69,7 @@
 #include "SpeakerProtection.h"
 
 std::shared_ptr<Device> Handset::obj = nullptr;
+std::mutex Handset::mInstanceMutex;
 
 std::shared_ptr<Device> Handset::getObject()
 {
@@ -78,6 +79,8 @@ std::shared_ptr<Device> Handset::getObject()
 std::shared_ptr<Device> Handset::getInstance(struct pal_device *device,
                                              std::shared_ptr<ResourceManager> Rm)
 {
+    std::lock_guard<std::mutex> lock(mInstanceMutex);
+
     if (!obj) {
         if (ResourceManager::isHandsetProtectionEnabled &&
                             ResourceManager::isSpeakerProtectionEnabled) {
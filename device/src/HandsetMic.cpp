@@ -37,6 +37,7 @@
 #include "kvh2xml.h"
 
 std::shared_ptr<Device> HandsetMic::obj = nullptr;
+std::mutex HandsetMic::mInstanceMutex;
 
 std::shared_ptr<Device> HandsetMic::getObject()
 {
@@ -46,6 +47,8 @@ std::shared_ptr<Device> HandsetMic::getObject()
 std::shared_ptr<Device> HandsetMic::getInstance(struct pal_device *device,
                                                 std::shared_ptr<ResourceManager> Rm)
 {
+    std::lock_guard<std::mutex> lock(mInstanceMutex);
+
     if (!obj) {
         std::shared_ptr<Device> sp(new HandsetMic(device, Rm));
         obj = sp;
@@ -37,6 +37,7 @@
 #include "kvh2xml.h"
 
 std::shared_ptr<Device> HandsetVaMic::obj = nullptr;
+std::mutex HandsetVaMic::mInstanceMutex;
 
 std::shared_ptr<Device> HandsetVaMic::getObject()
 {
@@ -46,6 +47,8 @@ std::shared_ptr<Device> HandsetVaMic::getObject()
 std::shared_ptr<Device> HandsetVaMic::getInstance(struct pal_device *device,
     std::shared_ptr<ResourceManager> Rm)
 {
+    std::lock_guard<std::mutex> lock(mInstanceMutex);
+
     if (!obj) {
         std::shared_ptr<Device> sp(new HandsetVaMic(device, Rm));
         obj = sp;
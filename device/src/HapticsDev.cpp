@@ -34,6 +34,7 @@
 #include "kvh2xml.h"
 
 std::shared_ptr<Device> HapticsDev::obj = nullptr;
+std::mutex HapticsDev::mInstanceMutex;
 
 std::shared_ptr<Device> HapticsDev::getObject()
 {
@@ -43,6 +44,8 @@ std::shared_ptr<Device> HapticsDev::getObject()
 std::shared_ptr<Device> HapticsDev::getInstance(struct pal_device *device,
                                              std::shared_ptr<ResourceManager> Rm)
 {
+    std::lock_guard<std::mutex> lock(mInstanceMutex);
+
     if (!obj) {
         std::shared_ptr<Device> sp(new HapticsDev(device, Rm));
         obj = sp;
@@ -34,10 +34,13 @@
 #include "kvh2xml.h"
 
 std::shared_ptr<Device> Headphone::obj = nullptr;
+std::mutex Headphone::mInstanceMutex;
 
 std::shared_ptr<Device> Headphone::getInstance(struct pal_device *device,
                                              std::shared_ptr<ResourceManager> Rm)
 {
+    std::lock_guard<std::mutex> lock(mInstanceMutex);
+
     if (!obj) {
         std::shared_ptr<Device> sp(new Headphone(device, Rm));
         obj = sp;
@@ -37,6 +37,7 @@
 #include "kvh2xml.h"
 
 std::shared_ptr<Device> HeadsetMic::obj = nullptr;
+std::mutex HeadsetMic::mInstanceMutex;
 
 std::shared_ptr<Device> HeadsetMic::getObject()
 {
@@ -46,6 +47,8 @@ std::shared_ptr<Device> HeadsetMic::getObject()
 std::shared_ptr<Device> HeadsetMic::getInstance(struct pal_device *device,
                                                 std::shared_ptr<ResourceManager> Rm)
 {
+    std::lock_guard<std::mutex> lock(mInstanceMutex);
+
     if (!obj) {
         std::shared_ptr<Device> sp(new HeadsetMic(device, Rm));
         obj = sp;
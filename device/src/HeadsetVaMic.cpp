@@ -37,6 +37,7 @@
 #include "kvh2xml.h"
 
 std::shared_ptr<Device> HeadsetVaMic::obj = nullptr;
+std::mutex HeadsetVaMic::mInstanceMutex;
 
 std::shared_ptr<Device> HeadsetVaMic::getObject()
 {
@@ -46,6 +47,8 @@ std::shared_ptr<Device> HeadsetVaMic::getObject()
 std::shared_ptr<Device> HeadsetVaMic::getInstance(struct pal_device *device,
     std::shared_ptr<ResourceManager> Rm)
 {
+    std::lock_guard<std::mutex> lock(mInstanceMutex);
+
     if (!obj) {
         std::shared_ptr<Device> sp(new HeadsetVaMic(device, Rm));
         obj = sp;
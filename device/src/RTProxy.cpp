@@ -39,6 +39,7 @@
 #include "Session.h"
 
 std::shared_ptr<Device> RTProxy::obj = nullptr;
+std::mutex RTProxy::mInstanceMutex;
 
 std::shared_ptr<Device> RTProxy::getObject()
 {
@@ -49,6 +50,8 @@ std::shared_ptr<Device> RTProxy::getObject()
 std::shared_ptr<Device> RTProxy::getInstance(struct pal_device *device,
                                              std::shared_ptr<ResourceManager> Rm)
 {
+    std::lock_guard<std::mutex> lock(mInstanceMutex);
+
     if (!obj) {
         std::shared_ptr<Device> sp(new RTProxy(device, Rm));
         obj = sp;
@@ -157,10 +160,13 @@ error:
 }
 
 std::shared_ptr<Device> RTProxyOut::obj = nullptr;
+std::mutex RTProxyOut::mInstanceMutex;
 
 std::shared_ptr<Device> RTProxyOut::getInstance(struct pal_device *device,
                                                      std::shared_ptr<ResourceManager> Rm)
 {
+    std::lock_guard<std::mutex> lock(mInstanceMutex);
+
     if (!obj) {
         std::shared_ptr<Device> sp(new RTProxyOut(device, Rm));
         obj = sp;
@@ -35,6 +35,7 @@
 #include "kvh2xml.h"
 
 std::shared_ptr<Device> Speaker::obj = nullptr;
+std::mutex Speaker::mInstanceMutex;
 
 std::shared_ptr<Device> Speaker::getObject()
 {
@@ -45,6 +46,8 @@ std::shared_ptr<Device> Speaker::getObject()
 std::shared_ptr<Device> Speaker::getInstance(struct pal_device *device,
                                              std::shared_ptr<ResourceManager> Rm)
 {
+    std::lock_guard<std::mutex> lock(mInstanceMutex);
+
     if (!obj) {
         if (ResourceManager::isSpeakerProtectionEnabled) {
             std::shared_ptr<Device> sp(new SpeakerProtection(device, Rm));
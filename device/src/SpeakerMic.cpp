@@ -37,6 +37,7 @@
 #include "kvh2xml.h"
 
 std::shared_ptr<Device> SpeakerMic::obj = nullptr;
+std::mutex SpeakerMic::mInstanceMutex;
 
 std::shared_ptr<Device> SpeakerMic::getObject()
 {
@@ -46,6 +47,8 @@ std::shared_ptr<Device> SpeakerMic::getObject()
 std::shared_ptr<Device> SpeakerMic::getInstance(struct pal_device *device,
                                                 std::shared_ptr<ResourceManager> Rm)
 {
+    std::lock_guard<std::mutex> lock(mInstanceMutex);
+
     if (!obj) {
         std::shared_ptr<Device> sp(new SpeakerMic(device, Rm));
         obj = sp;
@@ -66,7 +66,12 @@
 #include "SpeakerProtection.h"
 #include "SessionAlsaUtils.h"
 #include "kvh2xml.h"
+#include "PalThreadPolicy.h"
+#include "PalEventLoop.h"
 #include <errno.h>
+#include <stddef.h>
+#include <time.h>
+#include <unistd.h>
 #include <agm/agm_api.h>
 
 #include<fstream>
@@ -82,6 +87,7 @@
 #define FEEDBACK_MONO_1 "-mono-1"
 
 #define MIN_SPKR_IDLE_SEC (60 * 30)
+/* retry delay when the speaker temperature is out of range */
 #define WAKEUP_MIN_IDLE_CHECK (1000 * 30)
 
 #define SPKR_RIGHT_WSA_TEMP "SpkrRight WSA Temp"
@@ -126,6 +132,7 @@ std::thread SpeakerProtection::mCalThread;
 std::thread SpeakerProtection::XmaxTmaxLogThread;
 std::condition_variable SpeakerProtection::cv;
 std::mutex SpeakerProtection::cvMutex;
+std::condition_variable SpeakerProtection::calCv;
 std::mutex SpeakerProtection::calibrationMutex;
 
 bool SpeakerProtection::isSpkrInUse;
@@ -133,6 +140,9 @@ bool SpeakerProtection::calThrdCreated;
 bool SpeakerProtection::isDynamicCalTriggered = false;
 bool SpeakerProtection::startXmaxLogging = false;
 struct timespec SpeakerProtection::spkrLastTimeUsed;
+int SpeakerProtection::calTimer = 0;
+bool SpeakerProtection::calDue = false;
+uint32_t SpeakerProtection::calIdleMs = MIN_SPKR_IDLE_SEC * 1000;
 struct mixer *SpeakerProtection::virtMixer;
 struct mixer *SpeakerProtection::hwMixer;
 speaker_prot_cal_state SpeakerProtection::spkrCalState;
@@ -152,6 +162,7 @@ int SpeakerProtection::calibrationCallbackStatus;
 int SpeakerProtection::numberOfRequest;
 bool SpeakerProtection::mDspCallbackRcvd;
 std::shared_ptr<Device> SpeakerFeedback::obj = nullptr;
+std::mutex SpeakerFeedback::mInstanceMutex;
 int SpeakerFeedback::numSpeaker;
 
 std::string getDefaultSpkrTempCtrl(uint8_t spkr_pos)
@@ -230,23 +241,69 @@ void SpeakerProtection::spkrProtSetSpkrStatus(bool enable)
 {
     PAL_DBG(LOG_TAG, "Enter");
 
-    if (enable)
+    if (enable) {
         isSpkrInUse = true;
-    else {
+        if (calThrdCreated)
+            spkrCancelCalibration();
+    } else {
         isSpkrInUse = false;
         clock_gettime(CLOCK_BOOTTIME, &spkrLastTimeUsed);
         PAL_INFO(LOG_TAG, "Speaker used last time %ld", spkrLastTimeUsed.tv_sec);
+        if (calThrdCreated)
+            spkrScheduleCalibration(isDynamicCalTriggered ? 0 : calIdleMs);
     }
 
     PAL_DBG(LOG_TAG, "Exit");
 }
 
-/* Wait function for WAKEUP_MIN_IDLE_CHECK  */
+/* Wait until the calibration timer fires or the thread has to exit */
 void SpeakerProtection::spkrCalibrateWait()
 {
     std::unique_lock<std::mutex> lock(cvMutex);
-    cv.wait_for(lock,
-            std::chrono::milliseconds(WAKEUP_MIN_IDLE_CHECK));
+    calCv.wait(lock, [this] { return calDue || threadExit; });
+    calDue = false;
+}
+
+/* Make calibration due after delayMs, right away for a zero delay */
+void SpeakerProtection::spkrScheduleCalibration(uint32_t delayMs)
+{
+    PalEventLoop *loop = PalEventLoop::getInstance();
+    std::lock_guard<std::mutex> lock(cvMutex);
+
+    if (!calTimer && loop) {
+        calTimer = loop->addTimer(0, 0, []() {
+            std::lock_guard<std::mutex> lock(cvMutex);
+            calDue = true;
+            calCv.notify_all();
+        });
+        if (calTimer < 0) {
+            PAL_ERR(LOG_TAG, "failed to create calibration timer %d", calTimer);
+            calTimer = 0;
+        }
+    }
+
+    PAL_DBG(LOG_TAG, "calibration due in %u ms", delayMs);
+    if (delayMs && calTimer && loop) {
+        calDue = false;
+        loop->armTimer(calTimer, delayMs);
+    } else {
+        /* without a timer calibrate now rather than never */
+        if (calTimer && loop)
+            loop->disarmTimer(calTimer);
+        calDue = true;
+        calCv.notify_all();
+    }
+}
+
+/* Speaker went in use, nothing is due until it stops again */
+void SpeakerProtection::spkrCancelCalibration()
+{
+    PalEventLoop *loop = PalEventLoop::getInstance();
+    std::lock_guard<std::mutex> lock(cvMutex);
+
+    if (calTimer && loop)
+        loop->disarmTimer(calTimer);
+    calDue = false;
 }
 
 // Callback from DSP for Ressistance value
@@ -356,17 +413,15 @@ int SpeakerProtection::getCpsDevNumber(std::string mixer_name)
     return status;
 }
 
-int SpeakerProtection::getSpeakerTemperature(int spkr_pos)
+struct mixer_ctl *SpeakerProtection::getSpeakerTempCtl(int spkr_pos)
 {
     struct mixer_ctl *ctl;
     std::string mixer_ctl_name;
-    int status = 0;
     /**
      * It is assumed that for Mono speakers only right speaker will be there.
      * Thus we will get the Temperature just for right speaker.
      * TODO: Get the channel from RM.xml
      */
-    PAL_DBG(LOG_TAG, "Enter Speaker Get Temperature %d", spkr_pos);
     mixer_ctl_name = rm->getSpkrTempCtrl(spkr_pos);
     if (mixer_ctl_name.empty()) {
         PAL_DBG(LOG_TAG, "Using default mixer control");
@@ -376,8 +431,20 @@ int SpeakerProtection::getSpeakerTemperature(int spkr_pos)
     PAL_DBG(LOG_TAG, "audio_mixer %pK", hwMixer);
 
     ctl = mixer_get_ctl_by_name(hwMixer, mixer_ctl_name.c_str());
-    if (!ctl) {
+    if (!ctl)
         PAL_ERR(LOG_TAG, "Invalid mixer control: %s\n", mixer_ctl_name.c_str());
+
+    return ctl;
+}
+
+int SpeakerProtection::getSpeakerTemperature(int spkr_pos)
+{
+    struct mixer_ctl *ctl;
+    int status = 0;
+
+    PAL_DBG(LOG_TAG, "Enter Speaker Get Temperature %d", spkr_pos);
+    ctl = getSpeakerTempCtl(spkr_pos);
+    if (!ctl) {
         status = -EINVAL;
         return status;
     }
@@ -448,7 +515,6 @@ exit:
 
 int SpeakerProtection::spkrStartCalibration()
 {
-    FILE *fp = NULL;
     struct pal_device device, deviceRx;
     struct pal_channel_info ch_info;
     struct pal_device_info deviceRxSpkr;
@@ -1078,27 +1144,17 @@ int SpeakerProtection::spkrStartCalibration()
         // Store the R0T0 values
         if (mDspCallbackRcvd) {
             if (calibrationCallbackStatus == CALIBRATION_STATUS_SUCCESS) {
-                if (vi_miid_II == source_miid) {
-                    PAL_DBG(LOG_TAG, " opening this path %s",PAL_SP_II_TEMP_PATH);
-                   fp = fopen(PAL_SP_II_TEMP_PATH, "w+");
-                }
-                else if (vi_miid_I == source_miid) {
-                    PAL_DBG(LOG_TAG, " opening this path %s",PAL_SP_I_TEMP_PATH);
-                   fp = fopen(PAL_SP_I_TEMP_PATH, "w+");
-                }
-                if (!fp) {
-                    PAL_ERR(LOG_TAG, "Unable to open file for write %s",strerror(errno));
-
-                } else {
-                    PAL_DBG(LOG_TAG, "Write the R0T0 value to file");
-                    for (i = 0; i < eventCh; i++) {
-                        fwrite(&callback_data->r0_cali_q24[i],
-                                    sizeof(callback_data->r0_cali_q24[i]), 1, fp);
-                        fwrite(&spkerTempList[i + SpkrTempIndex], sizeof(int16_t), 1, fp);
-                    }
+                if (vi_miid_II == source_miid)
+                    ret = writeCalRecord(PAL_SP_II_TEMP_PATH, true,
+                                         (int32_t *)callback_data->r0_cali_q24,
+                                         &spkerTempList[SpkrTempIndex], eventCh);
+                else
+                    ret = writeCalRecord(PAL_SP_I_TEMP_PATH, false,
+                                         (int32_t *)callback_data->r0_cali_q24,
+                                         &spkerTempList[SpkrTempIndex], eventCh);
+                if (!ret) {
                     spkrCalState = SPKR_CALIBRATED;
                     free(callback_data);
-                    fclose(fp);
                 }
                 SpkrTempIndex = 2;
             }
@@ -1206,100 +1262,273 @@ void SpeakerProtection::getSpeakerTemperatureList()
     int value;
     PAL_DBG(LOG_TAG, "Enter Speaker Get Temperature List");
 
-    for(i = 0; i < numberOfChannels; i++) {
-         value = getSpeakerTemperature(i);
+    /* controls are looked up once, later passes only read the values */
+    if (spkrTempCtls.empty()) {
+        for (i = 0; i < numberOfChannels; i++)
+            spkrTempCtls.push_back(getSpeakerTempCtl(i));
+    }
+
+    for (i = 0; i < numberOfChannels; i++) {
+         value = spkrTempCtls[i] ? mixer_ctl_get_value(spkrTempCtls[i], 0) : -EINVAL;
          PAL_DBG(LOG_TAG, "Temperature %d ", value);
          spkerTempList[i] = value;
     }
     PAL_DBG(LOG_TAG, "Exit Speaker Get Temperature List");
 }
 
+static uint32_t spkrCalChecksum(const struct sp_cal_record *rec)
+{
+    const uint8_t *data = (const uint8_t *)rec;
+    uint32_t hash = 2166136261u;
+
+    /* FNV-1a */
+    for (size_t i = 0; i < offsetof(struct sp_cal_record, checksum); i++)
+        hash = (hash ^ data[i]) * 16777619u;
+    return hash;
+}
+
+/* Reads a cal file, older raw R0/T0 files come back with version 0 */
+int SpeakerProtection::readCalRecord(const char *path, struct sp_cal_record *rec)
+{
+    uint8_t buf[sizeof(struct sp_cal_record) + 1];
+    size_t size = 0;
+    size_t legacyCh = 0;
+    FILE *fp = NULL;
+
+    fp = fopen(path, "rb");
+    if (!fp)
+        return -ENOENT;
+    size = fread(buf, 1, sizeof(buf), fp);
+    fclose(fp);
+
+    memset(rec, 0, sizeof(*rec));
+    if (size == sizeof(*rec) && ((struct sp_cal_record *)buf)->magic == SP_CAL_RECORD_MAGIC) {
+        memcpy(rec, buf, sizeof(*rec));
+        if (rec->version != SP_CAL_RECORD_VERSION ||
+            rec->num_ch == 0 || rec->num_ch > SP_CAL_RECORD_MAX_CH ||
+            rec->checksum != spkrCalChecksum(rec)) {
+            PAL_ERR(LOG_TAG, "corrupt or unknown cal record %s", path);
+            return -EINVAL;
+        }
+        return 0;
+    }
+
+    /* raw dump: R0 in Q24 and T0 in Q6 per channel */
+    legacyCh = size / (sizeof(int32_t) + sizeof(int16_t));
+    if (!legacyCh || legacyCh > SP_CAL_RECORD_MAX_CH ||
+        size != legacyCh * (sizeof(int32_t) + sizeof(int16_t))) {
+        PAL_ERR(LOG_TAG, "unexpected cal file size %zu for %s", size, path);
+        return -EINVAL;
+    }
+    rec->num_ch = legacyCh;
+    for (size_t i = 0; i < legacyCh; i++) {
+        memcpy(&rec->r0_cali_q24[i], &buf[i * 6], sizeof(int32_t));
+        memcpy(&rec->t0_cali_q6[i], &buf[i * 6 + sizeof(int32_t)], sizeof(int16_t));
+    }
+    return 0;
+}
+
+/* R0/T0 of numCh speakers from a cal file, valid or not */
+int SpeakerProtection::readCalibration(const char *path, struct vi_r0t0_cfg_t *r0t0,
+                                       int numCh)
+{
+    struct sp_cal_record rec;
+    int status = 0;
+
+    status = readCalRecord(path, &rec);
+    if (status)
+        return status;
+    if (numCh > (int)rec.num_ch) {
+        PAL_ERR(LOG_TAG, "%s has %u channels, %d needed", path, rec.num_ch, numCh);
+        return -EINVAL;
+    }
+
+    for (int i = 0; i < numCh; i++) {
+        r0t0[i].r0_cali_q24 = rec.r0_cali_q24[i];
+        r0t0[i].t0_cali_q6 = rec.t0_cali_q6[i];
+    }
+    return 0;
+}
+
+void SpeakerProtection::getSpkrDevNums(bool secondModule, int32_t *devNum)
+{
+    devNum[0] = getCpsDevNumber(secondModule ? SPKR2_RIGHT_WSA_DEV_NUM :
+                                SPKR_RIGHT_WSA_DEV_NUM);
+    devNum[1] = MaxCH > 1 ? getCpsDevNumber(secondModule ? SPKR2_LEFT_WSA_DEV_NUM :
+                                            SPKR_LEFT_WSA_DEV_NUM) : 0;
+}
+
+int SpeakerProtection::writeCalRecord(const char *path, bool secondModule,
+                                      const int32_t *r0Q24, const int *t0Q6, int numCh)
+{
+    struct sp_cal_record rec;
+    std::string tmpPath = std::string(path) + ".tmp";
+    FILE *fp = NULL;
+    int status = 0;
+
+    if (numCh <= 0 || numCh > SP_CAL_RECORD_MAX_CH)
+        return -EINVAL;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.magic = SP_CAL_RECORD_MAGIC;
+    rec.version = SP_CAL_RECORD_VERSION;
+    rec.num_ch = numCh;
+    getSpkrDevNums(secondModule, rec.dev_num);
+    rec.cal_time = time(NULL);
+    for (int i = 0; i < numCh; i++) {
+        rec.r0_cali_q24[i] = r0Q24[i];
+        rec.t0_cali_q6[i] = t0Q6[i];
+    }
+    rec.checksum = spkrCalChecksum(&rec);
+
+    /* a crash mid write must not leave a half record behind */
+    PAL_DBG(LOG_TAG, "Write the R0T0 value to %s", path);
+    fp = fopen(tmpPath.c_str(), "wb");
+    if (!fp) {
+        status = -errno;
+        PAL_ERR(LOG_TAG, "Unable to open file for write %s", strerror(errno));
+        return status;
+    }
+    if (fwrite(&rec, sizeof(rec), 1, fp) != 1 || fflush(fp) || fsync(fileno(fp))) {
+        status = -EIO;
+        PAL_ERR(LOG_TAG, "Unable to write %s", tmpPath.c_str());
+    }
+    fclose(fp);
+    if (!status && rename(tmpPath.c_str(), path)) {
+        status = -errno;
+        PAL_ERR(LOG_TAG, "Unable to rename %s, status %d", tmpPath.c_str(), status);
+    }
+    if (status)
+        unlink(tmpPath.c_str());
+    return status;
+}
+
+/*
+ * Whether the cal file can be used without running the calibration graph:
+ * a current record of the same amps, not older than the validity window and
+ * calibrated close enough to the present speaker temperature.
+ */
+bool SpeakerProtection::isCalRecordValid(const char *path, bool secondModule,
+                                         int tempIndex)
+{
+    struct sp_cal_record rec;
+    int32_t devNum[SP_CAL_RECORD_MAX_CH];
+    int64_t age = 0;
+    int diff = 0;
+
+    if (readCalRecord(path, &rec))
+        return false;
+    if (rec.version != SP_CAL_RECORD_VERSION) {
+        PAL_INFO(LOG_TAG, "%s has no cal record, recalibrate", path);
+        return false;
+    }
+    if ((int)rec.num_ch < MaxCH) {
+        PAL_INFO(LOG_TAG, "%s covers %u speakers, recalibrate", path, rec.num_ch);
+        return false;
+    }
+
+    getSpkrDevNums(secondModule, devNum);
+    for (int i = 0; i < MaxCH; i++) {
+        if (devNum[i] > 0 && rec.dev_num[i] > 0 && devNum[i] != rec.dev_num[i]) {
+            PAL_INFO(LOG_TAG, "amp %d changed (%d -> %d), recalibrate", i,
+                     rec.dev_num[i], devNum[i]);
+            return false;
+        }
+    }
+
+    if (ResourceManager::spCalValidityDays > 0) {
+        age = time(NULL) - rec.cal_time;
+        if (age < 0 || age > (int64_t)ResourceManager::spCalValidityDays * 24 * 3600) {
+            PAL_INFO(LOG_TAG, "%s is %lld s old, recalibrate", path, (long long)age);
+            return false;
+        }
+    }
+
+    if (ResourceManager::spCalTempWindow > 0) {
+        getSpeakerTemperatureList();
+        for (int i = 0; i < MaxCH && i + tempIndex < numberOfChannels; i++) {
+            if (spkerTempList[i + tempIndex] == -EINVAL)
+                continue;
+            diff = spkerTempList[i + tempIndex] - rec.t0_cali_q6[i] / (1 << 6);
+            if (diff < 0)
+                diff = -diff;
+            if (diff > ResourceManager::spCalTempWindow) {
+                PAL_INFO(LOG_TAG, "speaker %d is %d C off the cal temperature, recalibrate",
+                         i + tempIndex, diff);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
 void SpeakerProtection::spkrCalibrationThread()
 {
+    PalThreadScope threadScope(PAL_THREAD_CLASS_BACKGROUND, "spkr_cal");
     unsigned long sec = 0;
-    bool proceed = false;
+    bool inRange = true;
     int i;
 
     while (!threadExit) {
-        PAL_DBG(LOG_TAG, "Inside calibration while loop");
-        proceed = false;
+        // Sleep until the speaker has been idle long enough, the timer is
+        // armed on speaker stop and cancelled on speaker start.
+        spkrCalibrateWait();
+        if (threadExit)
+            break;
+
+        PAL_DBG(LOG_TAG, "Calibration due");
         if (isSpeakerInUse(&sec)) {
             PAL_DBG(LOG_TAG, "Speaker in use. Wait for proper time");
-            spkrCalibrateWait();
-            PAL_DBG(LOG_TAG, "Waiting done");
             continue;
         }
-        else {
-            PAL_DBG(LOG_TAG, "Speaker not in use");
-            if (isDynamicCalTriggered) {
-                PAL_DBG(LOG_TAG, "Dynamic Calibration triggered");
-            }
-            else if (sec < minIdleTime) {
-                PAL_DBG(LOG_TAG, "Speaker not idle for minimum time. %lu", sec);
-                spkrCalibrateWait();
-                PAL_DBG(LOG_TAG, "Waited for speaker to be idle for min time");
-                continue;
-            }
-            proceed = true;
+        if (isDynamicCalTriggered) {
+            PAL_DBG(LOG_TAG, "Dynamic Calibration triggered");
+        } else if (sec < minIdleTime) {
+            PAL_DBG(LOG_TAG, "Speaker not idle for minimum time. %lu", sec);
+            spkrScheduleCalibration((minIdleTime - sec) * 1000);
+            continue;
         }
 
-        if (proceed) {
-            PAL_DBG(LOG_TAG, "Getting temperature of speakers");
-            getSpeakerTemperatureList();
+        PAL_DBG(LOG_TAG, "Getting temperature of speakers");
+        getSpeakerTemperatureList();
 
-            for (i = 0; i < numberOfChannels; i++) {
-                if ((spkerTempList[i] != -EINVAL) &&
-                    (spkerTempList[i] < TZ_TEMP_MIN_THRESHOLD ||
-                     spkerTempList[i] > TZ_TEMP_MAX_THRESHOLD)) {
-                    PAL_ERR(LOG_TAG, "Temperature out of range. Retry");
-                    spkrCalibrateWait();
-                    continue;
-                }
-            }
-            for (i = 0; i < numberOfChannels; i++) {
-                // Converting to Q6 format
-                spkerTempList[i] = (spkerTempList[i]*(1<<6));
-            }
+        inRange = true;
+        for (i = 0; i < numberOfChannels; i++) {
+            if ((spkerTempList[i] != -EINVAL) &&
+                (spkerTempList[i] < TZ_TEMP_MIN_THRESHOLD ||
+                 spkerTempList[i] > TZ_TEMP_MAX_THRESHOLD))
+                inRange = false;
         }
-        else {
+        if (!inRange) {
+            PAL_ERR(LOG_TAG, "Temperature out of range. Retry");
+            spkrScheduleCalibration(WAKEUP_MIN_IDLE_CHECK);
             continue;
         }
+        for (i = 0; i < numberOfChannels; i++) {
+            // Converting to Q6 format
+            spkerTempList[i] = (spkerTempList[i]*(1<<6));
+        }
 
         // Check whether speaker was in use in the meantime when temperature
         // was being read.
-        proceed = false;
         if (isSpeakerInUse(&sec)) {
             PAL_DBG(LOG_TAG, "Speaker in use. Wait for proper time");
-            spkrCalibrateWait();
-            PAL_DBG(LOG_TAG, "Waiting done");
             continue;
         }
-        else {
-            PAL_DBG(LOG_TAG, "Speaker not in use");
-            if (isDynamicCalTriggered) {
-                PAL_DBG(LOG_TAG, "Dynamic calibration triggered");
-            }
-            else if (sec < minIdleTime) {
-                PAL_DBG(LOG_TAG, "Speaker not idle for minimum time. %lu", sec);
-                spkrCalibrateWait();
-                PAL_DBG(LOG_TAG, "Waited for speaker to be idle for min time");
-                continue;
-            }
-            proceed = true;
-        }
 
-        if (proceed) {
-            // Start calibrating the speakers.
-            PAL_DBG(LOG_TAG, "Speaker not in use, start calibration");
-            spkrStartCalibration();
-            if (spkrCalState == SPKR_CALIBRATED) {
-                threadExit = true;
-            }
-        }
-        else {
-            continue;
+        // Start calibrating the speakers.
+        PAL_DBG(LOG_TAG, "Speaker not in use, start calibration");
+        spkrStartCalibration();
+        if (spkrCalState == SPKR_CALIBRATED) {
+            threadExit = true;
+        } else if (!isSpeakerInUse(&sec)) {
+            // Failed without the speaker being started, try again once
+            // the idle time has passed.
+            spkrScheduleCalibration(calIdleMs);
         }
     }
+    spkrCancelCalibration();
     isDynamicCalTriggered = false;
     calThrdCreated = false;
     PAL_DBG(LOG_TAG, "Calibration done, exiting the thread");
@@ -1310,7 +1539,6 @@ SpeakerProtection::SpeakerProtection(struct pal_device *device,
 {
     int status = 0;
     struct pal_device_info devinfo = {};
-    FILE *fp = NULL;
 
     spkerTempList = NULL;
 
@@ -1319,6 +1547,7 @@ SpeakerProtection::SpeakerProtection(struct pal_device *device,
         minIdleTime = ResourceManager::spQuickCalTime;
     else
         minIdleTime = MIN_SPKR_IDLE_SEC;
+    calIdleMs = minIdleTime * 1000;
 
     rm = Rm;
 
@@ -1374,16 +1603,18 @@ SpeakerProtection::SpeakerProtection(struct pal_device *device,
         goto exit;
     }
 
-    fp = fopen(PAL_SP_I_TEMP_PATH, "rb");
-    if (fp) {
-        PAL_DBG(LOG_TAG, "Cal File exists. Reading from it");
+    if (isCalRecordValid(PAL_SP_I_TEMP_PATH, false, 0) &&
+        (numberOfChannels != CHANNELS_4 ||
+         isCalRecordValid(PAL_SP_II_TEMP_PATH, true, CHANNELS_2))) {
+        PAL_DBG(LOG_TAG, "Cached calibration is valid, reusing it");
         spkrCalState = SPKR_CALIBRATED;
     }
     else {
         PAL_DBG(LOG_TAG, "Calibration Not done");
+        calThrdCreated = true;
+        spkrScheduleCalibration(calIdleMs);
         mCalThread = std::thread(&SpeakerProtection::spkrCalibrationThread,
                             this);
-        calThrdCreated = true;
     }
 exit:
     PAL_DBG(LOG_TAG, "exit. calThrdCreated :%d", calThrdCreated);
@@ -1556,6 +1787,7 @@ exit:
 
 void SpeakerProtection::startSpkrXmaxTmaxLogging()
 {
+    PalThreadScope threadScope(PAL_THREAD_CLASS_BACKGROUND, "spkr_xmax_tmax");
     FILE* log_fp = NULL;
     int32_t ret = 0;
 
@@ -2180,21 +2412,8 @@ int32_t SpeakerProtection::spkrProtProcessingMode(bool flag)
 
             // Setting the R0T0 values
             PAL_DBG(LOG_TAG, "Read R0T0 from file");
-            if (ch == CHANNELS_4)
-                fp = fopen(PAL_SP_II_TEMP_PATH, "rb");
-            else
-                fp = fopen(PAL_SP_I_TEMP_PATH, "rb");
-
-            if (fp) {
-                for (int i = 0; i < tempCH; i++) {
-                    fread(&r0t0Array[i].r0_cali_q24,
-                          sizeof(r0t0Array[i].r0_cali_q24), 1, fp);
-                    fread(&r0t0Array[i].t0_cali_q6,
-                          sizeof(r0t0Array[i].t0_cali_q6), 1, fp);
-                }
-                fclose(fp);
-            }
-            else {
+            if (readCalibration(ch == CHANNELS_4 ? PAL_SP_II_TEMP_PATH :
+                                PAL_SP_I_TEMP_PATH, r0t0Array, tempCH)) {
                 PAL_DBG(LOG_TAG, "Speaker not calibrated. Send safe value");
                 for (int i = 0; i < tempCH; i++) {
                     r0t0Array[i].r0_cali_q24 = MIN_RESISTANCE_SPKR_Q24;
@@ -2901,6 +3120,8 @@ int SpeakerProtection::speakerProtectionDynamicCal()
 
     calThrdCreated = true;
     isDynamicCalTriggered = true;
+    if (!isSpkrInUse)
+        spkrScheduleCalibration(0);
 
     std::thread dynamicCalThread(&SpeakerProtection::spkrCalibrationThread, this);
 
@@ -3222,29 +3443,21 @@ int32_t SpeakerProtection::getCalibrationData(void **param)
     double dr0[numberOfChannels];
     double dt0[numberOfChannels];
     std::ostringstream resString;
-    FILE *fp;
 
     memset(r0t0Array, 0, sizeof(vi_r0t0_cfg_t) * numberOfChannels);
     memset(dr0, 0, sizeof(double) * numberOfChannels);
     memset(dt0, 0, sizeof(double) * numberOfChannels);
     for (int ch = numberOfChannels; ch != 0; ch = ch >> CHANNELS_2) {
-        if (ch == CHANNELS_4) {
-            fp = fopen(PAL_SP_II_TEMP_PATH, "rb");
+        if (ch == CHANNELS_4)
             tempCH = CHANNELS_2;
-        } else
-            fp = fopen(PAL_SP_I_TEMP_PATH, "rb");
-        if (fp) {
+        if (!readCalibration(ch == CHANNELS_4 ? PAL_SP_II_TEMP_PATH :
+                             PAL_SP_I_TEMP_PATH, r0t0Array, MaxCH)) {
             for (i = 0; i < MaxCH; i++) {
-                fread(&r0t0Array[i].r0_cali_q24,
-                        sizeof(r0t0Array[i].r0_cali_q24), 1, fp);
-                fread(&r0t0Array[i].t0_cali_q6,
-                        sizeof(r0t0Array[i].t0_cali_q6), 1, fp);
                 // Convert to readable format
                 dr0[i+tempCH] = ((double)r0t0Array[i].r0_cali_q24)/(1 << 24);
                 dt0[i+tempCH] = ((double)r0t0Array[i].t0_cali_q6)/(1 << 6);
                 PAL_DBG(LOG_TAG, "R0= %lf, T0= %lf", dr0[i+tempCH], dt0[i+tempCH]);
             }
-            fclose(fp);
         }
         else {
             status = -EINVAL;
@@ -3306,7 +3519,6 @@ void SpeakerFeedback::updateVIcustomPayload()
     std::vector<Stream*> activeStreams;
     uint32_t miid = 0, ret = 0,tagid;
     struct vi_r0t0_cfg_t r0t0Array[numSpeaker];
-    FILE *fp = NULL;
     int Channels, tempCH;
     param_id_sp_th_vi_r0t0_cfg_t *spR0T0confg;
     param_id_sp_vi_op_mode_cfg_t modeConfg;
@@ -3385,21 +3597,9 @@ void SpeakerFeedback::updateVIcustomPayload()
             }
         }
 
-        if (ch == CHANNELS_4) {
-            fp = fopen(PAL_SP_II_TEMP_PATH, "rb");
-        }
-        else
-            fp = fopen(PAL_SP_I_TEMP_PATH, "rb");
-
-        if (fp) {
+        if (!SpeakerProtection::readCalibration(ch == CHANNELS_4 ?
+                PAL_SP_II_TEMP_PATH : PAL_SP_I_TEMP_PATH, r0t0Array, tempCH)) {
             PAL_DBG(LOG_TAG, "Speaker calibrated. Send calibrated value");
-            for (int i = 0; i < tempCH; i++) {
-                fread(&r0t0Array[i].r0_cali_q24,
-                        sizeof(r0t0Array[i].r0_cali_q24), 1, fp);
-                fread(&r0t0Array[i].t0_cali_q6,
-                        sizeof(r0t0Array[i].t0_cali_q6), 1, fp);
-            }
-            fclose(fp);
         }
         else {
             PAL_DBG(LOG_TAG, "Speaker not calibrated. Send safe value");
@@ -3488,6 +3688,8 @@ int32_t SpeakerFeedback::stop()
 std::shared_ptr<Device> SpeakerFeedback::getInstance(struct pal_device *device,
                                                      std::shared_ptr<ResourceManager> Rm)
 {
+    std::lock_guard<std::mutex> lock(mInstanceMutex);
+
     PAL_DBG(LOG_TAG," Feedback getInstance\n");
     if (!obj) {
         std::shared_ptr<Device> sp(new SpeakerFeedback(device, Rm));
@@ -72,13 +72,20 @@
 #include "Device.h"
 #include "kvh2xml.h"
 #include <unistd.h>
+#include <algorithm>
+#include <functional>
 
 std::shared_ptr<Device> USB::objRx = nullptr;
 std::shared_ptr<Device> USB::objTx = nullptr;
+std::mutex USB::mInstanceMutex;
+std::map<std::pair<int, int>, std::string> USBCardConfig::stream_desc_cache_;
+std::mutex USBCardConfig::stream_desc_mutex_;
 
 std::shared_ptr<Device> USB::getInstance(struct pal_device *device,
                                              std::shared_ptr<ResourceManager> Rm)
 {
+    std::lock_guard<std::mutex> lock(mInstanceMutex);
+
     if (!device)
        return NULL;
 
@@ -288,11 +295,12 @@ int USB::deinit(pal_param_device_connection_t device_conn)
     }
 
     if (iter != usb_card_config_list_.end()) {
-        //TODO: usb_remove_capability
         usb_card_config_list_.erase(iter);
     } else {
         PAL_INFO(LOG_TAG, "usb info has not been cached.");
     }
+    /* card is gone, next connection must re-read its descriptor */
+    USBCardConfig::invalidateStreamDescriptor(device_conn.device_config.usb_addr);
 
     return 0;
 }
@@ -435,10 +443,120 @@ void USBCardConfig::usb_info_dump(char* read_buf, int type) {
     }
 }
 
+int USBCardConfig::readStreamDescriptor(struct pal_usb_device_address addr,
+                                        std::string &desc)
+{
+    char path[128];
+    char *read_buf = NULL;
+    size_t num_read = 0;
+    FILE *fd = NULL;
+    int ret = 0;
+    std::pair<int, int> key(addr.card_id, addr.device_num);
+    std::lock_guard<std::mutex> lock(stream_desc_mutex_);
+
+    auto it = stream_desc_cache_.find(key);
+    if (it != stream_desc_cache_.end()) {
+        PAL_DBG(LOG_TAG, "stream descriptor of card %u is cached", addr.card_id);
+        desc = it->second;
+        return 0;
+    }
+
+    ret = snprintf(path, sizeof(path), "/proc/asound/card%u/stream0",
+             addr.card_id);
+    if (ret < 0) {
+        PAL_ERR(LOG_TAG, "failed on snprintf (%d) to path %s\n", ret, path);
+        return -EINVAL;
+    }
+
+    fd = fopen(path, "r");
+    if (!fd) {
+        PAL_ERR(LOG_TAG, "failed to open config file %s error: %d\n", path, errno);
+        return -EINVAL;
+    }
+
+    read_buf = (char *)calloc(1, USB_BUFF_SIZE + 1);
+    if (!read_buf) {
+        PAL_ERR(LOG_TAG, "Failed to create read_buf");
+        ret = -ENOMEM;
+        goto done;
+    }
+
+    num_read = fread(read_buf, 1, USB_BUFF_SIZE, fd);
+    if (ferror(fd)) {
+        PAL_ERR(LOG_TAG, "file read error");
+        ret = -EIO;
+        goto done;
+    }
+    read_buf[num_read] = '\0';
+
+    desc.assign(read_buf, num_read);
+    stream_desc_cache_[key] = desc;
+    ret = 0;
+
+done:
+    fclose(fd);
+    if (read_buf)
+        free(read_buf);
+
+    return ret;
+}
+
+void USBCardConfig::invalidateStreamDescriptor(struct pal_usb_device_address addr)
+{
+    std::lock_guard<std::mutex> lock(stream_desc_mutex_);
+
+    stream_desc_cache_.erase(std::make_pair(addr.card_id, addr.device_num));
+}
+
+void USBCardConfig::buildCapabilityTable(usb_usecase_type_t type)
+{
+    usb_capability_table_t *cap = &cap_table_[type];
+    bool is_playback = (type == USB_PLAYBACK);
+    uint32_t bm = 0;
+
+    memset(cap, 0, sizeof(*cap));
+
+    cap->max_bit_width = getMaxBitWidth(is_playback);
+    cap->max_channels = getMaxChannels(is_playback);
+
+    /* formats sorted by descending bit width */
+    std::vector<unsigned int> bit_widths;
+    for (auto &cfg : usb_device_config_list_) {
+        if (cfg->getType() != type)
+            continue;
+        if (std::find(bit_widths.begin(), bit_widths.end(), cfg->getBitWidth()) ==
+                bit_widths.end())
+            bit_widths.push_back(cfg->getBitWidth());
+        bm |= cfg->getSRMask(type);
+    }
+    std::sort(bit_widths.begin(), bit_widths.end(), std::greater<unsigned int>());
+    for (auto bw : bit_widths) {
+        if (cap->num_formats == (MAX_SUPPORTED_FORMATS + 1)) {
+            PAL_ERR(LOG_TAG, "reached the maximum num of formats");
+            break;
+        }
+        cap->format[cap->num_formats++] = getFormatByBitWidth(bw);
+    }
+
+    /* sample rates in supported_sample_rates_ order, i.e. descending */
+    usb_supported_sample_rates_mask_[type] |= bm;
+    while (bm && cap->num_sample_rates < MAX_SUPPORTED_SAMPLE_RATES) {
+        int idx = __builtin_ffs(bm) - 1;
+        cap->sample_rate[cap->num_sample_rates++] =
+            USBDeviceConfig::supported_sample_rates_[idx];
+        bm &= ~(1 << idx);
+    }
+
+    readSupportedChannelMask(is_playback, &cap->channel_mask);
+    cap->valid = true;
+
+    std::lock_guard<std::mutex> lock(best_config_mutex_);
+    best_config_cache_.clear();
+}
+
 int USBCardConfig::getCapability(usb_usecase_type_t type,
                                         struct pal_usb_device_address addr) {
     int32_t size = 0;
-    FILE *fd = NULL;
     int32_t channels_no;
     char *str_start = NULL;
     char *str_end = NULL;
@@ -449,47 +567,32 @@ int USBCardConfig::getCapability(usb_usecase_type_t type,
     char *read_buf = NULL;
     char *rates_str = NULL;
     char *interval_str_start = NULL;
-    char path[128];
     int ret = 0;
     char *bit_width_str = NULL;
-    size_t num_read = 0;
+    std::string desc;
     const char* suffix;
     bool jack_status;
     //std::shared_ptr<USBDeviceConfig> usb_device_info = nullptr;
 
     bool check = false;
 
-    memset(path, 0, sizeof(path));
     PAL_INFO(LOG_TAG, "for %s", (type == USB_PLAYBACK) ?
           PLAYBACK_PROFILE_STR : CAPTURE_PROFILE_STR);
 
-    ret = snprintf(path, sizeof(path), "/proc/asound/card%u/stream0",
-             addr.card_id);
-    if(ret < 0) {
-        PAL_ERR(LOG_TAG, "failed on snprintf (%d) to path %s\n", ret, path);
-        ret = -EINVAL;
-        goto done;
-    }
-
-    fd = fopen(path, "r");
-    if (!fd) {
-        PAL_ERR(LOG_TAG, "failed to open config file %s error: %d\n", path, errno);
-        ret = -EINVAL;
+    ret = readStreamDescriptor(addr, desc);
+    if (ret) {
+        PAL_ERR(LOG_TAG, "failed to read stream descriptor of card %u", addr.card_id);
         goto done;
     }
 
-    read_buf = (char *)calloc(1, USB_BUFF_SIZE + 1);
+    read_buf = (char *)calloc(1, desc.size() + 1);
     if (!read_buf) {
         PAL_ERR(LOG_TAG, "Failed to create read_buf");
         ret = -ENOMEM;
         goto done;
     }
-
-    if ((num_read = fread(read_buf, 1, USB_BUFF_SIZE, fd)) < 0) {
-        PAL_ERR(LOG_TAG, "file read error");
-        goto done;
-    }
-    read_buf[num_read] = '\0';
+    memcpy(read_buf, desc.c_str(), desc.size());
+    read_buf[desc.size()] = '\0';
 
     str_start = strstr(read_buf, ((type == USB_PLAYBACK) ?
                        PLAYBACK_PROFILE_STR : CAPTURE_PROFILE_STR));
@@ -615,12 +718,10 @@ int USBCardConfig::getCapability(usb_usecase_type_t type,
         format_list_map.insert( std::pair<int, std::shared_ptr<USBDeviceConfig>>(usb_device_info->getBitWidth(),usb_device_info));
     }
 
-     usb_info_dump(read_buf, type);
+    buildCapabilityTable(type);
+    usb_info_dump(read_buf, type);
 
 done:
-    if (fd)
-        fclose(fd);
-
     if (read_buf)
         free(read_buf);
 
@@ -806,9 +907,18 @@ bool USBCardConfig::readDefaultJackStatus(bool is_playback) {
 int USBCardConfig::readSupportedConfig(struct dynamic_media_config *config, bool is_playback, int usb_card)
 {
     const char* suffix;
-    readSupportedFormat(is_playback, config->format);
-    readSupportedSampleRate(is_playback, config->sample_rate);
-    readSupportedChannelMask(is_playback, config->mask);
+    usb_capability_table_t *cap = &cap_table_[is_playback ? USB_PLAYBACK : USB_CAPTURE];
+
+    if (cap->valid) {
+        memcpy(config->format, cap->format, cap->num_formats * sizeof(uint32_t));
+        memcpy(config->sample_rate, cap->sample_rate,
+               cap->num_sample_rates * sizeof(uint32_t));
+        config->mask[0] = cap->channel_mask;
+    } else {
+        readSupportedFormat(is_playback, config->format);
+        readSupportedSampleRate(is_playback, config->sample_rate);
+        readSupportedChannelMask(is_playback, config->mask);
+    }
     suffix = is_playback ? USB_OUT_JACK_SUFFIX : USB_IN_JACK_SUFFIX;
     config->jack_status = getJackConnectionStatus(usb_card, suffix);
     PAL_DBG(LOG_TAG, "config->jack_status = %d", config->jack_status);
@@ -835,6 +945,8 @@ int USBCardConfig::readBestConfig(struct pal_media_config *config,
 
     int target_sample_rate = devinfo->samplerate == 0 ?
                            config->sample_rate : devinfo->samplerate;
+    usb_best_config_key_t key;
+    usb_best_config_t best;
 
     if (is_playback) {
         PAL_INFO(LOG_TAG, "USB output uhqa = %d", uhqa);
@@ -844,6 +956,26 @@ int USBCardConfig::readBestConfig(struct pal_media_config *config,
         media_config = sattr->in_media_config;
     }
 
+    key.is_playback = is_playback;
+    key.uhqa = uhqa;
+    key.target_bit_width = target_bit_width;
+    key.target_sample_rate = target_sample_rate;
+    key.requested_sample_rate = config->sample_rate;
+    key.requested_channels = media_config.ch_info.channels;
+    {
+        std::lock_guard<std::mutex> lock(best_config_mutex_);
+        auto it = best_config_cache_.find(key);
+        if (it != best_config_cache_.end()) {
+            config->bit_width = it->second.bit_width;
+            config->sample_rate = it->second.sample_rate;
+            if (it->second.ch_info_valid)
+                config->ch_info = it->second.ch_info;
+            PAL_DBG(LOG_TAG, "cached best config bw %d sr %d ch %d",
+                    config->bit_width, config->sample_rate, config->ch_info.channels);
+            return 0;
+        }
+    }
+
     if (format_list_map.count(target_bit_width) == 0) {
         /* if bit width does not match, use highest width. */
         auto max_fmt = format_list_map.rbegin();
@@ -921,6 +1053,15 @@ UpdateBestCh:
                 candidate_config->updateBestChInfo(&media_config.ch_info, &config->ch_info);
         }
     }
+
+    best.bit_width = config->bit_width;
+    best.sample_rate = config->sample_rate;
+    best.ch_info_valid = (candidate_config != nullptr);
+    best.ch_info = config->ch_info;
+    {
+        std::lock_guard<std::mutex> lock(best_config_mutex_);
+        best_config_cache_[key] = best;
+    }
     return 0;
 }
 
@@ -974,7 +1115,8 @@ bool USBDeviceConfig::getJackStatus() {
 
 bool USBDeviceConfig::isRateSupported(int requested_rate)
 {
-    if (find(rates_.begin(),rates_.end(),requested_rate) != rates_.end()) {
+    if (std::binary_search(sorted_rates_.begin(), sorted_rates_.end(),
+                           (unsigned int)requested_rate)) {
         return true;
     }
     PAL_INFO(LOG_TAG, "requested rate not supported = %d", requested_rate);
@@ -1106,6 +1248,9 @@ int USBDeviceConfig::getSampleRates(int type, char *rates_str) {
             next_sr_string = strtok_r(NULL, " ,.-", &temp_ptr);
         } while (next_sr_string != NULL);
     }
+    /* rates_ keeps descriptor order for best rate selection */
+    sorted_rates_ = rates_;
+    std::sort(sorted_rates_.begin(), sorted_rates_.end());
     return 0;
 }
 
@@ -35,6 +35,7 @@
 
 std::shared_ptr<Device> UltrasoundDevice::objRx = nullptr;
 std::shared_ptr<Device> UltrasoundDevice::objTx = nullptr;
+std::mutex UltrasoundDevice::mInstanceMutex;
 
 std::shared_ptr<Device> UltrasoundDevice::getObject(pal_device_id_t id)
 {
@@ -48,6 +49,8 @@ std::shared_ptr<Device> UltrasoundDevice::getObject(pal_device_id_t id)
 std::shared_ptr<Device> UltrasoundDevice::getInstance(struct pal_device *device,
                                              std::shared_ptr<ResourceManager> Rm)
 {
+    std::lock_guard<std::mutex> lock(mInstanceMutex);
+
     if (device->id == PAL_DEVICE_OUT_ULTRASOUND ||
         device->id == PAL_DEVICE_OUT_ULTRASOUND_DEDICATED) {
         if (!objRx) {
@@ -331,6 +331,42 @@ ssize_t pal_stream_read(pal_stream_handle_t *stream_handle, struct pal_buffer *b
   */
 ssize_t pal_stream_write(pal_stream_handle_t *stream_handle, struct pal_buffer *buf);
 
+/**
+  * Read audio into a batch of buffers in one call. Each buffer
+  * carries its own metadata and timestamp as in pal_stream_read.
+  * Sessions supporting it service the whole batch under one
+  * stream lock, otherwise buffers are read one at a time.
+  * On return the size of each buffer holds the bytes read into it.
+  *
+  * \param[in] stream_handle - Valid stream handle obtained
+  *       from pal_stream_open
+  * \param[in,out] bufs - array of pal_buffer to read into.
+  * \param[in] num_bufs - number of buffers in bufs.
+  *
+  * \return - total number of bytes read, or error code if
+  *       nothing could be read.
+  */
+ssize_t pal_stream_read_batch(pal_stream_handle_t *stream_handle,
+                              struct pal_buffer *bufs, uint32_t num_bufs);
+
+/**
+  * Write a batch of buffers in one call. Each buffer carries its
+  * own metadata, timestamp and flags as in pal_stream_write.
+  * Sessions supporting it submit the whole batch under one stream
+  * lock, otherwise buffers are written one at a time. Writing stops
+  * at the first failing buffer.
+  *
+  * \param[in] stream_handle - Valid stream handle obtained
+  *       from pal_stream_open
+  * \param[in] bufs - array of pal_buffer to write.
+  * \param[in] num_bufs - number of buffers in bufs.
+  *
+  * \return - total number of bytes written, or error code if
+  *       nothing could be written.
+  */
+ssize_t pal_stream_write_batch(pal_stream_handle_t *stream_handle,
+                               struct pal_buffer *bufs, uint32_t num_bufs);
+
 /**
   * \brief get current device on stream.
   *
@@ -398,6 +434,28 @@ int32_t pal_stream_get_param(pal_stream_handle_t *stream_handle,
 int32_t pal_stream_set_param(pal_stream_handle_t *stream_handle,
                            uint32_t param_id, pal_param_payload *param_payload);
 
+/**
+  * \brief Allocate a param payload for pal_stream_set_param,
+  *        pal_stream_get_param queries and pal_gef_rw_param.
+  *        Non TKV effect params in such a payload are sent to and
+  *        read back from the DSP in place, without the copy behind
+  *        a module header. A payload must not be used by two calls
+  *        at the same time.
+  *
+  * \param[in] size - size of the payload contents, set as
+  *       payload_size.
+  *
+  * \return zeroed payload on success, NULL otherwise
+  */
+pal_param_payload *pal_param_payload_alloc(uint32_t size);
+
+/**
+  * \brief Free a payload from pal_param_payload_alloc.
+  *
+  * \param[in] param_payload - payload to free, may be NULL.
+  */
+void pal_param_payload_free(pal_param_payload *param_payload);
+
 /**
   * \brief Get audio volume specific to a stream.
   *
@@ -423,6 +481,24 @@ int32_t pal_stream_get_volume(pal_stream_handle_t *stream_handle,
 int32_t pal_stream_set_volume(pal_stream_handle_t *stream_handle,
                               struct pal_volume_data *volume);
 
+/**
+  * \brief Set audio volume specific to a stream without waiting for the
+  *        DSP. Updates made while a previous one is still pending replace
+  *        it, so only the newest volume is applied. A later
+  *        pal_stream_set_volume drops a still pending update.
+  *
+  * \param[in] stream_handle - Valid stream handle obtained
+  *       from pal_stream_open
+  * \param[in] volume - volume data to be set on the stream.
+  * \param[in] ramp_period_ms - DSP ramp towards the new volume,
+  *       0 keeps the current ramp setting.
+  *
+  * \return 0 if the update was queued, error code otherwise
+  */
+int32_t pal_stream_set_volume_async(pal_stream_handle_t *stream_handle,
+                                    struct pal_volume_data *volume,
+                                    uint32_t ramp_period_ms);
+
 /**
   * \brief Get current audio audio mute state to a stream.
   *
@@ -446,6 +522,18 @@ int32_t pal_stream_get_mute(pal_stream_handle_t *stream_handle, bool *state);
   */
 int32_t pal_stream_set_mute(pal_stream_handle_t *stream, bool state);
 
+/**
+  * \brief Set mute specific to a stream without waiting for the DSP,
+  *        with the same coalescing as pal_stream_set_volume_async.
+  *
+  * \param[in] stream_handle - Valid stream handle obtained
+  *       from pal_stream_open
+  * \param[in] state - mute state to be set to the stream.
+  *
+  * \return 0 if the update was queued, error code otherwise
+  */
+int32_t pal_stream_set_mute_async(pal_stream_handle_t *stream_handle, bool state);
+
 /**
   * \brief Get microphone mute state.
   *
@@ -476,6 +564,19 @@ int32_t pal_set_mic_mute(bool state);
   */
 int32_t pal_get_timestamp(pal_stream_handle_t *stream_handle, struct pal_session_time *stime);
 
+/**
+  * \brief Get drift of the stream's session time against CLOCK_MONOTONIC,
+  *        as estimated from the samples taken by pal_get_timestamp.
+  *
+  * \param[in] stream_handle - Valid stream handle obtained
+  *       from pal_stream_open
+  * \param[out] drift_ppm - estimated drift in parts per million,
+  *       0 until enough samples are available.
+  *
+  * \return 0 on success, error code otherwise
+  */
+int32_t pal_stream_get_timestamp_drift(pal_stream_handle_t *stream_handle, int32_t *drift_ppm);
+
 /**
   * \brief Add remove effects for Voip TX path.
   *
@@ -543,6 +644,18 @@ int32_t pal_stream_create_mmap_buffer(pal_stream_handle_t *stream_handle,
 int32_t pal_stream_get_mmap_position(pal_stream_handle_t *stream_handle,
                               struct pal_mmap_position *position);
 
+/**
+  * \brief Write a snapshot of the PAL state: active streams, stream-device
+  *        pairs, EC reference counts and frontend pool usage.
+  *
+  * \param[in] fd - file descriptor the snapshot is written to.
+  * \param[in] format - PAL_DUMP_FORMAT_JSON or PAL_DUMP_FORMAT_BINARY,
+  *       see struct pal_state_dump_header for the binary layout.
+  *
+  * \return 0 on success, error code otherwise
+  */
+int32_t pal_dump_state(int fd, pal_dump_format_t format);
+
 /**
   * \brief Register global callback to pal.
   *        This can be used to inform client about any information
@@ -678,6 +678,8 @@ typedef enum {
 /* type of global callback events. */
 typedef enum {
     PAL_SND_CARD_STATE,
+    PAL_SSR_STREAM_RECOVERED, /* event_data points to pal_ssr_stream_recovery_t */
+    PAL_SSR_RECOVERY_DONE,    /* event_data points to pal_ssr_recovery_stats_t */
 } pal_global_callback_event_t;
 
 struct pal_stream_info {
@@ -969,6 +971,8 @@ typedef enum {
     PAL_PARAM_ID_ULTRASOUND_RAMPDOWN = 62,
     PAL_PARAM_ID_VOLUME_CTRL_RAMP = 63,
     PAL_PARAM_ID_ULTRASOUND_SET_GAIN = 64,
+    PAL_PARAM_ID_NEXT_TRACK_PREFETCH = 65,
+    PAL_PARAM_ID_UPD_DUTY_CYCLE_CADENCE = 66,
 } pal_param_id_type_t;
 
 /** HDMI/DP */
@@ -1183,6 +1187,19 @@ typedef struct pal_param_upd_event_detection {
     bool     register_status;
 } pal_param_upd_event_detection_t;
 
+/* Payload For ID: PAL_PARAM_ID_UPD_DUTY_CYCLE_CADENCE
+ * Description   : Host side duty cycling of the ultrasound proximity stream.
+ *                 While the screen is off the emitter alternates between
+ *                 active_ms windows at the concurrency gain and sleep_ms
+ *                 windows muted. A detection event restarts the active
+ *                 window and gain changes are applied at window boundaries.
+ *                 Zero in either field turns duty cycling off.
+ */
+typedef struct pal_param_upd_cadence {
+    uint32_t active_ms;
+    uint32_t sleep_ms;
+} pal_param_upd_cadence_t;
+
 typedef struct pal_bt_tws_payload_s {
     bool isTwsMonoModeOn;
     uint32_t codecFormat;
@@ -1456,6 +1473,20 @@ struct pal_compr_gapless_mdata {
        uint32_t encoderPadding;
 };
 
+/* Payload For ID: PAL_PARAM_ID_NEXT_TRACK_PREFETCH
+ * Description   : Next gapless track handed to PAL ahead of partial drain.
+ *                 On partial drain PAL moves to the next track, applies the
+ *                 metadata and codec options and writes data before the
+ *                 current track finishes draining. The client resumes
+ *                 writing the next track from data_size onwards.
+ */
+struct pal_next_track_prefetch {
+    pal_snd_dec_t codec;                    /**< codec options of next track */
+    struct pal_compr_gapless_mdata mdata;   /**< encoder delay/padding */
+    uint32_t data_size;                     /**< bytes of data that follow */
+    uint8_t data[];                         /**< first buffers of next track */
+};
+
 typedef struct pal_device_mute_t {
     pal_stream_direction_t dir;
     bool mute;
@@ -1501,6 +1532,69 @@ typedef int32_t (*pal_stream_callback)(pal_stream_handle_t *stream_handle,
  */
 typedef int32_t (*pal_global_callback)(uint32_t event_id, uint32_t *event_data, uint64_t cookie);
 
+/** Output formats of pal_dump_state */
+typedef enum {
+    PAL_DUMP_FORMAT_JSON = 0,
+    PAL_DUMP_FORMAT_BINARY,
+} pal_dump_format_t;
+
+#define PAL_STATE_DUMP_MAGIC 0x534C4150 /* "PALS" */
+#define PAL_STATE_DUMP_VERSION 1
+#define PAL_STATE_DUMP_NAME_LEN 32
+
+/**
+ * Binary state dump layout: one pal_state_dump_header followed by
+ * num_streams pal_state_dump_stream, num_stream_devices
+ * pal_state_dump_stream_device, num_ec_refs pal_state_dump_ec_ref and
+ * num_fe_pools pal_state_dump_fe_pool records, in host byte order.
+ */
+struct pal_state_dump_header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t timestamp_ns;          /**< CLOCK_MONOTONIC time of the snapshot */
+    uint32_t card_state;
+    uint32_t num_streams;
+    uint32_t num_stream_devices;
+    uint32_t num_ec_refs;
+    uint32_t num_fe_pools;
+    uint32_t reserved;
+};
+
+struct pal_state_dump_stream {
+    uint64_t handle;
+    uint32_t type;                  /**< pal_stream_type_t */
+    uint32_t direction;             /**< pal_stream_direction_t */
+    uint32_t state;                 /**< stream state */
+    uint32_t instance_id;
+    uint32_t user_count;            /**< ops in flight on the stream */
+    uint32_t active;                /**< stream accepts new ops */
+};
+
+/** active stream-device pair */
+struct pal_state_dump_stream_device {
+    uint64_t handle;
+    uint32_t device_id;             /**< pal_device_id_t */
+    uint32_t reserved;
+};
+
+struct pal_state_dump_ec_ref {
+    uint64_t tx_handle;
+    uint32_t tx_device_id;
+    uint32_t rx_device_id;
+    int32_t count;
+    uint32_t reserved;
+};
+
+struct pal_state_dump_fe_pool {
+    char name[PAL_STATE_DUMP_NAME_LEN];
+    uint32_t capacity;
+    uint32_t reserved;
+    uint32_t in_use;
+    uint32_t peak_in_use;
+    uint32_t alloc_failures;
+    uint32_t padding;
+};
+
 /** Sound card state */
 typedef enum card_status_t {
     CARD_STATUS_OFFLINE = 0,
@@ -1508,6 +1602,21 @@ typedef enum card_status_t {
     CARD_STATUS_NONE,
 } card_status_t;
 
+/** Recovery of a single stream after sound card came back online, sent as soon as it is restored */
+typedef struct pal_ssr_stream_recovery {
+    uint32_t stream_type;    /**< pal_stream_type_t of the stream */
+    int32_t status;          /**< result of the stream ssr up handling */
+    uint32_t recovery_ms;    /**< time from card online to stream restored */
+} pal_ssr_stream_recovery_t;
+
+/** Summary of the recovery after sound card came back online */
+typedef struct pal_ssr_recovery_stats {
+    uint32_t num_streams;    /**< streams restored */
+    uint32_t num_failed;     /**< streams whose ssr up handling failed */
+    uint32_t voice_ms;       /**< time to restore all voice/VoIP streams, 0 if none */
+    uint32_t total_ms;       /**< time to restore all streams */
+} pal_ssr_recovery_stats_t;
+
 typedef struct pal_buffer_config {
     size_t buf_count; /**< number of buffers*/
     size_t buf_size; /**< This would be the size of each buffer*/
@@ -725,6 +725,22 @@ done:
     return ret;
 }
 
+/* the payload is copied into the binder call, the server side sends it in place */
+pal_param_payload *pal_param_payload_alloc(uint32_t size)
+{
+    pal_param_payload *param_payload = NULL;
+
+    param_payload = (pal_param_payload *)calloc(1, sizeof(pal_param_payload) + size);
+    if (param_payload)
+        param_payload->payload_size = size;
+    return param_payload;
+}
+
+void pal_param_payload_free(pal_param_payload *param_payload)
+{
+    free(param_payload);
+}
+
 int32_t pal_stream_get_param(pal_stream_handle_t *stream_handle,
                              uint32_t param_id,
                              pal_param_payload **param_payload)
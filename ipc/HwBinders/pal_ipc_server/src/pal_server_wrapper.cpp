@@ -930,17 +930,16 @@ Return<int32_t> PAL::ipc_pal_stream_set_param(const uint64_t streamHandle, uint3
         return -EINVAL;
     }
 
-    param_payload = (pal_param_payload *)calloc (1,
-                                    sizeof(pal_param_payload) + paramPayload.data()->size);
+    /* a PAL payload lets effect params go to the DSP without another copy */
+    param_payload = pal_param_payload_alloc(paramPayload.data()->size);
     if (!param_payload) {
         ALOGE("Not enough memory for param_payload");
         return -ENOMEM;
     }
-    param_payload->payload_size = paramPayload.data()->size;
     memcpy(param_payload->payload, paramPayload.data()->payload.data(),
            param_payload->payload_size);
     ret = pal_stream_set_param((pal_stream_handle_t *)streamHandle, paramId, param_payload);
-    free(param_payload);
+    pal_param_payload_free(param_payload);
     return ret;
 }
 
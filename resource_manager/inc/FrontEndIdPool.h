@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef FRONTEND_ID_POOL_H
+#define FRONTEND_ID_POOL_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define FE_POOL_MAX_IDS 64
+
+typedef struct fe_pool_stats {
+    uint32_t capacity;
+    uint32_t reserved;
+    uint32_t in_use;
+    uint32_t peak_in_use;
+    uint32_t alloc_failures;
+} fe_pool_stats_t;
+
+/*
+ * Fixed capacity pool of frontend (PCM/compress device) ids of one class.
+ * Free ids are tracked in a bitmap, allocation claims a bit with a CAS and
+ * free sets it back, so neither needs a lock. A number of ids can be held
+ * back for critical usecases; regular allocations fail once only the
+ * reserved ids are left.
+ */
+class FrontEndIdPool
+{
+protected:
+    std::string name_;
+    int ids_[FE_POOL_MAX_IDS];
+    uint32_t count_;
+    bool shared_;
+    std::atomic<uint64_t> freeMask_;
+    std::atomic<uint32_t> reserved_;
+    std::atomic<uint32_t> peakInUse_;
+    std::atomic<uint32_t> allocFailures_;
+    int indexOf(int id) const;
+public:
+    FrontEndIdPool(const char *name);
+    /* shared pools hand out ids without consuming them */
+    void init(const std::vector<int> &ids, bool shared = false);
+    void clear();
+    int allocate(bool critical = false);
+    int free(int id);
+    int reserve(uint32_t num);
+    uint32_t available() const;
+    void getStats(fe_pool_stats_t *stats) const;
+    const std::string &getName() const { return name_; }
+};
+
+#endif //FRONTEND_ID_POOL_H
@@ -38,6 +38,7 @@
 #include <memory>
 #include <iostream>
 #include <thread>
+#include <chrono>
 #include <mutex>
 #include <string>
 #include "audio_route/audio_route.h"
@@ -58,6 +59,8 @@
 #include "ContextManager.h"
 #include "SoundTriggerPlatformInfo.h"
 #include "SignalHandler.h"
+#include "FrontEndIdPool.h"
+#include "PalLazyInit.h"
 
 typedef enum {
     RX_HOSTLESS = 1,
@@ -84,9 +87,11 @@ typedef enum {
 #define AUDIO_PARAMETER_KEY_UPD_DUTY_CYCLE "upd_duty_cycle_enable"
 #define AUDIO_PARAMETER_KEY_UPD_VIRTUAL_PORT "upd_virtual_port"
 #define AUDIO_PARAMETER_KEY_SPKR_XMAX_TMAX_LOG "spkr_xmax_tmax_logging_enable"
+#define AUDIO_PARAMETER_KEY_RESERVED_FRONTENDS "critical_reserved_frontends"
 #define MAX_PCM_NAME_SIZE 50
 #define MAX_STREAM_INSTANCES (sizeof(uint64_t) << 3)
 #define MIN_USECASE_PRIORITY 0xFFFFFFFF
+#define SSR_RECOVERY_MAX_WORKERS 4
 #if LINUX_ENABLED
 #if defined(__LP64__)
 #define ADM_LIBRARY_PATH "/usr/lib64/libadm.so"
@@ -250,6 +255,28 @@ typedef enum {
     DEFER_NLPI_LPI_SWITCH,
 } defer_switch_state_t;
 
+/* detection stream types arbitrated against other usecases */
+typedef enum {
+    ST_CONC_VOICE_UI,
+    ST_CONC_ACD,
+    ST_CONC_SENSOR_PCM_DATA,
+    ST_CONC_TYPE_MAX,
+} st_conc_type_t;
+
+/* platform info flags per detection stream type */
+#define ST_CONC_POLICY_LPI          0x1
+#define ST_CONC_POLICY_NLPI_SWITCH  0x2
+#define ST_CONC_POLICY_LL_BARGEIN   0x4
+#define ST_CONC_POLICY_CAPTURE      0x8
+#define ST_CONC_POLICY_VOICE        0x10
+#define ST_CONC_POLICY_VOIP         0x20
+
+/* decision for an incoming stream, see GetConcurrencyInfo */
+#define ST_CONC_DECISION_RX         0x1
+#define ST_CONC_DECISION_TX         0x2
+#define ST_CONC_DECISION_PAUSE      0x4
+#define ST_CONC_DIR_MAX             (PAL_AUDIO_INPUT_OUTPUT + 1)
+
 struct usecase_custom_config_info
 {
     std::string key;
@@ -316,6 +343,19 @@ struct tx_ecinfo {
     std::vector<int> disabled_rx_streams;
 };
 
+/*
+ * EC ref count of a tx stream against one rx device, indicating number of
+ * Rx streams which use this rx device as output device and are not of a
+ * stream type disabled for the Tx stream. E.g., for SVA and Recording
+ * stream, LL playback with speaker may only count for Recording stream
+ * when ll barge-in is not enabled.
+ */
+typedef struct ec_ref_count {
+    int tx_dev_id;
+    int rx_dev_id;
+    int count;
+} ec_ref_count_t;
+
 enum {
     NATIVE_AUDIO_MODE_SRC = 1,
     NATIVE_AUDIO_MODE_TRUE_44_1,
@@ -330,6 +370,13 @@ struct nativeAudioProp {
    int na_mode;
 };
 
+/* order in which streams are restored after SSR, highest first */
+enum {
+    SSR_RECOVERY_PRIO_BACKGROUND = 0,
+    SSR_RECOVERY_PRIO_DEFAULT,
+    SSR_RECOVERY_PRIO_VOICE,
+};
+
 typedef struct devpp_mfc_config
 {
     uint32_t sample_rate;
@@ -398,6 +445,13 @@ class ContextManager;
 class StreamSensorPCMData;
 class StreamContextProxy;
 
+/* streams sharing a backend are restored together, one after another */
+typedef struct ssr_recovery_group {
+    int priority;
+    std::set<std::string> backEnds;
+    std::vector<Stream*> streams;
+} ssr_recovery_group_t;
+
 struct deviceIn {
     int deviceId;
     int max_channel;
@@ -406,18 +460,6 @@ struct deviceIn {
     std::vector<usecase_info> usecase;
     // dev ids supporting ec ref
     std::vector<pal_device_id_t> rx_dev_ids;
-    /*
-     * map dynamically maintain ec ref count, key for this map
-     * is rx device id, which is present in rx_dev_ids, and value
-     * for this map is a vector of all active tx streams using
-     * this rx device as ec ref. For each Tx stream, we have a
-     * EC ref count, indicating number of Rx streams which uses
-     * this rx device as output device and also not disabled stream
-     * type to the Tx stream. E.g., for SVA and Recording stream,
-     * LL playback with speaker may only count for Recording stream
-     * when ll barge-in is not enabled.
-     */
-    std::map<int, std::vector<std::pair<Stream *, int>>> ec_ref_count_map;
     std::string sndDevName;
     bool isExternalECRefEnabled;
     bool fractionalSRSupported;
@@ -442,8 +484,10 @@ private:
     void getHigherPriorityActiveStreams(const int inComingStreamPriority,
                                         std::vector<Stream*> &activestreams,
                                         std::vector<T> sourcestreams);
-    const std::vector<int> allocateVoiceFrontEndIds(std::vector<int> listAllPcmVoiceFrontEnds,
-                                  const int howMany);
+    FrontEndIdPool *getFrontEndPool(const struct pal_stream_attributes &sAttr,
+                                    int lDirection);
+    static bool isCriticalFrontEndUser(const struct pal_stream_attributes &sAttr);
+    static void applyFrontEndReservations();
     int getDeviceDefaultCapability(pal_param_device_capability_t capability);
 
     int handleScreenStatusChange(pal_param_screen_state_t screen_state);
@@ -454,7 +498,18 @@ private:
     int32_t streamDevConnect(std::vector <std::tuple<Stream *, struct pal_device *>> streamDevConnectList);
     int32_t streamDevDisconnect_l(std::vector <std::tuple<Stream *, uint32_t>> streamDevDisconnectList);
     int32_t streamDevConnect_l(std::vector <std::tuple<Stream *, struct pal_device *>> streamDevConnectList);
+    void planStreamDevSwitch_l(std::vector <std::tuple<Stream *, uint32_t>> &streamDevDisconnectList,
+                               std::vector <std::tuple<Stream *, struct pal_device *>> &streamDevConnectList,
+                               std::vector <std::tuple<Stream *, struct pal_device *>> &streamDevRelinkList);
+    int32_t streamDevRelink_l(std::vector <std::tuple<Stream *, struct pal_device *>> streamDevRelinkList,
+                              std::vector <std::tuple<Stream *, uint32_t>> &streamDevDisconnectList,
+                              std::vector <std::tuple<Stream *, struct pal_device *>> &streamDevConnectList);
     void ssrHandlingLoop(std::shared_ptr<ResourceManager> rm);
+    static int getSsrRecoveryPriority(Stream *s);
+    void buildSsrRecoveryGroups(std::vector<Stream*> &streams,
+                                std::vector<ssr_recovery_group_t> &groups);
+    void recoverStreamsOnSsr(std::vector<Stream*> &streams,
+                             std::chrono::steady_clock::time_point ssrStart);
     int updateECDeviceMap(std::shared_ptr<Device> rx_dev,
                         std::shared_ptr<Device> tx_dev,
                         Stream *tx_str, int count, bool is_txstop);
@@ -496,21 +551,44 @@ protected:
     std::vector <std::shared_ptr<Device>> plugin_devices_;
     std::vector <pal_device_id_t> avail_devices_;
     std::map<Stream*, std::pair<uint32_t, bool>> mActiveStreamUserCounter;
+    /* admitted streams not registered yet, per session limit, under mActiveStreamMutex */
+    std::map<pal_stream_type_t, uint32_t> mReservedStreamSlots;
+    static thread_local int sPendingStreamSlot;
     bool bOverwriteFlag;
     bool screen_state_ = true;
     bool charging_state_;
     bool is_charger_online_;
     bool is_concurrent_boost_state_;
     bool use_lpi_;
+    /*
+     * Concurrency rules compiled from sound trigger platform info once it is
+     * parsed, so stream start/stop arbitration is a table lookup.
+     */
+    uint8_t st_conc_policy_[ST_CONC_TYPE_MAX];
+    uint8_t st_conc_decision_[ST_CONC_TYPE_MAX][PAL_STREAM_MAX][ST_CONC_DIR_MAX];
+    /* bit per st_conc_type_t with a non zero decision for a stream type/dir */
+    uint8_t st_conc_affected_[PAL_STREAM_MAX][ST_CONC_DIR_MAX];
+    /*
+     * registered detection streams per st_conc_type_t, shared sensor capture
+     * clients included, updated in register/deregisterStream
+     */
+    uint32_t st_conc_active_cnt_[ST_CONC_TYPE_MAX] = {};
+    /*
+     * EC refs of active tx streams, keyed by tx stream so that a start,
+     * stop or device switch touches only the pairs of that stream. A tx
+     * stream normally has a single pair. Protected by mResourceManagerMutex.
+     */
+    std::unordered_map<Stream *, std::vector<ec_ref_count_t>> ecRefCounts;
+    bool transit_to_nlpi_on_charging_;
     bool current_concurrent_state_;
     bool is_ICL_config_;
     pal_speaker_rotation_type rotation_type_;
     bool isDeviceSwitch = false;
+    /* when both are needed, mActiveStreamMutex is taken first */
     static std::mutex mResourceManagerMutex;
     static std::mutex mGraphMutex;
     static std::mutex mActiveStreamMutex;
     static std::mutex mSleepMonitorMutex;
-    static std::mutex mListFrontEndsMutex;
     static int snd_virt_card;
     static int snd_hw_card;
 
@@ -526,22 +604,23 @@ protected:
     static std::vector<std::pair<int32_t, int32_t>> devicePcmId;
     static std::vector<std::pair<int32_t, std::string>> deviceLinkName;
     static std::vector<int> listAllFrontEndIds;
-    static std::vector<int> listAllPcmPlaybackFrontEnds;
-    static std::vector<int> listAllPcmRecordFrontEnds;
-    static std::vector<int> listAllPcmHostlessRxFrontEnds;
-    static std::vector<int> listAllNonTunnelSessionIds;
-    static std::vector<int> listAllPcmHostlessTxFrontEnds;
-    static std::vector<int> listAllCompressPlaybackFrontEnds;
-    static std::vector<int> listAllCompressRecordFrontEnds;
-    static std::vector<int> listFreeFrontEndIds;
-    static std::vector<int> listAllPcmVoice1RxFrontEnds;
-    static std::vector<int> listAllPcmVoice1TxFrontEnds;
-    static std::vector<int> listAllPcmVoice2RxFrontEnds;
-    static std::vector<int> listAllPcmVoice2TxFrontEnds;
-    static std::vector<int> listAllPcmExtEcTxFrontEnds;
-    static std::vector<int> listAllPcmInCallRecordFrontEnds;
-    static std::vector<int> listAllPcmInCallMusicFrontEnds;
-    static std::vector<int> listAllPcmContextProxyFrontEnds;
+    static FrontEndIdPool pcmPlaybackFePool;
+    static FrontEndIdPool pcmRecordFePool;
+    static FrontEndIdPool pcmHostlessRxFePool;
+    static FrontEndIdPool pcmHostlessTxFePool;
+    static FrontEndIdPool nonTunnelSessionIdPool;
+    static FrontEndIdPool compressPlaybackFePool;
+    static FrontEndIdPool compressRecordFePool;
+    static FrontEndIdPool pcmVoice1RxFePool;
+    static FrontEndIdPool pcmVoice1TxFePool;
+    static FrontEndIdPool pcmVoice2RxFePool;
+    static FrontEndIdPool pcmVoice2TxFePool;
+    static FrontEndIdPool pcmExtEcTxFePool;
+    static FrontEndIdPool pcmInCallRecordFePool;
+    static FrontEndIdPool pcmInCallMusicFePool;
+    static FrontEndIdPool pcmContextProxyFePool;
+    static FrontEndIdPool* const frontEndPools[];
+    static std::string reservedFrontEndsCfg;
     static std::vector<std::pair<int32_t, std::string>> listAllBackEndIds;
     static std::vector<std::pair<int32_t, std::string>> sndDeviceNameLUT;
     static std::vector<deviceCap> devInfo;
@@ -552,6 +631,8 @@ protected:
     static std::map<uint32_t, uint32_t> btSlimClockSrcMap;
     static std::vector<deviceIn> deviceInfo;
     static std::vector<tx_ecinfo> txEcInfo;
+    /* txEcInfo flattened, [tx stream type][rx stream type] */
+    static bool ecRefDisabled[PAL_STREAM_MAX][PAL_STREAM_MAX];
     static struct vsid_info vsidInfo;
     static struct volume_set_param_info volumeSetParamInfo_;
     static struct disable_lpm_info disableLpmInfo_;
@@ -628,6 +709,9 @@ public:
     static bool isMainSpeakerRight;
     /* Variable to store Quick calibration time for Speaker protection */
     static int spQuickCalTime;
+    /* Speaker calibration reuse limits, 0 disables the check */
+    static int spCalValidityDays;
+    static int spCalTempWindow;
     /* Variable to store the mode request for Speaker protection */
     pal_spkr_prot_payload mSpkrProtModeValue;
 
@@ -680,6 +764,14 @@ public:
     adm_request_focus_v2_1_t  admRequestFocus_v2_1Fn = NULL;
     void *admData = NULL;
     void *admLibHdl = NULL;
+    /* optional subsystems, brought up on first use or once boot completes */
+    std::unique_ptr<PalLazyInit> admInit;
+    std::unique_ptr<PalLazyInit> chargerListenerLazyInit;
+    std::unique_ptr<PalLazyInit> vuiDmgrInit;
+    std::unique_ptr<PalLazyInit> speakerInit;
+    int prewarmTimer = 0;
+    void prewarmOnBootCompleted();
+    void initSubsystemsForStream(struct pal_stream_attributes *attributes);
     static void *cl_lib_handle;
     static cl_init_t cl_init;
     static cl_deinit_t cl_deinit;
@@ -698,6 +790,9 @@ public:
     /* checks config for both stream and device */
     bool isStreamSupported(struct pal_stream_attributes *attributes,
                            struct pal_device *devices, int no_of_devices);
+    bool reserveStreamSlot(struct pal_stream_attributes *attributes,
+                           struct pal_device *devices, int no_of_devices);
+    void releaseStreamSlot();
     int32_t getDeviceConfig(struct pal_device *deviceattr,
                             struct pal_stream_attributes *attributes);
     /*getDeviceInfo - updates channels, fluence info of the device*/
@@ -806,6 +901,9 @@ public:
     void freeFrontEndIds (const std::vector<int> f,
                           const struct pal_stream_attributes,
                           int lDirection);
+    static int reserveFrontEnds(const std::string &poolName, uint32_t num);
+    void getFrontEndPoolStats(std::vector<std::pair<std::string, fe_pool_stats_t>> &stats);
+    int32_t dumpState(int fd, pal_dump_format_t format);
     const std::vector<std::string> getBackEndNames(const std::vector<std::shared_ptr<Device>> &deviceList) const;
     void getSharedBEDevices(std::vector<std::shared_ptr<Device>> &deviceList, std::shared_ptr<Device> inDevice) const;
     void getBackEndNames( const std::vector<std::shared_ptr<Device>> &deviceList,
@@ -825,6 +923,8 @@ public:
                               std::vector <Stream *> prevActiveStreams);
     const std::string getPALDeviceName(const pal_device_id_t id) const;
     bool isNonALSACodec(const struct pal_device *device) const;
+    static int getStConcIndex(pal_stream_type_t type);
+    void compileConcurrencyPolicy();
     bool isNLPISwitchSupported(pal_stream_type_t type);
     bool IsLPISupported(pal_stream_type_t type);
     bool IsLowLatencyBargeinSupported(pal_stream_type_t type);
@@ -837,6 +937,7 @@ public:
     bool IsVirtualPortForUPDEnabled();
     bool IsCustomGainEnabledForUPD();
     void GetSoundTriggerConcurrencyCount(pal_stream_type_t type, int32_t *enable_count, int32_t *disable_count);
+    bool IsSensorCaptureSourceAvailable();
     void GetSoundTriggerConcurrencyCount_l(pal_stream_type_t type, int32_t *enable_count, int32_t *disable_count);
     bool GetChargingState() const { return charging_state_; }
     bool getChargerOnlineState(void) const { return is_charger_online_; }
@@ -923,6 +1024,7 @@ public:
     static int setUpdCustomGainParam(struct str_parms *parms,char *value, int len);
     static int setDualMonoEnableParam(struct str_parms *parms,char *value, int len);
     static int setSignalHandlerEnableParam(struct str_parms *parms,char *value, int len);
+    static int setReservedFrontEndsParam(struct str_parms *parms, char *value, int len);
     static int setMuxconfigEnableParam(struct str_parms *parms,char *value, int len);
     static int setSpkrXmaxTmaxLoggingParam(struct str_parms* parms, char* value, int len);
     static bool isLpiLoggingEnabled();
@@ -969,7 +1071,8 @@ public:
     char* getDeviceNameFromID(uint32_t id);
     int getPalValueFromGKV(pal_key_vector_t *gkv, int key);
     pal_speaker_rotation_type getCurrentRotationType();
-    void ssrHandler(card_status_t state);
+    /* only queues the state, handling runs on the ssr thread */
+    static void ssrHandler(card_status_t state);
     int32_t getSidetoneMode(pal_device_id_t deviceId, pal_stream_type_t type,
                             sidetone_mode_t *mode);
     int getStreamInstanceID(Stream *str);
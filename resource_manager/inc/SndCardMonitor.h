@@ -30,6 +30,7 @@
 #ifndef SNDCARD_MONITOR_H
 #define SNDCARD_MONITOR_H
 #include <list>
+#include <mutex>
 #include "PalDefs.h"
 
 typedef struct {
@@ -41,8 +42,12 @@ typedef struct {
 class SndCardMonitor
 {
 private :
-    std::thread mThread;
-    void monitorThreadLoop();
+    int mFd;
+    int mRetryTimer;
+    int mTries;
+    std::mutex mLock;
+    void openCardState();
+    void onCardStateEvent(uint32_t events);
 
 public :
     SndCardMonitor(int sndNum);
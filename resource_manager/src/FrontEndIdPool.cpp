@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#define LOG_TAG "PAL: FrontEndIdPool"
+
+#include <algorithm>
+#include <errno.h>
+#include "PalCommon.h"
+#include "FrontEndIdPool.h"
+
+FrontEndIdPool::FrontEndIdPool(const char *name)
+    : name_(name),
+      count_(0),
+      shared_(false),
+      freeMask_(0),
+      reserved_(0),
+      peakInUse_(0),
+      allocFailures_(0)
+{
+}
+
+/* ids keep the order of the card config, duplicates are dropped */
+void FrontEndIdPool::init(const std::vector<int> &ids, bool shared)
+{
+    std::vector<int> unique;
+
+    for (auto id : ids) {
+        if (std::find(unique.begin(), unique.end(), id) == unique.end())
+            unique.push_back(id);
+    }
+    if (unique.size() > FE_POOL_MAX_IDS) {
+        PAL_ERR(LOG_TAG, "%s: %zu frontends exceed pool capacity %d",
+                name_.c_str(), unique.size(), FE_POOL_MAX_IDS);
+        unique.resize(FE_POOL_MAX_IDS);
+    }
+
+    count_ = unique.size();
+    for (uint32_t i = 0; i < count_; i++)
+        ids_[i] = unique[i];
+    shared_ = shared;
+    freeMask_.store(count_ == FE_POOL_MAX_IDS ? ~0ULL : ((1ULL << count_) - 1));
+    reserved_.store(0);
+    peakInUse_.store(0);
+    allocFailures_.store(0);
+    PAL_DBG(LOG_TAG, "%s: %u frontends", name_.c_str(), count_);
+}
+
+void FrontEndIdPool::clear()
+{
+    count_ = 0;
+    freeMask_.store(0);
+    reserved_.store(0);
+}
+
+int FrontEndIdPool::indexOf(int id) const
+{
+    for (uint32_t i = 0; i < count_; i++) {
+        if (ids_[i] == id)
+            return i;
+    }
+    return -1;
+}
+
+/*
+ * Returns the free id listed last in the card config, the one the former
+ * per-class lists handed out first, or -ENOSPC if the pool is exhausted.
+ */
+int FrontEndIdPool::allocate(bool critical)
+{
+    uint64_t mask = freeMask_.load(std::memory_order_acquire);
+    uint32_t inUse = 0;
+    uint32_t peak = 0;
+    int idx = 0;
+
+    if (shared_) {
+        if (!count_)
+            goto exhausted;
+        return ids_[count_ - 1];
+    }
+
+    do {
+        if (!mask)
+            goto exhausted;
+        if (!critical &&
+            (uint32_t)__builtin_popcountll(mask) <= reserved_.load(std::memory_order_relaxed))
+            goto exhausted;
+        idx = 63 - __builtin_clzll(mask);
+    } while (!freeMask_.compare_exchange_weak(mask, mask & ~(1ULL << idx),
+                                              std::memory_order_acq_rel,
+                                              std::memory_order_acquire));
+
+    inUse = count_ - __builtin_popcountll(mask & ~(1ULL << idx));
+    peak = peakInUse_.load(std::memory_order_relaxed);
+    while (inUse > peak &&
+           !peakInUse_.compare_exchange_weak(peak, inUse, std::memory_order_relaxed));
+
+    return ids_[idx];
+
+exhausted:
+    allocFailures_.fetch_add(1, std::memory_order_relaxed);
+    PAL_ERR(LOG_TAG, "%s exhausted: %u of %u in use, %u reserved, critical %d",
+            name_.c_str(), count_ - available(), count_,
+            reserved_.load(std::memory_order_relaxed), critical);
+    return -ENOSPC;
+}
+
+int FrontEndIdPool::free(int id)
+{
+    int idx = indexOf(id);
+    uint64_t prev = 0;
+
+    if (idx < 0) {
+        PAL_ERR(LOG_TAG, "%s: frontend %d does not belong to pool", name_.c_str(), id);
+        return -EINVAL;
+    }
+
+    if (shared_)
+        return 0;
+
+    prev = freeMask_.fetch_or(1ULL << idx, std::memory_order_acq_rel);
+    if (prev & (1ULL << idx))
+        PAL_DBG(LOG_TAG, "%s: frontend %d was already free", name_.c_str(), id);
+
+    return 0;
+}
+
+int FrontEndIdPool::reserve(uint32_t num)
+{
+    if (num > count_) {
+        PAL_ERR(LOG_TAG, "%s: cannot reserve %u of %u frontends",
+                name_.c_str(), num, count_);
+        return -EINVAL;
+    }
+    reserved_.store(num);
+    PAL_INFO(LOG_TAG, "%s: %u of %u frontends reserved", name_.c_str(), num, count_);
+    return 0;
+}
+
+uint32_t FrontEndIdPool::available() const
+{
+    return __builtin_popcountll(freeMask_.load(std::memory_order_acquire));
+}
+
+void FrontEndIdPool::getStats(fe_pool_stats_t *stats) const
+{
+    if (!stats)
+        return;
+
+    stats->capacity = count_;
+    stats->reserved = reserved_.load(std::memory_order_relaxed);
+    stats->in_use = shared_ ? 0 : count_ - available();
+    stats->peak_in_use = peakInUse_.load(std::memory_order_relaxed);
+    stats->alloc_failures = allocFailures_.load(std::memory_order_relaxed);
+}
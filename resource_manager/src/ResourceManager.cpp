@@ -46,6 +46,7 @@
 #include "StreamContextProxy.h"
 #include "StreamUltraSound.h"
 #include "StreamSensorPCMData.h"
+#include "SessionAlsaUtils.h"
 #include "gsl_intf.h"
 #include "Headphone.h"
 #include "PayloadBuilder.h"
@@ -59,6 +60,8 @@
 #include "DisplayPort.h"
 #include "Handset.h"
 #include "SndCardMonitor.h"
+#include "PalEventLoop.h"
+#include "PalThreadPolicy.h"
 #include "UltrasoundDevice.h"
 #include "ECRefDevice.h"
 #include <agm/agm_api.h>
@@ -66,6 +69,7 @@
 #include <unistd.h>
 #include <dlfcn.h>
 #include <mutex>
+#include <sstream>
 #include "kvh2xml.h"
 #include <sys/ioctl.h>
 
@@ -146,6 +150,8 @@
 #define CLOCK_SRC_DEFAULT 1
 
 #define WAIT_LL_PB 4
+/* how often boot completion is checked before pre-warming subsystems */
+#define PREWARM_BOOT_POLL_MS 1000
 #define WAIT_RECOVER_FET 150000
 
 /*this can be over written by the config file settings*/
@@ -428,25 +434,32 @@ std::mutex ResourceManager::mResourceManagerMutex;
 std::mutex ResourceManager::mChargerBoostMutex;
 std::mutex ResourceManager::mGraphMutex;
 std::mutex ResourceManager::mActiveStreamMutex;
+thread_local int ResourceManager::sPendingStreamSlot = -1;
 std::mutex ResourceManager::mSleepMonitorMutex;
-std::mutex ResourceManager::mListFrontEndsMutex;
 std::vector <int> ResourceManager::listAllFrontEndIds = {0};
-std::vector <int> ResourceManager::listFreeFrontEndIds = {0};
-std::vector <int> ResourceManager::listAllPcmPlaybackFrontEnds = {0};
-std::vector <int> ResourceManager::listAllPcmRecordFrontEnds = {0};
-std::vector <int> ResourceManager::listAllPcmHostlessRxFrontEnds = {0};
-std::vector <int> ResourceManager::listAllPcmHostlessTxFrontEnds = {0};
-std::vector <int> ResourceManager::listAllPcmExtEcTxFrontEnds = {0};
-std::vector <int> ResourceManager::listAllCompressPlaybackFrontEnds = {0};
-std::vector <int> ResourceManager::listAllCompressRecordFrontEnds = {0};
-std::vector <int> ResourceManager::listAllPcmVoice1RxFrontEnds = {0};
-std::vector <int> ResourceManager::listAllPcmVoice1TxFrontEnds = {0};
-std::vector <int> ResourceManager::listAllPcmVoice2RxFrontEnds = {0};
-std::vector <int> ResourceManager::listAllPcmVoice2TxFrontEnds = {0};
-std::vector <int> ResourceManager::listAllPcmInCallRecordFrontEnds = {0};
-std::vector <int> ResourceManager::listAllPcmInCallMusicFrontEnds = {0};
-std::vector <int> ResourceManager::listAllNonTunnelSessionIds = {0};
-std::vector <int> ResourceManager::listAllPcmContextProxyFrontEnds = {0};
+FrontEndIdPool ResourceManager::pcmPlaybackFePool("pcm_playback");
+FrontEndIdPool ResourceManager::pcmRecordFePool("pcm_record");
+FrontEndIdPool ResourceManager::pcmHostlessRxFePool("pcm_hostless_rx");
+FrontEndIdPool ResourceManager::pcmHostlessTxFePool("pcm_hostless_tx");
+FrontEndIdPool ResourceManager::nonTunnelSessionIdPool("non_tunnel");
+FrontEndIdPool ResourceManager::compressPlaybackFePool("compress_playback");
+FrontEndIdPool ResourceManager::compressRecordFePool("compress_record");
+FrontEndIdPool ResourceManager::pcmVoice1RxFePool("voice1_rx");
+FrontEndIdPool ResourceManager::pcmVoice1TxFePool("voice1_tx");
+FrontEndIdPool ResourceManager::pcmVoice2RxFePool("voice2_rx");
+FrontEndIdPool ResourceManager::pcmVoice2TxFePool("voice2_tx");
+FrontEndIdPool ResourceManager::pcmExtEcTxFePool("ext_ec_tx");
+FrontEndIdPool ResourceManager::pcmInCallRecordFePool("incall_record");
+FrontEndIdPool ResourceManager::pcmInCallMusicFePool("incall_music");
+FrontEndIdPool ResourceManager::pcmContextProxyFePool("context_proxy");
+FrontEndIdPool* const ResourceManager::frontEndPools[] = {
+    &pcmPlaybackFePool, &pcmRecordFePool, &pcmHostlessRxFePool,
+    &pcmHostlessTxFePool, &nonTunnelSessionIdPool, &compressPlaybackFePool,
+    &compressRecordFePool, &pcmVoice1RxFePool, &pcmVoice1TxFePool,
+    &pcmVoice2RxFePool, &pcmVoice2TxFePool, &pcmExtEcTxFePool,
+    &pcmInCallRecordFePool, &pcmInCallMusicFePool, &pcmContextProxyFePool,
+};
+std::string ResourceManager::reservedFrontEndsCfg;
 struct audio_mixer* ResourceManager::audio_virt_mixer = NULL;
 struct audio_mixer* ResourceManager::audio_hw_mixer = NULL;
 struct audio_route* ResourceManager::audio_route = NULL;
@@ -500,6 +513,8 @@ static int max_nt_sessions;
 bool ResourceManager::isRasEnabled = false;
 bool ResourceManager::isMainSpeakerRight;
 int ResourceManager::spQuickCalTime;
+int ResourceManager::spCalValidityDays = 0;
+int ResourceManager::spCalTempWindow = 0;
 bool ResourceManager::isGaplessEnabled = false;
 bool ResourceManager::isDualMonoEnabled = false;
 bool ResourceManager::isUHQAEnabled = false;
@@ -541,6 +556,7 @@ void str_parms_destroy(struct str_parms *str_parms){return;}
 std::vector<vote_type_t> ResourceManager::sleep_monitor_vote_type_(PAL_STREAM_MAX, NLPI_VOTE);
 std::vector<deviceIn> ResourceManager::deviceInfo;
 std::vector<tx_ecinfo> ResourceManager::txEcInfo;
+bool ResourceManager::ecRefDisabled[PAL_STREAM_MAX][PAL_STREAM_MAX];
 struct vsid_info ResourceManager::vsidInfo;
 struct volume_set_param_info ResourceManager::volumeSetParamInfo_;
 struct disable_lpm_info ResourceManager::disableLpmInfo_;
@@ -791,6 +807,8 @@ ResourceManager::ResourceManager()
 {
     PAL_INFO(LOG_TAG, "Enter: %p", this);
     int ret = 0;
+    /* re-enable the event loop torn down by a previous deinit() */
+    PalEventLoop::init();
     // Init audio_route and audio_mixer
     sleepmon_fd_ = -1;
     na_props.rm_na_prop_enabled = false;
@@ -870,81 +888,79 @@ ResourceManager::ResourceManager()
         PAL_ERR(LOG_TAG, "Failed to open ADSP sleep monitor file");
 #endif
     listAllFrontEndIds.clear();
-    listFreeFrontEndIds.clear();
-    listAllPcmPlaybackFrontEnds.clear();
-    listAllPcmRecordFrontEnds.clear();
-    listAllPcmHostlessRxFrontEnds.clear();
-    listAllNonTunnelSessionIds.clear();
-    listAllPcmHostlessTxFrontEnds.clear();
-    listAllCompressPlaybackFrontEnds.clear();
-    listAllCompressRecordFrontEnds.clear();
-    listAllPcmVoice1RxFrontEnds.clear();
-    listAllPcmVoice1TxFrontEnds.clear();
-    listAllPcmVoice2RxFrontEnds.clear();
-    listAllPcmVoice2TxFrontEnds.clear();
-    listAllPcmInCallRecordFrontEnds.clear();
-    listAllPcmInCallMusicFrontEnds.clear();
-    listAllPcmContextProxyFrontEnds.clear();
-    listAllPcmExtEcTxFrontEnds.clear();
     memset(stream_instances, 0, PAL_STREAM_MAX * sizeof(uint64_t));
     memset(in_stream_instances, 0, PAL_STREAM_MAX * sizeof(uint64_t));
 
-    for (int i=0; i < devInfo.size(); i++) {
+    {
+        std::map<FrontEndIdPool *, std::vector<int>> poolIds;
+
+        for (int i=0; i < devInfo.size(); i++) {
+
+            if (devInfo[i].type == PCM) {
+                if (devInfo[i].sess_mode == HOSTLESS && devInfo[i].playback == 1) {
+                    poolIds[&pcmHostlessRxFePool].push_back(devInfo[i].deviceId);
+                } else if (devInfo[i].sess_mode == HOSTLESS && devInfo[i].record == 1) {
+                    poolIds[&pcmHostlessTxFePool].push_back(devInfo[i].deviceId);
+                } else if (devInfo[i].playback == 1 && devInfo[i].sess_mode == DEFAULT) {
+                    poolIds[&pcmPlaybackFePool].push_back(devInfo[i].deviceId);
+                } else if (devInfo[i].record == 1 && devInfo[i].sess_mode == DEFAULT) {
+                    poolIds[&pcmRecordFePool].push_back(devInfo[i].deviceId);
+                } else if (devInfo[i].sess_mode == NON_TUNNEL && devInfo[i].record == 1) {
+                    poolIds[&pcmInCallRecordFePool].push_back(devInfo[i].deviceId);
+                } else if (devInfo[i].sess_mode == NON_TUNNEL && devInfo[i].playback == 1) {
+                    poolIds[&pcmInCallMusicFePool].push_back(devInfo[i].deviceId);
+                } else if (devInfo[i].sess_mode == NO_CONFIG && devInfo[i].record == 1) {
+                    poolIds[&pcmContextProxyFePool].push_back(devInfo[i].deviceId);
+                }
+            } else if (devInfo[i].type == COMPRESS) {
+                if (devInfo[i].playback == 1) {
+                    poolIds[&compressPlaybackFePool].push_back(devInfo[i].deviceId);
+                } else if (devInfo[i].record == 1) {
+                    poolIds[&compressRecordFePool].push_back(devInfo[i].deviceId);
+                }
+            } else if (devInfo[i].type == VOICE1) {
+                if (devInfo[i].sess_mode == HOSTLESS && devInfo[i].playback == 1) {
+                    poolIds[&pcmVoice1RxFePool].push_back(devInfo[i].deviceId);
+                }
+                if (devInfo[i].sess_mode == HOSTLESS && devInfo[i].record == 1) {
+                    poolIds[&pcmVoice1TxFePool].push_back(devInfo[i].deviceId);
+                }
+            } else if (devInfo[i].type == VOICE2) {
+                if (devInfo[i].sess_mode == HOSTLESS && devInfo[i].playback == 1) {
+                    poolIds[&pcmVoice2RxFePool].push_back(devInfo[i].deviceId);
+                }
+                if (devInfo[i].sess_mode == HOSTLESS && devInfo[i].record == 1) {
+                    poolIds[&pcmVoice2TxFePool].push_back(devInfo[i].deviceId);
+                }
+            } else if (devInfo[i].type == ExtEC) {
+                if (devInfo[i].sess_mode == HOSTLESS && devInfo[i].record == 1) {
+                    poolIds[&pcmExtEcTxFePool].push_back(devInfo[i].deviceId);
+                }
+            }
+            /*We create a master list of all the frontends*/
+            listAllFrontEndIds.push_back(devInfo[i].deviceId);
+        }
+        /*
+         *Arrange all the FrontendIds in descending order, this gives the
+         *largest deviceId being used for ALSA usecases.
+         *For NON-TUNNEL usecases the sessionIds to be used are formed by incrementing the largest used deviceID
+         *with number of non-tunnel sessions supported on a platform. This way we avoid any conflict of deviceIDs.
+         */
+        sort(listAllFrontEndIds.rbegin(), listAllFrontEndIds.rend());
+        int maxDeviceIdInUse = listAllFrontEndIds.at(0);
+        for (int i = 0; i < max_nt_sessions; i++)
+            poolIds[&nonTunnelSessionIdPool].push_back(maxDeviceIdInUse + i);
 
-        if (devInfo[i].type == PCM) {
-            if (devInfo[i].sess_mode == HOSTLESS && devInfo[i].playback == 1) {
-                listAllPcmHostlessRxFrontEnds.push_back(devInfo[i].deviceId);
-            } else if (devInfo[i].sess_mode == HOSTLESS && devInfo[i].record == 1) {
-                listAllPcmHostlessTxFrontEnds.push_back(devInfo[i].deviceId);
-            } else if (devInfo[i].playback == 1 && devInfo[i].sess_mode == DEFAULT) {
-                listAllPcmPlaybackFrontEnds.push_back(devInfo[i].deviceId);
-            } else if (devInfo[i].record == 1 && devInfo[i].sess_mode == DEFAULT) {
-                listAllPcmRecordFrontEnds.push_back(devInfo[i].deviceId);
-            } else if (devInfo[i].sess_mode == NON_TUNNEL && devInfo[i].record == 1) {
-                listAllPcmInCallRecordFrontEnds.push_back(devInfo[i].deviceId);
-            } else if (devInfo[i].sess_mode == NON_TUNNEL && devInfo[i].playback == 1) {
-                listAllPcmInCallMusicFrontEnds.push_back(devInfo[i].deviceId);
-            } else if (devInfo[i].sess_mode == NO_CONFIG && devInfo[i].record == 1) {
-                listAllPcmContextProxyFrontEnds.push_back(devInfo[i].deviceId);
-            }
-        } else if (devInfo[i].type == COMPRESS) {
-            if (devInfo[i].playback == 1) {
-                listAllCompressPlaybackFrontEnds.push_back(devInfo[i].deviceId);
-            } else if (devInfo[i].record == 1) {
-                listAllCompressRecordFrontEnds.push_back(devInfo[i].deviceId);
-            }
-        } else if (devInfo[i].type == VOICE1) {
-            if (devInfo[i].sess_mode == HOSTLESS && devInfo[i].playback == 1) {
-                listAllPcmVoice1RxFrontEnds.push_back(devInfo[i].deviceId);
-            }
-            if (devInfo[i].sess_mode == HOSTLESS && devInfo[i].record == 1) {
-                listAllPcmVoice1TxFrontEnds.push_back(devInfo[i].deviceId);
-            }
-        } else if (devInfo[i].type == VOICE2) {
-            if (devInfo[i].sess_mode == HOSTLESS && devInfo[i].playback == 1) {
-                listAllPcmVoice2RxFrontEnds.push_back(devInfo[i].deviceId);
-            }
-            if (devInfo[i].sess_mode == HOSTLESS && devInfo[i].record == 1) {
-                listAllPcmVoice2TxFrontEnds.push_back(devInfo[i].deviceId);
-            }
-        } else if (devInfo[i].type == ExtEC) {
-            if (devInfo[i].sess_mode == HOSTLESS && devInfo[i].record == 1) {
-                listAllPcmExtEcTxFrontEnds.push_back(devInfo[i].deviceId);
-            }
-        }
-        /*We create a master list of all the frontends*/
-        listAllFrontEndIds.push_back(devInfo[i].deviceId);
+        /*
+         * Voice frontends are bound to a VSID and handed out without being
+         * consumed, every call on the same VSID uses the same frontend.
+         */
+        for (auto pool : frontEndPools)
+            pool->init(poolIds[pool], (pool == &pcmVoice1RxFePool) ||
+                       (pool == &pcmVoice1TxFePool) || (pool == &pcmVoice2RxFePool) ||
+                       (pool == &pcmVoice2TxFePool));
+        applyFrontEndReservations();
     }
-    /*
-     *Arrange all the FrontendIds in descending order, this gives the
-     *largest deviceId being used for ALSA usecases.
-     *For NON-TUNNEL usecases the sessionIds to be used are formed by incrementing the largest used deviceID
-     *with number of non-tunnel sessions supported on a platform. This way we avoid any conflict of deviceIDs.
-     */
-     sort(listAllFrontEndIds.rbegin(), listAllFrontEndIds.rend());
-     int maxDeviceIdInUse = listAllFrontEndIds.at(0);
-     for (int i = 0; i < max_nt_sessions; i++)
-          listAllNonTunnelSessionIds.push_back(maxDeviceIdInUse + i);
 
     // Get AGM service handle
     ret = agm_register_service_crash_callback(&agmServiceCrashHandler,
@@ -958,7 +974,29 @@ ResourceManager::ResourceManager()
     mNTStreamInstancesList[NT_PATH_ENCODE] = encodeMap;
     mNTStreamInstancesList[NT_PATH_DECODE] = decodeMap;
 
-    ResourceManager::loadAdmLib();
+    admInit.reset(new PalLazyInit("adm",
+        [this]() { loadAdmLib(); return 0; }));
+    chargerListenerLazyInit.reset(new PalLazyInit("charger listener",
+        [this]() {
+            if (isChargeConcurrencyEnabled)
+                chargerListenerFeatureInit();
+            return 0;
+        },
+        []() {
+            if (isChargeConcurrencyEnabled)
+                chargerListenerDeinit();
+        }));
+    vuiDmgrInit.reset(new PalLazyInit("voiceui dmgr",
+        []() { voiceuiDmgrManagerInit(); return 0; },
+        []() { voiceuiDmgrManagerDeInit(); }));
+    // creating the speaker starts speaker protection and its calibration
+    speakerInit.reset(new PalLazyInit("speaker",
+        [this]() {
+            struct pal_device dattr;
+
+            dattr.id = PAL_DEVICE_OUT_SPEAKER;
+            return Device::getInstance(&dattr, rm) ? 0 : -ENODEV;
+        }));
     ResourceManager::initWakeLocks();
     ret = PayloadBuilder::init();
     if (ret) {
@@ -974,6 +1012,8 @@ ResourceManager::ResourceManager()
 
     }
 
+    compileConcurrencyPolicy();
+
     // init use_lpi_ flag
     use_lpi_ = IsLPISupported(PAL_STREAM_VOICE_UI) ||
         IsLPISupported(PAL_STREAM_ACD) ||
@@ -992,22 +1032,12 @@ ResourceManager::~ResourceManager()
     deviceTag.clear();
 
     listAllFrontEndIds.clear();
-    listAllPcmPlaybackFrontEnds.clear();
-    listAllPcmRecordFrontEnds.clear();
-    listAllPcmHostlessRxFrontEnds.clear();
-    listAllPcmHostlessTxFrontEnds.clear();
-    listAllCompressPlaybackFrontEnds.clear();
-    listAllCompressRecordFrontEnds.clear();
-    listFreeFrontEndIds.clear();
-    listAllPcmVoice1RxFrontEnds.clear();
-    listAllPcmVoice1TxFrontEnds.clear();
-    listAllPcmVoice2RxFrontEnds.clear();
-    listAllPcmVoice2TxFrontEnds.clear();
-    listAllNonTunnelSessionIds.clear();
-    listAllPcmExtEcTxFrontEnds.clear();
+    for (auto pool : frontEndPools)
+        pool->clear();
     devInfo.clear();
     deviceInfo.clear();
     txEcInfo.clear();
+    memset(ecRefDisabled, 0, sizeof(ecRefDisabled));
 
     STInstancesLists.clear();
     listAllBackEndIds.clear();
@@ -1239,6 +1269,7 @@ exit:
 
 void ResourceManager::ssrHandlingLoop(std::shared_ptr<ResourceManager> rm)
 {
+    PalThreadScope threadScope(PAL_THREAD_CLASS_SSR, "ssr");
     card_status_t state;
     card_status_t prevState = CARD_STATUS_ONLINE;
     std::unique_lock<std::mutex> lock(rm->cvMutex);
@@ -1327,6 +1358,9 @@ void ResourceManager::ssrHandlingLoop(std::shared_ptr<ResourceManager> rm)
                 }
                 prevState = state;
             } else if (state == CARD_STATUS_ONLINE) {
+                std::vector<Stream*> ssrStreams;
+                std::chrono::steady_clock::time_point ssrStart = std::chrono::steady_clock::now();
+
                 if (isContextManagerEnabled) {
                     mActiveStreamMutex.unlock();
                     ret = ctxMgr->ssrUpHandler();
@@ -1343,16 +1377,15 @@ void ResourceManager::ssrHandlingLoop(std::shared_ptr<ResourceManager> rm)
                         PAL_ERR(LOG_TAG, "Error incrementing the stream counter for the stream handle: %pK", str);
                         continue;
                     }
-                    ret = str->ssrUpHandler();
-                    if (0 != ret) {
-                        PAL_ERR(LOG_TAG, "Ssr up handling failed for %pK ret %d",
-                                          str, ret);
-                    }
-                    ret = decreaseStreamUserCounter(str);
-                    if (0 != ret) {
-                        PAL_ERR(LOG_TAG, "Error decrementing the stream counter for the stream handle: %pK", str);
-                    }
+                    ssrStreams.push_back(str);
                 }
+                /*
+                 * streams are pinned by their user counters, restore them
+                 * unlocked; each counter is dropped once its stream is up
+                 */
+                mActiveStreamMutex.unlock();
+                rm->recoverStreamsOnSsr(ssrStreams, ssrStart);
+                mActiveStreamMutex.lock();
                 prevState = state;
             } else {
                 PAL_ERR(LOG_TAG, "Invalid state. state %d", state);
@@ -1364,6 +1397,188 @@ void ResourceManager::ssrHandlingLoop(std::shared_ptr<ResourceManager> rm)
     PAL_INFO(LOG_TAG, "ssr Handling thread ended");
 }
 
+int ResourceManager::getSsrRecoveryPriority(Stream *s)
+{
+    pal_stream_type_t type = PAL_STREAM_LOW_LATENCY;
+
+    s->getStreamType(&type);
+    switch (type) {
+        case PAL_STREAM_VOICE_CALL:
+        case PAL_STREAM_VOIP:
+        case PAL_STREAM_VOIP_RX:
+        case PAL_STREAM_VOIP_TX:
+            return SSR_RECOVERY_PRIO_VOICE;
+        case PAL_STREAM_VOICE_UI:
+        case PAL_STREAM_ACD:
+        case PAL_STREAM_SENSOR_PCM_DATA:
+        case PAL_STREAM_ULTRASOUND:
+        case PAL_STREAM_CONTEXT_PROXY:
+            return SSR_RECOVERY_PRIO_BACKGROUND;
+        default:
+            return SSR_RECOVERY_PRIO_DEFAULT;
+    }
+}
+
+/*
+ * Streams sharing a backend end up in the same group, ordered by priority,
+ * so the shared device is brought up once by the most important stream
+ * before the others attach to it. A tx stream also counts the backends of
+ * the rx devices it can take its EC reference from, so it is restored after
+ * the rx streams feeding that reference. Groups are ordered by their highest
+ * stream priority.
+ */
+void ResourceManager::buildSsrRecoveryGroups(std::vector<Stream*> &streams,
+                                             std::vector<ssr_recovery_group_t> &groups)
+{
+    std::vector<std::shared_ptr<Device>> associatedDevices;
+    std::vector<std::string> backEnds;
+    std::string ecBackEnd;
+    auto byPriority = [](Stream *a, Stream *b) {
+        return getSsrRecoveryPriority(a) > getSsrRecoveryPriority(b);
+    };
+
+    groups.clear();
+    for (auto str : streams) {
+        ssr_recovery_group_t group;
+
+        associatedDevices.clear();
+        str->getAssociatedDevices(associatedDevices);
+        backEnds = getBackEndNames(associatedDevices);
+        group.backEnds.insert(backEnds.begin(), backEnds.end());
+        for (auto &dev : associatedDevices) {
+            for (auto &info : deviceInfo) {
+                if (info.deviceId != dev->getSndDeviceId())
+                    continue;
+                for (auto rxDevId : info.rx_dev_ids) {
+                    if (getBackendName(rxDevId, ecBackEnd) == 0)
+                        group.backEnds.insert(ecBackEnd);
+                }
+            }
+        }
+        group.priority = getSsrRecoveryPriority(str);
+
+        for (auto it = groups.begin(); it != groups.end();) {
+            bool shared = false;
+
+            for (auto &be : it->backEnds) {
+                if (group.backEnds.count(be)) {
+                    shared = true;
+                    break;
+                }
+            }
+            if (!shared) {
+                it++;
+                continue;
+            }
+            group.backEnds.insert(it->backEnds.begin(), it->backEnds.end());
+            group.streams.insert(group.streams.end(), it->streams.begin(), it->streams.end());
+            group.priority = std::max(group.priority, it->priority);
+            it = groups.erase(it);
+        }
+        group.streams.push_back(str);
+        std::stable_sort(group.streams.begin(), group.streams.end(), byPriority);
+        groups.push_back(group);
+    }
+
+    std::stable_sort(groups.begin(), groups.end(),
+        [](const ssr_recovery_group_t &a, const ssr_recovery_group_t &b) {
+            return a.priority > b.priority;
+        });
+}
+
+/*
+ * Runs ssrUpHandler of all given streams. Groups of streams with no backend
+ * in common are restored concurrently on up to SSR_RECOVERY_MAX_WORKERS
+ * threads, picked highest priority first so voice and VoIP are never queued
+ * behind sound trigger or sensor streams. As soon as a stream is restored
+ * its user counter is dropped and its time to recover is reported to the
+ * client, with no RM lock held so the client may call back into PAL, even
+ * to close that stream. The total is reported once all streams are up.
+ * Called without mActiveStreamMutex and with stream user counters taken.
+ */
+void ResourceManager::recoverStreamsOnSsr(std::vector<Stream*> &streams,
+                                          std::chrono::steady_clock::time_point ssrStart)
+{
+    std::vector<ssr_recovery_group_t> groups;
+    std::vector<std::thread> workers;
+    std::atomic<uint32_t> nextGroup(0);
+    std::mutex reportMutex;
+    std::mutex notifyMutex;
+    pal_ssr_recovery_stats_t stats = {0, 0, 0, 0};
+    uint32_t numWorkers = 0;
+
+    buildSsrRecoveryGroups(streams, groups);
+    PAL_INFO(LOG_TAG, "restoring %zu streams in %zu groups", streams.size(), groups.size());
+
+    auto recoverGroups = [&]() {
+        uint32_t idx = 0;
+        int32_t status = 0;
+        int32_t ret = 0;
+        int prio = SSR_RECOVERY_PRIO_DEFAULT;
+        pal_stream_type_t type = PAL_STREAM_LOW_LATENCY;
+        pal_ssr_stream_recovery_t streamStats;
+
+        while ((idx = nextGroup.fetch_add(1)) < groups.size()) {
+            for (auto str : groups[idx].streams) {
+                status = str->ssrUpHandler();
+                if (0 != status) {
+                    PAL_ERR(LOG_TAG, "Ssr up handling failed for %pK ret %d",
+                                      str, status);
+                }
+                str->getStreamType(&type);
+                prio = getSsrRecoveryPriority(str);
+                streamStats.stream_type = type;
+                streamStats.status = status;
+                streamStats.recovery_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - ssrStart).count();
+                PAL_INFO(LOG_TAG, "stream %pK type %d restored in %u ms, status %d",
+                         str, type, streamStats.recovery_ms, status);
+
+                /* str may be closed from here on */
+                mActiveStreamMutex.lock();
+                ret = decreaseStreamUserCounter(str);
+                mActiveStreamMutex.unlock();
+                if (0 != ret) {
+                    PAL_ERR(LOG_TAG, "Error decrementing the stream counter for the stream handle: %pK", str);
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(reportMutex);
+                    stats.num_streams++;
+                    if (status)
+                        stats.num_failed++;
+                    if (prio == SSR_RECOVERY_PRIO_VOICE)
+                        stats.voice_ms = std::max(stats.voice_ms, streamStats.recovery_ms);
+                }
+                /* one event at a time, the client sees them in completion order */
+                if (globalCb) {
+                    std::lock_guard<std::mutex> lock(notifyMutex);
+                    globalCb(PAL_SSR_STREAM_RECOVERED, (uint32_t *)&streamStats, cookie);
+                }
+            }
+        }
+    };
+
+    numWorkers = std::min<uint32_t>(groups.size(), SSR_RECOVERY_MAX_WORKERS);
+    for (uint32_t i = 1; i < numWorkers; i++) {
+        workers.push_back(std::thread([&]() {
+            PalThreadScope threadScope(PAL_THREAD_CLASS_SSR, "ssr_recovery");
+            recoverGroups();
+        }));
+    }
+    /* the ssr loop thread is already in its class */
+    recoverGroups();
+    for (auto &worker : workers)
+        worker.join();
+
+    stats.total_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - ssrStart).count();
+    PAL_INFO(LOG_TAG, "ssr recovery done, %u streams %u failed, voice %u ms total %u ms",
+             stats.num_streams, stats.num_failed, stats.voice_ms, stats.total_ms);
+    if (globalCb)
+        globalCb(PAL_SSR_RECOVERY_DONE, (uint32_t *)&stats, cookie);
+}
+
 int ResourceManager::initSndMonitor()
 {
     int ret = 0;
@@ -1695,32 +1910,61 @@ void ResourceManager::deInitContextManager()
 
 int ResourceManager::init()
 {
-    std::shared_ptr<Device> dev = nullptr;
-
-    // Initialize Speaker Protection calibration mode
-    struct pal_device dattr;
+    PalEventLoop *loop = NULL;
 
     mixerEventTread = std::thread(mixerEventWaitThreadLoop, rm);
 
-    //Initialize audio_charger_listener
-    if (rm && isChargeConcurrencyEnabled)
-        rm->chargerListenerFeatureInit();
-
-    // Get the speaker instance and activate speaker protection
-    dattr.id = PAL_DEVICE_OUT_SPEAKER;
-    dev = std::dynamic_pointer_cast<Device>(Device::getInstance(&dattr , rm));
-    if (dev) {
-        PAL_DBG(LOG_TAG, "Speaker instance created");
+    /*
+     * The charger listener, voiceui dmgr, ADM and the speaker (with speaker
+     * protection) are brought up by the first stream needing them, see
+     * initSubsystemsForStream(), or in the background once boot completes.
+     */
+    loop = PalEventLoop::getInstance();
+    if (rm && loop) {
+        rm->prewarmTimer = loop->addTimer(PREWARM_BOOT_POLL_MS, PREWARM_BOOT_POLL_MS,
+                                          []() { rm->prewarmOnBootCompleted(); });
+        if (rm->prewarmTimer < 0)
+            PAL_ERR(LOG_TAG, "failed to schedule pre-warm %d", rm->prewarmTimer);
     }
-    else
-        PAL_DBG(LOG_TAG, "Speaker instance not created");
-
-    PAL_INFO(LOG_TAG, "Initialize voiceui dmgr");
-    voiceuiDmgrManagerInit();
 
     return 0;
 }
 
+void ResourceManager::prewarmOnBootCompleted()
+{
+    PalEventLoop *loop = NULL;
+#ifndef FEATURE_IPQ_OPENWRT
+    char value[256] = {0};
+
+    property_get("sys.boot_completed", value, "0");
+    if (strcmp(value, "1"))
+        return;
+#endif
+    loop = PalEventLoop::getInstance();
+    if (loop)
+        loop->cancelTimer(prewarmTimer);
+
+    PAL_INFO(LOG_TAG, "boot completed, pre-warming optional subsystems");
+    admInit->prewarm();
+    chargerListenerLazyInit->prewarm();
+    vuiDmgrInit->prewarm();
+    speakerInit->prewarm();
+}
+
+/*
+ * Called from pal_stream_open before the stream is created, without any PAL
+ * lock held: the charger listener and voiceui dmgr may call back into
+ * ResourceManager while they initialize.
+ */
+void ResourceManager::initSubsystemsForStream(struct pal_stream_attributes *attributes)
+{
+    admInit->get();
+    if (attributes->direction != PAL_AUDIO_INPUT)
+        chargerListenerLazyInit->get();
+    if (attributes->type == PAL_STREAM_VOICE_UI)
+        vuiDmgrInit->get();
+}
+
 bool ResourceManager::isLpiLoggingEnabled()
 {
     char value[256] = {0};
@@ -2156,17 +2400,10 @@ bool ResourceManager::getEcRefStatus(pal_stream_type_t tx_streamtype,pal_stream_
        PAL_DBG(LOG_TAG, "no need to enable ec for tx stream %d", tx_streamtype);
        return false;
     }
-    for (int i = 0; i < txEcInfo.size(); i++) {
-        if (tx_streamtype == txEcInfo[i].tx_stream_type) {
-            for (auto rx_type = txEcInfo[i].disabled_rx_streams.begin();
-                  rx_type != txEcInfo[i].disabled_rx_streams.end(); rx_type++) {
-               if (rx_streamtype == *rx_type) {
-                   ecref_status = false;
-                   PAL_DBG(LOG_TAG, "given rx %d disabled %d status %d",rx_streamtype, *rx_type, ecref_status);
-                   break;
-               }
-            }
-        }
+    if (tx_streamtype < PAL_STREAM_MAX && rx_streamtype < PAL_STREAM_MAX &&
+        ecRefDisabled[tx_streamtype][rx_streamtype]) {
+        ecref_status = false;
+        PAL_DBG(LOG_TAG, "given rx %d disabled status %d", rx_streamtype, ecref_status);
     }
     return ecref_status;
 }
@@ -2808,6 +3045,30 @@ exit:
     return status;
 }
 
+/* stream types sharing one session limit in isStreamSupported share a slot */
+static pal_stream_type_t streamSlotType(pal_stream_type_t type)
+{
+    switch (type) {
+        case PAL_STREAM_VOIP:
+        case PAL_STREAM_VOIP_RX:
+        case PAL_STREAM_VOIP_TX:
+            return PAL_STREAM_LOW_LATENCY;
+        case PAL_STREAM_LOOPBACK:
+        case PAL_STREAM_TRANSCODE:
+            return PAL_STREAM_VOICE_UI;
+        default:
+            return type;
+    }
+}
+
+static size_t reservedStreamSlots(const std::map<pal_stream_type_t, uint32_t> &slots,
+                                  pal_stream_type_t type)
+{
+    auto it = slots.find(streamSlotType(type));
+
+    return (it != slots.end()) ? it->second : 0;
+}
+
 bool ResourceManager::isStreamSupported(struct pal_stream_attributes *attributes,
                                         struct pal_device *devices, int no_of_devices)
 {
@@ -2817,6 +3078,7 @@ bool ResourceManager::isStreamSupported(struct pal_stream_attributes *attributes
     uint32_t rc;
     size_t cur_sessions = 0;
     size_t max_sessions = 0;
+    bool limited = true;
 
     if (!attributes || ((no_of_devices > 0) && !devices)) {
         PAL_ERR(LOG_TAG, "Invalid input parameter attr %p, noOfDevices %d devices %p",
@@ -2908,16 +3170,25 @@ bool ResourceManager::isStreamSupported(struct pal_stream_attributes *attributes
             max_sessions = MAX_SESSIONS_ULTRASOUND;
             break;
         case PAL_STREAM_SENSOR_PCM_DATA:
-            cur_sessions = active_streams_sensor_pcm_data.size();
+            /* shared capture clients hold no graph, Attach checks the sources */
+            if (ACDPlatformInfo::GetInstance() &&
+                ACDPlatformInfo::GetInstance()->IsSharedSensorCaptureEnabled())
+                limited = false;
+            else
+                cur_sessions = active_streams_sensor_pcm_data.size();
             max_sessions = MAX_SESSIONS_SENSOR_PCM_DATA;
             break;
         default:
             PAL_ERR(LOG_TAG, "Invalid stream type = %d", type);
         return result;
     }
-    if (cur_sessions == max_sessions && type != PAL_STREAM_VOICE_CALL) {
+    /* admitted streams still running their constructor hold a session too */
+    if (limited)
+        cur_sessions += reservedStreamSlots(mReservedStreamSlots, type);
+    if (limited && cur_sessions >= max_sessions && type != PAL_STREAM_VOICE_CALL) {
         if (type == PAL_STREAM_VOICE_RECOGNITION &&
-            active_streams_db.size() < MAX_SESSIONS_DEEP_BUFFER) {
+            active_streams_db.size() + reservedStreamSlots(mReservedStreamSlots,
+                PAL_STREAM_DEEP_BUFFER) < MAX_SESSIONS_DEEP_BUFFER) {
                 attributes->type = PAL_STREAM_DEEP_BUFFER;
                 type = PAL_STREAM_DEEP_BUFFER;
         } else {
@@ -3056,6 +3327,42 @@ bool ResourceManager::isStreamSupported(struct pal_stream_attributes *attributes
     return result;
 }
 
+/*
+ * Admits a new stream and holds its session until the constructor registers
+ * it, so that streams can be constructed in parallel without going over the
+ * session limits. The reservation belongs to the calling thread.
+ */
+bool ResourceManager::reserveStreamSlot(struct pal_stream_attributes *attributes,
+                                        struct pal_device *devices, int no_of_devices)
+{
+    bool result = false;
+
+    mActiveStreamMutex.lock();
+    if (sPendingStreamSlot >= 0) {
+        PAL_ERR(LOG_TAG, "stream slot %d already reserved", sPendingStreamSlot);
+        goto exit;
+    }
+    result = isStreamSupported(attributes, devices, no_of_devices);
+    if (result) {
+        sPendingStreamSlot = streamSlotType(attributes->type);
+        mReservedStreamSlots[streamSlotType(attributes->type)]++;
+    }
+exit:
+    mActiveStreamMutex.unlock();
+    return result;
+}
+
+/* drops a reservation the constructor did not consume, e.g. on failure */
+void ResourceManager::releaseStreamSlot()
+{
+    mActiveStreamMutex.lock();
+    if (sPendingStreamSlot >= 0) {
+        mReservedStreamSlots[(pal_stream_type_t)sPendingStreamSlot]--;
+        sPendingStreamSlot = -1;
+    }
+    mActiveStreamMutex.unlock();
+}
+
 template <class T>
 int registerstream(T s, std::list<T> &streams)
 {
@@ -3076,6 +3383,10 @@ int ResourceManager::registerStream(Stream *s)
     }
     PAL_DBG(LOG_TAG, "stream type %d", type);
     mActiveStreamMutex.lock();
+    if (sPendingStreamSlot == streamSlotType(type)) {
+        mReservedStreamSlots[streamSlotType(type)]--;
+        sPendingStreamSlot = -1;
+    }
     switch (type) {
         case PAL_STREAM_LOW_LATENCY:
         case PAL_STREAM_VOIP_RX:
@@ -3182,7 +3493,9 @@ int ResourceManager::registerStream(Stream *s)
         case PAL_STREAM_SENSOR_PCM_DATA:
         {
             StreamSensorPCMData* sPCM = dynamic_cast<StreamSensorPCMData*>(s);
-            ret = registerstream(sPCM, active_streams_sensor_pcm_data);
+            /* only the stream owning a shared graph counts as a session */
+            if (!sPCM->IsSharedCaptureClient())
+                ret = registerstream(sPCM, active_streams_sensor_pcm_data);
             break;
         }
         case PAL_STREAM_CONTEXT_PROXY:
@@ -3203,6 +3516,8 @@ int ResourceManager::registerStream(Stream *s)
             break;
     }
     mActiveStreams.push_back(s);
+    if (getStConcIndex(type) >= 0)
+        st_conc_active_cnt_[getStConcIndex(type)]++;
 
 #if 0
     s->getStreamAttributes(&incomingStreamAttr);
@@ -3363,7 +3678,8 @@ int ResourceManager::deregisterStream(Stream *s)
         case PAL_STREAM_SENSOR_PCM_DATA:
         {
             StreamSensorPCMData* sPCM = dynamic_cast<StreamSensorPCMData*>(s);
-            ret = deregisterstream(sPCM, active_streams_sensor_pcm_data);
+            if (!sPCM->IsSharedCaptureClient())
+                ret = deregisterstream(sPCM, active_streams_sensor_pcm_data);
             break;
         }
         case PAL_STREAM_CONTEXT_PROXY:
@@ -3384,7 +3700,9 @@ int ResourceManager::deregisterStream(Stream *s)
             break;
     }
 
-    deregisterstream(s, mActiveStreams);
+    if (!deregisterstream(s, mActiveStreams) && getStConcIndex(type) >= 0 &&
+        st_conc_active_cnt_[getStConcIndex(type)] > 0)
+        st_conc_active_cnt_[getStConcIndex(type)]--;
 
     mActiveStreamMutex.unlock();
 exit:
@@ -3535,6 +3853,223 @@ int ResourceManager::printStreamUserCounter(Stream *s)
     return 0;
 }
 
+/*
+ * Applies the "critical_reserved_frontends" config, a comma separated list
+ * of <pool name>:<count> pairs, e.g. "pcm_playback:1,pcm_record:1".
+ */
+void ResourceManager::applyFrontEndReservations()
+{
+    std::string entry;
+    size_t start = 0, end = 0, pos = 0;
+
+    while (start < reservedFrontEndsCfg.size()) {
+        end = reservedFrontEndsCfg.find(',', start);
+        if (end == std::string::npos)
+            end = reservedFrontEndsCfg.size();
+        entry = reservedFrontEndsCfg.substr(start, end - start);
+        start = end + 1;
+
+        pos = entry.find(':');
+        if (pos == std::string::npos) {
+            PAL_ERR(LOG_TAG, "invalid frontend reservation %s", entry.c_str());
+            continue;
+        }
+        reserveFrontEnds(entry.substr(0, pos), atoi(entry.substr(pos + 1).c_str()));
+    }
+}
+
+int ResourceManager::reserveFrontEnds(const std::string &poolName, uint32_t num)
+{
+    for (auto pool : frontEndPools) {
+        if (pool->getName() == poolName)
+            return pool->reserve(num);
+    }
+    PAL_ERR(LOG_TAG, "no frontend pool named %s", poolName.c_str());
+    return -EINVAL;
+}
+
+void ResourceManager::getFrontEndPoolStats(
+        std::vector<std::pair<std::string, fe_pool_stats_t>> &stats)
+{
+    fe_pool_stats_t poolStats;
+
+    stats.clear();
+    for (auto pool : frontEndPools) {
+        pool->getStats(&poolStats);
+        stats.push_back(std::make_pair(pool->getName(), poolStats));
+    }
+}
+
+static int32_t writeAll(int fd, const void *data, size_t size)
+{
+    const char *ptr = (const char *)data;
+    ssize_t ret = 0;
+
+    while (size) {
+        ret = write(fd, ptr, size);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            return -errno;
+        }
+        ptr += ret;
+        size -= ret;
+    }
+    return 0;
+}
+
+/*
+ * Copies the state in one phase, holding mActiveStreamMutex and then
+ * mResourceManagerMutex (the order used elsewhere in RM) so the streams,
+ * their devices, EC references and frontend pools are sampled at the same
+ * point. No stream lock is taken. The copy is then formatted and written
+ * with no lock held; pointers are only reported as handles, never
+ * dereferenced after the locks are dropped.
+ */
+int32_t ResourceManager::dumpState(int fd, pal_dump_format_t format)
+{
+    struct pal_state_dump_header hdr = {};
+    std::vector<struct pal_state_dump_stream> streams;
+    std::vector<struct pal_state_dump_stream_device> streamDevs;
+    std::vector<struct pal_state_dump_ec_ref> ecRefs;
+    std::vector<struct pal_state_dump_fe_pool> fePools;
+    std::vector<std::pair<std::string, fe_pool_stats_t>> poolStats;
+    struct pal_stream_attributes sAttr;
+    struct timespec ts = {0, 0};
+    std::ostringstream json;
+    std::string out;
+    int32_t status = 0;
+
+    if (fd < 0 || (format != PAL_DUMP_FORMAT_JSON && format != PAL_DUMP_FORMAT_BINARY)) {
+        PAL_ERR(LOG_TAG, "invalid fd %d or format %d", fd, format);
+        return -EINVAL;
+    }
+
+    mActiveStreamMutex.lock();
+    mResourceManagerMutex.lock();
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    streams.reserve(mActiveStreams.size());
+    for (auto s : mActiveStreams) {
+        struct pal_state_dump_stream entry = {};
+        auto it = mActiveStreamUserCounter.find(s);
+
+        entry.handle = (uint64_t)(uintptr_t)s;
+        if (!s->getStreamAttributes(&sAttr)) {
+            entry.type = sAttr.type;
+            entry.direction = sAttr.direction;
+        }
+        entry.state = s->getCurState();
+        entry.instance_id = s->getInstanceId();
+        if (it != mActiveStreamUserCounter.end()) {
+            entry.user_count = it->second.first;
+            entry.active = it->second.second;
+        }
+        streams.push_back(entry);
+    }
+    hdr.card_state = cardState;
+    streamDevs.reserve(active_devices.size());
+    for (auto &pair : active_devices) {
+        struct pal_state_dump_stream_device entry = {};
+
+        entry.handle = (uint64_t)(uintptr_t)pair.second;
+        entry.device_id = pair.first ? pair.first->getSndDeviceId() : 0;
+        streamDevs.push_back(entry);
+    }
+    for (auto &tx : ecRefCounts) {
+        for (auto &ref : tx.second) {
+            struct pal_state_dump_ec_ref entry = {};
+
+            entry.tx_handle = (uint64_t)(uintptr_t)tx.first;
+            entry.tx_device_id = ref.tx_dev_id;
+            entry.rx_device_id = ref.rx_dev_id;
+            entry.count = ref.count;
+            ecRefs.push_back(entry);
+        }
+    }
+    /* the pools are lock free, sample them while the users are held off */
+    getFrontEndPoolStats(poolStats);
+    mResourceManagerMutex.unlock();
+    mActiveStreamMutex.unlock();
+
+    for (auto &pool : poolStats) {
+        struct pal_state_dump_fe_pool entry = {};
+
+        if (!pool.second.capacity)
+            continue;
+        strlcpy(entry.name, pool.first.c_str(), PAL_STATE_DUMP_NAME_LEN);
+        entry.capacity = pool.second.capacity;
+        entry.reserved = pool.second.reserved;
+        entry.in_use = pool.second.in_use;
+        entry.peak_in_use = pool.second.peak_in_use;
+        entry.alloc_failures = pool.second.alloc_failures;
+        fePools.push_back(entry);
+    }
+
+    hdr.magic = PAL_STATE_DUMP_MAGIC;
+    hdr.version = PAL_STATE_DUMP_VERSION;
+    hdr.timestamp_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    hdr.num_streams = streams.size();
+    hdr.num_stream_devices = streamDevs.size();
+    hdr.num_ec_refs = ecRefs.size();
+    hdr.num_fe_pools = fePools.size();
+
+    if (format == PAL_DUMP_FORMAT_BINARY) {
+        out.append((const char *)&hdr, sizeof(hdr));
+        out.append((const char *)streams.data(), streams.size() * sizeof(streams[0]));
+        out.append((const char *)streamDevs.data(), streamDevs.size() * sizeof(streamDevs[0]));
+        out.append((const char *)ecRefs.data(), ecRefs.size() * sizeof(ecRefs[0]));
+        out.append((const char *)fePools.data(), fePools.size() * sizeof(fePools[0]));
+    } else {
+        json << "{\"version\":" << hdr.version
+             << ",\"timestamp_ns\":" << hdr.timestamp_ns
+             << ",\"card_state\":" << hdr.card_state
+             << ",\"streams\":[";
+        for (size_t i = 0; i < streams.size(); i++) {
+            json << (i ? "," : "")
+                 << "{\"handle\":" << streams[i].handle
+                 << ",\"type\":" << streams[i].type
+                 << ",\"direction\":" << streams[i].direction
+                 << ",\"state\":" << streams[i].state
+                 << ",\"instance_id\":" << streams[i].instance_id
+                 << ",\"user_count\":" << streams[i].user_count
+                 << ",\"active\":" << (streams[i].active ? "true" : "false") << "}";
+        }
+        json << "],\"stream_devices\":[";
+        for (size_t i = 0; i < streamDevs.size(); i++) {
+            json << (i ? "," : "")
+                 << "{\"handle\":" << streamDevs[i].handle
+                 << ",\"device_id\":" << streamDevs[i].device_id << "}";
+        }
+        json << "],\"ec_refs\":[";
+        for (size_t i = 0; i < ecRefs.size(); i++) {
+            json << (i ? "," : "")
+                 << "{\"tx_handle\":" << ecRefs[i].tx_handle
+                 << ",\"tx_device_id\":" << ecRefs[i].tx_device_id
+                 << ",\"rx_device_id\":" << ecRefs[i].rx_device_id
+                 << ",\"count\":" << ecRefs[i].count << "}";
+        }
+        json << "],\"fe_pools\":[";
+        for (size_t i = 0; i < fePools.size(); i++) {
+            json << (i ? "," : "")
+                 << "{\"name\":\"" << fePools[i].name << "\""
+                 << ",\"capacity\":" << fePools[i].capacity
+                 << ",\"reserved\":" << fePools[i].reserved
+                 << ",\"in_use\":" << fePools[i].in_use
+                 << ",\"peak_in_use\":" << fePools[i].peak_in_use
+                 << ",\"alloc_failures\":" << fePools[i].alloc_failures << "}";
+        }
+        json << "]}\n";
+        out = json.str();
+    }
+
+    status = writeAll(fd, out.data(), out.size());
+    if (status)
+        PAL_ERR(LOG_TAG, "failed to write state dump, status %d", status);
+    PAL_DBG(LOG_TAG, "dumped %zu bytes, %u streams, status %d",
+            out.size(), hdr.num_streams, status);
+    return status;
+}
+
 // check if any of the ec device supports external ec
 bool ResourceManager::isExternalECSupported(std::shared_ptr<Device> tx_dev) {
     bool is_supported = false;
@@ -4218,42 +4753,121 @@ void ResourceManager::GetVoiceUIProperties(struct pal_st_properties *qstp)
     }
 }
 
-bool ResourceManager::isNLPISwitchSupported(pal_stream_type_t type) {
+int ResourceManager::getStConcIndex(pal_stream_type_t type)
+{
     switch (type) {
         case PAL_STREAM_VOICE_UI:
+            return ST_CONC_VOICE_UI;
         case PAL_STREAM_ACD:
-        case PAL_STREAM_SENSOR_PCM_DATA: {
-            std::shared_ptr<SoundTriggerPlatformInfo> st_info =
-                SoundTriggerPlatformInfo::GetInstance();
+            return ST_CONC_ACD;
+        case PAL_STREAM_SENSOR_PCM_DATA:
+            return ST_CONC_SENSOR_PCM_DATA;
+        default:
+            return -EINVAL;
+    }
+}
 
-            if (st_info)
-                return st_info->GetSupportNLPISwitch();
+/*
+ * Decision for a detection stream with the given platform policy when a
+ * stream of in_type/dir starts or stops.
+ *
+ * Generally voip/voice rx stream comes with related tx streams,
+ * so there's no need to switch to NLPI for voip/voice rx stream
+ * if corresponding voip/voice tx stream concurrency is not supported.
+ * Also note that capture concurrency has highest proirity that
+ * when capture concurrency is disabled then concurrency for voip
+ * and voice call should also be disabled even voice_conc_enable
+ * or voip_conc_enable is set to true.
+ */
+static uint8_t getStConcDecision(uint8_t policy, pal_stream_type_t in_type,
+                                 uint32_t dir)
+{
+    bool capture_conc = policy & ST_CONC_POLICY_CAPTURE;
+    uint8_t decision = 0;
 
-            break;
-        }
-        default:
-            break;
+    if (dir == PAL_AUDIO_OUTPUT &&
+        (in_type != PAL_STREAM_LOW_LATENCY || (policy & ST_CONC_POLICY_LL_BARGEIN)))
+        decision |= ST_CONC_DECISION_RX;
+
+    if (in_type == PAL_STREAM_VOICE_CALL) {
+        decision |= ST_CONC_DECISION_TX | ST_CONC_DECISION_RX;
+        if (!capture_conc || !(policy & ST_CONC_POLICY_VOICE))
+            decision |= ST_CONC_DECISION_PAUSE;
+    } else if (in_type == PAL_STREAM_VOIP_TX) {
+        decision |= ST_CONC_DECISION_TX;
+        if (!capture_conc || !(policy & ST_CONC_POLICY_VOIP))
+            decision |= ST_CONC_DECISION_PAUSE;
+    } else if (dir == PAL_AUDIO_INPUT &&
+               (in_type != PAL_STREAM_ACD &&
+                in_type != PAL_STREAM_SENSOR_PCM_DATA &&
+                in_type != PAL_STREAM_CONTEXT_PROXY  &&
+                in_type != PAL_STREAM_VOICE_UI)) {
+        decision |= ST_CONC_DECISION_TX;
+        if (!capture_conc && in_type != PAL_STREAM_PROXY)
+            decision |= ST_CONC_DECISION_PAUSE;
     }
-    return false;
+
+    return decision;
 }
 
-bool ResourceManager::IsLPISupported(pal_stream_type_t type) {
-    switch (type) {
-        case PAL_STREAM_VOICE_UI:
-        case PAL_STREAM_ACD:
-        case PAL_STREAM_SENSOR_PCM_DATA: {
-            std::shared_ptr<SoundTriggerPlatformInfo> st_info =
-                SoundTriggerPlatformInfo::GetInstance();
+/*
+ * Platform info is only parsed at init, so the arbitration rules for every
+ * detection stream type against every incoming stream type and direction
+ * are evaluated once here.
+ */
+void ResourceManager::compileConcurrencyPolicy()
+{
+    std::shared_ptr<SoundTriggerPlatformInfo> st_info =
+        SoundTriggerPlatformInfo::GetInstance();
+    std::shared_ptr<VoiceUIPlatformInfo> vui_info =
+        VoiceUIPlatformInfo::GetInstance();
+    uint8_t policy = 0;
 
-            if (st_info)
-                return st_info->GetLpiEnable();
+    if (st_info) {
+        if (st_info->GetLpiEnable())
+            policy |= ST_CONC_POLICY_LPI;
+        if (st_info->GetSupportNLPISwitch())
+            policy |= ST_CONC_POLICY_NLPI_SWITCH;
+        if (st_info->GetLowLatencyBargeinEnable())
+            policy |= ST_CONC_POLICY_LL_BARGEIN;
+        if (st_info->GetConcurrentCaptureEnable())
+            policy |= ST_CONC_POLICY_CAPTURE;
+        if (st_info->GetConcurrentVoiceCallEnable())
+            policy |= ST_CONC_POLICY_VOICE;
+        if (st_info->GetConcurrentVoipCallEnable())
+            policy |= ST_CONC_POLICY_VOIP;
+    }
 
-            break;
+    memset(st_conc_affected_, 0, sizeof(st_conc_affected_));
+    for (int i = 0; i < ST_CONC_TYPE_MAX; i++) {
+        st_conc_policy_[i] = policy;
+        for (int type = 0; type < PAL_STREAM_MAX; type++) {
+            for (uint32_t dir = 0; dir < ST_CONC_DIR_MAX; dir++) {
+                st_conc_decision_[i][type][dir] =
+                    getStConcDecision(policy, (pal_stream_type_t)type, dir);
+                if (st_conc_decision_[i][type][dir])
+                    st_conc_affected_[type][dir] |= (1 << i);
+            }
         }
-        default:
-            break;
     }
-    return false;
+
+    transit_to_nlpi_on_charging_ = vui_info &&
+        vui_info->GetTransitToNonLpiOnCharging();
+
+    PAL_INFO(LOG_TAG, "st concurrency policy 0x%x, transit to nlpi on charging %d",
+             policy, transit_to_nlpi_on_charging_);
+}
+
+bool ResourceManager::isNLPISwitchSupported(pal_stream_type_t type) {
+    int idx = getStConcIndex(type);
+
+    return idx >= 0 && (st_conc_policy_[idx] & ST_CONC_POLICY_NLPI_SWITCH);
+}
+
+bool ResourceManager::IsLPISupported(pal_stream_type_t type) {
+    int idx = getStConcIndex(type);
+
+    return idx >= 0 && (st_conc_policy_[idx] & ST_CONC_POLICY_LPI);
 }
 
 bool ResourceManager::IsDedicatedBEForUPDEnabled()
@@ -4284,6 +4898,21 @@ void ResourceManager::GetSoundTriggerConcurrencyCount(
     mActiveStreamMutex.unlock();
 }
 
+/*
+ * Session limit for shared sensor capture. Only the streams owning a shared
+ * graph are in active_streams_sensor_pcm_data, and they are only created
+ * with the capture source registry lock held, which the caller holds too.
+ */
+bool ResourceManager::IsSensorCaptureSourceAvailable()
+{
+    bool available;
+
+    mActiveStreamMutex.lock();
+    available = active_streams_sensor_pcm_data.size() < MAX_SESSIONS_SENSOR_PCM_DATA;
+    mActiveStreamMutex.unlock();
+    return available;
+}
+
 // this should only be called when LPI supported by platform
 void ResourceManager::GetSoundTriggerConcurrencyCount_l(
     pal_stream_type_t type,
@@ -4315,89 +4944,31 @@ void ResourceManager::GetSoundTriggerConcurrencyCount_l(
 }
 
 bool ResourceManager::IsLowLatencyBargeinSupported(pal_stream_type_t type) {
-    switch (type) {
-        case PAL_STREAM_VOICE_UI:
-        case PAL_STREAM_ACD:
-        case PAL_STREAM_SENSOR_PCM_DATA: {
-            std::shared_ptr<SoundTriggerPlatformInfo> st_info =
-                SoundTriggerPlatformInfo::GetInstance();
+    int idx = getStConcIndex(type);
 
-            if (st_info)
-                return st_info->GetLowLatencyBargeinEnable();
-
-            break;
-        }
-        default:
-            break;
-    }
-    return false;
+    return idx >= 0 && (st_conc_policy_[idx] & ST_CONC_POLICY_LL_BARGEIN);
 }
 
 bool ResourceManager::IsAudioCaptureConcurrencySupported(pal_stream_type_t type) {
-    switch (type) {
-        case PAL_STREAM_VOICE_UI:
-        case PAL_STREAM_ACD:
-        case PAL_STREAM_SENSOR_PCM_DATA: {
-            std::shared_ptr<SoundTriggerPlatformInfo> st_info =
-                SoundTriggerPlatformInfo::GetInstance();
+    int idx = getStConcIndex(type);
 
-            if (st_info)
-                return st_info->GetConcurrentCaptureEnable();
-
-            break;
-        }
-        default:
-            break;
-    }
-    return false;
+    return idx >= 0 && (st_conc_policy_[idx] & ST_CONC_POLICY_CAPTURE);
 }
 
 bool ResourceManager::IsVoiceCallConcurrencySupported(pal_stream_type_t type) {
-    switch (type) {
-        case PAL_STREAM_VOICE_UI:
-        case PAL_STREAM_ACD:
-        case PAL_STREAM_SENSOR_PCM_DATA: {
-            std::shared_ptr<SoundTriggerPlatformInfo> st_info =
-                SoundTriggerPlatformInfo::GetInstance();
+    int idx = getStConcIndex(type);
 
-            if (st_info)
-                return st_info->GetConcurrentVoiceCallEnable();
-
-            break;
-        }
-        default:
-            break;
-    }
-    return false;
+    return idx >= 0 && (st_conc_policy_[idx] & ST_CONC_POLICY_VOICE);
 }
 
 bool ResourceManager::IsVoipConcurrencySupported(pal_stream_type_t type) {
-    switch (type) {
-        case PAL_STREAM_VOICE_UI:
-        case PAL_STREAM_ACD:
-        case PAL_STREAM_SENSOR_PCM_DATA: {
-            std::shared_ptr<SoundTriggerPlatformInfo> st_info =
-                SoundTriggerPlatformInfo::GetInstance();
-
-            if (st_info)
-                return st_info->GetConcurrentVoipCallEnable();
+    int idx = getStConcIndex(type);
 
-            break;
-        }
-        default:
-            break;
-    }
-    return false;
+    return idx >= 0 && (st_conc_policy_[idx] & ST_CONC_POLICY_VOIP);
 }
 
 bool ResourceManager::IsTransitToNonLPIOnChargingSupported() {
-    std::shared_ptr<VoiceUIPlatformInfo> vui_info =
-        VoiceUIPlatformInfo::GetInstance();
-
-    if (vui_info)
-        return vui_info->GetTransitToNonLpiOnCharging();
-
-    return false;
+    return transit_to_nlpi_on_charging_;
 }
 
 bool ResourceManager::CheckForForcedTransitToNonLPI() {
@@ -4720,6 +5291,7 @@ int ResourceManager::registerMixerEventCallback(const std::vector<int> &DevIds,
 
 void ResourceManager::mixerEventWaitThreadLoop(
     std::shared_ptr<ResourceManager> rm) {
+    PalThreadScope threadScope(PAL_THREAD_CLASS_EVENT, "mixer_event");
     int ret = 0;
     struct ctl_event mixer_event = {0, {.data8 = {0}}};
     struct mixer *mixer = nullptr;
@@ -4871,12 +5443,9 @@ int ResourceManager::HandleDetectionStreamAction(pal_stream_type_t type, int32_t
     int status = 0;
     pal_stream_attributes st_attr;
 
-    if ((type == PAL_STREAM_VOICE_UI &&
-         !active_streams_st.size()) ||
-        (type == PAL_STREAM_ACD &&
-         !active_streams_acd.size()) ||
-        (type == PAL_STREAM_SENSOR_PCM_DATA &&
-         !active_streams_sensor_pcm_data.size())) {
+    /* shared sensor capture clients are counted too, they follow pause/resume */
+    int idx = getStConcIndex(type);
+    if (idx >= 0 && !st_conc_active_cnt_[idx]) {
         PAL_VERBOSE(LOG_TAG, "No active stream for type %d, skip action", type);
         return 0;
     }
@@ -4890,6 +5459,17 @@ int ResourceManager::HandleDetectionStreamAction(pal_stream_type_t type, int32_t
         if (st_attr.type != type)
             continue;
 
+        /*
+         * Shared sensor capture clients own no graph, they only follow the
+         * concurrency pause/resume (no stream passed). Around a backend
+         * update of a capture stream they are left alone, one of them may
+         * be starting that very stream with its lock held.
+         */
+        if ((action == ST_PAUSE || action == ST_RESUME) && data &&
+            type == PAL_STREAM_SENSOR_PCM_DATA &&
+            static_cast<StreamSensorPCMData *>(str)->IsSharedCaptureClient())
+            continue;
+
         switch (action) {
             case ST_PAUSE:
                 if (str != (Stream *)data) {
@@ -4961,53 +5541,23 @@ int ResourceManager::StartOtherDetectionStreams(void *st) {
 void ResourceManager::GetConcurrencyInfo(pal_stream_type_t st_type,
                          pal_stream_type_t in_type, pal_stream_direction_t dir,
                          bool *rx_conc, bool *tx_conc, bool *conc_en)
-{
-    bool voice_conc_enable = IsVoiceCallConcurrencySupported(st_type);
-    bool voip_conc_enable = IsVoipConcurrencySupported(st_type);
-    bool low_latency_bargein_enable = IsLowLatencyBargeinSupported(st_type);
-    bool audio_capture_conc_enable = IsAudioCaptureConcurrencySupported(st_type);
-
-    if (dir == PAL_AUDIO_OUTPUT) {
-        if (in_type == PAL_STREAM_LOW_LATENCY && !low_latency_bargein_enable) {
-            PAL_VERBOSE(LOG_TAG, "Ignore low latency playback stream");
-        } else {
-            *rx_conc = true;
-        }
-    }
-
-    /*
-     * Generally voip/voice rx stream comes with related tx streams,
-     * so there's no need to switch to NLPI for voip/voice rx stream
-     * if corresponding voip/voice tx stream concurrency is not supported.
-     * Also note that capture concurrency has highest proirity that
-     * when capture concurrency is disabled then concurrency for voip
-     * and voice call should also be disabled even voice_conc_enable
-     * or voip_conc_enable is set to true.
-     */
-    if (in_type == PAL_STREAM_VOICE_CALL) {
-        *tx_conc = true;
-        *rx_conc = true;
-        if (!audio_capture_conc_enable || !voice_conc_enable) {
-            PAL_DBG(LOG_TAG, "pause on voice concurrency");
-            *conc_en = false;
-        }
-    } else if (in_type == PAL_STREAM_VOIP_TX) {
-        *tx_conc = true;
-        if (!audio_capture_conc_enable || !voip_conc_enable) {
-            PAL_DBG(LOG_TAG, "pause on voip concurrency");
-            *conc_en = false;
-        }
-    } else if (dir == PAL_AUDIO_INPUT &&
-               (in_type != PAL_STREAM_ACD &&
-                in_type != PAL_STREAM_SENSOR_PCM_DATA &&
-                in_type != PAL_STREAM_CONTEXT_PROXY  &&
-                in_type != PAL_STREAM_VOICE_UI)) {
+{
+    int idx = getStConcIndex(st_type);
+    uint8_t decision = 0;
+
+    if (idx >= 0 && (uint32_t)in_type < PAL_STREAM_MAX &&
+        (uint32_t)dir < ST_CONC_DIR_MAX)
+        decision = st_conc_decision_[idx][in_type][dir];
+    else
+        decision = getStConcDecision(idx >= 0 ? st_conc_policy_[idx] : 0,
+                                     in_type, dir);
+
+    if (decision & ST_CONC_DECISION_RX)
+        *rx_conc = true;
+    if (decision & ST_CONC_DECISION_TX)
         *tx_conc = true;
-        if (!audio_capture_conc_enable && in_type != PAL_STREAM_PROXY) {
-            PAL_DBG(LOG_TAG, "pause on audio capture concurrency");
-            *conc_en = false;
-        }
-    }
+    if (decision & ST_CONC_DECISION_PAUSE)
+        *conc_en = false;
 
     PAL_INFO(LOG_TAG, "stream type %d Tx conc %d, Rx conc %d, concurrency%s allowed",
         in_type, *tx_conc, *rx_conc, *conc_en? "" : " not");
@@ -5164,9 +5714,20 @@ void ResourceManager::HandleConcurrencyForSoundTriggerStreams(pal_stream_type_t
                                                              pal_stream_direction_t dir,
                                                              bool active)
 {
+    static const pal_stream_type_t st_conc_types[ST_CONC_TYPE_MAX] = {
+        PAL_STREAM_VOICE_UI, PAL_STREAM_ACD, PAL_STREAM_SENSOR_PCM_DATA};
     std::vector<pal_stream_type_t> st_streams;
     bool do_st_stream_switch = false;
     bool use_lpi_temp = use_lpi_;
+    uint8_t affected = 0xff;
+
+    /* most usecases do not affect any detection stream, skip the lock */
+    if ((uint32_t)type < PAL_STREAM_MAX && (uint32_t)dir < ST_CONC_DIR_MAX)
+        affected = st_conc_affected_[type][dir];
+    if (!affected) {
+        PAL_VERBOSE(LOG_TAG, "stream type %d dir %d not arbitrated", type, dir);
+        return;
+    }
 
     mActiveStreamMutex.lock();
     PAL_DBG(LOG_TAG, "Enter, stream type %d, direction %d, active %d", type, dir, active);
@@ -5177,15 +5738,18 @@ void ResourceManager::HandleConcurrencyForSoundTriggerStreams(pal_stream_type_t
         use_lpi_temp = true;
     }
 
-    st_streams.push_back(PAL_STREAM_VOICE_UI);
-    st_streams.push_back(PAL_STREAM_ACD);
-    st_streams.push_back(PAL_STREAM_SENSOR_PCM_DATA);
-
-    for (pal_stream_type_t st_stream_type : st_streams) {
+    for (int i = 0; i < ST_CONC_TYPE_MAX; i++) {
+        pal_stream_type_t st_stream_type = st_conc_types[i];
         bool st_stream_conc_en = true;
         bool st_stream_tx_conc = false;
         bool st_stream_rx_conc = false;
 
+        /* only streams of registered types are paused or switched */
+        if (st_conc_active_cnt_[i])
+            st_streams.push_back(st_stream_type);
+        if (!(affected & (1 << i)))
+            continue;
+
         GetConcurrencyInfo(st_stream_type, type, dir,
                            &st_stream_rx_conc, &st_stream_tx_conc, &st_stream_conc_en);
 
@@ -5447,10 +6011,9 @@ int ResourceManager::updateECDeviceMap(std::shared_ptr<Device> rx_dev,
     int rx_dev_id = 0;
     int tx_dev_id = 0;
     int ec_count = 0;
-    int i = 0, j = 0;
+    int i = 0;
     bool tx_stream_found = false;
-    std::vector<std::pair<Stream *, int>>::iterator iter;
-    std::map<int, std::vector<std::pair<Stream *, int>>>::iterator map_iter;
+    std::vector<ec_ref_count_t>::iterator iter;
 
     if ((!rx_dev && !is_txstop) || !tx_dev || !tx_str) {
         PAL_ERR(LOG_TAG, "Invalid operation");
@@ -5469,42 +6032,39 @@ int ResourceManager::updateECDeviceMap(std::shared_ptr<Device> rx_dev,
         return -EINVAL;
     }
 
+    std::vector<ec_ref_count_t> &refs = ecRefCounts[tx_str];
     if (is_txstop) {
-        for (map_iter = deviceInfo[i].ec_ref_count_map.begin();
-            map_iter != deviceInfo[i].ec_ref_count_map.end(); map_iter++) {
-            rx_dev_id = (*map_iter).first;
-            if (rx_dev && rx_dev->getSndDeviceId() != rx_dev_id)
+        // without rx_dev, drop the stream from all rx devices of tx_dev
+        for (iter = refs.begin(); iter != refs.end();) {
+            if ((*iter).tx_dev_id != tx_dev_id ||
+                (rx_dev && rx_dev->getSndDeviceId() != (*iter).rx_dev_id)) {
+                iter++;
                 continue;
-            for (iter = deviceInfo[i].ec_ref_count_map[rx_dev_id].begin();
-                iter != deviceInfo[i].ec_ref_count_map[rx_dev_id].end(); iter++) {
-                if ((*iter).first == tx_str) {
-                    tx_stream_found = true;
-                    deviceInfo[i].ec_ref_count_map[rx_dev_id].erase(iter);
-                    ec_count = 0;
-                    break;
-                }
             }
-            if (tx_stream_found && rx_dev)
+            tx_stream_found = true;
+            rx_dev_id = (*iter).rx_dev_id;
+            iter = refs.erase(iter);
+            ec_count = 0;
+            if (rx_dev)
                 break;
         }
     } else {
         // rx_dev cannot be null if is_txstop is false
         rx_dev_id = rx_dev->getSndDeviceId();
 
-        for (iter = deviceInfo[i].ec_ref_count_map[rx_dev_id].begin();
-            iter != deviceInfo[i].ec_ref_count_map[rx_dev_id].end(); iter++) {
-            if ((*iter).first == tx_str) {
+        for (iter = refs.begin(); iter != refs.end(); iter++) {
+            if ((*iter).tx_dev_id == tx_dev_id && (*iter).rx_dev_id == rx_dev_id) {
                 tx_stream_found = true;
                 if (count > 0) {
-                    (*iter).second += count;
-                    ec_count = (*iter).second;
+                    (*iter).count += count;
+                    ec_count = (*iter).count;
                 } else if (count == 0) {
-                    if ((*iter).second > 0) {
-                        (*iter).second--;
+                    if ((*iter).count > 0) {
+                        (*iter).count--;
                     }
-                    ec_count = (*iter).second;
-                    if ((*iter).second == 0) {
-                        deviceInfo[i].ec_ref_count_map[rx_dev_id].erase(iter);
+                    ec_count = (*iter).count;
+                    if ((*iter).count == 0) {
+                        refs.erase(iter);
                     }
                 }
                 break;
@@ -5515,13 +6075,16 @@ int ResourceManager::updateECDeviceMap(std::shared_ptr<Device> rx_dev,
     if (!tx_stream_found) {
         if (count == 0) {
             PAL_ERR(LOG_TAG, "Cannot reset as ec ref not present");
+            if (refs.empty())
+                ecRefCounts.erase(tx_str);
             return -EINVAL;
         } else if (count > 0) {
-            deviceInfo[i].ec_ref_count_map[rx_dev_id].push_back(
-                std::make_pair(tx_str, count));
+            refs.push_back({tx_dev_id, rx_dev_id, count});
             ec_count = count;
         }
     }
+    if (refs.empty())
+        ecRefCounts.erase(tx_str);
 
     PAL_DBG(LOG_TAG, "EC ref count for stream device pair (%pK %d, %d) is %d",
         tx_str, tx_dev_id, rx_dev_id, ec_count);
@@ -5532,12 +6095,11 @@ std::shared_ptr<Device> ResourceManager::clearInternalECRefCounts(Stream *tx_str
     std::shared_ptr<Device> tx_dev)
 {
     int i = 0;
-    int rx_dev_id = 0;
     int tx_dev_id = 0;
     struct pal_device palDev;
     std::shared_ptr<Device> rx_dev = nullptr;
-    std::vector<std::pair<Stream *, int>>::iterator iter;
-    std::map<int, std::vector<std::pair<Stream *, int>>>::iterator map_iter;
+    std::unordered_map<Stream *, std::vector<ec_ref_count_t>>::iterator refs;
+    std::vector<ec_ref_count_t>::iterator iter;
 
     if (!tx_str || !tx_dev) {
         PAL_ERR(LOG_TAG, "Invalid operation");
@@ -5556,23 +6118,23 @@ std::shared_ptr<Device> ResourceManager::clearInternalECRefCounts(Stream *tx_str
         goto exit;
     }
 
-    for (map_iter = deviceInfo[i].ec_ref_count_map.begin();
-        map_iter != deviceInfo[i].ec_ref_count_map.end(); map_iter++) {
-        rx_dev_id = (*map_iter).first;
-        if (isExternalECRefEnabled(rx_dev_id))
+    refs = ecRefCounts.find(tx_str);
+    if (refs == ecRefCounts.end())
+        goto exit;
+
+    for (iter = refs->second.begin(); iter != refs->second.end();) {
+        if ((*iter).tx_dev_id != tx_dev_id || isExternalECRefEnabled((*iter).rx_dev_id)) {
+            iter++;
             continue;
-        for (iter = deviceInfo[i].ec_ref_count_map[rx_dev_id].begin();
-            iter != deviceInfo[i].ec_ref_count_map[rx_dev_id].end(); iter++) {
-            if ((*iter).first == tx_str) {
-                if ((*iter).second > 0) {
-                    palDev.id = (pal_device_id_t)rx_dev_id;
-                    rx_dev = Device::getInstance(&palDev, rm);
-                }
-                deviceInfo[i].ec_ref_count_map[rx_dev_id].erase(iter);
-                break;
-            }
         }
+        if ((*iter).count > 0) {
+            palDev.id = (pal_device_id_t)(*iter).rx_dev_id;
+            rx_dev = Device::getInstance(&palDev, rm);
+        }
+        iter = refs->second.erase(iter);
     }
+    if (refs->second.empty())
+        ecRefCounts.erase(refs);
 
 exit:
     return rx_dev;
@@ -6283,6 +6845,7 @@ int ResourceManager::getPcmDeviceId(int deviceId)
 void ResourceManager::deinit()
 {
     card_status_t state = CARD_STATUS_NONE;
+    PalEventLoop *loop = NULL;
 
     mixerClosed = true;
     mixer_close(audio_virt_mixer);
@@ -6294,13 +6857,20 @@ void ResourceManager::deinit()
         mixerEventTread.join();
     }
     PAL_DBG(LOG_TAG, "Mixer event thread joined");
-    if (sndmon)
+    if (sndmon) {
         delete sndmon;
+        sndmon = NULL;
+    }
 
-   if (isChargeConcurrencyEnabled)
-       chargerListenerDeinit();
-
-    voiceuiDmgrManagerDeInit();
+    loop = PalEventLoop::getInstance();
+    if (loop && rm->prewarmTimer > 0) {
+        loop->cancelTimer(rm->prewarmTimer);
+        rm->prewarmTimer = 0;
+    }
+    rm->admInit->close();
+    rm->chargerListenerLazyInit->close();
+    rm->vuiDmgrInit->close();
+    rm->speakerInit->close();
 
     cvMutex.lock();
     msgQ.push(state);
@@ -6311,6 +6881,8 @@ void ResourceManager::deinit()
     while (!msgQ.empty())
         msgQ.pop();
 
+    PalEventLoop::deinit();
+
 #ifdef SOC_PERIPHERAL_PROT
     if (socPerithread.joinable()) {
         socPerithread.join();
@@ -6416,24 +6988,16 @@ int ResourceManager::getNumFEs(const pal_stream_type_t sType) const
 const std::vector<int> ResourceManager::allocateFrontEndExtEcIds()
 {
     std::vector<int> f;
-    f.clear();
-    const int howMany = 1;
-    int id = 0;
-    std::vector<int>::iterator it;
-    if (howMany > listAllPcmExtEcTxFrontEnds.size()) {
-        PAL_ERR(LOG_TAG, "allocateFrontEndExtEcIds: requested for %d external ec front ends, have only %zu error",
-                        howMany, listAllPcmExtEcTxFrontEnds.size());
+    int id = pcmExtEcTxFePool.allocate();
+
+    if (id < 0) {
+        PAL_ERR(LOG_TAG, "allocateFrontEndExtEcIds: no external ec front end available");
         return f;
     }
-    id = (listAllPcmExtEcTxFrontEnds.size() - 1);
-    it =  (listAllPcmExtEcTxFrontEnds.begin() + id);
-    for (int i = 0; i < howMany; i++) {
-        f.push_back(listAllPcmExtEcTxFrontEnds.at(id));
-        listAllPcmExtEcTxFrontEnds.erase(it);
-        PAL_INFO(LOG_TAG, "allocateFrontEndExtEcIds: front end %d", f[i]);
-        it -= 1;
-        id -= 1;
-    }
+    f.push_back(id);
+    /* a previous user's graph may still be cached for this front end */
+    SessionAlsaUtils::invalidateModuleInstanceIds(id);
+    PAL_INFO(LOG_TAG, "allocateFrontEndExtEcIds: front end %d", id);
     return f;
 }
 
@@ -6441,46 +7005,33 @@ void ResourceManager::freeFrontEndEcTxIds(const std::vector<int> frontend)
 {
     for (int i = 0; i < frontend.size(); i++) {
         PAL_INFO(LOG_TAG, "freeing ext ec dev %d\n", frontend.at(i));
-        listAllPcmExtEcTxFrontEnds.push_back(frontend.at(i));
+        SessionAlsaUtils::invalidateModuleInstanceIds(frontend.at(i));
+        pcmExtEcTxFePool.free(frontend.at(i));
     }
     return;
 }
 
-template <typename T>
-void removeDuplicates(std::vector<T> &vec)
+bool ResourceManager::isCriticalFrontEndUser(const struct pal_stream_attributes &sAttr)
 {
-    std::sort(vec.begin(), vec.end());
-    vec.erase(std::unique(vec.begin(), vec.end()), vec.end());
-    return;
+    switch (sAttr.type) {
+        case PAL_STREAM_VOIP:
+        case PAL_STREAM_VOIP_RX:
+        case PAL_STREAM_VOIP_TX:
+        case PAL_STREAM_VOICE_CALL:
+        case PAL_STREAM_VOICE_CALL_RECORD:
+        case PAL_STREAM_VOICE_CALL_MUSIC:
+            return true;
+        default:
+            return false;
+    }
 }
 
-const std::vector<int> ResourceManager::allocateFrontEndIds(const struct pal_stream_attributes sAttr, int lDirection)
+FrontEndIdPool* ResourceManager::getFrontEndPool(const struct pal_stream_attributes &sAttr,
+                                                 int lDirection)
 {
-    //TODO: lock resource manager
-    std::vector<int> f;
-    f.clear();
-    const int howMany = getNumFEs(sAttr.type);
-    int id = 0;
-    std::vector<int>::iterator it;
-
-    mListFrontEndsMutex.lock();
-    switch(sAttr.type) {
+    switch (sAttr.type) {
         case PAL_STREAM_NON_TUNNEL:
-            if (howMany > listAllNonTunnelSessionIds.size()) {
-                PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends, have only %zu error",
-                                howMany, listAllPcmRecordFrontEnds.size());
-                 goto error;
-            }
-            id = (listAllNonTunnelSessionIds.size() - 1);
-            it =  (listAllNonTunnelSessionIds.begin() + id);
-            for (int i = 0; i < howMany; i++) {
-                f.push_back(listAllNonTunnelSessionIds.at(id));
-                listAllNonTunnelSessionIds.erase(it);
-                PAL_INFO(LOG_TAG, "allocateFrontEndIds: front end %d", f[i]);
-                it -= 1;
-                id -= 1;
-            }
-            break;
+            return &nonTunnelSessionIdPool;
         case PAL_STREAM_LOW_LATENCY:
         case PAL_STREAM_ULTRA_LOW_LATENCY:
         case PAL_STREAM_GENERIC:
@@ -6501,405 +7052,104 @@ const std::vector<int> ResourceManager::allocateFrontEndIds(const struct pal_str
         case PAL_STREAM_VOICE_RECOGNITION:
             switch (sAttr.direction) {
                 case PAL_AUDIO_INPUT:
-                    if (lDirection == TX_HOSTLESS) {
-                        if (howMany > listAllPcmHostlessTxFrontEnds.size()) {
-                            PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends, have only %zu error",
-                                              howMany, listAllPcmHostlessTxFrontEnds.size());
-                            goto error;
-                        }
-                        id = (listAllPcmHostlessTxFrontEnds.size() - 1);
-                        it = (listAllPcmHostlessTxFrontEnds.begin() + id);
-                        for (int i = 0; i < howMany; i++) {
-                           f.push_back(listAllPcmHostlessTxFrontEnds.at(id));
-                           listAllPcmHostlessTxFrontEnds.erase(it);
-                           PAL_INFO(LOG_TAG, "allocateFrontEndIds: front end %d", f[i]);
-                           it -= 1;
-                           id -= 1;
-                        }
-                    } else {
-                        if (howMany > listAllPcmRecordFrontEnds.size()) {
-                            PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends, have only %zu error",
-                                              howMany, listAllPcmRecordFrontEnds.size());
-                            goto error;
-                        }
-                        id = (listAllPcmRecordFrontEnds.size() - 1);
-                        it = (listAllPcmRecordFrontEnds.begin() + id);
-                        for (int i = 0; i < howMany; i++) {
-                            f.push_back(listAllPcmRecordFrontEnds.at(id));
-                            listAllPcmRecordFrontEnds.erase(it);
-                            PAL_INFO(LOG_TAG, "allocateFrontEndIds: front end %d", f[i]);
-                            it -= 1;
-                            id -= 1;
-                        }
-                    }
-                    break;
+                    return (lDirection == TX_HOSTLESS) ? &pcmHostlessTxFePool : &pcmRecordFePool;
                 case PAL_AUDIO_OUTPUT:
-                    if (howMany > listAllPcmPlaybackFrontEnds.size()) {
-                        PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends, have only %zu error",
-                                          howMany, listAllPcmPlaybackFrontEnds.size());
-                        goto error;
-                    }
-                    if (!listAllPcmPlaybackFrontEnds.size()) {
-                        PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends, but we dont have any (%zu) !!!!!!! ",
-                                howMany, listAllPcmPlaybackFrontEnds.size());
-                        goto error;
-                    }
-                    id = (int)(((int)listAllPcmPlaybackFrontEnds.size()) - 1);
-                    if (id < 0) {
-                        PAL_ERR(LOG_TAG, "allocateFrontEndIds: negative iterator id %d !!!!! ", id);
-                        goto error;
-                    }
-                    it =  (listAllPcmPlaybackFrontEnds.begin() + id);
-                    for (int i = 0; i < howMany; i++) {
-                        f.push_back(listAllPcmPlaybackFrontEnds.at(id));
-                        listAllPcmPlaybackFrontEnds.erase(it);
-                        PAL_INFO(LOG_TAG, "allocateFrontEndIds: front end %d", f[i]);
-                        it -= 1;
-                        id -= 1;
-                    }
-                    break;
+                    return &pcmPlaybackFePool;
                 case PAL_AUDIO_INPUT | PAL_AUDIO_OUTPUT:
-                    if (lDirection == RX_HOSTLESS) {
-                        if (howMany > listAllPcmHostlessRxFrontEnds.size()) {
-                            PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends, have only %zu error",
-                                              howMany, listAllPcmHostlessRxFrontEnds.size());
-                            goto error;
-                        }
-                        id = (listAllPcmHostlessRxFrontEnds.size() - 1);
-                        it = (listAllPcmHostlessRxFrontEnds.begin() + id);
-                        for (int i = 0; i < howMany; i++) {
-                           f.push_back(listAllPcmHostlessRxFrontEnds.at(id));
-                           listAllPcmHostlessRxFrontEnds.erase(it);
-                           PAL_INFO(LOG_TAG, "allocateFrontEndIds: front end %d", f[i]);
-                           it -= 1;
-                           id -= 1;
-                        }
-                    } else {
-                        if (howMany > listAllPcmHostlessTxFrontEnds.size()) {
-                            PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends, have only %zu error",
-                                              howMany, listAllPcmHostlessTxFrontEnds.size());
-                            goto error;
-                        }
-                        id = (listAllPcmHostlessTxFrontEnds.size() - 1);
-                        it = (listAllPcmHostlessTxFrontEnds.begin() + id);
-                        for (int i = 0; i < howMany; i++) {
-                           f.push_back(listAllPcmHostlessTxFrontEnds.at(id));
-                           listAllPcmHostlessTxFrontEnds.erase(it);
-                           PAL_INFO(LOG_TAG, "allocateFrontEndIds: front end %d", f[i]);
-                           it -= 1;
-                           id -= 1;
-                        }
-                    }
-                    break;
+                    return (lDirection == RX_HOSTLESS) ? &pcmHostlessRxFePool : &pcmHostlessTxFePool;
                 default:
-                    PAL_ERR(LOG_TAG,"direction unsupported");
-                    break;
+                    PAL_ERR(LOG_TAG, "direction unsupported");
+                    return nullptr;
             }
-            break;
         case PAL_STREAM_COMPRESSED:
             switch (sAttr.direction) {
                 case PAL_AUDIO_INPUT:
-                    if (howMany > listAllCompressRecordFrontEnds.size()) {
-                        PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends, have only %zu error",
-                                          howMany, listAllCompressRecordFrontEnds.size());
-                        goto error;
-                    }
-                    id = (listAllCompressRecordFrontEnds.size() - 1);
-                    it = (listAllCompressRecordFrontEnds.begin() + id);
-                    for (int i = 0; i < howMany; i++) {
-                        f.push_back(listAllCompressRecordFrontEnds.at(id));
-                        listAllCompressRecordFrontEnds.erase(it);
-                        PAL_INFO(LOG_TAG, "allocateFrontEndIds: front end %d", f[i]);
-                        it -= 1;
-                        id -= 1;
-                    }
-                    break;
+                    return &compressRecordFePool;
                 case PAL_AUDIO_OUTPUT:
-                    if (howMany > listAllCompressPlaybackFrontEnds.size()) {
-                        PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends, have only %zu error",
-                                          howMany, listAllCompressPlaybackFrontEnds.size());
-                        goto error;
-                    }
-                    id = (listAllCompressPlaybackFrontEnds.size() - 1);
-                    it = (listAllCompressPlaybackFrontEnds.begin() + id);
-                    for (int i = 0; i < howMany; i++) {
-                        f.push_back(listAllCompressPlaybackFrontEnds.at(id));
-                        listAllCompressPlaybackFrontEnds.erase(it);
-                        PAL_INFO(LOG_TAG, "allocateFrontEndIds: front end %d", f[i]);
-                        it -= 1;
-                        id -= 1;
-                    }
-                    break;
+                    return &compressPlaybackFePool;
                 default:
-                    PAL_ERR(LOG_TAG,"direction unsupported");
-                    break;
-                }
-                break;
-        case PAL_STREAM_VOICE_CALL:
-            switch (sAttr.direction) {
-              case PAL_AUDIO_INPUT | PAL_AUDIO_OUTPUT:
-                    if (lDirection == RX_HOSTLESS) {
-                        if (sAttr.info.voice_call_info.VSID == VOICEMMODE1 ||
-                            sAttr.info.voice_call_info.VSID == VOICELBMMODE1) {
-                            f = allocateVoiceFrontEndIds(listAllPcmVoice1RxFrontEnds, howMany);
-                        } else if(sAttr.info.voice_call_info.VSID == VOICEMMODE2 ||
-                            sAttr.info.voice_call_info.VSID == VOICELBMMODE2){
-                            f = allocateVoiceFrontEndIds(listAllPcmVoice2RxFrontEnds, howMany);
-                        } else {
-                            PAL_ERR(LOG_TAG,"invalid VSID 0x%x provided",
-                                    sAttr.info.voice_call_info.VSID);
-                        }
-                    } else {
-                        if (sAttr.info.voice_call_info.VSID == VOICEMMODE1 ||
-                            sAttr.info.voice_call_info.VSID == VOICELBMMODE1) {
-                            f = allocateVoiceFrontEndIds(listAllPcmVoice1TxFrontEnds, howMany);
-                        } else if(sAttr.info.voice_call_info.VSID == VOICEMMODE2 ||
-                            sAttr.info.voice_call_info.VSID == VOICELBMMODE2){
-                            f = allocateVoiceFrontEndIds(listAllPcmVoice2TxFrontEnds, howMany);
-                        } else {
-                            PAL_ERR(LOG_TAG,"invalid VSID 0x%x provided",
-                                    sAttr.info.voice_call_info.VSID);
-                        }
-                    }
-                    break;
-              default:
-                  PAL_ERR(LOG_TAG,"direction unsupported voice must be RX and TX");
-                  break;
+                    PAL_ERR(LOG_TAG, "direction unsupported");
+                    return nullptr;
             }
-            break;
+        case PAL_STREAM_VOICE_CALL:
+            if (sAttr.direction != (PAL_AUDIO_INPUT | PAL_AUDIO_OUTPUT)) {
+                PAL_ERR(LOG_TAG, "direction unsupported voice must be RX and TX");
+                return nullptr;
+            }
+            if (sAttr.info.voice_call_info.VSID == VOICEMMODE1 ||
+                sAttr.info.voice_call_info.VSID == VOICELBMMODE1)
+                return (lDirection == RX_HOSTLESS) ? &pcmVoice1RxFePool : &pcmVoice1TxFePool;
+            if (sAttr.info.voice_call_info.VSID == VOICEMMODE2 ||
+                sAttr.info.voice_call_info.VSID == VOICELBMMODE2)
+                return (lDirection == RX_HOSTLESS) ? &pcmVoice2RxFePool : &pcmVoice2TxFePool;
+            PAL_ERR(LOG_TAG, "invalid VSID 0x%x provided", sAttr.info.voice_call_info.VSID);
+            return nullptr;
         case PAL_STREAM_VOICE_CALL_RECORD:
-            if (howMany > listAllPcmInCallRecordFrontEnds.size()) {
-                    PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends, have only %zu error",
-                                      howMany, listAllPcmInCallRecordFrontEnds.size());
-                    goto error;
-                }
-            id = (listAllPcmInCallRecordFrontEnds.size() - 1);
-            it = (listAllPcmInCallRecordFrontEnds.begin() + id);
-            for (int i = 0; i < howMany; i++) {
-                f.push_back(listAllPcmInCallRecordFrontEnds.at(id));
-                listAllPcmInCallRecordFrontEnds.erase(it);
-                PAL_ERR(LOG_TAG, "allocateFrontEndIds: front end %d", f[i]);
-                it -= 1;
-                id -= 1;
-            }
-            break;
         case PAL_STREAM_VOICE_CALL_MUSIC:
-            if (howMany > listAllPcmInCallMusicFrontEnds.size()) {
-                    PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends, have only %zu error",
-                                      howMany, listAllPcmInCallMusicFrontEnds.size());
-                    goto error;
-                }
-            id = (listAllPcmInCallMusicFrontEnds.size() - 1);
-            it = (listAllPcmInCallMusicFrontEnds.begin() + id);
-            for (int i = 0; i < howMany; i++) {
-                f.push_back(listAllPcmInCallMusicFrontEnds.at(id));
-                listAllPcmInCallMusicFrontEnds.erase(it);
-                PAL_ERR(LOG_TAG, "allocateFrontEndIds: front end %d", f[i]);
-                it -= 1;
-                id -= 1;
-            }
-            break;
-       case PAL_STREAM_CONTEXT_PROXY:
-            if (howMany > listAllPcmContextProxyFrontEnds.size()) {
-                    PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends, have only %zu error",
-                                      howMany, listAllPcmContextProxyFrontEnds.size());
-                    goto error;
-                }
-            id = (listAllPcmContextProxyFrontEnds.size() - 1);
-            it = (listAllPcmContextProxyFrontEnds.begin() + id);
-            for (int i = 0; i < howMany; i++) {
-                f.push_back(listAllPcmContextProxyFrontEnds.at(id));
-                listAllPcmContextProxyFrontEnds.erase(it);
-                PAL_ERR(LOG_TAG, "allocateFrontEndIds: front end %d", f[i]);
-                it -= 1;
-                id -= 1;
-            }
-            break;
+            /* in call record and music share a type on free, pick by direction */
+            if (sAttr.direction == PAL_AUDIO_INPUT)
+                return &pcmInCallRecordFePool;
+            if (sAttr.direction == PAL_AUDIO_OUTPUT)
+                return &pcmInCallMusicFePool;
+            return (sAttr.type == PAL_STREAM_VOICE_CALL_RECORD) ?
+                    &pcmInCallRecordFePool : &pcmInCallMusicFePool;
+        case PAL_STREAM_CONTEXT_PROXY:
+            return &pcmContextProxyFePool;
         default:
-            break;
+            return nullptr;
     }
-
-error:
-    mListFrontEndsMutex.unlock();
-    return f;
 }
 
-
-const std::vector<int> ResourceManager::allocateVoiceFrontEndIds(std::vector<int> listAllPcmVoiceFrontEnds, const int howMany)
+const std::vector<int> ResourceManager::allocateFrontEndIds(const struct pal_stream_attributes sAttr, int lDirection)
 {
     std::vector<int> f;
-    f.clear();
+    const int howMany = getNumFEs(sAttr.type);
+    FrontEndIdPool *pool = getFrontEndPool(sAttr, lDirection);
+    bool critical = isCriticalFrontEndUser(sAttr);
     int id = 0;
-    std::vector<int>::iterator it;
-    if ( howMany > listAllPcmVoiceFrontEnds.size()) {
-        PAL_ERR(LOG_TAG, "allocate voice FrontEndIds: requested for %d front ends, have only %zu error",
-                howMany, listAllPcmVoiceFrontEnds.size());
+
+    if (!pool)
         return f;
-    }
-    id = (listAllPcmVoiceFrontEnds.size() - 1);
-    it =  (listAllPcmVoiceFrontEnds.begin() + id);
+
     for (int i = 0; i < howMany; i++) {
-        f.push_back(listAllPcmVoiceFrontEnds.at(id));
-        listAllPcmVoiceFrontEnds.erase(it);
-        PAL_INFO(LOG_TAG, "allocate VoiceFrontEndIds: front end %d", f[i]);
-        it -= 1;
-        id -= 1;
+        id = pool->allocate(critical);
+        if (id < 0) {
+            PAL_ERR(LOG_TAG, "allocateFrontEndIds: requested for %d front ends from %s, have only %d error",
+                    howMany, pool->getName().c_str(), i);
+            for (int j = 0; j < f.size(); j++)
+                pool->free(f.at(j));
+            f.clear();
+            break;
+        }
+        f.push_back(id);
+        /* a previous user's graph may still be cached for this front end */
+        SessionAlsaUtils::invalidateModuleInstanceIds(id);
+        PAL_INFO(LOG_TAG, "allocateFrontEndIds: front end %d", id);
     }
 
     return f;
 }
+
 void ResourceManager::freeFrontEndIds(const std::vector<int> frontend,
                                       const struct pal_stream_attributes sAttr,
                                       int lDirection)
 {
-    mListFrontEndsMutex.lock();
+    FrontEndIdPool *pool = nullptr;
+
     if (frontend.size() <= 0) {
         PAL_ERR(LOG_TAG,"frontend size is invalid");
-        mListFrontEndsMutex.unlock();
         return;
     }
     PAL_INFO(LOG_TAG, "stream type %d, freeing %d\n", sAttr.type,
              frontend.at(0));
 
-    switch(sAttr.type) {
-        case PAL_STREAM_NON_TUNNEL:
-            for (int i = 0; i < frontend.size(); i++) {
-                 listAllNonTunnelSessionIds.push_back(frontend.at(i));
-            }
-            removeDuplicates(listAllNonTunnelSessionIds);
-            break;
-        case PAL_STREAM_LOW_LATENCY:
-        case PAL_STREAM_ULTRA_LOW_LATENCY:
-        case PAL_STREAM_GENERIC:
-        case PAL_STREAM_PROXY:
-        case PAL_STREAM_DEEP_BUFFER:
-        case PAL_STREAM_SPATIAL_AUDIO:
-        case PAL_STREAM_VOIP:
-        case PAL_STREAM_VOIP_RX:
-        case PAL_STREAM_VOIP_TX:
-        case PAL_STREAM_VOICE_UI:
-        case PAL_STREAM_LOOPBACK:
-        case PAL_STREAM_ACD:
-        case PAL_STREAM_PCM_OFFLOAD:
-        case PAL_STREAM_HAPTICS:
-        case PAL_STREAM_ULTRASOUND:
-        case PAL_STREAM_SENSOR_PCM_DATA:
-        case PAL_STREAM_RAW:
-        case PAL_STREAM_VOICE_RECOGNITION:
-            switch (sAttr.direction) {
-                case PAL_AUDIO_INPUT:
-                    if (lDirection == TX_HOSTLESS) {
-                        for (int i = 0; i < frontend.size(); i++) {
-                            listAllPcmHostlessTxFrontEnds.push_back(frontend.at(i));
-                        }
-                        removeDuplicates(listAllPcmHostlessTxFrontEnds);
-                    } else {
-                        for (int i = 0; i < frontend.size(); i++) {
-                            listAllPcmRecordFrontEnds.push_back(frontend.at(i));
-                        }
-                        removeDuplicates(listAllPcmRecordFrontEnds);
-                    }
-                    break;
-                case PAL_AUDIO_OUTPUT:
-                    for (int i = 0; i < frontend.size(); i++) {
-                        listAllPcmPlaybackFrontEnds.push_back(frontend.at(i));
-                    }
-                    removeDuplicates(listAllPcmPlaybackFrontEnds);
-                    break;
-                case PAL_AUDIO_INPUT | PAL_AUDIO_OUTPUT:
-                    if (lDirection == RX_HOSTLESS) {
-                        for (int i = 0; i < frontend.size(); i++) {
-                            listAllPcmHostlessRxFrontEnds.push_back(frontend.at(i));
-                        }
-                        removeDuplicates(listAllPcmHostlessRxFrontEnds);
-                    } else {
-                        for (int i = 0; i < frontend.size(); i++) {
-                            listAllPcmHostlessTxFrontEnds.push_back(frontend.at(i));
-                        }
-                        removeDuplicates(listAllPcmHostlessTxFrontEnds);
-                    }
-                    break;
-                default:
-                    PAL_ERR(LOG_TAG,"direction unsupported");
-                    break;
-            }
-            break;
-
-        case PAL_STREAM_VOICE_CALL:
-            if (lDirection == RX_HOSTLESS) {
-                for (int i = 0; i < frontend.size(); i++) {
-                    if (sAttr.info.voice_call_info.VSID == VOICEMMODE1 ||
-                        sAttr.info.voice_call_info.VSID == VOICELBMMODE1) {
-                        listAllPcmVoice1RxFrontEnds.push_back(frontend.at(i));
-                    } else {
-                        listAllPcmVoice2RxFrontEnds.push_back(frontend.at(i));
-                    }
-
-                }
-                removeDuplicates(listAllPcmVoice1RxFrontEnds);
-                removeDuplicates(listAllPcmVoice2RxFrontEnds);
-            } else {
-                for (int i = 0; i < frontend.size(); i++) {
-                    if (sAttr.info.voice_call_info.VSID == VOICEMMODE1 ||
-                        sAttr.info.voice_call_info.VSID == VOICELBMMODE1) {
-                        listAllPcmVoice1TxFrontEnds.push_back(frontend.at(i));
-                    } else {
-                        listAllPcmVoice2TxFrontEnds.push_back(frontend.at(i));
-                    }
-                }
-                removeDuplicates(listAllPcmVoice1TxFrontEnds);
-                removeDuplicates(listAllPcmVoice2TxFrontEnds);
-            }
-            break;
+    pool = getFrontEndPool(sAttr, lDirection);
+    if (!pool)
+        return;
 
-        case PAL_STREAM_COMPRESSED:
-            switch (sAttr.direction) {
-                case PAL_AUDIO_INPUT:
-                    for (int i = 0; i < frontend.size(); i++) {
-                        listAllCompressRecordFrontEnds.push_back(frontend.at(i));
-                    }
-                    removeDuplicates(listAllCompressRecordFrontEnds);
-                    break;
-                case PAL_AUDIO_OUTPUT:
-                    for (int i = 0; i < frontend.size(); i++) {
-                        listAllCompressPlaybackFrontEnds.push_back(frontend.at(i));
-                    }
-                    removeDuplicates(listAllCompressPlaybackFrontEnds);
-                    break;
-                default:
-                    PAL_ERR(LOG_TAG,"direction unsupported");
-                    break;
-                }
-            break;
-        case PAL_STREAM_VOICE_CALL_RECORD:
-        case PAL_STREAM_VOICE_CALL_MUSIC:
-            switch (sAttr.direction) {
-              case PAL_AUDIO_INPUT:
-                for (int i = 0; i < frontend.size(); i++) {
-                    listAllPcmInCallRecordFrontEnds.push_back(frontend.at(i));
-                }
-                removeDuplicates(listAllPcmInCallRecordFrontEnds);
-                break;
-              case PAL_AUDIO_OUTPUT:
-                for (int i = 0; i < frontend.size(); i++) {
-                    listAllPcmInCallMusicFrontEnds.push_back(frontend.at(i));
-                }
-                removeDuplicates(listAllPcmInCallMusicFrontEnds);
-                break;
-              default:
-                break;
-            }
-            break;
-       case PAL_STREAM_CONTEXT_PROXY:
-            for (int i = 0; i < frontend.size(); i++) {
-                 listAllPcmContextProxyFrontEnds.push_back(frontend.at(i));
-            }
-            removeDuplicates(listAllPcmContextProxyFrontEnds);
-            break;
-        default:
-            break;
-    }
-    mListFrontEndsMutex.unlock();
+    SessionAlsaUtils::invalidateModuleInstanceIds(frontend);
+    for (int i = 0; i < frontend.size(); i++)
+        pool->free(frontend.at(i));
     return;
 }
 
@@ -7491,6 +7741,85 @@ int32_t ResourceManager::streamDevConnect_l(std::vector <std::tuple<Stream *, st
 }
 
 
+/*
+ * Pair up disconnect and connect entries of the same stream and device and
+ * ask the stream which graph edit the pair needs. Pairs that can be applied
+ * by relinking the session device are moved to the relink list, everything
+ * else is left for the full disconnect/connect path.
+ */
+void ResourceManager::planStreamDevSwitch_l(std::vector <std::tuple<Stream *, uint32_t>> &streamDevDisconnectList,
+                                            std::vector <std::tuple<Stream *, struct pal_device *>> &streamDevConnectList,
+                                            std::vector <std::tuple<Stream *, struct pal_device *>> &streamDevRelinkList)
+{
+    std::vector <std::tuple<Stream *, uint32_t>>::iterator dIter;
+    std::vector <std::tuple<Stream *, struct pal_device *>>::iterator cIter;
+    Stream *s = NULL;
+    bool relink = false;
+
+    for (dIter = streamDevDisconnectList.begin(); dIter != streamDevDisconnectList.end(); ) {
+        s = std::get<0>(*dIter);
+        relink = false;
+        if (s && isStreamActive(s, mActiveStreams)) {
+            for (cIter = streamDevConnectList.begin(); cIter != streamDevConnectList.end(); cIter++) {
+                if (std::get<0>(*cIter) != s || !std::get<1>(*cIter) ||
+                    std::get<1>(*cIter)->id != std::get<1>(*dIter))
+                    continue;
+                if (s->planDeviceSwitch_l(std::get<1>(*dIter), std::get<1>(*cIter)) ==
+                        DEV_SWITCH_EDIT_RELINK) {
+                    streamDevRelinkList.push_back(*cIter);
+                    streamDevConnectList.erase(cIter);
+                    relink = true;
+                }
+                break;
+            }
+        }
+        if (relink) {
+            PAL_INFO(LOG_TAG, "stream %pK device %d relinked in place", s, std::get<1>(*dIter));
+            dIter = streamDevDisconnectList.erase(dIter);
+        } else {
+            dIter++;
+        }
+    }
+}
+
+/*
+ * Relink the planned pairs. A pair whose relink failed before touching the
+ * graph is queued back onto the disconnect and connect lists, so it goes
+ * through the full switch like any other pair, and only that switch decides
+ * the result. Other relink failures are returned.
+ */
+int32_t ResourceManager::streamDevRelink_l(std::vector <std::tuple<Stream *, struct pal_device *>> streamDevRelinkList,
+                                           std::vector <std::tuple<Stream *, uint32_t>> &streamDevDisconnectList,
+                                           std::vector <std::tuple<Stream *, struct pal_device *>> &streamDevConnectList)
+{
+    int status = 0;
+    int ret = 0;
+    bool fullSwitch = false;
+    std::vector <std::tuple<Stream *, struct pal_device *>>::iterator sIter;
+
+    PAL_DBG(LOG_TAG, "Enter");
+    for (sIter = streamDevRelinkList.begin(); sIter != streamDevRelinkList.end(); sIter++) {
+        ret = std::get<0>(*sIter)->relinkStreamDevice_l(std::get<0>(*sIter), std::get<1>(*sIter),
+                                                        &fullSwitch);
+        if (ret && fullSwitch) {
+            PAL_ERR(LOG_TAG, "failed to relink stream %pK on device %d, falling back to full switch",
+                    std::get<0>(*sIter), std::get<1>(*sIter)->id);
+            streamDevDisconnectList.push_back({std::get<0>(*sIter), std::get<1>(*sIter)->id});
+            streamDevConnectList.push_back(*sIter);
+        } else if (ret) {
+            PAL_ERR(LOG_TAG, "failed to relink stream %pK on device %d",
+                    std::get<0>(*sIter), std::get<1>(*sIter)->id);
+            status = ret;
+        } else {
+            PAL_DBG(LOG_TAG, "relinked stream %pK on device %d",
+                    std::get<0>(*sIter), std::get<1>(*sIter)->id);
+        }
+    }
+
+    PAL_DBG(LOG_TAG, "Exit status: %d", status);
+    return status;
+}
+
 template <class T>
 void SortAndUnique(std::vector<T> &streams)
 {
@@ -7505,10 +7834,12 @@ int32_t ResourceManager::streamDevSwitch(std::vector <std::tuple<Stream *, uint3
                                          std::vector <std::tuple<Stream *, struct pal_device *>> streamDevConnectList)
 {
     int status = 0;
+    int relinkStatus = 0;
     std::vector <Stream*>::iterator sIter;
     std::vector <struct pal_device *>::iterator dIter;
     std::vector <std::tuple<Stream *, uint32_t>>::iterator sIter1;
     std::vector <std::tuple<Stream *, struct pal_device *>>::iterator sIter2;
+    std::vector <std::tuple<Stream *, struct pal_device *>> streamDevRelinkList;
     std::vector <Stream*> uniqueStreamsList;
     std::vector <struct pal_device *> uniqueDevConnectionList;
     pal_stream_attributes sAttr;
@@ -7586,6 +7917,18 @@ int32_t ResourceManager::streamDevSwitch(std::vector <std::tuple<Stream *, uint3
         }
     }
 
+    planStreamDevSwitch_l(streamDevDisconnectList, streamDevConnectList, streamDevRelinkList);
+
+    /*
+     * Relink first, so pairs that fall back are switched fully below.
+     * Relinked streams stay locked until exit, they are not in the connect
+     * list. Pairs that fell back report through the connect below.
+     */
+    relinkStatus = streamDevRelink_l(streamDevRelinkList, streamDevDisconnectList,
+                                     streamDevConnectList);
+    if (relinkStatus) {
+        PAL_ERR(LOG_TAG, "relink failed");
+    }
     status = streamDevDisconnect_l(streamDevDisconnectList);
     if (status) {
         PAL_ERR(LOG_TAG, "disconnect failed");
@@ -7595,6 +7938,8 @@ int32_t ResourceManager::streamDevSwitch(std::vector <std::tuple<Stream *, uint3
     if (status) {
         PAL_ERR(LOG_TAG, "Connect failed");
     }
+    if (!status && relinkStatus)
+        status = relinkStatus;
 
     for (sIter2 = streamDevConnectList.begin(); sIter2 != streamDevConnectList.end(); sIter2++) {
         if ((std::get<0>(*sIter2) != NULL) && isStreamActive(std::get<0>(*sIter2), mActiveStreams)) {
@@ -8110,6 +8455,7 @@ int ResourceManager::setConfigParams(struct str_parms *parms)
     ret = setUpdDutyCycleEnableParam(parms, value, len);
     ret = setUpdVirtualPortParam(parms, value, len);
     ret = setSpkrXmaxTmaxLoggingParam(parms, value, len);
+    ret = setReservedFrontEndsParam(parms, value, len);
 
     /* Not checking return value as this is optional */
     setLpiLoggingParams(parms, value, len);
@@ -8362,6 +8708,26 @@ int ResourceManager::setSignalHandlerEnableParam(struct str_parms *parms,
     return ret;
 }
 
+int ResourceManager::setReservedFrontEndsParam(struct str_parms *parms,
+                                 char *value, int len)
+{
+    int ret = -EINVAL;
+
+    if (!value || !parms)
+        return ret;
+
+    ret = str_parms_get_str(parms, AUDIO_PARAMETER_KEY_RESERVED_FRONTENDS,
+                                value, len);
+    if (ret >= 0) {
+        reservedFrontEndsCfg = value;
+        PAL_INFO(LOG_TAG, "critical frontend reservations %s", value);
+        str_parms_del(parms, AUDIO_PARAMETER_KEY_RESERVED_FRONTENDS);
+        ret = 0;
+    }
+
+    return ret;
+}
+
 int ResourceManager::setNativeAudioParams(struct str_parms *parms,
                                           char *value, int len)
 {
@@ -10278,9 +10644,11 @@ error:
     return status;
 }
 
+/* called with mResourceManagerMutex held */
 int ResourceManager::handleScreenStatusChange(pal_param_screen_state_t screen_state)
 {
     int status = 0;
+    std::vector<StreamUltraSound *> updStreams;
 
     if (screen_state_ != screen_state.screen_state) {
         if (screen_state.screen_state == false) {
@@ -10298,6 +10666,25 @@ int ResourceManager::handleScreenStatusChange(pal_param_screen_state_t screen_st
          *   status = (*iter)->handleScreenState(screen_state_);
          *  }
          */
+        /*
+         * Ultrasound duty cycles only while the screen is off. The streams
+         * take their own lock, so notify them pinned and with no RM lock held.
+         */
+        mResourceManagerMutex.unlock();
+        lockActiveStream();
+        for (auto upd : active_streams_ultrasound) {
+            if (increaseStreamUserCounter(upd) < 0)
+                continue;
+            updStreams.push_back(upd);
+        }
+        unlockActiveStream();
+        for (auto upd : updStreams)
+            upd->handleScreenState(screen_state.screen_state);
+        lockActiveStream();
+        for (auto upd : updStreams)
+            decreaseStreamUserCounter(upd);
+        unlockActiveStream();
+        mResourceManagerMutex.lock();
     }
     return status;
 }
@@ -11560,6 +11947,10 @@ void ResourceManager::process_device_info(struct xml_userdata *data, const XML_C
                 isMainSpeakerRight = true;
         } else if (!strcmp(tag_name, "quick_cal_time")) {
             spQuickCalTime = atoi(data->data_buf);
+        } else if (!strcmp(tag_name, "cal_validity_days")) {
+            spCalValidityDays = atoi(data->data_buf);
+        } else if (!strcmp(tag_name, "cal_temp_window")) {
+            spCalTempWindow = atoi(data->data_buf);
         }else if (!strcmp(tag_name, "ras_enabled")) {
             if (atoi(data->data_buf))
                 isRasEnabled = true;
@@ -11616,11 +12007,8 @@ void ResourceManager::process_device_info(struct xml_userdata *data, const XML_C
         if (!strcmp(tag_name, "id")) {
             std::string rxDeviceName(data->data_buf);
             pal_device_id_t rxDeviceId  = deviceIdLUT.at(rxDeviceName);
-            std::vector<std::pair<Stream *, int>> str_list;
-            str_list.clear();
             size = deviceInfo.size() - 1;
             deviceInfo[size].rx_dev_ids.push_back(rxDeviceId);
-            deviceInfo[size].ec_ref_count_map.insert({rxDeviceId, str_list});
         }
     } else if (data->tag == TAG_VI_CHMAP) {
         if (!strcmp(tag_name, "channel")) {
@@ -11719,6 +12107,8 @@ void ResourceManager::process_input_streams(struct xml_userdata *data, const XML
             type  = usecaseIdLUT.at(userIdname);
             size = txEcInfo.size() - 1;
             txEcInfo[size].disabled_rx_streams.push_back(type);
+            if (txEcInfo[size].tx_stream_type < PAL_STREAM_MAX && type < PAL_STREAM_MAX)
+                ecRefDisabled[txEcInfo[size].tx_stream_type][type] = true;
             PAL_DBG(LOG_TAG, "ecref %d", type);
         }
     }
@@ -11892,6 +12282,9 @@ void ResourceManager::startTag(void *userdata, const XML_Char *tag_name,
     } else if(strcmp(tag_name, "temp_ctrl") == 0) {
         processSpkrTempCtrls(attr);
         return;
+    } else if (strcmp(tag_name, "thread_policy") == 0) {
+        PalThreadPolicy::configure((const char **)attr);
+        return;
     }
 
     if (data->card_parsed)
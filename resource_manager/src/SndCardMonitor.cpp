@@ -37,98 +37,109 @@
 #include <unistd.h>
 #include <sys/stat.h>
 #include <fcntl.h>
-#include <sys/poll.h>
+#include <sys/epoll.h>
 #include <list>
-#include <sys/eventfd.h>
 #include "ResourceManager.h"
 #include "PalCommon.h"
+#include "PalEventLoop.h"
 #include "SndCardMonitor.h"
 
 #define SNDCARD_PATH "/sys/kernel/snd_card/card_state"
 #define MAX_SLEEP_RETRY 100
+#define SNDCARD_RETRY_INTERVAL_MS 500
 
-static int fd = -1, efd = -1;
-static int exit_thread = 0; //by default exit thread is made false
-
-void SndCardMonitor::monitorThreadLoop()
+/*
+ * Tries to open the card state node. Until the node shows up this is
+ * retried from a periodic event loop timer; once open, the node is watched
+ * for sysfs notifications on the event loop instead of a dedicated thread.
+ */
+void SndCardMonitor::openCardState()
 {
-    struct pollfd *poll_fds;
-    int rv = 0;
+    PalEventLoop *loop = PalEventLoop::getInstance();
     char buf[12];
-    int card_status = 0;
-    int tries = MAX_SLEEP_RETRY;
+    int fd = -1;
 
-    card_status_t status = CARD_STATUS_NONE;
-    std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
-    while(--tries) {
-        if (exit_thread == 1)
-            break;
-        if ((fd = open(SNDCARD_PATH, O_RDWR)) < 0) {
-            PAL_ERR(LOG_TAG, "Open failed snd sysfs node");
-        }
-        else {
-            PAL_VERBOSE(LOG_TAG, "snd sysfs node open successful");
-            break;
+    if (!loop)
+        return;
+
+    std::lock_guard<std::mutex> lock(mLock);
+    if (mFd >= 0)
+        return;
+
+    fd = open(SNDCARD_PATH, O_RDWR);
+    if (fd < 0) {
+        PAL_ERR(LOG_TAG, "Open failed snd sysfs node");
+        if (--mTries > 0) {
+            if (mRetryTimer <= 0)
+                mRetryTimer = loop->addTimer(SNDCARD_RETRY_INTERVAL_MS,
+                        SNDCARD_RETRY_INTERVAL_MS, [this]() { openCardState(); });
+            return;
         }
-        usleep(500000);
+        goto stop_retry;
     }
-    efd = eventfd(0, EFD_CLOEXEC);
-    if (fd == -1 || efd == -1)
-        goto Done;
-    poll_fds = (struct pollfd*) calloc(2, sizeof(struct pollfd));
-    if(NULL == poll_fds) {
-        PAL_ERR(LOG_TAG, "Memory allocation failed");
-        goto Done;
+    PAL_VERBOSE(LOG_TAG, "snd sysfs node open successful");
+
+    /* consume the current state so that only changes are notified */
+    memset(buf, 0, sizeof(buf));
+    read(fd, buf, 10);
+    lseek(fd, 0L, SEEK_SET);
+
+    if (loop->addFd(fd, EPOLLPRI | EPOLLERR,
+            [this](uint32_t events) { onCardStateEvent(events); })) {
+        PAL_ERR(LOG_TAG, "failed to watch snd sysfs node");
+        close(fd);
+        goto stop_retry;
     }
+    mFd = fd;
 
-    while(1) {
-        memset(buf , 0 ,sizeof(buf));
-        read(fd, buf, 10);
-        lseek(fd,0L,SEEK_SET);
-
-        poll_fds[0].fd = fd;
-        poll_fds[0].events = POLLERR | POLLPRI;
-        poll_fds[0].revents = 0;
-        poll_fds[1].fd = efd;
-        poll_fds[1].events = POLLERR | POLLIN;
-        poll_fds[1].revents = 0;
-
-        PAL_VERBOSE(LOG_TAG, "waiting sys_notify event\n");
-        if (( rv = poll(poll_fds, 2, -1)) < 0 ) {
-             PAL_ERR(LOG_TAG, "snd sysfs node poll error\n");
-        } else if ((poll_fds[0].revents & POLLPRI)) {
-            lseek(poll_fds[0].fd,0L,SEEK_SET);
-            read(poll_fds[0].fd, buf, 1);
-            sscanf(buf , "%d", &card_status);
-            PAL_INFO(LOG_TAG, "card status %d\n",card_status);
-            if (card_status == 0)
-                status = CARD_STATUS_OFFLINE;
-            else if (card_status == 1)
-                status = CARD_STATUS_ONLINE;
-            else if (card_status == 2)
-                break;
-
-            rm->ssrHandler(status);
-        } else if((poll_fds[1].revents & POLLIN)) {
-            uint64_t eval;
-            read(poll_fds[1].fd, &eval, 8);
-            if (eval == 1) {
-                free(poll_fds);
-                poll_fds = NULL;
-                close(efd);
-                close(fd);
-                break;
-            }
-       }
+stop_retry:
+    if (mRetryTimer > 0) {
+        loop->cancelTimer(mRetryTimer);
+        mRetryTimer = 0;
     }
-Done:
-    return;
+}
+
+/*
+ * Runs inline on the event loop thread. The state is only queued to the
+ * RM ssr thread; getInstance() is avoided as it may create the RM.
+ */
+void SndCardMonitor::onCardStateEvent(uint32_t events)
+{
+    PalEventLoop *loop = NULL;
+    card_status_t status = CARD_STATUS_NONE;
+    int card_status = 0;
+    char buf[12];
+
+    if (!(events & EPOLLPRI))
+        return;
+
+    memset(buf, 0, sizeof(buf));
+    lseek(mFd, 0L, SEEK_SET);
+    read(mFd, buf, 1);
+    sscanf(buf, "%d", &card_status);
+    PAL_INFO(LOG_TAG, "card status %d\n", card_status);
+    if (card_status == 0) {
+        status = CARD_STATUS_OFFLINE;
+    } else if (card_status == 1) {
+        status = CARD_STATUS_ONLINE;
+    } else if (card_status == 2) {
+        /* stop watching, the node is closed on destruction */
+        loop = PalEventLoop::getInstance();
+        if (loop)
+            loop->removeFd(mFd);
+        return;
+    }
+
+    ResourceManager::ssrHandler(status);
 }
 
 SndCardMonitor::SndCardMonitor(int sndNum)
+    : mFd(-1),
+      mRetryTimer(0),
+      mTries(MAX_SLEEP_RETRY)
 {
     sndNum = 0; //not used at present.
-    mThread = std::thread(&SndCardMonitor::monitorThreadLoop, this);
+    openCardState();
     PAL_VERBOSE(LOG_TAG, "Snd card monitor init done.");
     return;
 }
@@ -136,9 +147,22 @@ SndCardMonitor::SndCardMonitor(int sndNum)
 
 SndCardMonitor::~SndCardMonitor()
 {
-   uint64_t eval = 1;
-   exit_thread = 1;
-   if(efd != -1)
-      write(efd, &eval, 8);
-   mThread.join();
+    PalEventLoop *loop = PalEventLoop::getInstance();
+    int timer = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        timer = mRetryTimer;
+        mRetryTimer = 0;
+        mTries = 0;
+    }
+    if (loop && timer > 0)
+        loop->cancelTimer(timer);
+
+    if (mFd >= 0) {
+        if (loop)
+            loop->removeFd(mFd);
+        close(mFd);
+        mFd = -1;
+    }
 }
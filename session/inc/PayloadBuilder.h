@@ -44,6 +44,7 @@
 #include <algorithm>
 #include <expat.h>
 #include <map>
+#include <mutex>
 #include <regex>
 #include <sstream>
 #include "Stream.h"
@@ -182,6 +183,9 @@ protected:
    static std::vector<allKVs> all_streampps;
    static std::vector<allKVs> all_devices;
    static std::vector<allKVs> all_devicepps;
+   /* buffers from allocParamPayload and the bytes available at payload */
+   static std::mutex paramPayloadMutex;
+   static std::map<pal_param_payload *, size_t> paramPayloads;
 
 public:
     void payloadUsbAudioConfig(uint8_t** payload, size_t* size,
@@ -206,6 +210,20 @@ public:
     int payloadCustomParam(uint8_t **alsaPayload, size_t *size,
                             uint32_t *customayload, uint32_t customPayloadSize,
                             uint32_t moduleInstanceId, uint32_t dspParamId);
+    static pal_param_payload *allocParamPayload(uint32_t size);
+    static void freeParamPayload(pal_param_payload *payload);
+    /*
+     * Non TKV effect payloads in a buffer from allocParamPayload are sent
+     * without a copy: the module param header is written over the effect
+     * header and param id, which take the same 16 bytes, and the original
+     * bytes are kept in saved until restoreCustomParamInPlace.
+     */
+    int payloadCustomParamInPlace(uint8_t **alsaPayload, size_t *size,
+                            effect_pal_payload_t *effectPayload,
+                            uint32_t moduleInstanceId,
+                            struct apm_module_param_data_t *saved);
+    void restoreCustomParamInPlace(effect_pal_payload_t *effectPayload,
+                            const struct apm_module_param_data_t *saved);
     int payloadACDBParam(uint8_t **alsaPayload, size_t *size,
                             uint8_t *acdbParam,
                             uint32_t moduleInstanceId,
@@ -155,6 +155,8 @@ public:
     virtual int writeBufferInit(Stream *s __unused, size_t noOfBuf __unused, size_t bufSize __unused, int flag __unused) {return 0;};
     virtual int read(Stream *s __unused, int tag __unused, struct pal_buffer *buf __unused, int * size __unused) {return 0;};
     virtual int write(Stream *s __unused, int tag __unused, struct pal_buffer *buf __unused, int * size __unused, int flag __unused) {return 0;};
+    virtual int readBatch(Stream *s, int tag, struct pal_buffer *bufs, uint32_t numBufs, int *size);
+    virtual int writeBatch(Stream *s, int tag, struct pal_buffer *bufs, uint32_t numBufs, int *size);
     virtual int getParameters(Stream *s __unused, int tagId __unused, uint32_t param_id __unused, void **payload __unused) {return 0;};
     virtual int setParameters(Stream *s __unused, int tagId __unused, uint32_t param_id __unused, void *payload __unused) {return 0;};
     virtual int registerCallBack(session_callback cb __unused, uint64_t cookie __unused) {return 0;};
@@ -75,6 +75,8 @@ private:
     std::vector<int> sessionIds;
     pal_audio_fmt_t audio_fmt;
     int fileWrite(Stream *s, int tag, struct pal_buffer *buf, int * size, int flag);
+    int fillAgmBuffer(struct pal_stream_attributes *sAttr, struct pal_buffer *buf,
+                      struct agm_buff *agmBuf, bool isWrite);
     std::vector <std::pair<int, int>> ckv;
     std::vector <std::pair<int, int>> tkv;
     int getAgmCodecId(pal_audio_fmt_t fmt);
@@ -100,6 +102,8 @@ public:
     int getParameters(Stream *s, int tagId, uint32_t param_id, void **payload);
     int read(Stream *s, int tag, struct pal_buffer *buf, int * size) override;
     int write(Stream *s, int tag, struct pal_buffer *buf, int * size, int flag) override;
+    int readBatch(Stream *s, int tag, struct pal_buffer *bufs, uint32_t numBufs, int *size) override;
+    int writeBatch(Stream *s, int tag, struct pal_buffer *bufs, uint32_t numBufs, int *size) override;
     int setECRef(Stream *s __unused, std::shared_ptr<Device> rx_dev __unused, bool is_enable __unused) {return 0;};
     int registerCallBack(session_callback cb, uint64_t cookie);
     int drain(pal_drain_type_t type);
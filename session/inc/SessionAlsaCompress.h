@@ -99,6 +99,9 @@ private:
 
     std::condition_variable cv_; /* used to wait for incoming requests */
     std::mutex cv_mutex_; /* mutex used in conjunction with above cv */
+    std::mutex prefetch_mutex_; /* guards the staged next track */
+    std::mutex codec_mutex_; /* guards codec, also set from the offload thread */
+    struct pal_next_track_prefetch *nextTrack = NULL;
     void getSndCodecParam(struct snd_codec &codec, struct pal_stream_attributes &sAttr);
     int getSndCodecId(pal_audio_fmt_t fmt);
     int setCustomFormatParam(pal_audio_fmt_t audio_fmt);
@@ -119,6 +122,9 @@ private:
     bool isCodecConfigNeeded(pal_audio_fmt_t audio_fmt,
                              pal_stream_direction_t stream_direction);
     int configureEarlyEOSDelay(void);
+    int stageNextTrack(pal_param_payload *param_payload);
+    int applyNextTrack();
+    void dropNextTrack();
     void updateCodecOptions(pal_param_payload *param_payload,
                             pal_stream_direction_t stream_direction);
     pal_device_id_t ecRefDevId;
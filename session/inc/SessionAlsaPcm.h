@@ -122,6 +122,7 @@ public:
     int writeBufferInit(Stream *s, size_t noOfBuf, size_t bufSize, int flag) override;
     int read(Stream *s, int tag, struct pal_buffer *buf, int * size) override;
     int write(Stream *s, int tag, struct pal_buffer *buf, int * size, int flag) override;
+    int writeBatch(Stream *s, int tag, struct pal_buffer *bufs, uint32_t numBufs, int *size) override;
     int setParameters(Stream *s, int tagId, uint32_t param_id, void *payload) override;
     int getParameters(Stream *s, int tagId, uint32_t param_id, void **payload) override;
     int setECRef(Stream *s, std::shared_ptr<Device> rx_dev, bool is_enable) override;
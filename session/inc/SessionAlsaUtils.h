@@ -83,6 +83,13 @@ private:
     static struct mixer_ctl *getBeMixerControl(struct mixer *am, std::string beName,
         uint32_t idx);
     static struct mixer_ctl *getStaticMixerControl(struct mixer *am, std::string name);
+    /* tag -> miid of the graph behind each (pcm device, interface) */
+    static std::mutex miidCacheMutex;
+    static std::map<std::pair<int, std::string>, std::unordered_map<uint32_t, uint32_t>> miidCache;
+    /* bumped on every invalidation, a fetch that raced one is not cached */
+    static uint64_t miidCacheGen;
+    static int fetchTagModuleMap(struct mixer *mixer, int device, const char *intf_name,
+                       std::unordered_map<uint32_t, uint32_t> &tagMap);
 public:
     ~SessionAlsaUtils();
     static bool isRxDevice(uint32_t devId);
@@ -109,6 +116,9 @@ public:
                     std::vector<std::pair<std::string, int>> &freeDeviceMetaData);
     static int getModuleInstanceId(struct mixer *mixer, int device, const char *intf_name,
                        int tag_id, uint32_t *miid);
+    static void invalidateModuleInstanceIds(int device);
+    static void invalidateModuleInstanceIds(const std::vector<int> &DevIds);
+    static void invalidateModuleInstanceIds(const std::string &intfName);
     static int getTagsWithModuleInfo(struct mixer *mixer, int device, const char *intf_name,
                        uint8_t *payload);
     static int setMixerParameter(struct mixer *mixer, int device,
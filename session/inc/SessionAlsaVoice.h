@@ -146,6 +146,9 @@ private:
     int setPopSuppressorMute(Stream *s);
     int setExtECRef(Stream *s, std::shared_ptr<Device> rx_dev, bool is_enable);
     int getRXDevice(Stream *s, std::shared_ptr<Device> &rx_dev);
+    static void openHostlessPcm(unsigned int card, unsigned int device,
+                                unsigned int flags, struct pcm_config *config,
+                                struct pcm **pcm);
 };
 
 #endif //SESSION_ALSAVOICE_H
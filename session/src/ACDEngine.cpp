@@ -71,6 +71,7 @@
 #include "Stream.h"
 #include "StreamACD.h"
 #include "ResourceManager.h"
+#include "PalThreadPolicy.h"
 #include "kvh2xml.h"
 #include "acd_api.h"
 
@@ -339,6 +340,7 @@ void ACDEngine::ParseEventAndNotifyClient()
 
 void ACDEngine::EventProcessingThread(ACDEngine *engine)
 {
+    PalThreadScope threadScope(PAL_THREAD_CLASS_LAB, "acd_event");
     PAL_INFO(LOG_TAG, "Enter. start thread loop");
     if (!engine) {
         PAL_ERR(LOG_TAG, "Error:%d Invalid engine", -EINVAL);
@@ -259,6 +259,8 @@ std::vector<allKVs> PayloadBuilder::all_streams;
 std::vector<allKVs> PayloadBuilder::all_streampps;
 std::vector<allKVs> PayloadBuilder::all_devices;
 std::vector<allKVs> PayloadBuilder::all_devicepps;
+std::mutex PayloadBuilder::paramPayloadMutex;
+std::map<pal_param_payload *, size_t> PayloadBuilder::paramPayloads;
 
 template <typename T>
 void PayloadBuilder::populateChannelMixerCoeff(T pcmChannel, uint8_t numChannel,
@@ -1567,6 +1569,95 @@ int PayloadBuilder::payloadACDBParam(uint8_t **alsaPayload, size_t *size,
     return 0;
 }
 
+pal_param_payload *PayloadBuilder::allocParamPayload(uint32_t size)
+{
+    std::lock_guard<std::mutex> lock(paramPayloadMutex);
+    pal_param_payload *payload = NULL;
+    /* the mixer payload built in place is padded to 8 bytes */
+    size_t capacity = PAL_ALIGN_8BYTE((size_t)size) + 8;
+
+    payload = (pal_param_payload *)calloc(1, sizeof(pal_param_payload) + capacity);
+    if (!payload) {
+        PAL_ERR(LOG_TAG, "failed to allocate param payload of %u bytes", size);
+        return NULL;
+    }
+    payload->payload_size = size;
+    paramPayloads[payload] = capacity;
+    return payload;
+}
+
+void PayloadBuilder::freeParamPayload(pal_param_payload *payload)
+{
+    std::lock_guard<std::mutex> lock(paramPayloadMutex);
+
+    if (!payload)
+        return;
+    if (!paramPayloads.erase(payload)) {
+        PAL_ERR(LOG_TAG, "%pK was not allocated by PAL", payload);
+        return;
+    }
+    free(payload);
+}
+
+int PayloadBuilder::payloadCustomParamInPlace(uint8_t **alsaPayload, size_t *size,
+            effect_pal_payload_t *effectPayload, uint32_t moduleInstanceId,
+            struct apm_module_param_data_t *saved) {
+    struct apm_module_param_data_t *header = NULL;
+    pal_param_payload *param = NULL;
+    pal_effect_custom_payload_t *customPayload = NULL;
+    size_t alsaPayloadSize = 0;
+    uint32_t paramSize = 0;
+    uint32_t paramId = 0;
+
+    static_assert(sizeof(effect_pal_payload_t) + sizeof(pal_effect_custom_payload_t) ==
+                  sizeof(struct apm_module_param_data_t),
+                  "module param header must cover the effect header");
+
+    if (!effectPayload || !saved || effectPayload->isTKV ||
+        effectPayload->payloadSize < sizeof(pal_effect_custom_payload_t))
+        return -EINVAL;
+
+    paramSize = effectPayload->payloadSize - sizeof(uint32_t);
+    alsaPayloadSize = PAL_ALIGN_8BYTE(sizeof(struct apm_module_param_data_t) +
+                                      (size_t)paramSize);
+    param = (pal_param_payload *)((uint8_t *)effectPayload -
+                                  offsetof(pal_param_payload, payload));
+    {
+        std::lock_guard<std::mutex> lock(paramPayloadMutex);
+        auto it = paramPayloads.find(param);
+
+        if (it == paramPayloads.end())
+            return -ENOENT;
+        if (alsaPayloadSize > it->second) {
+            PAL_ERR(LOG_TAG, "effect payload of %u bytes overruns its buffer",
+                    effectPayload->payloadSize);
+            return -ENOSPC;
+        }
+    }
+
+    customPayload = (pal_effect_custom_payload_t *)effectPayload->payload;
+    paramId = customPayload->paramId;
+    header = (struct apm_module_param_data_t *)effectPayload;
+    memcpy(saved, header, sizeof(*saved));
+
+    header->module_instance_id = moduleInstanceId;
+    header->param_id = paramId;
+    header->error_code = 0x0;
+    header->param_size = paramSize;
+    memset((uint8_t *)header + sizeof(*header) + paramSize, 0,
+           alsaPayloadSize - sizeof(*header) - paramSize);
+
+    *size = alsaPayloadSize;
+    *alsaPayload = (uint8_t *)header;
+    PAL_VERBOSE(LOG_TAG, "param id 0x%x, %zu bytes in place", paramId, alsaPayloadSize);
+    return 0;
+}
+
+void PayloadBuilder::restoreCustomParamInPlace(effect_pal_payload_t *effectPayload,
+            const struct apm_module_param_data_t *saved) {
+    memcpy(effectPayload, saved, sizeof(*saved));
+}
+
 int PayloadBuilder::payloadCustomParam(uint8_t **alsaPayload, size_t *size,
             uint32_t *customPayload, uint32_t customPayloadSize,
             uint32_t moduleInstanceId, uint32_t paramId) {
@@ -306,6 +306,8 @@ int Session::getEffectParameters(Stream *s __unused, effect_pal_payload_t *effec
     struct mixer_ctl *ctl = NULL;
     pal_effect_custom_payload_t *effectCustomPayload = nullptr;
     PayloadBuilder builder;
+    struct apm_module_param_data_t saved;
+    bool inPlace = false;
 
     PAL_DBG(LOG_TAG, "Enter.");
 
@@ -324,9 +326,17 @@ int Session::getEffectParameters(Stream *s __unused, effect_pal_payload_t *effec
         goto exit;
     }
 
-    builder.payloadQuery(&payloadData, &payloadSize,
-                            miid, effectCustomPayload->paramId,
-                            effectPayload->payloadSize - sizeof(uint32_t));
+    if (!builder.payloadCustomParamInPlace(&payloadData, &payloadSize,
+            effectPayload, miid, &saved)) {
+        /* the query goes out empty, as from payloadQuery */
+        inPlace = true;
+        memset(payloadData + sizeof(struct apm_module_param_data_t), 0,
+               payloadSize - sizeof(struct apm_module_param_data_t));
+    } else {
+        builder.payloadQuery(&payloadData, &payloadSize,
+                                miid, effectCustomPayload->paramId,
+                                effectPayload->payloadSize - sizeof(uint32_t));
+    }
     status = mixer_ctl_set_array(ctl, payloadData, payloadSize);
     if (0 != status) {
         PAL_ERR(LOG_TAG, "Set custom config failed, status = %d", status);
@@ -339,13 +349,18 @@ int Session::getEffectParameters(Stream *s __unused, effect_pal_payload_t *effec
         goto exit;
     }
 
-    ptr = (uint8_t *)payloadData + sizeof(struct apm_module_param_data_t);
-    ar_mem_cpy(effectCustomPayload->data, effectPayload->payloadSize,
-                        ptr, effectPayload->payloadSize);
+    /* in place, the result is already in effectCustomPayload->data */
+    if (!inPlace) {
+        ptr = (uint8_t *)payloadData + sizeof(struct apm_module_param_data_t);
+        ar_mem_cpy(effectCustomPayload->data, effectPayload->payloadSize,
+                            ptr, effectPayload->payloadSize);
+    }
 
 exit:
     ctl = NULL;
-    if (payloadData)
+    if (inPlace)
+        builder.restoreCustomParamInPlace(effectPayload, &saved);
+    else if (payloadData)
         free(payloadData);
     PAL_ERR(LOG_TAG, "Exit. status %d", status);
     return status;
@@ -438,6 +453,8 @@ int Session::setEffectParametersNonTKV(Stream *s __unused, effect_pal_payload_t
     size_t payloadSize = 0;
     uint8_t *payloadData = NULL;
     pal_effect_custom_payload_t *effectCustomPayload = nullptr;
+    struct apm_module_param_data_t saved;
+    bool inPlace = false;
 
     PAL_DBG(LOG_TAG, "Enter.");
 
@@ -456,14 +473,19 @@ int Session::setEffectParametersNonTKV(Stream *s __unused, effect_pal_payload_t
 
     /* Now we got the miid, build set param payload */
     effectCustomPayload = (pal_effect_custom_payload_t *)effectPayload->payload;
-    status = builder.payloadCustomParam(&payloadData, &payloadSize,
-            effectCustomPayload->data,
-            effectPayload->payloadSize - sizeof(uint32_t),
-            miid, effectCustomPayload->paramId);
-    if (status != 0) {
-        PAL_ERR(LOG_TAG, "payloadCustomParam failed. status = %d",
-                status);
-        goto exit;
+    if (!builder.payloadCustomParamInPlace(&payloadData, &payloadSize,
+            effectPayload, miid, &saved)) {
+        inPlace = true;
+    } else {
+        status = builder.payloadCustomParam(&payloadData, &payloadSize,
+                effectCustomPayload->data,
+                effectPayload->payloadSize - sizeof(uint32_t),
+                miid, effectCustomPayload->paramId);
+        if (status != 0) {
+            PAL_ERR(LOG_TAG, "payloadCustomParam failed. status = %d",
+                    status);
+            goto exit;
+        }
     }
     /* set param through set mixer param */
     status = SessionAlsaUtils::setMixerParameter(mixer,
@@ -473,7 +495,9 @@ int Session::setEffectParametersNonTKV(Stream *s __unused, effect_pal_payload_t
     PAL_INFO(LOG_TAG, "mixer set param status = %d\n", status);
 
 exit:
-    if (payloadData) {
+    if (inPlace) {
+        builder.restoreCustomParamInPlace(effectPayload, &saved);
+    } else if (payloadData) {
         free(payloadData);
         payloadData = NULL;
     }
@@ -649,6 +673,49 @@ int Session::freeCustomPayload()
     return 0;
 }
 
+/*
+ * Fallback for sessions without native batch support, buffers are handed
+ * to read()/write() one at a time. Stops at the first failure with *size
+ * set to the bytes transferred so far; on read each buffer's size is
+ * updated to the number of bytes read into it.
+ */
+int Session::readBatch(Stream *s, int tag, struct pal_buffer *bufs, uint32_t numBufs, int *size)
+{
+    int status = 0;
+    int bytes = 0;
+    int total = 0;
+
+    for (uint32_t i = 0; i < numBufs; i++) {
+        bytes = 0;
+        status = read(s, tag, &bufs[i], &bytes);
+        if (status)
+            break;
+        bufs[i].size = bytes;
+        total += bytes;
+    }
+    if (size)
+        *size = total;
+    return status;
+}
+
+int Session::writeBatch(Stream *s, int tag, struct pal_buffer *bufs, uint32_t numBufs, int *size)
+{
+    int status = 0;
+    int bytes = 0;
+    int total = 0;
+
+    for (uint32_t i = 0; i < numBufs; i++) {
+        bytes = 0;
+        status = write(s, tag, &bufs[i], &bytes, 0);
+        if (status)
+            break;
+        total += bytes;
+    }
+    if (size)
+        *size = total;
+    return status;
+}
+
 int Session::pause(Stream * s __unused)
 {
     return 0;
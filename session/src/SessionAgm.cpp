@@ -459,42 +459,54 @@ int SessionAgm::stop(Stream * s __unused)
     return status;
 }
 
-int SessionAgm::read(Stream *s, int tag __unused, struct pal_buffer *buf, int *size )
+int SessionAgm::fillAgmBuffer(struct pal_stream_attributes *sAttr, struct pal_buffer *buf,
+                              struct agm_buff *agmBuf, bool isWrite)
 {
-    uint32_t bytes_read = 0;
-    int status;
-    struct agm_buff agm_buffer = {0, 0, 0, NULL, 0, NULL, {0, 0, 0}};
-    struct pal_stream_attributes sAttr;
-
-    s->getStreamAttributes(&sAttr);
     if (!buf) {
         PAL_VERBOSE(LOG_TAG, "buf: %pK, size: %zu",
                     buf, (buf ? buf->size : 0));
         return -EINVAL;
     }
-    if (!agmSessHandle) {
-        PAL_ERR(LOG_TAG, "NULL pointer access,agmSessHandle is invalid");
-        return -EINVAL;
-    }
-    agm_buffer.size = buf->size;
-    agm_buffer.metadata_size = buf->metadata_size;
-    agm_buffer.metadata = buf->metadata;
-    if (buf->ts && (sAttr.flags & PAL_STREAM_FLAG_TIMESTAMP)) {
-       agm_buffer.flags = AGM_BUFF_FLAG_TS_VALID;
+    memset(agmBuf, 0, sizeof(*agmBuf));
+    agmBuf->size = buf->size;
+    agmBuf->metadata_size = buf->metadata_size;
+    agmBuf->metadata = buf->metadata;
+    if (buf->ts && (sAttr->flags & PAL_STREAM_FLAG_TIMESTAMP)) {
+       agmBuf->flags = AGM_BUFF_FLAG_TS_VALID;
        if (ULONG_MAX/MICRO_SECS_PER_SEC > buf->ts->tv_sec) {
-           agm_buffer.timestamp =
+           agmBuf->timestamp =
                buf->ts->tv_sec * MICRO_SECS_PER_SEC +  (buf->ts->tv_nsec/1000);
        } else {
            PAL_ERR(LOG_TAG, "timestamp tv_sec overflown %lu", buf->ts->tv_sec);
            return -EINVAL;
        }
     }
-    agm_buffer.addr = buf->buffer;
-    if (sAttr.flags & PAL_STREAM_FLAG_EXTERN_MEM) {
-        agm_buffer.alloc_info.alloc_handle = buf->alloc_info.alloc_handle;
-        agm_buffer.alloc_info.alloc_size = buf->alloc_info.alloc_size;
-        agm_buffer.alloc_info.offset = buf->alloc_info.offset;
+    if (isWrite && (buf->flags & PAL_STREAM_FLAG_EOF))
+       agmBuf->flags |= AGM_BUFF_FLAG_EOF;
+    agmBuf->addr = buf->buffer;
+    if (sAttr->flags & PAL_STREAM_FLAG_EXTERN_MEM) {
+        agmBuf->alloc_info.alloc_handle = buf->alloc_info.alloc_handle;
+        agmBuf->alloc_info.alloc_size = buf->alloc_info.alloc_size;
+        agmBuf->alloc_info.offset = buf->alloc_info.offset;
     }
+    return 0;
+}
+
+int SessionAgm::read(Stream *s, int tag __unused, struct pal_buffer *buf, int *size )
+{
+    uint32_t bytes_read = 0;
+    int status;
+    struct agm_buff agm_buffer = {0, 0, 0, NULL, 0, NULL, {0, 0, 0}};
+    struct pal_stream_attributes sAttr;
+
+    s->getStreamAttributes(&sAttr);
+    if (!agmSessHandle) {
+        PAL_ERR(LOG_TAG, "NULL pointer access,agmSessHandle is invalid");
+        return -EINVAL;
+    }
+    status = fillAgmBuffer(&sAttr, buf, &agm_buffer, false);
+    if (status)
+        return status;
 
     status = agm_session_read_with_metadata(agmSessHandle, &agm_buffer, &bytes_read);
 
@@ -506,6 +518,45 @@ int SessionAgm::read(Stream *s, int tag __unused, struct pal_buffer *buf, int *s
     return status;
 }
 
+/*
+ * Stream attributes are looked up and the session handle checked once for
+ * the whole batch, each buffer keeps its own metadata and timestamp.
+ */
+int SessionAgm::readBatch(Stream *s, int tag __unused, struct pal_buffer *bufs,
+                          uint32_t numBufs, int *size)
+{
+    uint32_t bytes_read = 0;
+    int status = 0;
+    int total = 0;
+    struct agm_buff agm_buffer;
+    struct pal_stream_attributes sAttr;
+
+    s->getStreamAttributes(&sAttr);
+    if (!bufs || !agmSessHandle) {
+        PAL_ERR(LOG_TAG, "invalid bufs %pK or agmSessHandle %pK", bufs, agmSessHandle);
+        return -EINVAL;
+    }
+
+    for (uint32_t i = 0; i < numBufs; i++) {
+        status = fillAgmBuffer(&sAttr, &bufs[i], &agm_buffer, false);
+        if (status)
+            break;
+        bytes_read = 0;
+        status = agm_session_read_with_metadata(agmSessHandle, &agm_buffer, &bytes_read);
+        if (status) {
+            PAL_ERR(LOG_TAG, "read of buffer %u of %u failed %d", i, numBufs, status);
+            break;
+        }
+        bufs[i].size = bytes_read;
+        total += bytes_read;
+    }
+    PAL_VERBOSE(LOG_TAG, "read %d bytes in %u buffers", total, numBufs);
+
+    if (size)
+        *size = total;
+    return status;
+}
+
 int SessionAgm::fileWrite(Stream *s __unused, int tag __unused, struct pal_buffer *buf, int * size, int flag __unused)
 {
     std::fstream fs;
@@ -531,36 +582,13 @@ int SessionAgm::write(Stream *s, int tag __unused, struct pal_buffer *buf, int *
     struct pal_stream_attributes sAttr;
 
     s->getStreamAttributes(&sAttr);
-    if (!buf) {
-        PAL_VERBOSE(LOG_TAG, "buf: %pK, size: %zu",
-                    buf, (buf ? buf->size : 0));
-        return -EINVAL;
-    }
     if (!agmSessHandle) {
         PAL_ERR(LOG_TAG, "NULL pointer access,agmSessHandle is invalid");
         return -EINVAL;
     }
-    agm_buffer.size = buf->size;
-    agm_buffer.metadata_size = buf->metadata_size;
-    agm_buffer.metadata = buf->metadata;
-    if (buf->ts && (sAttr.flags & PAL_STREAM_FLAG_TIMESTAMP)) {
-       agm_buffer.flags = AGM_BUFF_FLAG_TS_VALID;
-       if (ULONG_MAX/MICRO_SECS_PER_SEC > buf->ts->tv_sec) {
-           agm_buffer.timestamp =
-               buf->ts->tv_sec * MICRO_SECS_PER_SEC +  (buf->ts->tv_nsec/1000);
-       } else {
-           PAL_ERR(LOG_TAG, "timestamp tv_sec overflown %lu", buf->ts->tv_sec);
-           return -EINVAL;
-       }
-    }
-    if (buf->flags & PAL_STREAM_FLAG_EOF)
-       agm_buffer.flags |= AGM_BUFF_FLAG_EOF;
-    agm_buffer.addr = buf->buffer;
-    if (sAttr.flags & PAL_STREAM_FLAG_EXTERN_MEM) {
-        agm_buffer.alloc_info.alloc_handle = buf->alloc_info.alloc_handle;
-        agm_buffer.alloc_info.alloc_size = buf->alloc_info.alloc_size;
-        agm_buffer.alloc_info.offset = buf->alloc_info.offset;
-    }
+    status = fillAgmBuffer(&sAttr, buf, &agm_buffer, true);
+    if (status)
+        return status;
 
     status = agm_session_write_with_metadata(agmSessHandle, &agm_buffer, &bytes_written);
 
@@ -572,6 +600,40 @@ int SessionAgm::write(Stream *s, int tag __unused, struct pal_buffer *buf, int *
     return status;
 }
 
+int SessionAgm::writeBatch(Stream *s, int tag __unused, struct pal_buffer *bufs,
+                           uint32_t numBufs, int *size)
+{
+    size_t bytes_written = 0;
+    int status = 0;
+    int total = 0;
+    struct agm_buff agm_buffer;
+    struct pal_stream_attributes sAttr;
+
+    s->getStreamAttributes(&sAttr);
+    if (!bufs || !agmSessHandle) {
+        PAL_ERR(LOG_TAG, "invalid bufs %pK or agmSessHandle %pK", bufs, agmSessHandle);
+        return -EINVAL;
+    }
+
+    for (uint32_t i = 0; i < numBufs; i++) {
+        status = fillAgmBuffer(&sAttr, &bufs[i], &agm_buffer, true);
+        if (status)
+            break;
+        bytes_written = 0;
+        status = agm_session_write_with_metadata(agmSessHandle, &agm_buffer, &bytes_written);
+        if (status) {
+            PAL_ERR(LOG_TAG, "write of buffer %u of %u failed %d", i, numBufs, status);
+            break;
+        }
+        total += bytes_written;
+    }
+    PAL_VERBOSE(LOG_TAG, "wrote %d bytes in %u buffers", total, numBufs);
+
+    if (size)
+        *size = total;
+    return status;
+}
+
 int SessionAgm::setParameters(Stream *s __unused, int tagId __unused, uint32_t param_id, void *payload)
 {
     int32_t status = 0;
@@ -71,6 +71,7 @@
 #include "SessionAlsaUtils.h"
 #include "Stream.h"
 #include "ResourceManager.h"
+#include "PalThreadPolicy.h"
 #include "media_fmt_api.h"
 #include "gapless_api.h"
 #include <agm/agm_api.h>
@@ -81,6 +82,8 @@
 
 #define CHS_2 2
 #define AACObjHE_PS 29
+/* longest wait for buffer space while writing a prefetched next track */
+#define NEXT_TRACK_WAIT_TIMEOUT_MS 3000
 
 void SessionAlsaCompress::updateCodecOptions(
     pal_param_payload *param_payload, pal_stream_direction_t stream_direction) {
@@ -640,6 +643,7 @@ int SessionAlsaCompress::setCustomFormatParam(pal_audio_fmt_t audio_fmt)
 
 void SessionAlsaCompress::offloadThreadLoop(SessionAlsaCompress* compressObj)
 {
+    PalThreadScope threadScope(PAL_THREAD_CLASS_OFFLOAD, "offload");
     std::shared_ptr<offload_msg> msg;
     uint32_t event_id = 0;
     int ret = 0;
@@ -689,6 +693,9 @@ void SessionAlsaCompress::offloadThreadLoop(SessionAlsaCompress* compressObj)
                         ret = compress_next_track(compressObj->compress);
                         PAL_INFO(LOG_TAG, "out of compress next track, ret %d", ret);
                         if (ret == 0) {
+                            /* not fatal, client still writes the rest of the track */
+                            if (compressObj->applyNextTrack())
+                                PAL_ERR(LOG_TAG, "prefetched next track not applied");
                             ret = compress_partial_drain(compressObj->compress);
                             PAL_INFO(LOG_TAG, "out of partial compress_drain, ret %d", ret);
                         }
@@ -745,6 +752,7 @@ SessionAlsaCompress::SessionAlsaCompress(std::shared_ptr<ResourceManager> Rm)
 
 SessionAlsaCompress::~SessionAlsaCompress()
 {
+    dropNextTrack();
     delete builder;
     compressDevIds.clear();
 }
@@ -1329,6 +1337,149 @@ int SessionAlsaCompress::configureEarlyEOSDelay(void)
     return status;
 }
 
+int SessionAlsaCompress::stageNextTrack(pal_param_payload *param_payload)
+{
+    struct pal_next_track_prefetch *track = NULL;
+    struct pal_next_track_prefetch *prev = NULL;
+    size_t size = 0;
+
+    if (!compress || !isGaplessFmt) {
+        PAL_ERR(LOG_TAG, "prefetch not supported, compress %pK fmt %x",
+                compress, audio_fmt);
+        return -EINVAL;
+    }
+    if (!param_payload ||
+        param_payload->payload_size < sizeof(struct pal_next_track_prefetch)) {
+        PAL_ERR(LOG_TAG, "invalid prefetch payload");
+        return -EINVAL;
+    }
+
+    track = (struct pal_next_track_prefetch *)param_payload->payload;
+    /* compare against the room left so a huge data_size cannot wrap size */
+    if (track->data_size >
+        param_payload->payload_size - sizeof(struct pal_next_track_prefetch)) {
+        PAL_ERR(LOG_TAG, "prefetch data %u bytes exceeds payload size %u",
+                track->data_size, param_payload->payload_size);
+        return -EINVAL;
+    }
+    size = sizeof(struct pal_next_track_prefetch) + track->data_size;
+
+    track = (struct pal_next_track_prefetch *)malloc(size);
+    if (!track) {
+        PAL_ERR(LOG_TAG, "failed to allocate memory");
+        return -ENOMEM;
+    }
+    memcpy(track, param_payload->payload, size);
+
+    prefetch_mutex_.lock();
+    prev = nextTrack;
+    nextTrack = track;
+    prefetch_mutex_.unlock();
+    if (prev) {
+        PAL_INFO(LOG_TAG, "replacing staged next track");
+        free(prev);
+    }
+
+    PAL_DBG(LOG_TAG, "staged next track, delay %u padding %u data %u bytes",
+            track->mdata.encoderDelay, track->mdata.encoderPadding, track->data_size);
+    return 0;
+}
+
+void SessionAlsaCompress::dropNextTrack()
+{
+    struct pal_next_track_prefetch *track = NULL;
+
+    prefetch_mutex_.lock();
+    track = nextTrack;
+    nextTrack = NULL;
+    prefetch_mutex_.unlock();
+    if (track) {
+        PAL_DBG(LOG_TAG, "dropping staged next track");
+        free(track);
+    }
+}
+
+/*
+ * Called on the offload thread right after compress_next_track, so the
+ * metadata, codec options and data below belong to the next track and
+ * reach the DSP while the current one drains.
+ */
+int SessionAlsaCompress::applyNextTrack()
+{
+    struct pal_next_track_prefetch *track = NULL;
+    struct compr_gapless_mdata mdata;
+    pal_param_payload *codecPayload = NULL;
+    uint32_t offset = 0;
+    int written = 0;
+    int status = 0;
+
+    prefetch_mutex_.lock();
+    track = nextTrack;
+    nextTrack = NULL;
+    prefetch_mutex_.unlock();
+    if (!track)
+        return 0;
+
+    PAL_DBG(LOG_TAG, "Enter, data %u bytes", track->data_size);
+    mdata.encoder_delay = track->mdata.encoderDelay;
+    mdata.encoder_padding = track->mdata.encoderPadding;
+    status = compress_set_gapless_metadata(compress, &mdata);
+    if (status) {
+        PAL_ERR(LOG_TAG, "set gapless metadata failed %d", status);
+        goto exit;
+    }
+
+    codecPayload = (pal_param_payload *)calloc(1,
+                        sizeof(pal_param_payload) + sizeof(pal_snd_dec_t));
+    if (!codecPayload) {
+        PAL_ERR(LOG_TAG, "failed to allocate memory");
+        status = -ENOMEM;
+        goto exit;
+    }
+    codecPayload->payload_size = sizeof(pal_snd_dec_t);
+    memcpy(codecPayload->payload, &track->codec, sizeof(pal_snd_dec_t));
+    codec_mutex_.lock();
+    updateCodecOptions(codecPayload, PAL_AUDIO_OUTPUT);
+    if (audio_fmt == PAL_AUDIO_FMT_VORBIS) {
+        sendNextTrackParams = true;
+        status = setCustomFormatParam(audio_fmt);
+    } else if (isCodecConfigNeeded(audio_fmt, PAL_AUDIO_OUTPUT)) {
+        status = compress_set_codec_params(compress, &codec);
+    }
+    codec_mutex_.unlock();
+    free(codecPayload);
+    if (status) {
+        PAL_ERR(LOG_TAG, "set next track codec params failed %d", status);
+        goto exit;
+    }
+
+    while (offset < track->data_size) {
+        written = compress_write(compress, track->data + offset,
+                                 track->data_size - offset);
+        if (written < 0) {
+            PAL_ERR(LOG_TAG, "next track write failed %d", written);
+            status = written;
+            goto exit;
+        }
+        offset += written;
+        if (offset < track->data_size && ioMode) {
+            /* the offload thread must not hang here if the DSP stops consuming */
+            status = compress_wait(compress, NEXT_TRACK_WAIT_TIMEOUT_MS);
+            if (status < 0) {
+                PAL_ERR(LOG_TAG, "compress_wait failed %d after %u of %u bytes",
+                        status, offset, track->data_size);
+                goto exit;
+            }
+            status = 0;
+        }
+    }
+
+exit:
+    free(track);
+    PAL_DBG(LOG_TAG, "Exit, %u bytes written, status %d", offset, status);
+    return status;
+}
+
 int SessionAlsaCompress::start(Stream * s)
 {
     struct compr_config compress_config = {};
@@ -1420,7 +1571,9 @@ int SessionAlsaCompress::start(Stream * s)
                 PAL_ERR(LOG_TAG, "Failed to get tag info %x, status = %d", STREAM_SPR, status);
                 goto exit;;
             }
+            codec_mutex_.lock();
             setCustomFormatParam(audio_fmt);
+            codec_mutex_.unlock();
             for (int i = 0; i < associatedDevices.size();i++) {
                 status = associatedDevices[i]->getDeviceAttributes(&dAttr);
                 if(0 != status) {
@@ -1736,6 +1889,7 @@ int SessionAlsaCompress::stop(Stream * s __unused)
             if (compress && playback_started) {
                 status = compress_stop(compress);
             }
+            dropNextTrack();
             // Deregister for callback for Soft Pause
             if (isPauseRegistrationDone) {
                 payload_size = sizeof(struct agm_event_reg_cfg);
@@ -2135,6 +2289,10 @@ int SessionAlsaCompress::setParameters(Stream *s __unused, int tagId, uint32_t p
             return 0;
         }
         case PAL_PARAM_ID_CODEC_CONFIGURATION:
+        {
+            /* a prefetched next track may be applied on the offload thread */
+            std::lock_guard<std::mutex> lock(codec_mutex_);
+
             PAL_DBG(LOG_TAG, "Compress Codec Configuration");
             updateCodecOptions((pal_param_payload *)payload, sAttr.direction);
             if (compress && audio_fmt != PAL_AUDIO_FMT_VORBIS) {
@@ -2154,6 +2312,10 @@ int SessionAlsaCompress::setParameters(Stream *s __unused, int tagId, uint32_t p
                 sendNextTrackParams = true;
                 status = setCustomFormatParam(audio_fmt);
             }
+        }
+        break;
+        case PAL_PARAM_ID_NEXT_TRACK_PREFETCH:
+            status = stageNextTrack(param_payload);
         break;
         case PAL_PARAM_ID_GAPLESS_MDATA:
         {
@@ -2382,6 +2382,64 @@ exit:
     return status;
 }
 
+/*
+ * For mmap usecases the whole batch is written within a single ADM focus
+ * window instead of requesting and releasing focus for every buffer and
+ * period. Other usecases go through the per buffer write().
+ */
+int SessionAlsaPcm::writeBatch(Stream *s, int tag, struct pal_buffer *bufs,
+                               uint32_t numBufs, int *size)
+{
+    int status = 0;
+    size_t totalSize = 0, bytesWritten = 0, offset = 0, sizeWritten = 0;
+    struct pal_stream_attributes sAttr;
+    long ns = 0;
+
+    status = s->getStreamAttributes(&sAttr);
+    if (status != 0) {
+        PAL_ERR(LOG_TAG, "stream get attributes failed");
+        return status;
+    }
+
+    if (!SessionAlsaUtils::isMmapUsecase(sAttr))
+        return Session::writeBatch(s, tag, bufs, numBufs, size);
+
+    if (pcm == NULL || bufs == NULL) {
+        PAL_ERR(LOG_TAG, "invalid pcm %pK or bufs %pK", pcm, bufs);
+        return -EINVAL;
+    }
+
+    for (uint32_t i = 0; i < numBufs; i++)
+        totalSize += bufs[i].size;
+    if (sAttr.out_media_config.sample_rate)
+        ns = pcm_bytes_to_frames(pcm, totalSize)*1000000000LL/
+            sAttr.out_media_config.sample_rate;
+    PAL_DBG(LOG_TAG, "batch of %u bufs, size:%zu ns:%ld", numBufs, totalSize, ns);
+
+    requestAdmFocus(s, ns);
+    for (uint32_t i = 0; i < numBufs && !status; i++) {
+        offset = bufs[i].offset;
+        while (offset < bufs[i].offset + bufs[i].size) {
+            sizeWritten = bufs[i].offset + bufs[i].size - offset;
+            if (out_buf_size && sizeWritten > out_buf_size)
+                sizeWritten = out_buf_size;
+            status = pcm_mmap_write(pcm, static_cast<char *>(bufs[i].buffer) + offset,
+                                    sizeWritten);
+            if (status != 0) {
+                PAL_ERR(LOG_TAG, "Error! pcm_mmap_write failed for buffer %u", i);
+                break;
+            }
+            offset += sizeWritten;
+            bytesWritten += sizeWritten;
+        }
+    }
+    releaseAdmFocus(s);
+
+    if (size)
+        *size = bytesWritten;
+    return status;
+}
+
 int SessionAlsaPcm::readBufferInit(Stream * /*streamHandle*/, size_t /*noOfBuf*/, size_t /*bufSize*/,
                                    int /*flag*/)
 {
@@ -86,6 +86,10 @@ static constexpr const char* const COMPRESS_SND_DEV_NAME_PREFIX = "COMPRESS";
 static constexpr const char* const PCM_SND_DEV_NAME_PREFIX = "PCM";
 static constexpr const char* const PCM_SND_VOICE_DEV_NAME_PREFIX = "VOICEMMODE";
 
+std::mutex SessionAlsaUtils::miidCacheMutex;
+std::map<std::pair<int, std::string>, std::unordered_map<uint32_t, uint32_t>> SessionAlsaUtils::miidCache;
+uint64_t SessionAlsaUtils::miidCacheGen = 0;
+
 static const char *feCtrlNames[] = {
     " control",
     " metadata",
@@ -390,6 +394,8 @@ int SessionAlsaUtils::open(Stream * streamHandle, std::shared_ptr<ResourceManage
     struct pal_device dAttr;
     PayloadBuilder* builder = nullptr;
 
+    invalidateModuleInstanceIds(DevIds);
+
     PAL_DBG(LOG_TAG, "Entry \n");
 
     memset(&dAttr, 0, sizeof(pal_device));
@@ -630,6 +636,8 @@ int SessionAlsaUtils::close(Stream * streamHandle, std::shared_ptr<ResourceManag
     struct mixer_ctl *beMetaDataMixerCtrl = nullptr;
     struct mixer *mixerHandle = nullptr;
 
+    invalidateModuleInstanceIds(DevIds);
+
     status = streamHandle->getStreamAttributes(&sAttr);
     if(0 != status) {
         PAL_ERR(LOG_TAG, "getStreamAttributes Failed \n");
@@ -966,6 +974,7 @@ int SessionAlsaUtils::setDeviceMetadata(std::shared_ptr<ResourceManager> rmHandl
     if (deviceMetaData.size)
         status = mixer_ctl_set_array(beMetaDataMixerCtrl, (void *)deviceMetaData.buf,
                         deviceMetaData.size);
+    invalidateModuleInstanceIds(backEndName);
 
     free(deviceMetaData.buf);
     deviceMetaData.buf = nullptr;
@@ -1047,6 +1056,7 @@ int SessionAlsaUtils::setDeviceMediaConfig(std::shared_ptr<ResourceManager> rmHa
     PAL_INFO(LOG_TAG, "%s rate ch fmt data_fmt %ld %ld %ld %ld\n", backEndName.c_str(),
                      aif_media_config[0], aif_media_config[1],
                      aif_media_config[2], aif_media_config[3]);
+    invalidateModuleInstanceIds(backEndName);
 
     return mixer_ctl_set_array(ctl, &aif_media_config,
                                sizeof(aif_media_config)/sizeof(aif_media_config[0]));
@@ -1118,8 +1128,13 @@ exit:
     return status;
 }
 
-int SessionAlsaUtils::getModuleInstanceId(struct mixer *mixer, int device, const char *intf_name,
-                       int tag_id, uint32_t *miid)
+/*
+ * Reads the tagged module info of the graph behind a pcm device and
+ * interface once and keeps the tag -> miid table, so that later MIID
+ * lookups need neither the metadata write nor the getTaggedInfo read.
+ */
+int SessionAlsaUtils::fetchTagModuleMap(struct mixer *mixer, int device, const char *intf_name,
+                       std::unordered_map<uint32_t, uint32_t> &tagMap)
 {
     char *pcmDeviceName = NULL;
     char const *control = "getTaggedInfo";
@@ -1172,7 +1187,7 @@ int SessionAlsaUtils::getModuleInstanceId(struct mixer *mixer, int device, const
     }
     tag_info = (struct gsl_tag_module_info *)payload;
     PAL_DBG(LOG_TAG, "num of tags associated with stream %d is %d\n", device, tag_info->num_tags);
-    ret = -1;
+    tagMap.clear();
     tag_entry = (struct gsl_tag_module_info_entry *)(&tag_info->tag_module_entry[0]);
     offset = 0;
     for (i = 0; i < tag_info->num_tags; i++) {
@@ -1180,27 +1195,95 @@ int SessionAlsaUtils::getModuleInstanceId(struct mixer *mixer, int device, const
 
         PAL_DBG(LOG_TAG, "tag id[%d] = 0x%x, num_modules = 0x%x\n", i, tag_entry->tag_id, tag_entry->num_modules);
         offset = sizeof(struct gsl_tag_module_info_entry) + (tag_entry->num_modules * sizeof(struct gsl_module_id_info_entry));
-        if (tag_entry->tag_id == tag_id) {
-            struct gsl_module_id_info_entry *mod_info_entry;
-
-            if (tag_entry->num_modules) {
-                 mod_info_entry = &tag_entry->module_entry[0];
-                 *miid = mod_info_entry->module_iid;
-                 PAL_DBG(LOG_TAG, "MIID is 0x%x\n", *miid);
-                 ret = 0;
-                 break;
-            }
+        /* first module carrying the tag wins, as with the former linear search */
+        if (tag_entry->num_modules && !tagMap.count(tag_entry->tag_id))
+            tagMap[tag_entry->tag_id] = tag_entry->module_entry[0].module_iid;
+    }
+
+    free(payload);
+    free(mixer_str);
+    return 0;
+}
+
+int SessionAlsaUtils::getModuleInstanceId(struct mixer *mixer, int device, const char *intf_name,
+                       int tag_id, uint32_t *miid)
+{
+    int ret = 0;
+    std::pair<int, std::string> key(device, intf_name ? intf_name : "");
+    std::unordered_map<uint32_t, uint32_t> tagMap;
+    std::unordered_map<uint32_t, uint32_t> *map = nullptr;
+    uint64_t gen = 0;
+
+    std::unique_lock<std::mutex> lock(miidCacheMutex);
+    auto it = miidCache.find(key);
+    if (it != miidCache.end()) {
+        map = &it->second;
+    } else {
+        gen = miidCacheGen;
+        lock.unlock();
+        ret = fetchTagModuleMap(mixer, device, intf_name, tagMap);
+        if (ret)
+            return ret;
+        lock.lock();
+        if (gen == miidCacheGen) {
+            map = &miidCache.emplace(key, std::move(tagMap)).first->second;
+        } else {
+            /*
+             * The graph was invalidated while the lock was dropped. Answer
+             * this lookup from what was read, but do not cache it, the next
+             * lookup reads the graph again.
+             */
+            PAL_DBG(LOG_TAG, "MIID cache invalidated during fetch for device %d", device);
+            map = &tagMap;
         }
     }
 
-    if (*miid == 0) {
-         ret = -EINVAL;
-         PAL_ERR(LOG_TAG, "No matching MIID found for tag: 0x%x, error:%d", tag_id, ret);
+    auto tagIt = map->find((uint32_t)tag_id);
+    if (tagIt == map->end() || tagIt->second == 0) {
+        ret = -EINVAL;
+        PAL_ERR(LOG_TAG, "No matching MIID found for tag: 0x%x, error:%d", tag_id, ret);
+        return ret;
     }
+    *miid = tagIt->second;
+    PAL_DBG(LOG_TAG, "MIID is 0x%x\n", *miid);
+    return 0;
+}
 
-    free(payload);
-    free(mixer_str);
-    return ret;
+void SessionAlsaUtils::invalidateModuleInstanceIds(int device)
+{
+    std::lock_guard<std::mutex> lock(miidCacheMutex);
+
+    miidCacheGen++;
+    for (auto it = miidCache.begin(); it != miidCache.end();) {
+        if (it->first.first == device)
+            it = miidCache.erase(it);
+        else
+            it++;
+    }
+}
+
+void SessionAlsaUtils::invalidateModuleInstanceIds(const std::vector<int> &DevIds)
+{
+    for (auto device : DevIds)
+        invalidateModuleInstanceIds(device);
+}
+
+/*
+ * Backend metadata or media config changed under live frontends. Device
+ * side modules are looked up with the backend name as interface, drop
+ * those entries on every frontend.
+ */
+void SessionAlsaUtils::invalidateModuleInstanceIds(const std::string &intfName)
+{
+    std::lock_guard<std::mutex> lock(miidCacheMutex);
+
+    miidCacheGen++;
+    for (auto it = miidCache.begin(); it != miidCache.end();) {
+        if (it->first.second == intfName)
+            it = miidCache.erase(it);
+        else
+            it++;
+    }
 }
 
 int SessionAlsaUtils::getTagsWithModuleInfo(struct mixer *mixer, int device, const char *intf_name,
@@ -1503,6 +1586,9 @@ int SessionAlsaUtils::open(Stream * streamHandle, std::shared_ptr<ResourceManage
     struct pal_device dAttr;
     bool isDeviceFound = false;
 
+    invalidateModuleInstanceIds(RxDevIds);
+    invalidateModuleInstanceIds(TxDevIds);
+
     if (RxDevIds.empty() || TxDevIds.empty()) {
         PAL_ERR(LOG_TAG, "RX and TX FE Dev Ids are empty");
         return -EINVAL;
@@ -1865,6 +1951,7 @@ int SessionAlsaUtils::openDev(std::shared_ptr<ResourceManager> rmHandle,
         mixer_ctl_set_array(beMetaDataMixerCtrl, (void *)deviceMetaData.buf,
                 deviceMetaData.size);
     mixer_ctl_set_enum_by_string(feMixerCtrls[FE_CONNECT], backEndName.data());
+    invalidateModuleInstanceIds(backEndName);
     deviceKV.clear();
     free(deviceMetaData.buf);
     deviceMetaData.buf = nullptr;
@@ -1906,6 +1993,9 @@ int SessionAlsaUtils::close(Stream * streamHandle, std::shared_ptr<ResourceManag
     uint32_t streamDevicePropId[] = {0x08000010, 1, 0x3}; /** gsl_subgraph_platform_driver_props.xml */
     uint32_t i, rxDevNum, txDevNum;
 
+    invalidateModuleInstanceIds(RxDevIds);
+    invalidateModuleInstanceIds(TxDevIds);
+
     status = streamHandle->getStreamAttributes(&sAttr);
     if(0 != status) {
         PAL_ERR(LOG_TAG, "getStreamAttributes Failed \n");
@@ -2088,6 +2178,8 @@ int SessionAlsaUtils::disconnectSessionDevice(Stream* streamHandle, pal_stream_t
     uint32_t i;
     int devCount = 0;
 
+    invalidateModuleInstanceIds(pcmDevIds);
+
     switch (streamType) {
         case PAL_STREAM_COMPRESSED:
             disconnectCtrlName << COMPRESS_SND_DEV_NAME_PREFIX << pcmDevIds.at(0) << " disconnect";
@@ -2215,6 +2307,9 @@ int SessionAlsaUtils::disconnectSessionDevice(Stream* streamHandle, pal_stream_t
     struct mixer_ctl *txFeMixerCtrls[FE_MAX_NUM_MIXER_CONTROLS] = { nullptr };
     std::ostringstream txFeName;
 
+    invalidateModuleInstanceIds(pcmTxDevIds);
+    invalidateModuleInstanceIds(pcmRxDevIds);
+
     switch (streamType) {
          case PAL_STREAM_ULTRASOUND:
          case PAL_STREAM_LOOPBACK:
@@ -2269,6 +2364,8 @@ int SessionAlsaUtils::connectSessionDevice(Session* sess, Stream* streamHandle,
     PayloadBuilder* builder = new PayloadBuilder();
     std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
 
+    invalidateModuleInstanceIds(pcmDevIds);
+
     status = rmHandle->getVirtualAudioMixer(&mixerHandle);
     if (status) {
         PAL_ERR(LOG_TAG, "get mixer handle failed %d", status);
@@ -2444,6 +2541,9 @@ int SessionAlsaUtils::connectSessionDevice(Session* sess, Stream* streamHandle,
     size_t payloadSize = 0;
     bool is_out_dev = false;
 
+    invalidateModuleInstanceIds(pcmTxDevIds);
+    invalidateModuleInstanceIds(pcmRxDevIds);
+
     if (dAttr.id > PAL_DEVICE_OUT_MIN && dAttr.id < PAL_DEVICE_OUT_MAX) {
         is_out_dev = true;
         connectCtrlName << PCM_SND_DEV_NAME_PREFIX << pcmRxDevIds.at(0) << " connect";
@@ -2547,6 +2647,8 @@ int SessionAlsaUtils::setupSessionDevice(Stream* streamHandle, pal_stream_type_t
     struct vsid_info vsidinfo = {};
     sidetone_mode_t sidetoneMode = SIDETONE_OFF;
 
+    invalidateModuleInstanceIds(pcmDevIds);
+
     status = rmHandle->getVirtualAudioMixer(&mixerHandle);
     if (status) {
         PAL_VERBOSE(LOG_TAG, "get mixer handle failed %d", status);
@@ -206,6 +206,13 @@ uint32_t SessionAlsaVoice::getMIID(const char *backendName, uint32_t tagId, uint
 }
 
 
+void SessionAlsaVoice::openHostlessPcm(unsigned int card, unsigned int device,
+                                       unsigned int flags, struct pcm_config *config,
+                                       struct pcm **pcm)
+{
+    *pcm = pcm_open(card, device, flags, config);
+}
+
 int SessionAlsaVoice::prepare(Stream * s __unused)
 {
    return 0;
@@ -716,6 +723,7 @@ int SessionAlsaVoice::setTaggedSlotMask(Stream * s)
 int SessionAlsaVoice::start(Stream * s)
 {
     struct pcm_config config;
+    struct pcm_config txConfig;
     struct pal_stream_attributes sAttr;
     int32_t status = 0;
     std::shared_ptr<Device> rxDevice = nullptr;
@@ -725,6 +733,7 @@ int SessionAlsaVoice::start(Stream * s)
     size_t payloadSize = 0;
     struct pal_volume_data *volume = NULL;
     bool isTxStarted = false, isRxStarted = false;
+    std::thread txOpenThread;
 
     PAL_DBG(LOG_TAG,"Enter");
 
@@ -753,6 +762,18 @@ int SessionAlsaVoice::start(Stream * s)
     config.stop_threshold = 0;
     config.silence_threshold = 0;
 
+    txConfig = config;
+    txConfig.rate = sAttr.in_media_config.sample_rate;
+    if (sAttr.in_media_config.bit_width == 32)
+        txConfig.format = PCM_FORMAT_S32_LE;
+    else if (sAttr.in_media_config.bit_width == 24)
+        txConfig.format = PCM_FORMAT_S24_3LE;
+    else if (sAttr.in_media_config.bit_width == 16)
+        txConfig.format = PCM_FORMAT_S16_LE;
+    txConfig.channels = sAttr.in_media_config.ch_info.channels;
+    txConfig.period_size = in_buf_size;
+    txConfig.period_count = in_buf_count;
+
     /*setup external ec if needed*/
     status = getRXDevice(s, rxDevice);
     if (status) {
@@ -761,7 +782,25 @@ int SessionAlsaVoice::start(Stream * s)
     }
     setExtECRef(s, rxDevice, true);
 
+    /*
+     * RX and TX hostless graphs do not depend on each other until they are
+     * started, so build the TX graph on a helper thread while this thread
+     * builds the RX one. Configuration below still goes out serially as it
+     * shares the custom payload and mixer.
+     */
+    try {
+        txOpenThread = std::thread(openHostlessPcm, rm->getVirtualSndCard(),
+                                   pcmDevTxIds.at(0), PCM_IN, &txConfig, &pcmTx);
+    } catch (const std::exception& e) {
+        PAL_ERR(LOG_TAG, "tx open thread create failed %s, open serially", e.what());
+    }
     pcmRx = pcm_open(rm->getVirtualSndCard(), pcmDevRxIds.at(0), PCM_OUT, &config);
+    if (txOpenThread.joinable())
+        txOpenThread.join();
+    else
+        openHostlessPcm(rm->getVirtualSndCard(), pcmDevTxIds.at(0), PCM_IN,
+                        &txConfig, &pcmTx);
+
     if (!pcmRx) {
         PAL_ERR(LOG_TAG, "Exit pcm-rx open failed");
         status = -EINVAL;
@@ -774,18 +813,6 @@ int SessionAlsaVoice::start(Stream * s)
         goto err_pcm_open;
     }
 
-    config.rate = sAttr.in_media_config.sample_rate;
-    if (sAttr.in_media_config.bit_width == 32)
-        config.format = PCM_FORMAT_S32_LE;
-    else if (sAttr.in_media_config.bit_width == 24)
-        config.format = PCM_FORMAT_S24_3LE;
-    else if (sAttr.in_media_config.bit_width == 16)
-        config.format = PCM_FORMAT_S16_LE;
-    config.channels = sAttr.in_media_config.ch_info.channels;
-    config.period_size = in_buf_size;
-    config.period_count = in_buf_count;
-
-    pcmTx = pcm_open(rm->getVirtualSndCard(), pcmDevTxIds.at(0), PCM_IN, &config);
     if (!pcmTx) {
         PAL_ERR(LOG_TAG, "Exit pcm-tx open failed");
         status = -EINVAL;
@@ -161,6 +161,12 @@ int32_t SoundTriggerEngine::CreateBuffer(uint32_t buffer_size,
             reader_list[i]->reset();
     }
 
+    if (!buffer_->getBufferSize()) {
+        PAL_ERR(LOG_TAG, "Failed to allocate memory for ring buffer");
+        status = -ENOMEM;
+        goto exit;
+    }
+
     if (engine_size != reader_list.size()) {
         reader_list.clear();
         for (i = 0; i < engine_size; i++) {
@@ -43,6 +43,7 @@
 #include "StreamSoundTrigger.h"
 #include "Stream.h"
 #include "SoundTriggerPlatformInfo.h"
+#include "PalThreadPolicy.h"
 #include "VoiceUIInterface.h"
 
 #define CNN_BUFFER_LENGTH 10000
@@ -54,6 +55,7 @@ ST_DBG_DECLARE(static int user_verification_cnt = 0);
 void SoundTriggerEngineCapi::BufferThreadLoop(
     SoundTriggerEngineCapi *capi_engine)
 {
+    PalThreadScope threadScope(PAL_THREAD_CLASS_LAB, "st_capi_buffer");
     StreamSoundTrigger *s = nullptr;
     int32_t status = 0;
     int32_t detection_state = ENGINE_IDLE;
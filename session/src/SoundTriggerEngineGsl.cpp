@@ -44,6 +44,7 @@
 #include "StreamSoundTrigger.h"
 #include "ResourceManager.h"
 #include "SoundTriggerPlatformInfo.h"
+#include "PalThreadPolicy.h"
 #include "VoiceUIInterface.h"
 #include "sh_mem_pull_push_mode_api.h"
 
@@ -69,6 +70,7 @@ std::condition_variable cvEOS;
 void SoundTriggerEngineGsl::EventProcessingThread(
     SoundTriggerEngineGsl *gsl_engine) {
 
+    PalThreadScope threadScope(PAL_THREAD_CLASS_LAB, "st_gsl_event");
     int32_t status = 0;
     StreamSoundTrigger *det_str = nullptr;
     std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
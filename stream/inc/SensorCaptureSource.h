@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef SENSOR_CAPTURE_SOURCE_H
+#define SENSOR_CAPTURE_SOURCE_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+class StreamSensorPCMData;
+
+/*
+ * Capture graph shared by sensor PCM data clients with the same effect and
+ * media config. The first client to start creates an internal stream that
+ * owns the frontend and DSP graph; later clients only attach to it. The
+ * internal stream is registered with RM like any other sensor stream, so
+ * concurrency, LPI and device switch handling apply to the graph once.
+ * It is torn down when the last client detaches, the caller releases it
+ * once it dropped its own locks. A client starting on a key that is going
+ * down is started when the teardown is done.
+ */
+class SensorCaptureSource
+{
+public:
+    static std::shared_ptr<SensorCaptureSource> Attach(StreamSensorPCMData *client,
+                                                       int32_t *status);
+    static std::shared_ptr<SensorCaptureSource> Detach(
+        std::shared_ptr<SensorCaptureSource> source, StreamSensorPCMData *client);
+    static void Release(std::shared_ptr<SensorCaptureSource> source);
+    static uint32_t GetNumSources();
+
+    SensorCaptureSource(const std::string &key);
+    ~SensorCaptureSource();
+    const std::string& GetKey() const { return key_; }
+
+private:
+    int32_t Open(StreamSensorPCMData *client);
+    void Close();
+
+    static std::mutex sources_mutex_;
+    static std::map<std::string, std::shared_ptr<SensorCaptureSource>> sources_;
+    /* keys whose capture stream is going down, and clients waiting for it */
+    static std::map<std::string, std::vector<StreamSensorPCMData *>> closing_;
+
+    std::string key_;
+    StreamSensorPCMData *owner_;
+    std::set<StreamSensorPCMData *> clients_;
+};
+
+#endif //SENSOR_CAPTURE_SOURCE_H
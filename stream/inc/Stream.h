@@ -65,7 +65,10 @@
 #define STREAM_H_
 
 #include "PalDefs.h"
+#include "PalClockModel.h"
 #include <algorithm>
+#include <atomic>
+#include <map>
 #include <vector>
 #include <string.h>
 #include <stdlib.h>
@@ -96,6 +99,12 @@ typedef enum {
     STREAM_STOPPED
 } stream_state_t;
 
+/* graph edit the device switch planner picks for a stream-device pair */
+typedef enum {
+    DEV_SWITCH_EDIT_FULL = 0,   /* stop, close, reopen and restart the device */
+    DEV_SWITCH_EDIT_RELINK      /* keep the device running, relink session device only */
+} dev_switch_edit_t;
+
 #define BUF_SIZE_PLAYBACK 1024
 #define BUF_SIZE_CAPTURE 960
 #define NO_OF_BUF 4
@@ -169,6 +178,9 @@ typedef enum {
  */
 #define MUTE_RAMP_PERIOD (40*1000)
 
+/* volume ramp PCM and compress streams run with while started */
+#define VOL_CTRL_RAMP_DEFAULT_MS 0x28
+
 class Device;
 class ResourceManager;
 class Session;
@@ -179,13 +191,14 @@ protected:
     uint32_t mNoOfDevices;
     std::vector <std::shared_ptr<Device>> mDevices;  // current running devices
     std::vector <std::shared_ptr<Device>> mPalDevices; // pal devices set from client, which may differ from mDevices
+    std::map<uint32_t, struct pal_device> mSwitchFromDevAttr; // stream-device attr replaced by a pending custom key switch
     Session* session;
     struct pal_stream_attributes* mStreamAttr;
     int mGainLevel;
     int mOrientation = 0;
     std::mutex mStreamMutex;
     std::mutex mGetParamMutex;
-    static std::mutex mBaseStreamMutex; //TBD change this. as having a single static mutex for all instances of Stream is incorrect. Replace
+    static std::mutex mRmInitMutex; // guards lazy rm init, stream creation itself is not serialized
     static std::shared_ptr<ResourceManager> rm;
     struct modifier_kv *mModifiers;
     uint32_t mNoOfModifiers;
@@ -204,10 +217,30 @@ protected:
     static std::mutex pauseMutex;
     bool mutexLockedbyRm = false;
     bool mDutyCycleEnable = false;
+    PalClockModel mSessionTimeModel; // answers getTimestamp between DSP queries
+    struct pal_session_time mLastSessionTime = {};
+    struct pal_session_time mLastReturnedTime = {}; // floor for answers while running
     sem_t mInUse;
+    /* latest value wins slot for async volume/mute, drained on PalEventLoop */
+    std::mutex mAsyncVolLock;
+    struct pal_volume_data *mPendingVolume = NULL;
+    uint32_t mAsyncVolPairs = 0; // pairs mPendingVolume can hold
+    uint32_t mPendingRampMs = 0;
+    bool mVolumePending = false;
+    bool mMutePending = false;
+    bool mPendingMute = false;
+    bool mAsyncVolPosted = false;
+    uint64_t mAsyncVolCoalesced = 0;
+    /* bumped by every volume/mute request, a value taken from the slot is
+     * only applied if it is still the latest once mStreamMutex is held */
+    std::atomic<uint32_t> mVolumeSeq{0};
+    std::atomic<uint32_t> mMuteSeq{0};
+    int mAsyncVolTimer = 0; // retries the slot while mStreamMutex is busy, under mAsyncVolLock
     int connectToDefaultDevice(Stream* streamHandle, uint32_t dir);
+    int32_t postAsyncVolume(std::unique_lock<std::mutex> &lock);
+    void applyAsyncVolume();
 public:
-    virtual ~Stream() {};
+    virtual ~Stream();
     struct pal_volume_data* mVolumeData = NULL;
     pal_stream_callback streamCb;
     uint64_t cookie;
@@ -238,6 +271,8 @@ public:
     virtual int32_t addRemoveEffect(pal_audio_effect_t effect, bool enable) = 0; //TBD: make this non virtual and prrovide implementation as StreamPCM and StreamCompressed are doing the same things
     virtual int32_t setParameters(uint32_t param_id, void *payload) = 0;
     virtual int32_t write(struct pal_buffer *buf) = 0; //TBD: make this non virtual and prrovide implementation as StreamPCM and StreamCompressed are doing the same things
+    virtual int32_t writeBatch(struct pal_buffer *bufs, uint32_t numBufs);
+    virtual int32_t readBatch(struct pal_buffer *bufs, uint32_t numBufs);
     virtual int32_t registerCallBack(pal_stream_callback cb, uint64_t cookie) = 0;
     virtual int32_t getCallBack(pal_stream_callback *cb) = 0;
     virtual int32_t getParameters(uint32_t param_id, void **payload) = 0;
@@ -281,12 +316,18 @@ public:
          uint32_t no_of_devices, struct modifier_kv *modifiers, uint32_t no_of_modifiers);
     bool isStreamAudioOutFmtSupported(pal_audio_fmt_t format);
     int32_t getTimestamp(struct pal_session_time *stime);
+    int32_t getTimestampDrift(int32_t *driftPpm);
+    int32_t setVolumeAsync(struct pal_volume_data *volume, uint32_t rampMs);
+    int32_t setMuteAsync(bool state);
+    void dropAsyncUpdate(bool mute);
     int32_t handleBTDeviceNotReady(bool& a2dpSuspend);
     int disconnectStreamDevice(Stream* streamHandle,  pal_device_id_t dev_id);
     int disconnectStreamDevice_l(Stream* streamHandle,  pal_device_id_t dev_id);
     int connectStreamDevice(Stream* streamHandle, struct pal_device *dattr);
     int connectStreamDevice_l(Stream* streamHandle, struct pal_device *dattr);
     int switchDevice(Stream* streamHandle, uint32_t no_of_devices, struct pal_device *deviceArray);
+    dev_switch_edit_t planDeviceSwitch_l(uint32_t curDevId, struct pal_device *dattr);
+    int relinkStreamDevice_l(Stream* streamHandle, struct pal_device *dattr, bool *fullSwitch);
     bool isGKVMatch(pal_key_vector_t* gkv);
     int32_t getEffectParameters(void *effect_query, size_t *payload_size);
     uint32_t getInstanceId() { return mInstanceID; }
@@ -324,6 +365,12 @@ public:
         mutexLockedbyRm = false;
         mStreamMutex.unlock();
     };
+    bool tryLockStreamMutex() {
+        if (!mStreamMutex.try_lock())
+            return false;
+        mutexLockedbyRm = true;
+        return true;
+    };
     bool isMutexLockedbyRm() { return mutexLockedbyRm; }
     void lockGetParamMutex() { mGetParamMutex.lock(); };
     void unlockGetParamMutex() { mGetParamMutex.unlock(); };
@@ -363,6 +410,8 @@ public:
    int32_t addRemoveEffect(pal_audio_effect_t effect __unused, bool enable __unused) {return 0;};
    int32_t read(struct pal_buffer *buf) override;
    int32_t write(struct pal_buffer *buf) override;
+   int32_t readBatch(struct pal_buffer *bufs, uint32_t numBufs) override;
+   int32_t writeBatch(struct pal_buffer *bufs, uint32_t numBufs) override;
    int32_t registerCallBack(pal_stream_callback cb, uint64_t cookie) override;
    int32_t getCallBack(pal_stream_callback *cb) override;
    int32_t getParameters(uint32_t param_id, void **payload) override;
@@ -61,6 +61,7 @@ public:
    int32_t addRemoveEffect(pal_audio_effect_t effect, bool enable) override;
    int32_t read(struct pal_buffer *buf) override;
    int32_t write(struct pal_buffer *buf) override;
+   int32_t writeBatch(struct pal_buffer *bufs, uint32_t numBufs) override;
    int32_t registerCallBack(pal_stream_callback cb, uint64_t cookie) override;
    int32_t getCallBack(pal_stream_callback *cb) override;
    int32_t getParameters(uint32_t param_id, void **payload) override;
@@ -79,6 +80,7 @@ public:
 
 private:
     uint32_t volRampPeriodms;
+    PalClockModel mMmapPosModel; // answers GetMmapPosition between hw ptr reads
 };
 
 #endif//STREAMPCM_H_
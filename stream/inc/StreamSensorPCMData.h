@@ -39,6 +39,8 @@
 #include "StreamCommon.h"
 #include "ACDPlatformInfo.h"
 
+class SensorCaptureSource;
+
 class StreamSensorPCMData : public StreamCommon
 {
 public:
@@ -47,7 +49,8 @@ public:
                         const uint32_t no_of_devices __unused,
                         const struct modifier_kv *modifiers __unused,
                         const uint32_t no_of_modifiers __unused,
-                        const std::shared_ptr<ResourceManager> rm);
+                        const std::shared_ptr<ResourceManager> rm,
+                        bool is_capture_source = false);
     ~StreamSensorPCMData();
     std::shared_ptr<CaptureProfile> GetCurrentCaptureProfile();
     int32_t addRemoveEffect(pal_audio_effect_t effect, bool enable);
@@ -63,10 +66,17 @@ public:
     int32_t ConnectDevice(pal_device_id_t device_id) override;
     pal_device_id_t GetAvailCaptureDevice();
     struct st_uuid GetVendorUuid();
+    std::string GetCaptureSourceKey();
+    void GetCaptureDeviceAttr(struct pal_device *dattr) { *dattr = capture_dev_attr_; }
+    pal_audio_effect_t GetEffect() const { return effect_; }
+    bool IsSharedCaptureClient() const { return use_shared_capture_; }
 
 private:
+    friend class SensorCaptureSource;
     void GetUUID(class SoundTriggerUUID *uuid, const struct st_uuid *vendor_uuid);
     int32_t SetupStreamConfig(const struct st_uuid *vendor_uuid);
+    int32_t startSharedCapture();
+    void resumeSharedCapture();
     int32_t DisconnectDevice_l(pal_device_id_t device_id);
     int32_t ConnectDevice_l(pal_device_id_t device_id);
     int32_t setECRef(std::shared_ptr<Device> dev, bool is_enable);
@@ -75,8 +85,15 @@ private:
     std::shared_ptr<ACDPlatformInfo> acd_info_;
     std::shared_ptr<CaptureProfile> cap_prof_;
     uint32_t pcm_data_stream_effect;
+    pal_audio_effect_t effect_;
     bool use_lpi_;
     bool paused_;
+    /* clients of a shared capture graph do not open their own session */
+    bool use_shared_capture_;
+    /* client start deferred while concurrency pauses sensor capture */
+    bool shared_start_pending_;
+    struct pal_device capture_dev_attr_;
+    std::shared_ptr<SensorCaptureSource> capture_src_;
 };
 
 #endif//StreamSensorPCMData_H_
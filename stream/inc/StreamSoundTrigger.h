@@ -515,17 +515,13 @@ private:
 
     int32_t notifyClient(bool detection);
 
-    static void TimerThread(StreamSoundTrigger& st_stream);
     void PostDelayedStop();
     void CancelDelayedStop();
     void InternalStopRecognition();
-    std::thread timer_thread_;
-    std::mutex timer_mutex_;
-    std::condition_variable timer_start_cond_;
-    std::condition_variable timer_wait_cond_;
-    bool timer_stop_waiting_;
-    bool exit_timer_thread_;
+    int delayed_stop_timer_;
     bool pending_stop_;
+    /* a fire queued before a cancel and repost must not stop early */
+    ChronoSteadyClock_t pending_stop_deadline_;
     bool paused_;
     bool device_opened_;
     st_module_type_t model_type_;
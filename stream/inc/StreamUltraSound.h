@@ -52,8 +52,24 @@ public:
    int32_t stop();
    int32_t setUltraSoundGain_l(pal_ultrasound_gain_t new_gain);
    int32_t setUltraSoundGain(pal_ultrasound_gain_t new_gain);
+   void handleScreenState(bool screen_on);
 private:
     pal_ultrasound_gain_t gain;
+    /* host duty cycling, see PAL_PARAM_ID_UPD_DUTY_CYCLE_CADENCE */
+    pal_param_upd_cadence_t cadence;
+    pal_ultrasound_gain_t targetGain; /* applied at the next active window */
+    int cadenceTimer;
+    bool dutyCycling;
+    bool sleeping;
+    int64_t wakeDueUs;
+    uint32_t wakeCount;
+    int64_t wakeLatencySumUs;
+    int64_t wakeLatencyMaxUs;
+    int32_t applyUltraSoundGain_l(pal_ultrasound_gain_t new_gain);
+    void startDutyCycle_l();
+    void stopDutyCycle_l(bool wake);
+    void wake_l();
+    void onWindowBoundary();
     static void HandleCallBack(uint64_t hdl, uint32_t event_id,
                                void *data, uint32_t event_size, uint32_t miid);
     void HandleEvent(uint32_t event_id, void *data, uint32_t event_size);
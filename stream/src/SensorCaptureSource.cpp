@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#define LOG_TAG "PAL: SensorCaptureSource"
+
+#include "SensorCaptureSource.h"
+#include "StreamSensorPCMData.h"
+#include "ResourceManager.h"
+
+std::mutex SensorCaptureSource::sources_mutex_;
+std::map<std::string, std::shared_ptr<SensorCaptureSource>> SensorCaptureSource::sources_;
+std::map<std::string, std::vector<StreamSensorPCMData *>> SensorCaptureSource::closing_;
+
+SensorCaptureSource::SensorCaptureSource(const std::string &key) :
+    key_(key),
+    owner_(nullptr)
+{
+}
+
+SensorCaptureSource::~SensorCaptureSource()
+{
+    if (owner_)
+        Close();
+}
+
+std::shared_ptr<SensorCaptureSource> SensorCaptureSource::Attach(
+    StreamSensorPCMData *client, int32_t *status)
+{
+    std::shared_ptr<SensorCaptureSource> source = nullptr;
+    std::string key;
+    int32_t ret = 0;
+
+    if (!client) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    key = client->GetCaptureSourceKey();
+
+    {
+        std::lock_guard<std::mutex> lck(sources_mutex_);
+        auto closing = closing_.find(key);
+        if (closing != closing_.end()) {
+            /* pinned until Release resumes it */
+            std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
+            rm->lockActiveStream();
+            ret = rm->increaseStreamUserCounter(client);
+            rm->unlockActiveStream();
+            if (!ret) {
+                closing->second.push_back(client);
+                ret = -EAGAIN;
+            }
+            PAL_INFO(LOG_TAG, "capture source %s is closing, client %pK waits, ret %d",
+                     key.c_str(), client, ret);
+            goto exit;
+        }
+        auto it = sources_.find(key);
+        if (it != sources_.end()) {
+            source = it->second;
+        } else {
+            if (!ResourceManager::getInstance()->IsSensorCaptureSourceAvailable()) {
+                ret = -EBUSY;
+                PAL_ERR(LOG_TAG, "Error:%d no session left for capture source %s",
+                        ret, key.c_str());
+                goto exit;
+            }
+            source = std::make_shared<SensorCaptureSource>(key);
+            ret = source->Open(client);
+            if (ret) {
+                PAL_ERR(LOG_TAG, "Error:%d failed to open capture source %s",
+                        ret, key.c_str());
+                source = nullptr;
+                goto exit;
+            }
+            sources_[key] = source;
+        }
+        source->clients_.insert(client);
+        PAL_INFO(LOG_TAG, "client %pK attached to %s, %zu clients",
+                 client, key.c_str(), source->clients_.size());
+    }
+
+exit:
+    if (status)
+        *status = ret;
+    return source;
+}
+
+/*
+ * Unlinks the client. The last client gets the source back and has to pass
+ * it to Release() after dropping its stream lock, closing the capture
+ * stream takes the RM locks and may pause other sensor clients.
+ */
+std::shared_ptr<SensorCaptureSource> SensorCaptureSource::Detach(
+    std::shared_ptr<SensorCaptureSource> source, StreamSensorPCMData *client)
+{
+    if (!source)
+        return nullptr;
+
+    std::lock_guard<std::mutex> lck(sources_mutex_);
+    source->clients_.erase(client);
+    PAL_INFO(LOG_TAG, "client %pK detached from %s, %zu clients",
+             client, source->key_.c_str(), source->clients_.size());
+    if (!source->clients_.empty())
+        return nullptr;
+
+    sources_.erase(source->key_);
+    /* keep the key busy so no second graph comes up while this one goes down */
+    closing_[source->key_];
+    return source;
+}
+
+void SensorCaptureSource::Release(std::shared_ptr<SensorCaptureSource> source)
+{
+    std::vector<StreamSensorPCMData *> waiters;
+
+    if (!source)
+        return;
+
+    source->Close();
+
+    {
+        std::lock_guard<std::mutex> lck(sources_mutex_);
+        auto it = closing_.find(source->key_);
+        if (it != closing_.end()) {
+            waiters.swap(it->second);
+            closing_.erase(it);
+        }
+    }
+
+    /* starts the waiters still pending and drops their pin */
+    for (StreamSensorPCMData *client : waiters)
+        client->resumeSharedCapture();
+}
+
+uint32_t SensorCaptureSource::GetNumSources()
+{
+    std::lock_guard<std::mutex> lck(sources_mutex_);
+    return sources_.size();
+}
+
+int32_t SensorCaptureSource::Open(StreamSensorPCMData *client)
+{
+    std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
+    struct pal_stream_attributes sattr;
+    struct pal_device dattr;
+    int32_t status = 0;
+
+    PAL_DBG(LOG_TAG, "Enter, key %s", key_.c_str());
+    client->getStreamAttributes(&sattr);
+    client->GetCaptureDeviceAttr(&dattr);
+
+    try {
+        owner_ = new StreamSensorPCMData(&sattr, &dattr, 1, NULL, 0, rm, true);
+    } catch (const std::exception& e) {
+        PAL_ERR(LOG_TAG, "Error: capture stream create failed %s", e.what());
+        owner_ = nullptr;
+        status = -EINVAL;
+        goto exit;
+    }
+    rm->initStreamUserCounter(owner_);
+
+    status = owner_->open();
+    if (status) {
+        PAL_ERR(LOG_TAG, "Error:%d capture stream open failed", status);
+        goto close_owner;
+    }
+
+    status = owner_->addRemoveEffect(client->GetEffect(), true);
+    if (status) {
+        PAL_ERR(LOG_TAG, "Error:%d capture stream effect setup failed", status);
+        goto close_owner;
+    }
+
+    status = owner_->start();
+    if (status) {
+        PAL_ERR(LOG_TAG, "Error:%d capture stream start failed", status);
+        goto close_owner;
+    }
+    goto exit;
+
+close_owner:
+    Close();
+exit:
+    PAL_DBG(LOG_TAG, "Exit, status %d", status);
+    return status;
+}
+
+void SensorCaptureSource::Close()
+{
+    std::shared_ptr<ResourceManager> rm = ResourceManager::getInstance();
+    StreamSensorPCMData *owner = owner_;
+    int32_t status = 0;
+
+    PAL_DBG(LOG_TAG, "Enter, key %s", key_.c_str());
+    owner_ = nullptr;
+    if (!owner)
+        return;
+
+    owner->setCachedState(STREAM_IDLE);
+    status = owner->close();
+    if (status)
+        PAL_ERR(LOG_TAG, "Error:%d capture stream close failed", status);
+
+    rm->deactivateStreamUserCounter(owner);
+    delete owner;
+    rm->eraseStreamUserCounter(owner);
+    PAL_DBG(LOG_TAG, "Exit");
+}
@@ -75,11 +75,30 @@
 #include "SessionAlsaPcm.h"
 #include "ResourceManager.h"
 #include "Device.h"
+#include "PalEventLoop.h"
 #include "USBAudio.h"
 
 std::shared_ptr<ResourceManager> Stream::rm = nullptr;
-std::mutex Stream::mBaseStreamMutex;
+std::mutex Stream::mRmInitMutex;
 std::mutex Stream::pauseMutex;
+
+/* retry period of async volume updates while the stream lock is busy */
+#define ASYNC_VOL_RETRY_MS 5
+
+Stream::~Stream()
+{
+    PalEventLoop *loop = PalEventLoop::getInstance();
+    int timer = 0;
+
+    /* close waits for the update user count, nothing is in flight here */
+    mAsyncVolLock.lock();
+    timer = mAsyncVolTimer;
+    mAsyncVolTimer = 0;
+    mAsyncVolLock.unlock();
+    if (timer > 0 && loop)
+        loop->cancelTimer(timer);
+    free(mPendingVolume);
+}
 std::condition_variable Stream::pauseCV;
 
 
@@ -98,7 +117,6 @@ void Stream::handleSoftPauseCallBack(uint64_t hdl, uint32_t event_id,
 Stream* Stream::create(struct pal_stream_attributes *sAttr, struct pal_device *dAttr,
     uint32_t noOfDevices, struct modifier_kv *modifiers, uint32_t noOfModifiers)
 {
-    std::lock_guard<std::mutex> lock(mBaseStreamMutex);
     Stream* stream = NULL;
     int status = 0;
     uint32_t count = 0;
@@ -114,12 +132,14 @@ Stream* Stream::create(struct pal_stream_attributes *sAttr, struct pal_device *d
     }
 
     /* get RM instance */
+    {
+        std::lock_guard<std::mutex> lock(mRmInitMutex);
+        if (!rm)
+            rm = ResourceManager::getInstance();
+    }
     if (!rm) {
-        rm = ResourceManager::getInstance();
-        if (!rm) {
-            PAL_ERR(LOG_TAG, "ResourceManager getInstance failed");
-            goto exit;
-        }
+        PAL_ERR(LOG_TAG, "ResourceManager getInstance failed");
+        goto exit;
     }
     PAL_VERBOSE(LOG_TAG,"get RM instance success and noOfDevices %d \n", noOfDevices);
 
@@ -176,22 +196,37 @@ Stream* Stream::create(struct pal_stream_attributes *sAttr, struct pal_device *d
                PAL_ERR(LOG_TAG, "Not able to get Device config %d", status);
                goto exit;
             }
-            // check if it's grouped device and group config needs to update
-            rm->lockActiveStream();
-            status = rm->checkAndUpdateGroupDevConfig((struct pal_device *)&palDevsAttr[count], sAttr,
-                                                    streamsToSwitch, &streamDevAttr, true);
-            rm->unlockActiveStream();
-            if (status) {
-                PAL_ERR(LOG_TAG, "no valid group device config found");
-            }
         }
 
         count++;
     }
 
+    /*
+     * Device configs above are resolved without any shared lock so that
+     * streams can be created from several threads in parallel. Only the
+     * group device check looks at other active streams, do it for all
+     * devices in one active stream window.
+     */
+    rm->lockActiveStream();
+    for (uint32_t i = 0; i < count; i++) {
+        if (palDevsAttr[i].address.card_id == DUMMY_SND_CARD)
+            continue;
+        // check if it's grouped device and group config needs to update
+        status = rm->checkAndUpdateGroupDevConfig((struct pal_device *)&palDevsAttr[i], sAttr,
+                                                streamsToSwitch, &streamDevAttr, true);
+        if (status) {
+            PAL_ERR(LOG_TAG, "no valid group device config found");
+        }
+    }
+    rm->unlockActiveStream();
+
 stream_create:
     PAL_DBG(LOG_TAG, "stream type 0x%x", sAttr->type);
-    if (rm->isStreamSupported(sAttr, palDevsAttr, noOfDevices)) {
+    /*
+     * The session is reserved in RM until the constructor registers the
+     * stream, constructors themselves run without any shared lock.
+     */
+    if (rm->reserveStreamSlot(sAttr, palDevsAttr, noOfDevices)) {
         try {
             switch (sAttr->type) {
                 case PAL_STREAM_LOW_LATENCY:
@@ -287,12 +322,14 @@ stream_create:
             }
         }
         catch (const std::exception& e) {
+            rm->releaseStreamSlot();
             PAL_ERR(LOG_TAG, "Stream create failed for stream type 0x%x", sAttr->type);
             if (palDevsAttr) {
                 free(palDevsAttr);
             }
             throw std::runtime_error(e.what());
         }
+        rm->releaseStreamSlot();
     } else {
         PAL_ERR(LOG_TAG,"Requested config not supported");
         goto exit;
@@ -425,6 +462,40 @@ int32_t Stream::rwACDBParameters(void *payload, uint32_t sampleRate,
     return status;
 }
 
+/*
+ * Default batch handling, buffers go through write()/read() one at a time.
+ * Returns the total bytes transferred, or the error if the first buffer
+ * already failed. On read each buffer's size is set to the bytes read.
+ */
+int32_t Stream::writeBatch(struct pal_buffer *bufs, uint32_t numBufs)
+{
+    int32_t ret = 0;
+    int32_t total = 0;
+
+    for (uint32_t i = 0; i < numBufs; i++) {
+        ret = write(&bufs[i]);
+        if (ret < 0)
+            return total ? total : ret;
+        total += ret;
+    }
+    return total;
+}
+
+int32_t Stream::readBatch(struct pal_buffer *bufs, uint32_t numBufs)
+{
+    int32_t ret = 0;
+    int32_t total = 0;
+
+    for (uint32_t i = 0; i < numBufs; i++) {
+        ret = read(&bufs[i]);
+        if (ret < 0)
+            return total ? total : ret;
+        bufs[i].size = ret;
+        total += ret;
+    }
+    return total;
+}
+
 int32_t Stream::getStreamType (pal_stream_type_t* streamType)
 {
     int32_t status = 0;
@@ -824,9 +895,34 @@ bool Stream::isStreamAudioOutFmtSupported(pal_audio_fmt_t format)
     }
 }
 
+static inline int64_t palTimeToUs(const struct pal_time_us *t)
+{
+    return (int64_t)(((uint64_t)t->value_msw << 32) | t->value_lsw);
+}
+
+static inline void usToPalTime(int64_t us, struct pal_time_us *t)
+{
+    t->value_lsw = (uint32_t)((uint64_t)us & 0xFFFFFFFF);
+    t->value_msw = (uint32_t)((uint64_t)us >> 32);
+}
+
+/* raise t to floor if it is behind, then remember it as the new floor */
+static inline void holdPalTime(struct pal_time_us *t, struct pal_time_us *floor)
+{
+    if (palTimeToUs(t) < palTimeToUs(floor))
+        *t = *floor;
+    *floor = *t;
+}
+
 int32_t Stream::getTimestamp(struct pal_session_time *stime)
 {
     int32_t status = 0;
+    int64_t queryUs = 0;
+    int64_t sampleUs = 0;
+    int64_t sessionUs = 0;
+    int64_t lastSessionUs = 0;
+    bool running = false;
+
     if (!stime) {
         status = -EINVAL;
         PAL_ERR(LOG_TAG, "Invalid session time pointer, status %d", status);
@@ -838,7 +934,42 @@ int32_t Stream::getTimestamp(struct pal_session_time *stime)
         goto exit;
     }
     mGetParamMutex.lock();
+    /*
+     * While the session runs, session time moves with the DSP clock and is
+     * answered from the model between DSP queries. Absolute time follows the
+     * monotonic clock and the last processed timestamp keeps its offset to
+     * the session time.
+     */
+    running = (currentState == STREAM_STARTED) && !isPaused;
+    queryUs = PalClockModel::nowUs();
+    if (!running) {
+        mSessionTimeModel.reset();
+        mLastReturnedTime = {};
+    } else if (mSessionTimeModel.getLastSample(&sampleUs, &lastSessionUs) &&
+               mSessionTimeModel.predict(queryUs, &sessionUs)) {
+        *stime = mLastSessionTime;
+        usToPalTime(sessionUs, &stime->session_time);
+        usToPalTime(palTimeToUs(&mLastSessionTime.absolute_time) + queryUs - sampleUs,
+                    &stime->absolute_time);
+        usToPalTime(palTimeToUs(&mLastSessionTime.timestamp) + sessionUs - lastSessionUs,
+                    &stime->timestamp);
+        holdPalTime(&stime->session_time, &mLastReturnedTime.session_time);
+        holdPalTime(&stime->absolute_time, &mLastReturnedTime.absolute_time);
+        holdPalTime(&stime->timestamp, &mLastReturnedTime.timestamp);
+        mGetParamMutex.unlock();
+        goto exit;
+    }
     status = session->getTimestamp(stime);
+    if (0 == status && running) {
+        /* the DSP sampled its clocks somewhere within the query */
+        sampleUs = (queryUs + PalClockModel::nowUs()) / 2;
+        mSessionTimeModel.addSample(sampleUs, palTimeToUs(&stime->session_time));
+        mLastSessionTime = *stime;
+        /* a real reading may land behind an earlier extrapolated answer */
+        holdPalTime(&stime->session_time, &mLastReturnedTime.session_time);
+        holdPalTime(&stime->absolute_time, &mLastReturnedTime.absolute_time);
+        holdPalTime(&stime->timestamp, &mLastReturnedTime.timestamp);
+    }
     mGetParamMutex.unlock();
     if (0 != status) {
         PAL_ERR(LOG_TAG, "Failed to get session timestamp status %d", status);
@@ -853,6 +984,212 @@ exit:
     return status;
 }
 
+int32_t Stream::getTimestampDrift(int32_t *driftPpm)
+{
+    if (!driftPpm) {
+        PAL_ERR(LOG_TAG, "Invalid drift pointer");
+        return -EINVAL;
+    }
+
+    *driftPpm = mSessionTimeModel.getDriftPpm();
+    PAL_VERBOSE(LOG_TAG, "session time drift %d ppm", *driftPpm);
+    return 0;
+}
+
+/*
+ * Hands the slot to a PalEventLoop worker unless one already owns it, in
+ * which case the newer value simply replaces the one it has not picked up
+ * yet. The worker holds a stream user count until the slot is empty, so
+ * close waits for it. Called with mAsyncVolLock held by lock, which is
+ * dropped before the resource manager is called.
+ */
+int32_t Stream::postAsyncVolume(std::unique_lock<std::mutex> &lock)
+{
+    PalEventLoop *loop = NULL;
+    int32_t status = 0;
+
+    if (mAsyncVolPosted) {
+        mAsyncVolCoalesced++;
+        PAL_VERBOSE(LOG_TAG, "coalesced into pending update, %llu so far",
+                    (unsigned long long)mAsyncVolCoalesced);
+        return 0;
+    }
+    mAsyncVolPosted = true;
+    loop = PalEventLoop::getInstance();
+    if (loop && mAsyncVolTimer <= 0)
+        mAsyncVolTimer = loop->addTimer(0, 0, [this]() { applyAsyncVolume(); });
+    lock.unlock();
+
+    rm->lockActiveStream();
+    status = rm->increaseStreamUserCounter(this);
+    rm->unlockActiveStream();
+    if (status) {
+        PAL_ERR(LOG_TAG, "failed to increase stream user count");
+        lock.lock();
+        mVolumePending = false;
+        mMutePending = false;
+        mAsyncVolPosted = false;
+        return status;
+    }
+
+    if (loop && !loop->post([this]() { applyAsyncVolume(); }))
+        return 0;
+
+    PAL_ERR(LOG_TAG, "failed to post volume update, applying inline");
+    applyAsyncVolume();
+    return 0;
+}
+
+/*
+ * Drains the slot. Runs on the shared event loop workers, so it never
+ * waits for mStreamMutex: while the stream is busy the slot is left alone
+ * and retried from mAsyncVolTimer.
+ */
+void Stream::applyAsyncVolume()
+{
+    alignas(struct pal_volume_data) uint8_t volBuf[sizeof(uint32_t) +
+                   sizeof(struct pal_channel_vol_kv) * PAL_MAX_CHANNELS_SUPPORTED];
+    struct pal_volume_data *volume = (struct pal_volume_data *)volBuf;
+    struct pal_vol_ctrl_ramp_param rampParam;
+    PalEventLoop *loop = NULL;
+    int timer = 0;
+    uint32_t volSize = 0;
+    uint32_t volSeq = 0;
+    uint32_t muteSeq = 0;
+    bool applyVolume = false;
+    bool applyMute = false;
+    bool muteState = false;
+    int32_t status = 0;
+
+    for (;;) {
+        if (!tryLockStreamMutex()) {
+            mAsyncVolLock.lock();
+            timer = mAsyncVolTimer;
+            mAsyncVolLock.unlock();
+            loop = PalEventLoop::getInstance();
+            if (timer > 0 && loop && !loop->armTimer(timer, ASYNC_VOL_RETRY_MS))
+                return;
+            /* no way to come back later, wait here */
+            lockStreamMutex();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mAsyncVolLock);
+
+            if (!mVolumePending && !mMutePending) {
+                mAsyncVolPosted = false;
+                break;
+            }
+            applyVolume = mVolumePending;
+            applyMute = mMutePending;
+            muteState = mPendingMute;
+            rampParam.ramp_period_ms = mPendingRampMs;
+            if (applyVolume) {
+                volSize = sizeof(uint32_t) +
+                    sizeof(struct pal_channel_vol_kv) * mPendingVolume->no_of_volpair;
+                memcpy(volume, mPendingVolume, volSize);
+            }
+            volSeq = mVolumeSeq.load();
+            muteSeq = mMuteSeq.load();
+            mVolumePending = false;
+            mMutePending = false;
+        }
+
+        /* a synchronous call since the slot was read wins */
+        if (applyVolume && volSeq == mVolumeSeq.load()) {
+            if (rampParam.ramp_period_ms && session && currentState == STREAM_STARTED) {
+                status = session->setParameters(this, TAG_STREAM_VOLUME,
+                                                PAL_PARAM_ID_VOLUME_CTRL_RAMP, &rampParam);
+                if (status)
+                    PAL_DBG(LOG_TAG, "vol ctrl ramp not applied, status %d", status);
+            }
+            status = setVolume(volume);
+            if (status)
+                PAL_ERR(LOG_TAG, "async setVolume failed with status %d", status);
+            if (rampParam.ramp_period_ms && session && currentState == STREAM_STARTED) {
+                /* later plain set_volume calls use the regular ramp */
+                rampParam.ramp_period_ms = VOL_CTRL_RAMP_DEFAULT_MS;
+                status = session->setParameters(this, TAG_STREAM_VOLUME,
+                                                PAL_PARAM_ID_VOLUME_CTRL_RAMP, &rampParam);
+                if (status)
+                    PAL_DBG(LOG_TAG, "vol ctrl ramp not restored, status %d", status);
+            }
+        }
+
+        if (applyMute && muteSeq == mMuteSeq.load()) {
+            status = mute_l(muteState);
+            if (status)
+                PAL_ERR(LOG_TAG, "async mute failed with status %d", status);
+        }
+        unlockStreamMutex();
+    }
+    unlockStreamMutex();
+
+    rm->lockActiveStream();
+    rm->decreaseStreamUserCounter(this);
+    rm->unlockActiveStream();
+}
+
+int32_t Stream::setVolumeAsync(struct pal_volume_data *volume, uint32_t rampMs)
+{
+    std::unique_lock<std::mutex> lock(mAsyncVolLock);
+    struct pal_volume_data *pending = NULL;
+    uint32_t volSize = 0;
+
+    if (!volume || volume->no_of_volpair == 0 ||
+        volume->no_of_volpair > PAL_MAX_CHANNELS_SUPPORTED) {
+        PAL_ERR(LOG_TAG, "Invalid volume data");
+        return -EINVAL;
+    }
+
+    volSize = sizeof(uint32_t) +
+        sizeof(struct pal_channel_vol_kv) * volume->no_of_volpair;
+    /* the slot only ever grows, so steady state updates do not allocate */
+    if (volume->no_of_volpair > mAsyncVolPairs) {
+        pending = (struct pal_volume_data *)realloc(mPendingVolume, volSize);
+        if (!pending) {
+            PAL_ERR(LOG_TAG, "failed to allocate volume slot");
+            return -ENOMEM;
+        }
+        mPendingVolume = pending;
+        mAsyncVolPairs = volume->no_of_volpair;
+    }
+
+    memcpy(mPendingVolume, volume, volSize);
+    mPendingRampMs = rampMs;
+    mVolumePending = true;
+    mVolumeSeq++;
+    return postAsyncVolume(lock);
+}
+
+int32_t Stream::setMuteAsync(bool state)
+{
+    std::unique_lock<std::mutex> lock(mAsyncVolLock);
+
+    mPendingMute = state;
+    mMutePending = true;
+    mMuteSeq++;
+    return postAsyncVolume(lock);
+}
+
+/*
+ * A synchronous update supersedes whatever is still waiting in the slot,
+ * and a value a worker already took is dropped once it sees the new
+ * sequence. Called before the caller takes mStreamMutex.
+ */
+void Stream::dropAsyncUpdate(bool mute)
+{
+    std::lock_guard<std::mutex> lock(mAsyncVolLock);
+
+    if (mute) {
+        mMutePending = false;
+        mMuteSeq++;
+    } else {
+        mVolumePending = false;
+        mVolumeSeq++;
+    }
+}
+
 int32_t Stream::handleBTDeviceNotReady(bool& a2dpSuspend)
 {
     int32_t status = 0;
@@ -1347,6 +1684,146 @@ exit:
     return status;
 }
 
+/*
+ * Decide how the pending switch of this stream from curDevId to dattr is
+ * applied. A full switch tears the device down and brings it up again. When
+ * only the custom key changed and it resolves to the same snd device and
+ * media config, the backend can keep running and only the session device
+ * (devicepp subgraph) needs to be relinked with the new key. This is only
+ * done while this stream is the sole user of the device.
+ */
+dev_switch_edit_t Stream::planDeviceSwitch_l(uint32_t curDevId, struct pal_device *dattr)
+{
+    dev_switch_edit_t edit = DEV_SWITCH_EDIT_FULL;
+    struct pal_device_info curDevInfo = {};
+    struct pal_device_info newDevInfo = {};
+    struct pal_device *curDattr = NULL;
+    std::map<uint32_t, struct pal_device>::iterator iter;
+    std::shared_ptr<Device> dev = nullptr;
+
+    if (!dattr || dattr->id != curDevId)
+        goto exit;
+
+    iter = mSwitchFromDevAttr.find(curDevId);
+    if (iter == mSwitchFromDevAttr.end())
+        goto exit;
+    curDattr = &iter->second;
+
+    if (currentState != STREAM_STARTED && currentState != STREAM_PAUSED)
+        goto exit;
+
+    for (int i = 0; i < mDevices.size(); i++) {
+        if (mDevices[i]->getSndDeviceId() == curDevId) {
+            dev = mDevices[i];
+            break;
+        }
+    }
+    if (!dev || rm->isBtDevice((pal_device_id_t)curDevId))
+        goto exit;
+
+    /* the relink rewrites the device attributes, other users would see them */
+    if (dev->getDeviceCount() > 1)
+        goto exit;
+
+    if (curDattr->config.sample_rate != dattr->config.sample_rate ||
+        curDattr->config.bit_width != dattr->config.bit_width ||
+        curDattr->config.aud_fmt_id != dattr->config.aud_fmt_id ||
+        curDattr->config.ch_info.channels != dattr->config.ch_info.channels)
+        goto exit;
+
+    rm->getDeviceInfo((pal_device_id_t)curDevId, mStreamAttr->type,
+                      curDattr->custom_config.custom_key, &curDevInfo);
+    rm->getDeviceInfo(dattr->id, mStreamAttr->type,
+                      dattr->custom_config.custom_key, &newDevInfo);
+    if (curDevInfo.sndDevName != newDevInfo.sndDevName)
+        goto exit;
+
+    edit = DEV_SWITCH_EDIT_RELINK;
+
+exit:
+    mSwitchFromDevAttr.erase(curDevId);
+    PAL_DBG(LOG_TAG, "stream %pK device %d, edit %s", this, curDevId,
+            edit == DEV_SWITCH_EDIT_RELINK ? "relink" : "full");
+    return edit;
+}
+
+/*
+ * Relink the session device of a running device with new attributes. When
+ * it fails before anything was changed, *fullSwitch is set and the caller
+ * has to apply the pair through the full disconnect/connect path.
+ */
+int32_t Stream::relinkStreamDevice_l(Stream* streamHandle, struct pal_device *dattr,
+                                     bool *fullSwitch)
+{
+    int32_t status = 0;
+    std::shared_ptr<Device> dev = nullptr;
+    int idx = -1;
+
+    if (fullSwitch)
+        *fullSwitch = false;
+    if (!dattr) {
+        PAL_ERR(LOG_TAG, "invalid params");
+        return -EINVAL;
+    }
+
+    for (int i = 0; i < mDevices.size(); i++) {
+        if (mDevices[i]->getSndDeviceId() == dattr->id) {
+            dev = mDevices[i];
+            idx = i;
+            break;
+        }
+    }
+    if (!dev) {
+        PAL_ERR(LOG_TAG, "device %d is not running on stream", dattr->id);
+        return -EINVAL;
+    }
+
+    PAL_DBG(LOG_TAG, "device %d name %s, relink with custom key %s",
+            dattr->id, dev->getPALDeviceName().c_str(), dattr->custom_config.custom_key);
+
+    rm->lockGraph();
+    status = session->disconnectSessionDevice(streamHandle, mStreamAttr->type, dev);
+    rm->unlockGraph();
+    if (0 != status) {
+        /* nothing changed yet, caller falls back to a full switch */
+        PAL_ERR(LOG_TAG, "disconnectSessionDevice failed:%d", status);
+        if (fullSwitch && status != -ENETRESET)
+            *fullSwitch = true;
+        return status;
+    }
+
+    dev->setDeviceAttributes(*dattr);
+    status = session->setupSessionDevice(streamHandle, mStreamAttr->type, dev);
+    if (0 != status) {
+        PAL_ERR(LOG_TAG, "setupSessionDevice for %d failed with status %d",
+                dattr->id, status);
+        goto reconnect;
+    }
+
+    rm->lockGraph();
+    status = session->connectSessionDevice(streamHandle, mStreamAttr->type, dev);
+    rm->unlockGraph();
+    if (0 != status) {
+        PAL_ERR(LOG_TAG, "connectSessionDevice failed:%d", status);
+        goto reconnect;
+    }
+    return 0;
+
+reconnect:
+    if (status == -ENETRESET)
+        return status;
+
+    /* session device is already unlinked, release the device and bring it up again */
+    rm->deregisterDevice(dev, this);
+    rm->lockGraph();
+    dev->stop();
+    dev->close();
+    mDevices.erase(mDevices.begin() + idx);
+    rm->unlockGraph();
+
+    return connectStreamDevice_l(streamHandle, dattr);
+}
+
 /*
   legend:
   s1 - current stream
@@ -1450,6 +1927,7 @@ int32_t Stream::switchDevice(Stream* streamHandle, uint32_t numDev, struct pal_d
     }
 
     streamHandle->getStreamAttributes(&strAttr);
+    mSwitchFromDevAttr.clear();
 
     for (int i = 0; i < mDevices.size(); i++) {
         pal_device_id_t curDevId = (pal_device_id_t)mDevices[i]->getSndDeviceId();
@@ -1492,6 +1970,8 @@ int32_t Stream::switchDevice(Stream* streamHandle, uint32_t numDev, struct pal_d
                         newDevices[j].custom_config.custom_key,
                         curDevAttr.custom_config.custom_key);
                     force_switch_dev_id = newDevices[j].id;
+                    /* stream-device attr is replaced below, keep it for the switch planner */
+                    mSwitchFromDevAttr[curDevId] = curDevAttr;
                 }
                 break;
             }
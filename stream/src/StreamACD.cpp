@@ -38,6 +38,7 @@
 #include <unistd.h>
 #include "ResourceManager.h"
 #include "Device.h"
+#include "PalThreadPolicy.h"
 #include "kvh2xml.h"
 
 StreamACD::StreamACD(struct pal_stream_attributes *sattr,
@@ -989,6 +990,7 @@ exit:
 
 void StreamACD::EventNotificationThread(StreamACD *stream)
 {
+    PalThreadScope threadScope(PAL_THREAD_CLASS_EVENT, "acd_notify");
     PAL_DBG(LOG_TAG, "Enter. start thread loop");
 
     std::unique_lock<std::mutex> lck(stream->mutex_);
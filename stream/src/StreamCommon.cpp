@@ -618,9 +618,7 @@ int32_t StreamCommon::ssrUpHandler()
              PAL_ERR(LOG_TAG, "Error:stream open failed. status %d", status);
              goto exit;
          }
-         rm->unlockActiveStream();
          status = start();
-         rm->lockActiveStream();
          if (0 != status) {
              PAL_ERR(LOG_TAG, "Error:stream start failed. status %d", status);
              goto exit;
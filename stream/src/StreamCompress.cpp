@@ -778,15 +778,16 @@ int32_t StreamCompress::setVolume(struct pal_volume_data *volume)
        goto exit;
     }
 
-    // if already allocated free and reallocate
-    if (mVolumeData) {
+    // reuse the cached buffer when the layout is unchanged, else reallocate
+    if (mVolumeData && mVolumeData->no_of_volpair != volume->no_of_volpair) {
         free(mVolumeData);
         mVolumeData = NULL;
     }
 
     volSize = (sizeof(struct pal_volume_data) +
             (sizeof(struct pal_channel_vol_kv) * (volume->no_of_volpair)));
-    mVolumeData = (struct pal_volume_data *)calloc(1, volSize);
+    if (!mVolumeData)
+        mVolumeData = (struct pal_volume_data *)calloc(1, volSize);
     if (!mVolumeData) {
        PAL_ERR(LOG_TAG, "failed to calloc for volume data");
        status = -ENOMEM;
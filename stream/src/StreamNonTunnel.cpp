@@ -422,6 +422,84 @@ exit :
     return status;
 }
 
+int32_t StreamNonTunnel::readBatch(struct pal_buffer *bufs, uint32_t numBufs)
+{
+    int32_t status = 0;
+    int32_t size = 0;
+
+    PAL_DBG(LOG_TAG, "Enter. session handle - %pK, state %d, %u buffers",
+            session, currentState, numBufs);
+
+    mStreamMutex.lock();
+    if ((rm->cardState == CARD_STATUS_OFFLINE) || ssrInNTMode == true) {
+        PAL_ERR(LOG_TAG, "Sound card offline currentState %d", currentState);
+        status = -ENETRESET;
+        goto exit;
+    }
+
+    if (currentState != STREAM_STARTED) {
+        PAL_ERR(LOG_TAG, "Stream not started yet, state %d", currentState);
+        status = -EINVAL;
+        goto exit;
+    }
+
+    status = session->readBatch(this, SHMEM_ENDPOINT, bufs, numBufs, &size);
+    if (0 != status) {
+        PAL_ERR(LOG_TAG, "session batch read failed with status %d after %d bytes",
+                status, size);
+        if (status == -ENETRESET && rm->cardState != CARD_STATUS_OFFLINE) {
+            PAL_ERR(LOG_TAG, "Sound card offline, informing RM");
+            rm->ssrHandler(CARD_STATUS_OFFLINE);
+        }
+        if (size)
+            status = size;
+        goto exit;
+    }
+    mStreamMutex.unlock();
+    PAL_DBG(LOG_TAG, "Exit. session batch read successful size - %d", size);
+    return size;
+exit:
+    mStreamMutex.unlock();
+    PAL_DBG(LOG_TAG, "Exit. status %d", status);
+    return status;
+}
+
+int32_t StreamNonTunnel::writeBatch(struct pal_buffer *bufs, uint32_t numBufs)
+{
+    int32_t status = 0;
+    int32_t size = 0;
+
+    PAL_DBG(LOG_TAG, "Enter. session handle - %pK, state %d, %u buffers",
+            session, currentState, numBufs);
+
+    mStreamMutex.lock();
+    if ((rm->cardState == CARD_STATUS_OFFLINE) || ssrInNTMode == true) {
+        PAL_DBG(LOG_TAG, "sound card offline dropped %u buffers", numBufs);
+        mStreamMutex.unlock();
+        return -ENETRESET;
+    }
+    mStreamMutex.unlock();
+
+    if ((currentState != STREAM_STARTED) && (currentState != STREAM_PAUSED)) {
+        PAL_ERR(LOG_TAG, "Stream not started yet, state %d", currentState);
+        return (currentState == STREAM_STOPPED) ? -EIO : -EINVAL;
+    }
+
+    status = session->writeBatch(this, SHMEM_ENDPOINT, bufs, numBufs, &size);
+    if (0 != status) {
+        PAL_ERR(LOG_TAG, "session batch write failed with status %d after %d bytes",
+                status, size);
+        /* ENETRESET is the error code returned by AGM during SSR */
+        if (status == -ENETRESET && rm->cardState != CARD_STATUS_OFFLINE) {
+            PAL_ERR(LOG_TAG, "Sound card offline, informing RM");
+            rm->ssrHandler(CARD_STATUS_OFFLINE);
+        }
+        return size ? size : status;
+    }
+    PAL_DBG(LOG_TAG, "Exit. session batch write successful size - %d", size);
+    return size;
+}
+
 int32_t  StreamNonTunnel::registerCallBack(pal_stream_callback cb, uint64_t cookie)
 {
     streamCb = cb;
@@ -840,14 +840,15 @@ int32_t StreamPCM::setVolume(struct pal_volume_data *volume)
        goto exit;
     }
 
-    // if already allocated free and reallocate
-    if (mVolumeData) {
+    // reuse the cached buffer when the layout is unchanged, else reallocate
+    if (mVolumeData && mVolumeData->no_of_volpair != volume->no_of_volpair) {
         free(mVolumeData);
         mVolumeData = NULL;
     }
 
     volSize = sizeof(uint32_t) + (sizeof(struct pal_channel_vol_kv) * (volume->no_of_volpair));
-    mVolumeData = (struct pal_volume_data *)calloc(1, volSize);
+    if (!mVolumeData)
+        mVolumeData = (struct pal_volume_data *)calloc(1, volSize);
     if (!mVolumeData) {
         status = -ENOMEM;
         PAL_ERR(LOG_TAG, "failed to calloc for volume data");
@@ -1055,6 +1056,60 @@ exit:
     return status;
 }
 
+/*
+ * Started streams hand the whole batch to the session under one lock,
+ * everything else (SSR, standby, not started) keeps the per buffer
+ * handling of write().
+ */
+int32_t StreamPCM::writeBatch(struct pal_buffer *bufs, uint32_t numBufs)
+{
+    int32_t status = 0;
+    int32_t size = 0;
+
+    PAL_VERBOSE(LOG_TAG, "Enter. session handle - %pK, state %d, %u buffers",
+            session, currentState, numBufs);
+
+    mStreamMutex.lock();
+    if (rm->cardState == CARD_STATUS_OFFLINE || cachedState != STREAM_IDLE ||
+        ((currentState != STREAM_STARTED) && (currentState != STREAM_PAUSED))) {
+        mStreamMutex.unlock();
+        return Stream::writeBatch(bufs, numBufs);
+    }
+
+    status = session->writeBatch(this, SHMEM_ENDPOINT, bufs, numBufs, &size);
+    mStreamMutex.unlock();
+    if (0 != status) {
+        PAL_ERR(LOG_TAG, "session batch write failed with status %d after %d bytes",
+                status, size);
+        /* ENETRESET is the error code returned by AGM during SSR */
+        if (errno == -ENETRESET || rm->cardState == CARD_STATUS_OFFLINE) {
+            if (rm->cardState != CARD_STATUS_OFFLINE) {
+                PAL_ERR(LOG_TAG, "Sound card offline, informing RM");
+                rm->ssrHandler(CARD_STATUS_OFFLINE);
+            }
+            size = 0;
+            for (uint32_t i = 0; i < numBufs; i++)
+                size += bufs[i].size;
+            PAL_DBG(LOG_TAG, "dropped buffers size - %d", size);
+            return size;
+        }
+        return size ? size : status;
+    }
+
+    if (currentState == STREAM_PAUSED && !isPaused) {
+        rm->lockActiveStream();
+        mStreamMutex.lock();
+        for (int i = 0; i < mDevices.size(); i++) {
+            rm->registerDevice(mDevices[i], this);
+        }
+        mStreamMutex.unlock();
+        rm->unlockActiveStream();
+        currentState = STREAM_STARTED;
+    }
+    PAL_VERBOSE(LOG_TAG, "Exit. session batch write successful size - %d", size);
+    return size;
+}
+
 int32_t  StreamPCM::registerCallBack(pal_stream_callback /*cb*/, uint64_t /*cookie*/)
 {
     return 0;
@@ -1612,9 +1667,7 @@ int32_t StreamPCM::ssrUpHandler()
             PAL_ERR(LOG_TAG, "stream open failed. status %d", status);
             goto exit;
         }
-        rm->unlockActiveStream();
         status = start();
-        rm->lockActiveStream();
         if (0 != status) {
             PAL_ERR(LOG_TAG, "stream start failed. status %d", status);
             goto exit;
@@ -1633,9 +1686,7 @@ int32_t StreamPCM::ssrUpHandler()
             PAL_ERR(LOG_TAG, "stream open failed. status %d", status);
             goto exit;
         }
-        rm->unlockActiveStream();
         status = start();
-        rm->lockActiveStream();
         if (0 != status) {
             PAL_ERR(LOG_TAG, "stream start failed. status %d", status);
             goto exit;
@@ -1702,13 +1753,40 @@ exit:
 int32_t StreamPCM::GetMmapPosition(struct pal_mmap_position *position)
 {
     int32_t status = 0;
+    int64_t nowUs = 0;
+    int64_t frames = 0;
+    uint32_t sampleRate = 0;
 
     PAL_DBG(LOG_TAG, "Enter. session handle - %pK", session);
 
+    if (!position)
+        return -EINVAL;
+
     mStreamMutex.lock();
+    if (currentState != STREAM_STARTED) {
+        mMmapPosModel.reset();
+    } else {
+        sampleRate = (mStreamAttr->direction == PAL_AUDIO_INPUT) ?
+                     mStreamAttr->in_media_config.sample_rate :
+                     mStreamAttr->out_media_config.sample_rate;
+        mMmapPosModel.setNominalRate(sampleRate / 1000000.0);
+        nowUs = PalClockModel::nowUs();
+        if (mMmapPosModel.predict(nowUs, &frames)) {
+            position->position_frames = (int32_t)frames;
+            position->time_nanoseconds = nowUs * 1000;
+            goto unlock;
+        }
+    }
+
     status = session->GetMmapPosition(this, position);
-    if (0 != status)
+    if (0 != status) {
         PAL_ERR(LOG_TAG, "session prepare failed with status = %d", status);
+    } else if (currentState == STREAM_STARTED) {
+        mMmapPosModel.addSample(position->time_nanoseconds / 1000,
+                                position->position_frames);
+        position->position_frames = (int32_t)mMmapPosModel.clamp(position->position_frames);
+    }
+unlock:
     mStreamMutex.unlock();
     PAL_DBG(LOG_TAG, "Exit. status - %d", status);
 
@@ -39,6 +39,8 @@
 #include "SessionAlsaPcm.h"
 #include "ResourceManager.h"
 #include "Device.h"
+#include "SensorCaptureSource.h"
+#include "PalEventLoop.h"
 #include <unistd.h>
 
 StreamSensorPCMData::StreamSensorPCMData(const struct pal_stream_attributes *sattr __unused,
@@ -46,12 +48,19 @@ StreamSensorPCMData::StreamSensorPCMData(const struct pal_stream_attributes *sat
                     const uint32_t no_of_devices __unused,
                     const struct modifier_kv *modifiers __unused,
                     const uint32_t no_of_modifiers __unused,
-                    const std::shared_ptr<ResourceManager> rm):
+                    const std::shared_ptr<ResourceManager> rm,
+                    bool is_capture_source):
                     StreamCommon(sattr,dattr,no_of_devices,modifiers,no_of_modifiers,rm)
 {
     int32_t enable_concurrency_count = 0;
     int32_t disable_concurrency_count = 0;
     paused_ = false;
+    effect_ = PAL_AUDIO_EFFECT_NONE;
+    capture_src_ = nullptr;
+    shared_start_pending_ = false;
+    memset(&capture_dev_attr_, 0, sizeof(capture_dev_attr_));
+    if (dattr && no_of_devices)
+        capture_dev_attr_ = dattr[0];
 
     PAL_DBG(LOG_TAG, "Enter");
     /* get ACD platform info */
@@ -61,6 +70,9 @@ StreamSensorPCMData::StreamSensorPCMData(const struct pal_stream_attributes *sat
         throw std::runtime_error("Failed to get acd platform info");
     }
 
+    use_shared_capture_ = !is_capture_source &&
+                          acd_info_->IsSharedSensorCaptureEnabled();
+
     rm->registerStream(this);
     /* Print the concurrency feature flags supported */
     PAL_INFO(LOG_TAG, "capture conc enable %d,voice conc enable %d,voip conc enable %d",
@@ -92,6 +104,10 @@ StreamSensorPCMData::StreamSensorPCMData(const struct pal_stream_attributes *sat
 StreamSensorPCMData::~StreamSensorPCMData()
 {
     PAL_DBG(LOG_TAG, "Enter");
+    if (capture_src_) {
+        SensorCaptureSource::Release(SensorCaptureSource::Detach(capture_src_, this));
+        capture_src_ = nullptr;
+    }
     rm->resetStreamInstanceID(this);
     rm->deregisterStream(this);
     mDevices.clear();
@@ -174,6 +190,11 @@ int32_t StreamSensorPCMData::start()
             session, currentState, paused_ ? "True" : "False");
 
     std::lock_guard<std::mutex> lck(mStreamMutex);
+    if (use_shared_capture_) {
+        status = startSharedCapture();
+        goto exit;
+    }
+
     if (true == paused_) {
         PAL_DBG(LOG_TAG,"concurrency is not supported, start the stream later");
         goto exit;
@@ -269,13 +290,25 @@ int32_t StreamSensorPCMData::stop()
 {
     int32_t status = 0;
     bool backend_update = false;
+    std::shared_ptr<SensorCaptureSource> released = nullptr;
 
     PAL_DBG(LOG_TAG, "Enter. session handle: %pK, state: %d, paused_: %s",
             session, currentState, paused_ ? "True" : "False");
 
-    std::lock_guard<std::mutex> lck(mStreamMutex);
+    std::unique_lock<std::mutex> lck(mStreamMutex);
 
-    if (currentState == STREAM_STARTED || currentState == STREAM_PAUSED) {
+    if (use_shared_capture_ && (capture_src_ || shared_start_pending_)) {
+        if (capture_src_)
+            released = SensorCaptureSource::Detach(capture_src_, this);
+        capture_src_ = nullptr;
+        shared_start_pending_ = false;
+        currentState = STREAM_STOPPED;
+        /* the last client closes the capture stream without its lock */
+        if (released) {
+            lck.unlock();
+            SensorCaptureSource::Release(released);
+        }
+    } else if (currentState == STREAM_STARTED || currentState == STREAM_PAUSED) {
         /* Do not update capture profile when pausing stream */
         if (false == paused_) {
             backend_update = rm->UpdateSoundTriggerCaptureProfile(this, false);
@@ -327,14 +360,47 @@ int32_t StreamSensorPCMData::stop()
 int32_t StreamSensorPCMData::Resume()
 {
     int32_t status = 0;
+    PalEventLoop *loop = NULL;
 
     PAL_DBG(LOG_TAG, "Enter");
 
+    /*
+     * The shared capture stream is resumed by RM on its own. A client start
+     * deferred by concurrency attaches from the event loop, as attaching may
+     * register a new capture stream, which needs the active stream lock
+     * that RM holds here.
+     */
+    if (use_shared_capture_) {
+        std::lock_guard<std::mutex> lck(mStreamMutex);
+        paused_ = false;
+        if (!shared_start_pending_)
+            goto exit;
+        loop = PalEventLoop::getInstance();
+        if (!loop) {
+            status = -EINVAL;
+            PAL_ERR(LOG_TAG, "Error:%d no event loop to resume shared capture", status);
+            goto exit;
+        }
+        /* called with the active stream lock held */
+        status = rm->increaseStreamUserCounter(this);
+        if (status) {
+            PAL_ERR(LOG_TAG, "Error:%d failed to increase stream user count", status);
+            goto exit;
+        }
+        if (loop->post([this]() { resumeSharedCapture(); })) {
+            status = -EINVAL;
+            PAL_ERR(LOG_TAG, "Error:%d failed to post shared capture resume", status);
+            rm->decreaseStreamUserCounter(this);
+        }
+        goto exit;
+    }
+
     paused_ = false;
     status = start();
     if (status)
         PAL_ERR(LOG_TAG, "Error:%d Resume Stream failed", status);
 
+exit:
     PAL_DBG(LOG_TAG, "Exit, status %d", status);
     return status;
 }
@@ -345,6 +411,13 @@ int32_t StreamSensorPCMData::Pause()
 
     PAL_DBG(LOG_TAG, "Enter");
 
+    /* the shared capture stream is paused by RM on its own */
+    if (use_shared_capture_) {
+        std::lock_guard<std::mutex> lck(mStreamMutex);
+        paused_ = true;
+        goto exit;
+    }
+
     paused_ = true;
     status = stop();
     if (!status)
@@ -352,10 +425,95 @@ int32_t StreamSensorPCMData::Pause()
     else
         PAL_ERR(LOG_TAG, "Error:%d Pause Stream failed", status);
 
+exit:
     PAL_DBG(LOG_TAG, "Exit, status %d", status);
     return status;
 }
 
+int32_t StreamSensorPCMData::startSharedCapture()
+{
+    int32_t status = 0;
+
+    if (currentState == STREAM_STARTED) {
+        PAL_INFO(LOG_TAG, "Stream already started, state %d", currentState);
+        goto exit;
+    }
+
+    if (currentState != STREAM_INIT && currentState != STREAM_STOPPED &&
+        currentState != STREAM_PAUSED) {
+        PAL_ERR(LOG_TAG, "Error:Stream is not opened yet");
+        status = -EINVAL;
+        goto exit;
+    }
+
+    if (!cap_prof_) {
+        PAL_ERR(LOG_TAG, "Error:%d no capture profile, effect not set", -EINVAL);
+        status = -EINVAL;
+        goto exit;
+    }
+
+    /* same concurrency gate as a stream with its own graph */
+    if (paused_) {
+        PAL_DBG(LOG_TAG, "concurrency is not supported, start the stream later");
+        shared_start_pending_ = true;
+        goto exit;
+    }
+
+    capture_src_ = SensorCaptureSource::Attach(this, &status);
+    if (status == -EAGAIN) {
+        /* the capture source with this key is going down, started after it */
+        PAL_DBG(LOG_TAG, "capture source is closing, start the stream later");
+        capture_src_ = nullptr;
+        shared_start_pending_ = true;
+        status = 0;
+        goto exit;
+    }
+    if (status) {
+        PAL_ERR(LOG_TAG, "Error:%d Failed to attach to shared capture", status);
+        capture_src_ = nullptr;
+        goto exit;
+    }
+    shared_start_pending_ = false;
+    currentState = STREAM_STARTED;
+
+exit:
+    return status;
+}
+
+/* event loop side of Resume(), the stream is pinned by its user counter */
+void StreamSensorPCMData::resumeSharedCapture()
+{
+    int32_t status = 0;
+
+    mStreamMutex.lock();
+    if (shared_start_pending_ && !paused_) {
+        status = startSharedCapture();
+        if (status)
+            PAL_ERR(LOG_TAG, "Error:%d deferred shared capture start failed", status);
+    }
+    mStreamMutex.unlock();
+
+    rm->lockActiveStream();
+    rm->decreaseStreamUserCounter(this);
+    rm->unlockActiveStream();
+}
+
+/*
+ * Capture device and profile follow global state (headset availability,
+ * LPI), so clients only differ in effect and media config.
+ */
+std::string StreamSensorPCMData::GetCaptureSourceKey()
+{
+    char key[64];
+
+    snprintf(key, sizeof(key), "effect:%u-sr:%u-ch:%u-bw:%u",
+             pcm_data_stream_effect,
+             mStreamAttr->in_media_config.sample_rate,
+             mStreamAttr->in_media_config.ch_info.channels,
+             mStreamAttr->in_media_config.bit_width);
+    return std::string(key);
+}
+
 void StreamSensorPCMData::GetUUID(class SoundTriggerUUID *uuid,
                                   const struct st_uuid *vendor_uuid)
 {
@@ -490,6 +648,8 @@ int32_t StreamSensorPCMData::addRemoveEffect(pal_audio_effect_t effect, bool ena
         goto exit;
     }
 
+    effect_ = effect;
+
     /* Use QC Sensor PCM Data as default streamConfig */
     status = SetupStreamConfig(&qc_sensor_pcm_data_uuid);
     if (status)
@@ -520,8 +680,8 @@ int32_t StreamSensorPCMData::HandleConcurrentStream(bool active)
     if (active == false)
         mStreamMutex.lock();
 
-    if (currentState != STREAM_STARTED) {
-        PAL_INFO(LOG_TAG, "Stream is not in started state");
+    if (currentState != STREAM_STARTED || use_shared_capture_) {
+        PAL_INFO(LOG_TAG, "Stream is not in started state or uses shared capture");
         if (active == true)
             mStreamMutex.unlock();
         return status;
@@ -591,6 +751,11 @@ int32_t StreamSensorPCMData::DisconnectDevice_l(pal_device_id_t device_id)
     int32_t status = 0;
 
     PAL_DBG(LOG_TAG, "Enter, device_id: %d", device_id);
+    if (use_shared_capture_) {
+        PAL_DBG(LOG_TAG, "device switch handled by shared capture stream");
+        goto exit;
+    }
+
     if (mDevices[0]->getSndDeviceId() != device_id) {
         PAL_ERR(LOG_TAG, "Error:%d Device %d not connected, ignore",
                 -EINVAL, device_id);
@@ -650,6 +815,10 @@ int32_t StreamSensorPCMData::ConnectDevice_l(pal_device_id_t device_id)
     std::shared_ptr<Device> device = nullptr;
 
     PAL_DBG(LOG_TAG, "Enter, device_id: %d", device_id);
+    if (use_shared_capture_) {
+        PAL_DBG(LOG_TAG, "device switch handled by shared capture stream");
+        goto connect_err;
+    }
 
     device = GetPalDevice(this, device_id);
     if (!device) {
@@ -753,6 +922,9 @@ int32_t StreamSensorPCMData::setECRef(std::shared_ptr<Device> dev, bool is_enabl
 {
     int32_t status = 0;
 
+    if (use_shared_capture_)
+        return status;
+
     std::lock_guard<std::mutex> lck(mStreamMutex);
     if (!use_lpi_)
         status = setECRef_l(dev, is_enable);
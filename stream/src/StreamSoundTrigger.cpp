@@ -73,6 +73,7 @@
 #include "Device.h"
 #include "kvh2xml.h"
 #include "VoiceUIInterface.h"
+#include "PalEventLoop.h"
 
 // TODO: find another way to print debug logs by default
 #define ST_DBG_LOGS
@@ -227,26 +228,29 @@ StreamSoundTrigger::StreamSoundTrigger(struct pal_stream_attributes *sattr,
         paused_ = true;
     }
 
-    timer_thread_ = std::thread(TimerThread, std::ref(*this));
-    timer_stop_waiting_ = false;
-    exit_timer_thread_ = false;
+    /* deferred stop runs on the shared event loop, armed on demand */
+    delayed_stop_timer_ = 0;
+    if (PalEventLoop::getInstance())
+        delayed_stop_timer_ = PalEventLoop::getInstance()->addTimer(0, 0,
+            [this]() { InternalStopRecognition(); });
+    if (delayed_stop_timer_ <= 0)
+        PAL_ERR(LOG_TAG, "failed to create deferred stop timer %d", delayed_stop_timer_);
 
     PAL_DBG(LOG_TAG, "Exit");
 }
 
 StreamSoundTrigger::~StreamSoundTrigger() {
-    mStreamMutex.lock();
-    {
-        std::lock_guard<std::mutex> lck(timer_mutex_);
-        exit_timer_thread_ = true;
-        timer_stop_waiting_ = true;
-        timer_wait_cond_.notify_one();
-        timer_start_cond_.notify_one();
-    }
-    if (timer_thread_.joinable()) {
-        PAL_DBG(LOG_TAG, "Join timer thread");
-        timer_thread_.join();
+    /*
+     * Cancel before taking the stream lock, a running deferred stop
+     * needs it and cancelTimer waits for the handler to return.
+     */
+    if (delayed_stop_timer_ > 0) {
+        PAL_DBG(LOG_TAG, "Cancel deferred stop timer");
+        if (PalEventLoop::getInstance())
+            PalEventLoop::getInstance()->cancelTimer(delayed_stop_timer_);
+        delayed_stop_timer_ = 0;
     }
+    mStreamMutex.lock();
 
     st_states_.clear();
     engines_.clear();
@@ -906,52 +910,48 @@ int32_t StreamSoundTrigger::SetEngineDetectionState(int32_t det_type) {
 
 void StreamSoundTrigger::InternalStopRecognition() {
     int32_t status = 0;
+    int64_t remaining_ms = 0;
 
     PAL_DBG(LOG_TAG, "Enter");
     std::lock_guard<std::mutex> lck(mStreamMutex);
     if (pending_stop_) {
+        /*
+         * disarmTimer does not drop a fire that is already queued, so this
+         * may belong to a stop cancelled and posted again since.
+         */
+        remaining_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            pending_stop_deadline_ - std::chrono::steady_clock::now()).count();
+        if (remaining_ms > 0) {
+            PAL_DBG(LOG_TAG, "stale deferred stop, %lld ms left",
+                    (long long)remaining_ms);
+            if (delayed_stop_timer_ > 0 && PalEventLoop::getInstance())
+                PalEventLoop::getInstance()->armTimer(delayed_stop_timer_,
+                                                      remaining_ms);
+            goto exit;
+        }
         std::shared_ptr<StEventConfig> ev_cfg(
            new StStopRecognitionEventConfig(true));
         status = cur_state_->ProcessEvent(ev_cfg);
     }
+exit:
     PAL_DBG(LOG_TAG, "Exit, status %d", status);
 }
 
-void StreamSoundTrigger::TimerThread(StreamSoundTrigger& st_stream) {
-    PAL_DBG(LOG_TAG, "Enter");
-
-    std::unique_lock<std::mutex> lck(st_stream.timer_mutex_);
-    while (!st_stream.exit_timer_thread_) {
-        st_stream.timer_start_cond_.wait(lck);
-        if (st_stream.exit_timer_thread_)
-            break;
-
-        st_stream.timer_wait_cond_.wait_for(lck,
-            std::chrono::milliseconds(ST_DEFERRED_STOP_DEALY_MS));
-
-        if (!st_stream.timer_stop_waiting_ && !st_stream.exit_timer_thread_) {
-            st_stream.timer_mutex_.unlock();
-            st_stream.InternalStopRecognition();
-            st_stream.timer_mutex_.lock();
-        }
-    }
-    PAL_DBG(LOG_TAG, "Exit");
-}
-
 void StreamSoundTrigger::PostDelayedStop() {
     PAL_VERBOSE(LOG_TAG, "Post Delayed Stop for %p", this);
     pending_stop_ = true;
-    std::lock_guard<std::mutex> lck(timer_mutex_);
-    timer_stop_waiting_ = false;
-    timer_start_cond_.notify_one();
+    pending_stop_deadline_ = std::chrono::steady_clock::now() +
+        std::chrono::milliseconds(ST_DEFERRED_STOP_DEALY_MS);
+    if (delayed_stop_timer_ > 0 && PalEventLoop::getInstance())
+        PalEventLoop::getInstance()->armTimer(delayed_stop_timer_,
+                                              ST_DEFERRED_STOP_DEALY_MS);
 }
 
 void StreamSoundTrigger::CancelDelayedStop() {
     PAL_VERBOSE(LOG_TAG, "Cancel Delayed stop for %p", this);
     pending_stop_ = false;
-    std::lock_guard<std::mutex> lck(timer_mutex_);
-    timer_stop_waiting_ = true;
-    timer_wait_cond_.notify_one();
+    if (delayed_stop_timer_ > 0 && PalEventLoop::getInstance())
+        PalEventLoop::getInstance()->disarmTimer(delayed_stop_timer_);
 }
 
 std::shared_ptr<SoundTriggerEngine> StreamSoundTrigger::HandleEngineLoad(
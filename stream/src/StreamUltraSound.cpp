@@ -38,21 +38,51 @@
 #include "SessionAlsaPcm.h"
 #include "ResourceManager.h"
 #include "Device.h"
+#include "PalEventLoop.h"
 #include "us_detect_api.h"
+#include <time.h>
 #include <unistd.h>
 
+static int64_t nowUs()
+{
+    struct timespec ts = {0, 0};
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
 StreamUltraSound::StreamUltraSound(const struct pal_stream_attributes *sattr __unused, struct pal_device *dattr __unused,
                     const uint32_t no_of_devices __unused, const struct modifier_kv *modifiers __unused,
                     const uint32_t no_of_modifiers __unused, const std::shared_ptr<ResourceManager> rm):
                   StreamCommon(sattr,dattr,no_of_devices,modifiers,no_of_modifiers,rm)
 {
     gain = PAL_ULTRASOUND_GAIN_MUTE;
+    targetGain = PAL_ULTRASOUND_GAIN_MUTE;
+    cadence = {0, 0};
+    dutyCycling = false;
+    sleeping = false;
+    wakeDueUs = 0;
+    wakeCount = 0;
+    wakeLatencySumUs = 0;
+    wakeLatencyMaxUs = 0;
+    cadenceTimer = 0;
+    if (PalEventLoop::getInstance())
+        cadenceTimer = PalEventLoop::getInstance()->addTimer(0, 0,
+            [this]() { onWindowBoundary(); });
+    if (cadenceTimer <= 0)
+        PAL_ERR(LOG_TAG, "failed to create duty cycle timer %d", cadenceTimer);
     session->registerCallBack((session_callback)HandleCallBack,((uint64_t) this));
     rm->registerStream(this);
 }
 
 StreamUltraSound::~StreamUltraSound()
 {
+    /* a running window boundary takes the stream lock, cancel waits for it */
+    if (cadenceTimer > 0) {
+        if (PalEventLoop::getInstance())
+            PalEventLoop::getInstance()->cancelTimer(cadenceTimer);
+        cadenceTimer = 0;
+    }
     rm->resetStreamInstanceID(this);
     rm->deregisterStream(this);
 }
@@ -105,6 +135,13 @@ int32_t StreamUltraSound::start()
     PAL_INFO(LOG_TAG, "Ultrasound gain(%d) set sucessfully", gain);
 
 skip_upd_set_gain:
+    if (rm->IsCustomGainEnabledForUPD()) {
+        mStreamMutex.lock();
+        /* gain to come back to after a sleep window */
+        targetGain = gain;
+        startDutyCycle_l();
+        mStreamMutex.unlock();
+    }
     PAL_DBG(LOG_TAG, "Exit status: %d", status);
     return status;
 }
@@ -119,6 +156,8 @@ int32_t StreamUltraSound::stop()
 
     if (rm->IsCustomGainEnabledForUPD()) {
         mStreamMutex.lock();
+        /* muting anyway, no need to wake from a sleep window first */
+        stopDutyCycle_l(false);
         if (currentState == STREAM_STARTED || currentState == STREAM_PAUSED) {
 
             status = setUltraSoundGain_l(PAL_ULTRASOUND_GAIN_MUTE);
@@ -167,6 +206,30 @@ int32_t  StreamUltraSound::setParameters(uint32_t param_id, void *payload)
                 status);
             break;
         }
+        case PAL_PARAM_ID_UPD_DUTY_CYCLE_CADENCE:
+        {
+            pal_param_payload *param_payload = (pal_param_payload *)payload;
+
+            if (param_payload->payload_size != sizeof(pal_param_upd_cadence_t)) {
+                PAL_ERR(LOG_TAG, "Incorrect size : expected (%zu), received(%u)",
+                        sizeof(pal_param_upd_cadence_t), param_payload->payload_size);
+                status = -EINVAL;
+                break;
+            }
+            /* sleep windows mute the emitter through the custom gain */
+            if (!rm->IsCustomGainEnabledForUPD() || cadenceTimer <= 0) {
+                PAL_ERR(LOG_TAG, "Duty cycling needs custom gain for UPD");
+                status = -EINVAL;
+                break;
+            }
+            stopDutyCycle_l(true);
+            cadence = *(pal_param_upd_cadence_t *)param_payload->payload;
+            PAL_INFO(LOG_TAG, "duty cycle cadence active %u ms sleep %u ms",
+                     cadence.active_ms, cadence.sleep_ms);
+            if (currentState == STREAM_STARTED)
+                startDutyCycle_l();
+            break;
+        }
         default:
             PAL_ERR(LOG_TAG, "Error:Unsupported param id %u", param_id);
             status = -EINVAL;
@@ -187,13 +250,16 @@ void StreamUltraSound::HandleEvent(uint32_t event_id, void *data, uint32_t event
     PAL_INFO(LOG_TAG, "%s event received %d",
             (event_type == US_DETECT_NEAR)? "NEAR": "FAR", event_type);
 
+    mStreamMutex.lock();
+    /* the proximity state moved, stay awake for another active window */
+    if (dutyCycling && !sleeping && PalEventLoop::getInstance())
+        PalEventLoop::getInstance()->armTimer(cadenceTimer, cadence.active_ms);
     if (callback_) {
         PAL_INFO(LOG_TAG, "Notify detection event to client");
-        mStreamMutex.lock();
         callback_((pal_stream_handle_t *)this, event_id, &event_type,
                   event_size, cookie_);
-        mStreamMutex.unlock();
     }
+    mStreamMutex.unlock();
 }
 
 void StreamUltraSound::HandleCallBack(uint64_t hdl, uint32_t event_id,
@@ -231,7 +297,6 @@ int32_t StreamUltraSound::setUltraSoundGain(pal_ultrasound_gain_t new_gain)
 int32_t StreamUltraSound::setUltraSoundGain_l(pal_ultrasound_gain_t new_gain)
 {
     int32_t status = 0;
-    pal_ultrasound_gain_t mute = PAL_ULTRASOUND_GAIN_MUTE;
 
     if (!rm->IsCustomGainEnabledForUPD()) {
         PAL_ERR(LOG_TAG,"Custom Gain not enabled for UPD, returning");
@@ -240,6 +305,26 @@ int32_t StreamUltraSound::setUltraSoundGain_l(pal_ultrasound_gain_t new_gain)
 
     PAL_DBG(LOG_TAG, "Received request to set Ultrasound gain(%d)", new_gain);
 
+    if (dutyCycling) {
+        targetGain = new_gain;
+        /* Mute goes out right away, so does the gain after a device switch
+         * muted the active window. Other changes are batched, the next
+         * active window starts with them. */
+        if (sleeping || ((new_gain != PAL_ULTRASOUND_GAIN_MUTE) &&
+                         (gain != PAL_ULTRASOUND_GAIN_MUTE))) {
+            PAL_DBG(LOG_TAG, "Ultrasound gain(%d) deferred to next window", new_gain);
+            return status;
+        }
+    }
+
+    return applyUltraSoundGain_l(new_gain);
+}
+
+int32_t StreamUltraSound::applyUltraSoundGain_l(pal_ultrasound_gain_t new_gain)
+{
+    int32_t status = 0;
+    pal_ultrasound_gain_t mute = PAL_ULTRASOUND_GAIN_MUTE;
+
     if (gain != new_gain) {
 
         if ((gain != PAL_ULTRASOUND_GAIN_MUTE) && (new_gain != PAL_ULTRASOUND_GAIN_MUTE)) {
@@ -274,3 +359,108 @@ int32_t StreamUltraSound::setUltraSoundGain_l(pal_ultrasound_gain_t new_gain)
     }
     return status;
 }
+
+void StreamUltraSound::handleScreenState(bool screen_on)
+{
+    mStreamMutex.lock();
+    /* screen on needs a prompt NEAR, run continuously until it goes off */
+    if (screen_on)
+        stopDutyCycle_l(true);
+    else if (currentState == STREAM_STARTED)
+        startDutyCycle_l();
+    mStreamMutex.unlock();
+}
+
+void StreamUltraSound::startDutyCycle_l()
+{
+    if (dutyCycling || !cadence.active_ms || !cadence.sleep_ms || cadenceTimer <= 0)
+        return;
+    if (!rm->IsCustomGainEnabledForUPD() || rm->getScreenState())
+        return;
+
+    PAL_DBG(LOG_TAG, "start duty cycle, active %u ms sleep %u ms",
+            cadence.active_ms, cadence.sleep_ms);
+    /* start() skips the gain when no device is active, make sleep mute real */
+    if (gain != targetGain)
+        applyUltraSoundGain_l(targetGain);
+    dutyCycling = true;
+    sleeping = false;
+    wakeCount = 0;
+    wakeLatencySumUs = 0;
+    wakeLatencyMaxUs = 0;
+    if (PalEventLoop::getInstance())
+        PalEventLoop::getInstance()->armTimer(cadenceTimer, cadence.active_ms);
+}
+
+void StreamUltraSound::stopDutyCycle_l(bool wake)
+{
+    if (!dutyCycling)
+        return;
+
+    /* a boundary already waiting on the stream lock sees dutyCycling false */
+    if (PalEventLoop::getInstance())
+        PalEventLoop::getInstance()->disarmTimer(cadenceTimer);
+    if (sleeping && wake) {
+        wakeDueUs = nowUs();
+        wake_l();
+    }
+    dutyCycling = false;
+    sleeping = false;
+    if (wakeCount)
+        PAL_INFO(LOG_TAG, "duty cycle stopped, %u wakes, latency avg %lld us max %lld us",
+                 wakeCount, (long long)(wakeLatencySumUs / wakeCount),
+                 (long long)wakeLatencyMaxUs);
+}
+
+void StreamUltraSound::wake_l()
+{
+    int64_t latency = 0;
+    int32_t status = 0;
+
+    status = applyUltraSoundGain_l(targetGain);
+    if (status)
+        PAL_ERR(LOG_TAG, "failed to wake with gain %d, status %d", targetGain, status);
+    sleeping = false;
+
+    /* from the end of the sleep window until the emitter is back on */
+    latency = nowUs() - wakeDueUs;
+    wakeCount++;
+    wakeLatencySumUs += latency;
+    if (latency > wakeLatencyMaxUs)
+        wakeLatencyMaxUs = latency;
+    PAL_DBG(LOG_TAG, "woke with gain %d, latency %lld us", targetGain, (long long)latency);
+}
+
+void StreamUltraSound::onWindowBoundary()
+{
+    int32_t status = 0;
+
+    mStreamMutex.lock();
+    if (!dutyCycling)
+        goto exit;
+    if (currentState != STREAM_STARTED) {
+        stopDutyCycle_l(false);
+        goto exit;
+    }
+
+    if (sleeping) {
+        wake_l();
+        if (PalEventLoop::getInstance())
+            PalEventLoop::getInstance()->armTimer(cadenceTimer, cadence.active_ms);
+    } else {
+        status = applyUltraSoundGain_l(PAL_ULTRASOUND_GAIN_MUTE);
+        if (status) {
+            /* emitter state unknown, keep it running rather than guess */
+            PAL_ERR(LOG_TAG, "failed to enter sleep window, status %d", status);
+            dutyCycling = false;
+            goto exit;
+        }
+        sleeping = true;
+        wakeDueUs = nowUs() + cadence.sleep_ms * 1000LL;
+        if (PalEventLoop::getInstance())
+            PalEventLoop::getInstance()->armTimer(cadenceTimer, cadence.sleep_ms);
+    }
+
+exit:
+    mStreamMutex.unlock();
+}
@@ -0,0 +1,563 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+/*
+ * PalReplay - replays a trace written by a libar-pal built with
+ * PAL_API_RECORDER and reports per api latency.
+ *
+ *   PalReplay [-f] [-n loops] <trace>
+ *
+ * Each recorded thread is replayed on a thread of its own. A call is issued
+ * once all calls that started before it have been issued and the open of
+ * its stream has returned, so calls that overlapped in the recording
+ * overlap again. By default the recorded gaps between calls are kept, -f
+ * issues them back to back. Write and read, single or batched, use zeroed
+ * buffers of the recorded sizes, dump state goes to /dev/null. Get param
+ * calls are issued with the payload the caller passed in, payloads PAL
+ * returns are not freed as several point into PAL state. Gef read and acdb
+ * param calls are counted but not issued, calls whose payload was
+ * truncated by the recorder are skipped.
+ *
+ * Built with the replay stub backend (--with-replay-stub) the trace runs
+ * on a host without audio hardware.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "PalApi.h"
+#include "PalApiRecorder.h"
+
+static const char *apiNames[PAL_API_MAX] = {
+    "",
+    "stream_open",
+    "stream_close",
+    "stream_start",
+    "stream_stop",
+    "stream_write",
+    "stream_read",
+    "stream_get_param",
+    "stream_set_param",
+    "stream_set_volume",
+    "stream_set_mute",
+    "stream_pause",
+    "stream_resume",
+    "stream_drain",
+    "stream_flush",
+    "stream_suspend",
+    "get_timestamp",
+    "add_remove_effect",
+    "stream_set_device",
+    "set_param",
+    "get_param",
+    "stream_write_batch",
+    "stream_read_batch",
+    "set_volume_async",
+    "set_mute_async",
+    "get_ts_drift",
+    "get_tags_module_info",
+    "get_mmap_position",
+    "create_mmap_buffer",
+    "dump_state",
+    "register_global_cb",
+    "gef_rw_param",
+    "gef_rw_param_acdb",
+};
+
+struct replay_call {
+    struct pal_api_trace_record rec;
+    std::vector<uint8_t> blob;
+};
+
+struct replay_stats {
+    std::vector<int64_t> latency_ns;
+    uint32_t failed;
+    uint32_t status_mismatch;
+    uint32_t skipped;
+};
+
+/* shared by the replay threads, lock guards everything below it */
+struct replay_state {
+    std::vector<struct replay_call> calls;
+    std::vector<long> opener;      /* index of the open a call depends on, -1 none */
+    bool fast;
+    int64_t base;
+    std::mutex lock;
+    std::condition_variable cv;
+    size_t issued;
+    std::vector<bool> done;
+    std::map<uint64_t, pal_stream_handle_t *> handles;
+    std::vector<struct replay_stats> stats;
+};
+
+static int64_t nowNs()
+{
+    struct timespec ts = {0, 0};
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int32_t replayCallback(pal_stream_handle_t *stream_handle, uint32_t event_id,
+                              uint32_t *event_data, uint32_t event_data_size,
+                              uint64_t cookie)
+{
+    return 0;
+}
+
+static int32_t replayGlobalCallback(uint32_t event_id, uint32_t *event_data,
+                                    uint64_t cookie)
+{
+    return 0;
+}
+
+static int loadTrace(const char *path, std::vector<struct replay_call> &calls)
+{
+    struct pal_api_trace_header header;
+    struct replay_call call;
+    FILE *fp = NULL;
+    int status = 0;
+
+    fp = fopen(path, "rb");
+    if (!fp) {
+        fprintf(stderr, "cannot open %s: %s\n", path, strerror(errno));
+        return -errno;
+    }
+
+    if (fread(&header, sizeof(header), 1, fp) != 1 ||
+        header.magic != PAL_API_TRACE_MAGIC ||
+        header.version != PAL_API_TRACE_VERSION) {
+        fprintf(stderr, "%s is not a version %d PAL api trace\n", path,
+                PAL_API_TRACE_VERSION);
+        status = -EINVAL;
+        goto exit;
+    }
+
+    while (fread(&call.rec, sizeof(call.rec), 1, fp) == 1) {
+        if (call.rec.api == 0 || call.rec.api >= PAL_API_MAX ||
+            call.rec.blob_size > PAL_API_TRACE_MAX_BLOB) {
+            fprintf(stderr, "corrupt record %zu\n", calls.size());
+            status = -EINVAL;
+            goto exit;
+        }
+        call.blob.resize(call.rec.blob_size);
+        if (call.rec.blob_size &&
+            fread(call.blob.data(), call.rec.blob_size, 1, fp) != 1) {
+            /* recording cut short, keep what is complete */
+            break;
+        }
+        calls.push_back(call);
+    }
+    /* records are in completion order */
+    std::stable_sort(calls.begin(), calls.end(),
+                     [](const struct replay_call &a, const struct replay_call &b) {
+                         if (a.rec.seq != b.rec.seq)
+                             return a.rec.seq < b.rec.seq;
+                         return a.rec.start_ns < b.rec.start_ns;
+                     });
+
+exit:
+    fclose(fp);
+    return status;
+}
+
+static int32_t replayOpen(const struct replay_call &call, struct replay_state &st)
+{
+    const uint8_t *data = call.blob.data();
+    size_t need = sizeof(struct pal_stream_attributes) +
+                  call.rec.arg * sizeof(struct pal_device) +
+                  call.rec.arg2 * sizeof(struct modifier_kv);
+    struct pal_stream_attributes *attr = NULL;
+    struct pal_device *devices = NULL;
+    struct modifier_kv *modifiers = NULL;
+    pal_stream_handle_t *handle = NULL;
+    int32_t status = 0;
+
+    if (call.blob.size() < need)
+        return -EINVAL;
+
+    attr = (struct pal_stream_attributes *)data;
+    data += sizeof(*attr);
+    if (call.rec.arg)
+        devices = (struct pal_device *)data;
+    data += call.rec.arg * sizeof(struct pal_device);
+    if (call.rec.arg2)
+        modifiers = (struct modifier_kv *)data;
+
+    status = pal_stream_open(attr, call.rec.arg, devices, call.rec.arg2, modifiers,
+                             replayCallback, 0, &handle);
+    if (!status) {
+        std::lock_guard<std::mutex> lock(st.lock);
+        st.handles[call.rec.result_handle] = handle;
+    }
+    return status;
+}
+
+/* returns 1 when the call is not issued */
+static int replayCall(const struct replay_call &call, struct replay_state &st,
+                      std::vector<uint8_t> &scratch, int32_t *status)
+{
+    pal_stream_handle_t *handle = NULL;
+    pal_param_payload *payload = NULL;
+    pal_param_payload *paramOut = NULL;
+    void *globalOut = NULL;
+    size_t size = 0;
+    struct pal_buffer buf;
+    struct pal_session_time stime;
+    struct pal_mmap_position position;
+    struct pal_mmap_buffer mmapBuf;
+    std::vector<struct pal_buffer> bufs;
+    const size_t *sizes = NULL;
+    const uint32_t *target = NULL;
+    size_t total = 0;
+    int32_t drift = 0;
+    int fd = -1;
+    ssize_t bytes = 0;
+
+    if (call.rec.flags & PAL_API_TRACE_FLAG_BLOB_TRUNCATED)
+        return 1;
+    if (call.rec.handle) {
+        std::lock_guard<std::mutex> lock(st.lock);
+        auto it = st.handles.find(call.rec.handle);
+        if (it == st.handles.end())
+            return 1;
+        handle = it->second;
+        if (call.rec.api == PAL_API_STREAM_CLOSE)
+            st.handles.erase(it);
+    }
+
+    switch (call.rec.api) {
+    case PAL_API_STREAM_OPEN:
+        *status = replayOpen(call, st);
+        break;
+    case PAL_API_STREAM_CLOSE:
+        *status = pal_stream_close(handle);
+        break;
+    case PAL_API_STREAM_START:
+        *status = pal_stream_start(handle);
+        break;
+    case PAL_API_STREAM_STOP:
+        *status = pal_stream_stop(handle);
+        break;
+    case PAL_API_STREAM_WRITE:
+    case PAL_API_STREAM_READ:
+        if (scratch.size() < call.rec.arg)
+            scratch.resize(call.rec.arg);
+        memset(&buf, 0, sizeof(buf));
+        buf.buffer = scratch.data();
+        buf.size = call.rec.arg;
+        if (call.rec.api == PAL_API_STREAM_WRITE)
+            bytes = pal_stream_write(handle, &buf);
+        else
+            bytes = pal_stream_read(handle, &buf);
+        *status = (int32_t)bytes;
+        break;
+    case PAL_API_STREAM_GET_PARAM:
+        if (call.blob.size() >= sizeof(*payload)) {
+            payload = (pal_param_payload *)calloc(1, call.blob.size());
+            if (!payload)
+                return 1;
+            memcpy(payload, call.blob.data(), call.blob.size());
+            payload->payload_size = call.blob.size() - sizeof(*payload);
+            paramOut = payload;
+        }
+        *status = pal_stream_get_param(handle, call.rec.arg, &paramOut);
+        free(payload);
+        break;
+    case PAL_API_GET_PARAM:
+        size = call.rec.arg2;
+        if (call.blob.size()) {
+            if (scratch.size() < std::max(size, call.blob.size()))
+                scratch.resize(std::max(size, call.blob.size()));
+            memcpy(scratch.data(), call.blob.data(), call.blob.size());
+            globalOut = scratch.data();
+        }
+        *status = pal_get_param(call.rec.arg, &globalOut, &size, NULL);
+        break;
+    case PAL_API_GET_TAGS_WITH_MODULE_INFO:
+        size = call.rec.arg;
+        if (scratch.size() < size)
+            scratch.resize(size);
+        *status = pal_stream_get_tags_with_module_info(handle, &size,
+                                                       size ? scratch.data() : NULL);
+        break;
+    case PAL_API_STREAM_SET_PARAM:
+        payload = (pal_param_payload *)calloc(1, sizeof(*payload) + call.blob.size());
+        if (!payload)
+            return 1;
+        payload->payload_size = call.blob.size();
+        memcpy(payload->payload, call.blob.data(), call.blob.size());
+        *status = pal_stream_set_param(handle, call.rec.arg, payload);
+        free(payload);
+        break;
+    case PAL_API_STREAM_SET_VOLUME:
+        if (call.blob.size() < sizeof(struct pal_volume_data))
+            return 1;
+        *status = pal_stream_set_volume(handle,
+                                        (struct pal_volume_data *)call.blob.data());
+        break;
+    case PAL_API_STREAM_SET_MUTE:
+        *status = pal_stream_set_mute(handle, call.rec.arg);
+        break;
+    case PAL_API_STREAM_PAUSE:
+        *status = pal_stream_pause(handle);
+        break;
+    case PAL_API_STREAM_RESUME:
+        *status = pal_stream_resume(handle);
+        break;
+    case PAL_API_STREAM_DRAIN:
+        *status = pal_stream_drain(handle, (pal_drain_type_t)call.rec.arg);
+        break;
+    case PAL_API_STREAM_FLUSH:
+        *status = pal_stream_flush(handle);
+        break;
+    case PAL_API_STREAM_SUSPEND:
+        *status = pal_stream_suspend(handle);
+        break;
+    case PAL_API_GET_TIMESTAMP:
+        *status = pal_get_timestamp(handle, &stime);
+        break;
+    case PAL_API_ADD_REMOVE_EFFECT:
+        *status = pal_add_remove_effect(handle, (pal_audio_effect_t)call.rec.arg,
+                                        call.rec.arg2);
+        break;
+    case PAL_API_STREAM_SET_DEVICE:
+        if (call.blob.size() < call.rec.arg * sizeof(struct pal_device))
+            return 1;
+        *status = pal_stream_set_device(handle, call.rec.arg,
+                                        (struct pal_device *)call.blob.data());
+        break;
+    case PAL_API_SET_PARAM:
+        *status = pal_set_param(call.rec.arg, (void *)call.blob.data(),
+                                call.blob.size());
+        break;
+    case PAL_API_STREAM_WRITE_BATCH:
+    case PAL_API_STREAM_READ_BATCH:
+        if (!call.rec.arg || call.blob.size() < call.rec.arg * sizeof(size_t))
+            return 1;
+        sizes = (const size_t *)call.blob.data();
+        for (uint32_t i = 0; i < call.rec.arg; i++)
+            total += sizes[i];
+        if (scratch.size() < total)
+            scratch.resize(total);
+        bufs.resize(call.rec.arg);
+        total = 0;
+        for (uint32_t i = 0; i < call.rec.arg; i++) {
+            memset(&bufs[i], 0, sizeof(bufs[i]));
+            bufs[i].buffer = scratch.data() + total;
+            bufs[i].size = sizes[i];
+            total += sizes[i];
+        }
+        if (call.rec.api == PAL_API_STREAM_WRITE_BATCH)
+            bytes = pal_stream_write_batch(handle, bufs.data(), call.rec.arg);
+        else
+            bytes = pal_stream_read_batch(handle, bufs.data(), call.rec.arg);
+        *status = (int32_t)bytes;
+        break;
+    case PAL_API_STREAM_SET_VOLUME_ASYNC:
+        if (call.blob.size() < sizeof(struct pal_volume_data))
+            return 1;
+        *status = pal_stream_set_volume_async(handle,
+                                              (struct pal_volume_data *)call.blob.data(),
+                                              call.rec.arg);
+        break;
+    case PAL_API_STREAM_SET_MUTE_ASYNC:
+        *status = pal_stream_set_mute_async(handle, call.rec.arg);
+        break;
+    case PAL_API_GET_TIMESTAMP_DRIFT:
+        *status = pal_stream_get_timestamp_drift(handle, &drift);
+        break;
+    case PAL_API_GET_MMAP_POSITION:
+        *status = pal_stream_get_mmap_position(handle, &position);
+        break;
+    case PAL_API_CREATE_MMAP_BUFFER:
+        memset(&mmapBuf, 0, sizeof(mmapBuf));
+        *status = pal_stream_create_mmap_buffer(handle, (int32_t)call.rec.arg, &mmapBuf);
+        break;
+    case PAL_API_DUMP_STATE:
+        fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+        if (fd < 0)
+            return 1;
+        *status = pal_dump_state(fd, (pal_dump_format_t)call.rec.arg);
+        close(fd);
+        break;
+    case PAL_API_REGISTER_GLOBAL_CALLBACK:
+        *status = pal_register_global_callback(call.rec.arg ? replayGlobalCallback : NULL, 0);
+        break;
+    case PAL_API_GEF_RW_PARAM:
+        if (call.rec.arg2 != GEF_PARAM_WRITE || call.blob.size() < 2 * sizeof(uint32_t))
+            return 1;
+        target = (const uint32_t *)call.blob.data();
+        *status = pal_gef_rw_param(call.rec.arg,
+                                   (void *)(call.blob.data() + 2 * sizeof(uint32_t)),
+                                   call.blob.size() - 2 * sizeof(uint32_t),
+                                   (pal_device_id_t)target[0],
+                                   (pal_stream_type_t)target[1], call.rec.arg2);
+        break;
+    default:
+        return 1;
+    }
+    return 0;
+}
+
+static void printStats(std::vector<struct replay_stats> &stats)
+{
+    printf("%-20s %8s %6s %6s %6s %10s %10s %10s %10s %10s\n", "api", "calls",
+           "fail", "diff", "skip", "min_us", "avg_us", "p50_us", "p99_us", "max_us");
+    for (int api = 1; api < PAL_API_MAX; api++) {
+        std::vector<int64_t> &lat = stats[api].latency_ns;
+        int64_t sum = 0;
+
+        if (lat.empty() && !stats[api].skipped)
+            continue;
+        std::sort(lat.begin(), lat.end());
+        for (int64_t ns : lat)
+            sum += ns;
+        if (lat.empty()) {
+            printf("%-20s %8d %6d %6d %6u\n", apiNames[api], 0, 0, 0,
+                   stats[api].skipped);
+            continue;
+        }
+        printf("%-20s %8zu %6u %6u %6u %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+               apiNames[api], lat.size(), stats[api].failed,
+               stats[api].status_mismatch, stats[api].skipped,
+               lat.front() / 1000.0, sum / 1000.0 / lat.size(),
+               lat[lat.size() / 2] / 1000.0, lat[(lat.size() * 99) / 100] / 1000.0,
+               lat.back() / 1000.0);
+    }
+}
+
+/* replays the calls of one recorded thread, idx is in start order */
+static void replayThread(struct replay_state *st, std::vector<size_t> idx)
+{
+    std::vector<uint8_t> scratch;
+    int64_t begin = 0, wait = 0;
+    int32_t status = 0;
+    int skipped = 0;
+
+    for (size_t i : idx) {
+        const struct replay_call &call = st->calls[i];
+
+        {
+            std::unique_lock<std::mutex> lock(st->lock);
+            st->cv.wait(lock, [st, i] {
+                return st->issued == i &&
+                       (st->opener[i] < 0 || st->done[st->opener[i]]);
+            });
+        }
+        if (!st->fast) {
+            wait = st->base + call.rec.start_ns - nowNs();
+            if (wait > 0)
+                usleep(wait / 1000);
+        }
+        {
+            std::lock_guard<std::mutex> lock(st->lock);
+            st->issued++;
+        }
+        st->cv.notify_all();
+
+        begin = nowNs();
+        skipped = replayCall(call, *st, scratch, &status);
+        {
+            std::lock_guard<std::mutex> lock(st->lock);
+            struct replay_stats &stats = st->stats[call.rec.api];
+
+            st->done[i] = true;
+            if (skipped) {
+                stats.skipped++;
+            } else {
+                stats.latency_ns.push_back(nowNs() - begin);
+                if (status)
+                    stats.failed++;
+                if (status != call.rec.status)
+                    stats.status_mismatch++;
+            }
+        }
+        st->cv.notify_all();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    struct replay_state st;
+    std::map<uint32_t, std::vector<size_t>> perThread;
+    std::map<uint64_t, size_t> openOf;
+    std::vector<std::thread> threads;
+    int loops = 1;
+    int32_t status = 0;
+    int opt;
+
+    st.fast = false;
+    while ((opt = getopt(argc, argv, "fn:")) != -1) {
+        switch (opt) {
+        case 'f':
+            st.fast = true;
+            break;
+        case 'n':
+            loops = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-f] [-n loops] <trace>\n", argv[0]);
+            return 1;
+        }
+    }
+    if (optind >= argc || loops <= 0) {
+        fprintf(stderr, "usage: %s [-f] [-n loops] <trace>\n", argv[0]);
+        return 1;
+    }
+
+    if (loadTrace(argv[optind], st.calls))
+        return 1;
+    printf("%zu calls loaded from %s\n", st.calls.size(), argv[optind]);
+
+    /* a call on a stream waits for the open that returned its handle */
+    st.opener.assign(st.calls.size(), -1);
+    for (size_t i = 0; i < st.calls.size(); i++) {
+        const struct pal_api_trace_record &rec = st.calls[i].rec;
+
+        if (rec.handle && openOf.count(rec.handle))
+            st.opener[i] = (long)openOf[rec.handle];
+        if (rec.api == PAL_API_STREAM_OPEN && rec.result_handle)
+            openOf[rec.result_handle] = i;
+        perThread[rec.tid].push_back(i);
+    }
+    st.stats.resize(PAL_API_MAX);
+
+    status = pal_init();
+    if (status) {
+        fprintf(stderr, "pal_init failed %d\n", status);
+        return 1;
+    }
+
+    for (int loop = 0; loop < loops; loop++) {
+        st.issued = 0;
+        st.done.assign(st.calls.size(), false);
+        st.base = nowNs() - (st.calls.empty() ? 0 : st.calls.front().rec.start_ns);
+        for (auto &it : perThread)
+            threads.emplace_back(replayThread, &st, it.second);
+        for (std::thread &t : threads)
+            t.join();
+        threads.clear();
+
+        /* streams left open by a partial trace */
+        for (auto &it : st.handles)
+            pal_stream_close(it.second);
+        st.handles.clear();
+    }
+
+    pal_deinit();
+    printStats(st.stats);
+    return 0;
+}
@@ -0,0 +1,592 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+/*
+ * PalReplayStub - backend for running PalReplay on a Linux host without
+ * audio hardware. libpal is linked against this library instead of
+ * tinyalsa, tinycompress, audioroute and the AGM client, so the ACDB
+ * lookups behind AGM are not made either.
+ *
+ * Mixer controls keep the last value written and read back zeros
+ * otherwise. Pcm streams consume and produce data at the rate of their
+ * config so that write and read latencies look like a real device,
+ * compress streams and AGM sessions accept everything at once.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <tinyalsa/asoundlib.h>
+#include <tinycompress/tinycompress.h>
+#include <audio_route/audio_route.h>
+#include <agm/agm_api.h>
+
+#define STUB_EVENT_WAIT_MS 100
+
+struct mixer_ctl {
+    struct mixer_ctl *next;
+    char *name;
+    uint8_t *data;
+    size_t size;
+};
+
+struct mixer {
+    unsigned int card;
+    struct mixer_ctl *ctls;
+};
+
+struct pcm {
+    struct pcm_config config;
+    unsigned int flags;
+    int64_t start_ns;
+    uint64_t frames;
+};
+
+struct compress {
+    int nonblock;
+};
+
+struct audio_route {
+    unsigned int card;
+};
+
+static pthread_mutex_t stub_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int64_t stub_now_ns(void)
+{
+    struct timespec ts = {0, 0};
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* ---- pcm ---- */
+
+unsigned int pcm_format_to_bits(enum pcm_format format)
+{
+    switch (format) {
+    case PCM_FORMAT_S32_LE:
+    case PCM_FORMAT_S24_LE:
+        return 32;
+    case PCM_FORMAT_S24_3LE:
+        return 24;
+    case PCM_FORMAT_S8:
+        return 8;
+    default:
+        return 16;
+    }
+}
+
+unsigned int pcm_frames_to_bytes(struct pcm *pcm, unsigned int frames)
+{
+    return frames * pcm->config.channels *
+           (pcm_format_to_bits(pcm->config.format) >> 3);
+}
+
+unsigned int pcm_bytes_to_frames(struct pcm *pcm, unsigned int bytes)
+{
+    unsigned int frame = pcm_frames_to_bytes(pcm, 1);
+
+    return frame ? bytes / frame : 0;
+}
+
+struct pcm *pcm_open(unsigned int card, unsigned int device, unsigned int flags,
+                     struct pcm_config *config)
+{
+    struct pcm *pcm = calloc(1, sizeof(*pcm));
+
+    if (!pcm)
+        return NULL;
+    if (config)
+        pcm->config = *config;
+    if (!pcm->config.rate)
+        pcm->config.rate = 48000;
+    if (!pcm->config.channels)
+        pcm->config.channels = 2;
+    pcm->flags = flags;
+    return pcm;
+}
+
+int pcm_close(struct pcm *pcm)
+{
+    free(pcm);
+    return 0;
+}
+
+int pcm_is_ready(struct pcm *pcm)
+{
+    return pcm != NULL;
+}
+
+int pcm_start(struct pcm *pcm)
+{
+    pcm->start_ns = stub_now_ns();
+    pcm->frames = 0;
+    return 0;
+}
+
+int pcm_stop(struct pcm *pcm)
+{
+    pcm->start_ns = 0;
+    return 0;
+}
+
+/* blocks until the device would have played or captured the frames */
+static void pcm_pace(struct pcm *pcm, unsigned int bytes)
+{
+    int64_t due;
+    int64_t now;
+
+    if (!pcm->start_ns)
+        pcm_start(pcm);
+    pcm->frames += pcm_bytes_to_frames(pcm, bytes);
+    due = pcm->start_ns + (int64_t)(pcm->frames * 1000000000ULL / pcm->config.rate);
+    now = stub_now_ns();
+    if (due > now)
+        usleep((due - now) / 1000);
+}
+
+int pcm_write(struct pcm *pcm, const void *data, unsigned int count)
+{
+    pcm_pace(pcm, count);
+    return 0;
+}
+
+int pcm_read(struct pcm *pcm, void *data, unsigned int count)
+{
+    memset(data, 0, count);
+    pcm_pace(pcm, count);
+    return 0;
+}
+
+int pcm_mmap_write(struct pcm *pcm, const void *data, unsigned int count)
+{
+    return pcm_write(pcm, data, count);
+}
+
+int pcm_mmap_read(struct pcm *pcm, void *data, unsigned int count)
+{
+    return pcm_read(pcm, data, count);
+}
+
+int pcm_mmap_begin(struct pcm *pcm, void **areas, unsigned int *offset,
+                   unsigned int *frames)
+{
+    return -ENOSYS;
+}
+
+int pcm_mmap_commit(struct pcm *pcm, unsigned int offset, unsigned int frames)
+{
+    return -ENOSYS;
+}
+
+int pcm_mmap_get_hw_ptr(struct pcm *pcm, unsigned int *hw_ptr, struct timespec *tstamp)
+{
+    int64_t now = stub_now_ns();
+
+    *hw_ptr = pcm->start_ns ?
+        (unsigned int)((now - pcm->start_ns) * pcm->config.rate / 1000000000LL) : 0;
+    if (tstamp) {
+        tstamp->tv_sec = now / 1000000000LL;
+        tstamp->tv_nsec = now % 1000000000LL;
+    }
+    return 0;
+}
+
+int pcm_ioctl(struct pcm *pcm, int request, ...)
+{
+    return -ENOSYS;
+}
+
+int pcm_get_poll_fd(struct pcm *pcm)
+{
+    return -1;
+}
+
+unsigned int pcm_get_buffer_size(struct pcm *pcm)
+{
+    return pcm->config.period_size * pcm->config.period_count;
+}
+
+/* ---- mixer ---- */
+
+struct mixer *mixer_open(unsigned int card)
+{
+    struct mixer *mixer = calloc(1, sizeof(*mixer));
+
+    if (mixer)
+        mixer->card = card;
+    return mixer;
+}
+
+void mixer_close(struct mixer *mixer)
+{
+    struct mixer_ctl *ctl;
+
+    if (!mixer)
+        return;
+    while ((ctl = mixer->ctls)) {
+        mixer->ctls = ctl->next;
+        free(ctl->name);
+        free(ctl->data);
+        free(ctl);
+    }
+    free(mixer);
+}
+
+const char *mixer_get_name(struct mixer *mixer)
+{
+    return "pal-replay-stub";
+}
+
+struct mixer_ctl *mixer_get_ctl(struct mixer *mixer, unsigned int id)
+{
+    return NULL;
+}
+
+/* controls are created on first use, any name PAL asks for exists */
+struct mixer_ctl *mixer_get_ctl_by_name(struct mixer *mixer, const char *name)
+{
+    struct mixer_ctl *ctl;
+
+    pthread_mutex_lock(&stub_lock);
+    for (ctl = mixer->ctls; ctl; ctl = ctl->next) {
+        if (!strcmp(ctl->name, name))
+            goto exit;
+    }
+    ctl = calloc(1, sizeof(*ctl));
+    if (!ctl)
+        goto exit;
+    ctl->name = strdup(name);
+    if (!ctl->name) {
+        free(ctl);
+        ctl = NULL;
+        goto exit;
+    }
+    ctl->next = mixer->ctls;
+    mixer->ctls = ctl;
+exit:
+    pthread_mutex_unlock(&stub_lock);
+    return ctl;
+}
+
+const char *mixer_ctl_get_name(struct mixer_ctl *ctl)
+{
+    return ctl->name;
+}
+
+unsigned int mixer_ctl_get_num_values(struct mixer_ctl *ctl)
+{
+    return ctl->size ? ctl->size : 1;
+}
+
+int mixer_ctl_get_array(struct mixer_ctl *ctl, void *array, size_t count)
+{
+    pthread_mutex_lock(&stub_lock);
+    memset(array, 0, count);
+    if (ctl->size)
+        memcpy(array, ctl->data, ctl->size < count ? ctl->size : count);
+    pthread_mutex_unlock(&stub_lock);
+    return 0;
+}
+
+int mixer_ctl_set_array(struct mixer_ctl *ctl, const void *array, size_t count)
+{
+    uint8_t *data = NULL;
+
+    if (!count)
+        return 0;
+    pthread_mutex_lock(&stub_lock);
+    if (count > ctl->size) {
+        data = realloc(ctl->data, count);
+        if (!data) {
+            pthread_mutex_unlock(&stub_lock);
+            return -ENOMEM;
+        }
+        ctl->data = data;
+    }
+    memcpy(ctl->data, array, count);
+    ctl->size = count;
+    pthread_mutex_unlock(&stub_lock);
+    return 0;
+}
+
+int mixer_ctl_get_value(struct mixer_ctl *ctl, unsigned int id)
+{
+    int value = 0;
+
+    pthread_mutex_lock(&stub_lock);
+    if ((id + 1) * sizeof(int) <= ctl->size)
+        memcpy(&value, ctl->data + id * sizeof(int), sizeof(int));
+    pthread_mutex_unlock(&stub_lock);
+    return value;
+}
+
+int mixer_ctl_set_value(struct mixer_ctl *ctl, unsigned int id, int value)
+{
+    uint8_t *data = NULL;
+    size_t need = (id + 1) * sizeof(int);
+
+    pthread_mutex_lock(&stub_lock);
+    if (need > ctl->size) {
+        data = realloc(ctl->data, need);
+        if (!data) {
+            pthread_mutex_unlock(&stub_lock);
+            return -ENOMEM;
+        }
+        memset(data + ctl->size, 0, need - ctl->size);
+        ctl->data = data;
+        ctl->size = need;
+    }
+    memcpy(ctl->data + id * sizeof(int), &value, sizeof(int));
+    pthread_mutex_unlock(&stub_lock);
+    return 0;
+}
+
+int mixer_ctl_set_enum_by_string(struct mixer_ctl *ctl, const char *string)
+{
+    return mixer_ctl_set_array(ctl, string, strlen(string) + 1);
+}
+
+void mixer_ctl_update(struct mixer_ctl *ctl)
+{
+}
+
+int mixer_subscribe_events(struct mixer *mixer, int subscribe)
+{
+    return 0;
+}
+
+/* no events are ever raised, keep waiters from spinning */
+int mixer_wait_event(struct mixer *mixer, int timeout)
+{
+    if (timeout < 0 || timeout > STUB_EVENT_WAIT_MS)
+        timeout = STUB_EVENT_WAIT_MS;
+    usleep(timeout * 1000);
+    return 0;
+}
+
+int mixer_read_event(struct mixer *mixer, struct ctl_event *ev)
+{
+    return -EAGAIN;
+}
+
+/* ---- compress ---- */
+
+struct compress *compress_open(unsigned int card, unsigned int device,
+                               unsigned int flags, struct compr_config *config)
+{
+    return calloc(1, sizeof(struct compress));
+}
+
+void compress_close(struct compress *compress)
+{
+    free(compress);
+}
+
+int compress_write(struct compress *compress, const void *buf, unsigned int size)
+{
+    return size;
+}
+
+int compress_read(struct compress *compress, void *buf, unsigned int size)
+{
+    memset(buf, 0, size);
+    return size;
+}
+
+int compress_start(struct compress *compress)
+{
+    return 0;
+}
+
+int compress_stop(struct compress *compress)
+{
+    return 0;
+}
+
+int compress_pause(struct compress *compress)
+{
+    return 0;
+}
+
+int compress_resume(struct compress *compress)
+{
+    return 0;
+}
+
+int compress_drain(struct compress *compress)
+{
+    return 0;
+}
+
+int compress_partial_drain(struct compress *compress)
+{
+    return 0;
+}
+
+int compress_next_track(struct compress *compress)
+{
+    return 0;
+}
+
+int compress_set_gapless_metadata(struct compress *compress,
+                                  struct compr_gapless_mdata *mdata)
+{
+    return 0;
+}
+
+int compress_set_codec_params(struct compress *compress, struct snd_codec *codec)
+{
+    return 0;
+}
+
+void compress_nonblock(struct compress *compress, int nonblock)
+{
+    compress->nonblock = nonblock;
+}
+
+int compress_wait(struct compress *compress, int timeout_ms)
+{
+    return 0;
+}
+
+const char *compress_get_error(struct compress *compress)
+{
+    return "";
+}
+
+/* ---- audio route ---- */
+
+struct audio_route *audio_route_init(unsigned int card, const char *xml_path)
+{
+    struct audio_route *ar = calloc(1, sizeof(*ar));
+
+    if (ar)
+        ar->card = card;
+    return ar;
+}
+
+void audio_route_free(struct audio_route *ar)
+{
+    free(ar);
+}
+
+int audio_route_apply_and_update_path(struct audio_route *ar, const char *name)
+{
+    return 0;
+}
+
+int audio_route_reset_and_update_path(struct audio_route *ar, const char *name)
+{
+    return 0;
+}
+
+/* ---- agm ---- */
+
+int agm_session_open(uint32_t session_id, enum agm_session_mode sess_mode,
+                     uint64_t *handle)
+{
+    *handle = session_id;
+    return 0;
+}
+
+int agm_session_close(uint64_t hndl)
+{
+    return 0;
+}
+
+int agm_session_register_cb(uint32_t session_id, agm_event_cb cb,
+                            enum event_type evt_type, void *client_data)
+{
+    return 0;
+}
+
+int agm_session_set_metadata(uint32_t session_id, uint32_t size, uint8_t *metadata)
+{
+    return 0;
+}
+
+int agm_session_set_params(uint32_t session_id, void *payload, size_t size)
+{
+    return 0;
+}
+
+int agm_session_set_non_tunnel_mode_config(uint64_t hndl,
+                                           struct agm_session_config *session_config,
+                                           struct agm_media_config *in_media_config,
+                                           struct agm_media_config *out_media_config,
+                                           struct agm_buffer_config *in_buffer_config,
+                                           struct agm_buffer_config *out_buffer_config)
+{
+    return 0;
+}
+
+int agm_session_prepare(uint64_t hndl)
+{
+    return 0;
+}
+
+int agm_session_start(uint64_t hndl)
+{
+    return 0;
+}
+
+int agm_session_stop(uint64_t hndl)
+{
+    return 0;
+}
+
+int agm_session_suspend(uint64_t hndl)
+{
+    return 0;
+}
+
+int agm_session_flush(uint64_t hndl)
+{
+    return 0;
+}
+
+int agm_session_eos(uint64_t hndl)
+{
+    return 0;
+}
+
+int agm_session_write_with_metadata(uint64_t hndl, struct agm_buff *buf,
+                                    size_t *consumed_size)
+{
+    *consumed_size = buf->size;
+    return 0;
+}
+
+int agm_session_read_with_metadata(uint64_t hndl, struct agm_buff *buf,
+                                   uint32_t *captured_size)
+{
+    memset(buf->addr, 0, buf->size);
+    *captured_size = buf->size;
+    return 0;
+}
+
+int agm_session_aif_get_tag_module_info(uint32_t session_id, uint32_t aif_id,
+                                        void *payload, size_t *size)
+{
+    if (payload && *size)
+        memset(payload, 0, *size);
+    return 0;
+}
+
+int agm_register_service_crash_callback(agm_service_crash_cb cb, uint64_t cookie)
+{
+    return 0;
+}
+
+int agm_dump(struct agm_dump_info *dump_info)
+{
+    return 0;
+}
@@ -134,10 +134,12 @@ public:
 
     static std::shared_ptr<ACDPlatformInfo> GetInstance();
     bool IsACDEnabled() const { return acd_enable_; }
+    bool IsSharedSensorCaptureEnabled() const { return shared_sensor_capture_; }
     std::shared_ptr<ACDStreamConfig> GetStreamConfig(const UUID& uuid) const;
 
 private:
     bool acd_enable_;
+    bool shared_sensor_capture_;
     static std::shared_ptr<ACDPlatformInfo> me_;
     std::shared_ptr<SoundTriggerXml> curr_child_;
     std::map<UUID, std::shared_ptr<ACDStreamConfig>> acd_cfg_list_;
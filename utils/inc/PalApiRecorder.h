@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef PAL_API_RECORDER_H
+#define PAL_API_RECORDER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef PAL_API_TRACE_PATH
+#define PAL_API_TRACE_PATH "/data/vendor/audio/pal_api_trace.bin"
+#endif
+
+#define PAL_API_TRACE_MAGIC 0x52544150 /* "PATR" */
+#define PAL_API_TRACE_VERSION 2
+/* payload bytes kept per record, longer payloads are cut */
+#define PAL_API_TRACE_MAX_BLOB (64 * 1024)
+/* records waiting for the writer thread, further records are dropped */
+#define PAL_API_TRACE_MAX_QUEUED 4096
+
+/* pal_api_trace_record flags */
+#define PAL_API_TRACE_FLAG_BLOB_TRUNCATED 0x1
+
+typedef enum {
+    PAL_API_STREAM_OPEN = 1,
+    PAL_API_STREAM_CLOSE,
+    PAL_API_STREAM_START,
+    PAL_API_STREAM_STOP,
+    PAL_API_STREAM_WRITE,
+    PAL_API_STREAM_READ,
+    PAL_API_STREAM_GET_PARAM,
+    PAL_API_STREAM_SET_PARAM,
+    PAL_API_STREAM_SET_VOLUME,
+    PAL_API_STREAM_SET_MUTE,
+    PAL_API_STREAM_PAUSE,
+    PAL_API_STREAM_RESUME,
+    PAL_API_STREAM_DRAIN,
+    PAL_API_STREAM_FLUSH,
+    PAL_API_STREAM_SUSPEND,
+    PAL_API_GET_TIMESTAMP,
+    PAL_API_ADD_REMOVE_EFFECT,
+    PAL_API_STREAM_SET_DEVICE,
+    PAL_API_SET_PARAM,
+    PAL_API_GET_PARAM,
+    PAL_API_STREAM_WRITE_BATCH,
+    PAL_API_STREAM_READ_BATCH,
+    PAL_API_STREAM_SET_VOLUME_ASYNC,
+    PAL_API_STREAM_SET_MUTE_ASYNC,
+    PAL_API_GET_TIMESTAMP_DRIFT,
+    PAL_API_GET_TAGS_WITH_MODULE_INFO,
+    PAL_API_GET_MMAP_POSITION,
+    PAL_API_CREATE_MMAP_BUFFER,
+    PAL_API_DUMP_STATE,
+    PAL_API_REGISTER_GLOBAL_CALLBACK,
+    PAL_API_GEF_RW_PARAM,
+    PAL_API_GEF_RW_PARAM_ACDB,
+    PAL_API_MAX,
+} pal_api_id_t;
+
+/*
+ * Trace file layout: one pal_api_trace_header followed by records, each a
+ * pal_api_trace_record and blob_size bytes of payload. Handles are the
+ * recording process pointers and only identify streams within the trace.
+ * Records are written when a call returns, seq gives the order the calls
+ * started in. A payload cut at PAL_API_TRACE_MAX_BLOB is flagged truncated.
+ *
+ * Blobs per api:
+ *   STREAM_OPEN       pal_stream_attributes, pal_device[arg], modifier_kv[arg2]
+ *   STREAM_SET_PARAM  param payload, arg = param id
+ *   STREAM_GET_PARAM  caller supplied pal_param_payload if any, arg = param id
+ *   STREAM_SET_VOLUME pal_volume_data, ASYNC has the ramp period in arg
+ *   STREAM_SET_DEVICE pal_device[arg]
+ *   SET_PARAM         param payload, arg = param id
+ *   GET_PARAM         caller supplied payload if any, arg = param id,
+ *                     arg2 = payload size passed in
+ *   WRITE/READ_BATCH  size_t buffer size[arg]
+ *   GEF_RW_PARAM      device id and stream type as uint32_t, then the param
+ *                     payload on writes, arg = param id, arg2 = direction
+ * WRITE/READ carry the buffer size in arg, MUTE/DRAIN/EFFECT the value in
+ * arg, GET_TAGS_WITH_MODULE_INFO the size passed in, GEF_RW_PARAM_ACDB
+ * the param id in arg, CREATE_MMAP_BUFFER the min size in frames,
+ * DUMP_STATE the format and REGISTER_GLOBAL_CALLBACK whether a callback
+ * was set.
+ *
+ * Not recorded: pal_init/pal_deinit, which bracket the trace, the
+ * pal_param_payload_alloc/free memory helpers, which touch no PAL state,
+ * and the pal_stream_get_buffer_size, get_device, get_volume, get_mute and
+ * get/set_mic_mute stubs, which only return -ENOSYS.
+ */
+struct pal_api_trace_header {
+    uint32_t magic;
+    uint32_t version;
+    int64_t start_ns;     /* CLOCK_MONOTONIC of the first record */
+};
+
+struct pal_api_trace_record {
+    uint32_t api;
+    uint32_t tid;
+    uint64_t seq;           /* start order across all threads */
+    uint64_t handle;
+    uint64_t result_handle; /* handle returned by STREAM_OPEN */
+    int64_t start_ns;       /* relative to the header start_ns */
+    int64_t duration_ns;
+    int32_t status;
+    uint32_t arg;
+    uint32_t arg2;
+    uint32_t blob_size;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+class PalApiRecorder
+{
+public:
+    static int start(const char *path);
+    static void stop();
+    static bool isActive() { return sActive.load(std::memory_order_acquire); }
+    static int64_t nowNs();
+    static uint64_t nextSeq() { return sSeq.fetch_add(1, std::memory_order_relaxed); }
+    static void write(const struct pal_api_trace_record *rec,
+                      const std::vector<uint8_t> &blob);
+
+private:
+    static void writerLoop();
+
+    /* start/stop and the file, the file is only written by the writer */
+    static std::mutex sLock;
+    static FILE *sFile;
+    static int64_t sStartNs;
+    static std::atomic<bool> sActive;
+    static std::atomic<uint64_t> sSeq;
+    /* serialized records handed from the calling threads to the writer */
+    static std::mutex sQueueLock;
+    static std::condition_variable sQueueCv;
+    static std::vector<std::vector<uint8_t>> sQueue;
+    static bool sExit;
+    static uint32_t sDropped;
+    static std::thread sWriter;
+};
+
+/* one api call, written out when the calling function returns */
+class PalApiRecord
+{
+public:
+    PalApiRecord(pal_api_id_t api, const void *handle, const int32_t *status)
+        : mActive(PalApiRecorder::isActive()),
+          mStatus(status)
+    {
+        mRec = {};
+        mRec.api = api;
+        mRec.handle = (uint64_t)(uintptr_t)handle;
+        if (mActive) {
+            mRec.seq = PalApiRecorder::nextSeq();
+            mRec.start_ns = PalApiRecorder::nowNs();
+        }
+    }
+    ~PalApiRecord();
+    void setArg(uint32_t arg) { mRec.arg = arg; }
+    void setArg2(uint32_t arg) { mRec.arg2 = arg; }
+    void setResultHandle(const void *handle) { mRec.result_handle = (uint64_t)(uintptr_t)handle; }
+    void addBlob(const void *data, size_t size);
+
+private:
+    bool mActive;
+    const int32_t *mStatus;
+    struct pal_api_trace_record mRec;
+    std::vector<uint8_t> mBlob;
+};
+
+#ifdef PAL_API_RECORDER
+#define PAL_API_RECORD(api, handle, status) \
+    PalApiRecord palApiRecord(api, handle, &(status))
+#define PAL_API_RECORD_ARG(arg) palApiRecord.setArg(arg)
+#define PAL_API_RECORD_ARG2(arg) palApiRecord.setArg2(arg)
+#define PAL_API_RECORD_RESULT(handle) palApiRecord.setResultHandle(handle)
+#define PAL_API_RECORD_BLOB(data, size) palApiRecord.addBlob(data, size)
+#else
+#define PAL_API_RECORD(api, handle, status) do {} while (0)
+#define PAL_API_RECORD_ARG(arg) do {} while (0)
+#define PAL_API_RECORD_ARG2(arg) do {} while (0)
+#define PAL_API_RECORD_RESULT(handle) do {} while (0)
+#define PAL_API_RECORD_BLOB(data, size) do {} while (0)
+#endif
+
+#endif //PAL_API_RECORDER_H
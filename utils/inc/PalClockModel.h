@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef PAL_CLOCK_MODEL_H
+#define PAL_CLOCK_MODEL_H
+
+#include <stdint.h>
+#include <mutex>
+
+#define PAL_CLOCK_MODEL_MAX_SAMPLES 8
+#define PAL_CLOCK_MODEL_MIN_FIT_SAMPLES 3
+/* age of the newest real sample after which a query goes to the DSP again */
+#define PAL_CLOCK_MODEL_REFRESH_US 50000
+/* prediction miss on a real sample that restarts the fit */
+#define PAL_CLOCK_MODEL_TOLERANCE_US 1000
+
+/*
+ * Linear model of a counter that advances with CLOCK_MONOTONIC, such as the
+ * DSP session time or an mmap hw pointer. Real samples are fed in by the
+ * caller whenever it has to query the hardware; queries within the refresh
+ * window are answered from a least squares fit over the last few samples
+ * instead. Until enough samples span the window the nominal rate is used.
+ * A sample missing the prediction by more than the tolerance (pause, flush,
+ * underrun, track change) drops the history and starts a new fit, so the
+ * error of a prediction is bounded by what the counter can do within one
+ * refresh window. A prediction never runs ahead of the newest real sample
+ * plus its age at the nominal rate, and answers never go backwards until
+ * reset() is called.
+ */
+class PalClockModel
+{
+public:
+    /* rate in counter units per microsecond */
+    PalClockModel(double nominalRate = 1.0);
+    void setNominalRate(double rate);
+    void reset();
+    void addSample(int64_t timeUs, int64_t value);
+    bool predict(int64_t timeUs, int64_t *value);
+    /* value handed out on a real query, never below earlier answers */
+    int64_t clamp(int64_t value);
+    /* last real sample, false if the model is empty */
+    bool getLastSample(int64_t *timeUs, int64_t *value);
+    int32_t getDriftPpm();
+    static int64_t nowUs();
+
+private:
+    void reset_l();
+    double getRate_l();
+    int64_t predict_l(int64_t timeUs);
+
+    std::mutex mLock;
+    double mNominalRate;
+    int64_t mTimeUs[PAL_CLOCK_MODEL_MAX_SAMPLES];
+    int64_t mValue[PAL_CLOCK_MODEL_MAX_SAMPLES];
+    uint32_t mHead;
+    uint32_t mCount;
+    /* last answer handed out, kept across fit restarts until reset() */
+    int64_t mLastOut;
+    bool mHaveOut;
+};
+
+#endif //PAL_CLOCK_MODEL_H
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef PAL_EVENT_LOOP_H
+#define PAL_EVENT_LOOP_H
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#define PAL_EVENT_LOOP_MAX_EVENTS 16
+#define PAL_EVENT_LOOP_NUM_WORKERS 2
+
+typedef struct pal_event_loop_stats {
+    uint64_t wakeups;
+    uint64_t fd_events;
+    uint64_t timer_expiries;
+    uint64_t work_items;
+    uint32_t num_fds;
+    uint32_t num_timers;
+    uint32_t max_queue_depth;
+} pal_event_loop_stats_t;
+
+/*
+ * Process wide reactor for PAL background work. A single thread waits on an
+ * epoll set; registered fds are dispatched inline on that thread, so their
+ * handlers must not block. Timers (timerfd) and posted work items run on a
+ * small worker pool and may block.
+ */
+class PalEventLoop
+{
+public:
+    typedef std::function<void(uint32_t events)> fd_handler_t;
+    typedef std::function<void()> work_t;
+
+    /* returns NULL once deinit() has run until init() re-enables the loop */
+    static PalEventLoop* getInstance();
+    static void init();
+    static void deinit();
+
+    int addFd(int fd, uint32_t events, fd_handler_t handler);
+    /* waits for a running handler of fd unless called from the loop thread */
+    int removeFd(int fd);
+    /* returns a timer id > 0; a zero delayMs creates the timer disarmed */
+    int addTimer(uint32_t delayMs, uint32_t periodMs, work_t handler);
+    int armTimer(int timerId, uint32_t delayMs, uint32_t periodMs = 0);
+    int disarmTimer(int timerId);
+    /* waits for a running handler of the timer unless called from it */
+    int cancelTimer(int timerId);
+    int post(work_t work);
+    void getStats(pal_event_loop_stats_t *stats);
+
+private:
+    typedef struct {
+        int fd;
+        work_t handler;
+    } timer_entry_t;
+
+    PalEventLoop();
+    ~PalEventLoop();
+    int start();
+    void stop();
+    void loopThread();
+    void workerThread();
+    void runTimer(int timerId);
+
+    static std::mutex sInstanceMutex;
+    static PalEventLoop *sInstance;
+    static bool sDeinitDone;
+    static thread_local int sCurrentTimer;
+
+    int mEpollFd;
+    int mWakeFd;
+    std::atomic<bool> mExit;
+    int mNextTimerId;
+    int mDispatchFd;
+    std::thread mLoopThread;
+    std::vector<std::thread> mWorkers;
+    std::mutex mLock;
+    std::condition_variable mDispatchCv;
+    std::map<int, fd_handler_t> mFds;
+    std::map<int, timer_entry_t> mTimers;
+    std::multiset<int> mRunningTimers;
+    std::mutex mWorkLock;
+    std::condition_variable mWorkCv;
+    std::deque<work_t> mWork;
+    uint32_t mMaxQueueDepth;
+    std::atomic<uint64_t> mWakeups;
+    std::atomic<uint64_t> mFdEvents;
+    std::atomic<uint64_t> mTimerExpiries;
+    std::atomic<uint64_t> mWorkItems;
+};
+
+#endif //PAL_EVENT_LOOP_H
@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef PAL_LAZY_INIT_H
+#define PAL_LAZY_INIT_H
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+
+/*
+ * Optional subsystem brought up on first use instead of at pal_init.
+ *
+ * get() runs the init function once, callers racing with it wait for it to
+ * finish and every later call returns the status of that run. prewarm()
+ * runs get() from the PalEventLoop workers so the cost is usually paid
+ * before the first real user. close() runs the deinit function if init
+ * ran and turns later get() calls, including pending pre-warms, into
+ * -ENODEV.
+ *
+ * get() must not be called with locks held that the init function or
+ * callbacks it triggers take.
+ */
+class PalLazyInit
+{
+public:
+    typedef std::function<int()> init_t;
+    typedef std::function<void()> deinit_t;
+
+    PalLazyInit(const char *name, init_t init, deinit_t deinit = nullptr);
+    int get();
+    bool isDone();
+    int prewarm();
+    void close();
+
+private:
+    std::string mName;
+    init_t mInit;
+    deinit_t mDeinit;
+    std::mutex mLock;
+    std::atomic<bool> mDone;
+    bool mClosed;
+    int mStatus;
+};
+
+#endif //PAL_LAZY_INIT_H
@@ -34,6 +34,7 @@
 
 
 #include <stdlib.h>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <vector>
@@ -45,6 +46,8 @@
 #define PALRINGBUFFER_H_
 
 #define DEFAULT_PAL_RING_BUFFER_SIZE 4096 * 10
+/* idle mappings kept per buffer size for the next engine */
+#define PAL_RING_BUFFER_POOL_MAX_IDLE 4
 
 typedef enum {
     READER_DISABLED = 0,
@@ -86,22 +89,29 @@ class PalRingBufferReader {
     uint32_t requestedSize_;
 };
 
-class PalRingBuffer {
+/*
+ * Anonymous mappings backing ring buffers. Pages of a mapping are only
+ * committed when written, and are handed back with MADV_DONTNEED before a
+ * mapping goes idle, so pooled buffers cost address space but no memory.
+ * Engines with the same sample format ask for the same size and reuse each
+ * other's mappings.
+ */
+class PalRingBufferPool {
  public:
-    explicit PalRingBuffer(size_t bufferSize)
-        : buffer_((char*)(new char[bufferSize])),
-          startIndex(0),
-          endIndex(0),
-          writeOffset_(0),
-          bufferEnd_(bufferSize) {}
-
-    ~PalRingBuffer() {
-        if (buffer_)
-            delete buffer_;
+    static char* acquire(size_t size);
+    static void release(char *buffer, size_t size);
+    static void discard(char *buffer, size_t size);
+    static size_t roundToPage(size_t size);
+
+ private:
+    static std::mutex mutex_;
+    static std::multimap<size_t, char*> idle_;
+};
 
-        for (int i = 0; i < readOffsets_.size(); i++)
-            delete readOffsets_[i];
-    }
+class PalRingBuffer {
+ public:
+    explicit PalRingBuffer(size_t bufferSize);
+    ~PalRingBuffer();
 
     PalRingBufferReader* newReader();
 
@@ -122,6 +132,7 @@ class PalRingBuffer {
     uint32_t endIndex;
     size_t writeOffset_;
     size_t bufferEnd_;
+    size_t touchedSize_; // bytes written since the last reset, bounded by bufferEnd_
     std::vector<PalRingBufferReader*> readOffsets_;
     void updateUnReadSize(size_t writtenSize);
     friend class PalRingBufferReader;
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#ifndef PAL_THREAD_POLICY_H
+#define PAL_THREAD_POLICY_H
+
+#include <sched.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <map>
+#include <mutex>
+#include <string>
+
+typedef enum {
+    PAL_THREAD_CLASS_OFFLOAD,    /* compress offload refill/drain */
+    PAL_THREAD_CLASS_LAB,        /* sound trigger/ACD buffering and detection events */
+    PAL_THREAD_CLASS_EVENT,      /* mixer event wait, notification and command threads */
+    PAL_THREAD_CLASS_EVENT_LOOP, /* PalEventLoop reactor and workers */
+    PAL_THREAD_CLASS_SSR,        /* SSR handling and recovery */
+    PAL_THREAD_CLASS_BACKGROUND, /* calibration, logging and other best effort work */
+    PAL_THREAD_CLASS_MAX,
+} pal_thread_class_t;
+
+typedef struct pal_thread_policy {
+    int sched_policy;      /* SCHED_OTHER or SCHED_FIFO */
+    int priority;          /* SCHED_FIFO priority */
+    int nice;              /* SCHED_OTHER nice value */
+    uint64_t cpu_mask;     /* 0 leaves the affinity alone */
+    std::string cgroup;    /* file the tid is written to, empty for none */
+} pal_thread_policy_t;
+
+/* what a thread had before entering a class, put back when it leaves */
+typedef struct pal_thread_state {
+    bool registered;           /* thread was already in a class */
+    pal_thread_class_t cls;
+    bool saved;                /* scheduling below was read */
+    int sched_policy;
+    struct sched_param param;
+    int nice;
+    cpu_set_t cpus;
+} pal_thread_state_t;
+
+/*
+ * Scheduling policy per PAL thread class, configured from the thread_policy
+ * tags of resourcemanager.xml:
+ *
+ *   <thread_policy class="offload" policy="fifo" priority="2"
+ *                  cpu_mask="0xf0" cgroup="/dev/cpuset/audio-app/tasks"/>
+ *
+ * Internal threads enter their class when they start, through
+ * PalThreadScope. Policies apply to threads entering later and also to the
+ * ones already registered, so threads started before the xml is parsed
+ * (the event loop) are covered too. Classes without a policy keep whatever
+ * the creating thread had.
+ */
+class PalThreadPolicy
+{
+public:
+    static void enter(pal_thread_class_t cls, const char *name,
+                      pal_thread_state_t *prev);
+    static void leave(const pal_thread_state_t *prev);
+    static int setPolicy(pal_thread_class_t cls, const pal_thread_policy_t *policy);
+    /* attributes of a thread_policy xml tag */
+    static int configure(const char **attr);
+
+private:
+    static int apply(pid_t tid, pal_thread_class_t cls, const pal_thread_policy_t &policy);
+    static int getClass(const char *name, pal_thread_class_t *cls);
+    static void save(pid_t tid, pal_thread_state_t *state);
+    static void restore(pid_t tid, const pal_thread_state_t &state);
+
+    static std::mutex sLock;
+    static std::map<pal_thread_class_t, pal_thread_policy_t> sPolicies;
+    static std::map<pid_t, pal_thread_class_t> sThreads;
+};
+
+/*
+ * Enters a class for the lifetime of the calling thread function. Leaving
+ * puts back the class and scheduling the thread had, so a scope may be
+ * nested inside another one.
+ */
+class PalThreadScope
+{
+public:
+    PalThreadScope(pal_thread_class_t cls, const char *name) {
+        PalThreadPolicy::enter(cls, name, &mPrev);
+    }
+    ~PalThreadScope() {
+        PalThreadPolicy::leave(&mPrev);
+    }
+
+private:
+    pal_thread_state_t mPrev;
+};
+
+#endif //PAL_THREAD_POLICY_H
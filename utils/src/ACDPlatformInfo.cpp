@@ -231,6 +231,7 @@ std::shared_ptr<ACDPlatformInfo> ACDPlatformInfo::me_ = nullptr;
 
 ACDPlatformInfo::ACDPlatformInfo() :
     acd_enable_(true),
+    shared_sensor_capture_(false),
     curr_child_(nullptr)
 {
 }
@@ -281,6 +282,8 @@ void ACDPlatformInfo::HandleStartTag(const char* tag, const char** attribs)
                 PAL_ERR(LOG_TAG, "Error:%d missing attrib value for tag %s", -EINVAL, tag);
             } else if (!strcmp(attribs[i], "acd_enable")) {
                 acd_enable_ = !strncasecmp(attribs[++i], "true", 4) ? true : false;
+            } else if (!strcmp(attribs[i], "shared_sensor_capture")) {
+                shared_sensor_capture_ = !strncasecmp(attribs[++i], "true", 4) ? true : false;
             } else {
                 PAL_ERR(LOG_TAG, "Invalid attribute %s", attribs[i++]);
             }
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#define LOG_TAG "PAL: PalApiRecorder"
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "PalCommon.h"
+#include "PalApiRecorder.h"
+#include "PalThreadPolicy.h"
+
+/* records are small and frequent, let stdio batch them */
+#define PAL_API_TRACE_FILE_BUF (256 * 1024)
+
+std::mutex PalApiRecorder::sLock;
+FILE *PalApiRecorder::sFile = NULL;
+int64_t PalApiRecorder::sStartNs = 0;
+std::atomic<bool> PalApiRecorder::sActive(false);
+std::atomic<uint64_t> PalApiRecorder::sSeq(0);
+std::mutex PalApiRecorder::sQueueLock;
+std::condition_variable PalApiRecorder::sQueueCv;
+std::vector<std::vector<uint8_t>> PalApiRecorder::sQueue;
+bool PalApiRecorder::sExit = true;
+uint32_t PalApiRecorder::sDropped = 0;
+std::thread PalApiRecorder::sWriter;
+
+int64_t PalApiRecorder::nowNs()
+{
+    struct timespec ts = {0, 0};
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int PalApiRecorder::start(const char *path)
+{
+    std::lock_guard<std::mutex> lock(sLock);
+    struct pal_api_trace_header header;
+    int status = 0;
+
+    if (sFile)
+        return 0;
+
+    sFile = fopen(path, "wbe");
+    if (!sFile) {
+        status = -errno;
+        PAL_ERR(LOG_TAG, "failed to open trace %s, status %d", path, status);
+        return status;
+    }
+    setvbuf(sFile, NULL, _IOFBF, PAL_API_TRACE_FILE_BUF);
+
+    sStartNs = nowNs();
+    header.magic = PAL_API_TRACE_MAGIC;
+    header.version = PAL_API_TRACE_VERSION;
+    header.start_ns = sStartNs;
+    if (fwrite(&header, sizeof(header), 1, sFile) != 1) {
+        status = -EIO;
+        PAL_ERR(LOG_TAG, "failed to write trace header");
+        fclose(sFile);
+        sFile = NULL;
+        return status;
+    }
+
+    {
+        std::lock_guard<std::mutex> qLock(sQueueLock);
+        sQueue.clear();
+        sExit = false;
+        sDropped = 0;
+    }
+    sSeq.store(0, std::memory_order_relaxed);
+    sWriter = std::thread(&PalApiRecorder::writerLoop);
+    sActive.store(true, std::memory_order_release);
+    PAL_INFO(LOG_TAG, "recording PAL api calls to %s", path);
+    return 0;
+}
+
+void PalApiRecorder::stop()
+{
+    std::lock_guard<std::mutex> lock(sLock);
+    uint32_t dropped = 0;
+
+    sActive.store(false, std::memory_order_release);
+    if (!sFile)
+        return;
+
+    {
+        std::lock_guard<std::mutex> qLock(sQueueLock);
+        sExit = true;
+        dropped = sDropped;
+    }
+    sQueueCv.notify_one();
+    if (sWriter.joinable())
+        sWriter.join();
+
+    fclose(sFile);
+    sFile = NULL;
+    PAL_INFO(LOG_TAG, "api trace closed, %u records dropped", dropped);
+}
+
+/* drains the queue into the file, the calling threads never touch stdio */
+void PalApiRecorder::writerLoop()
+{
+    PalThreadScope threadScope(PAL_THREAD_CLASS_BACKGROUND, "api_trace");
+    std::vector<std::vector<uint8_t>> batch;
+    std::unique_lock<std::mutex> lock(sQueueLock);
+    bool failed = false;
+
+    while (true) {
+        sQueueCv.wait(lock, [] { return sExit || !sQueue.empty(); });
+        if (sQueue.empty())
+            break;
+        batch.swap(sQueue);
+        lock.unlock();
+        for (const std::vector<uint8_t> &entry : batch) {
+            if (failed)
+                break;
+            if (fwrite(entry.data(), entry.size(), 1, sFile) != 1) {
+                PAL_ERR(LOG_TAG, "trace write failed, stop recording");
+                sActive.store(false, std::memory_order_release);
+                failed = true;
+            }
+        }
+        batch.clear();
+        lock.lock();
+    }
+}
+
+void PalApiRecorder::write(const struct pal_api_trace_record *rec,
+                           const std::vector<uint8_t> &blob)
+{
+    std::vector<uint8_t> entry(sizeof(*rec) + blob.size());
+    struct pal_api_trace_record *out = (struct pal_api_trace_record *)entry.data();
+
+    *out = *rec;
+    out->start_ns -= sStartNs;
+    out->blob_size = blob.size();
+    if (out->blob_size)
+        memcpy(entry.data() + sizeof(*out), blob.data(), out->blob_size);
+
+    std::lock_guard<std::mutex> lock(sQueueLock);
+    /* a call that started before stop() returned after it */
+    if (sExit)
+        return;
+    if (sQueue.size() >= PAL_API_TRACE_MAX_QUEUED) {
+        sDropped++;
+        return;
+    }
+    sQueue.push_back(std::move(entry));
+    sQueueCv.notify_one();
+}
+
+void PalApiRecord::addBlob(const void *data, size_t size)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+
+    if (!mActive || !data || !size)
+        return;
+
+    if (mBlob.size() + size > PAL_API_TRACE_MAX_BLOB) {
+        size = PAL_API_TRACE_MAX_BLOB - mBlob.size();
+        mRec.flags |= PAL_API_TRACE_FLAG_BLOB_TRUNCATED;
+    }
+    mBlob.insert(mBlob.end(), bytes, bytes + size);
+}
+
+PalApiRecord::~PalApiRecord()
+{
+    if (!mActive)
+        return;
+
+    mRec.duration_ns = PalApiRecorder::nowNs() - mRec.start_ns;
+    mRec.tid = (uint32_t)syscall(SYS_gettid);
+    mRec.status = mStatus ? *mStatus : 0;
+    PalApiRecorder::write(&mRec, mBlob);
+}
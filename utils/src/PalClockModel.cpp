@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#define LOG_TAG "PAL: PalClockModel"
+
+#include <time.h>
+#include "PalCommon.h"
+#include "PalClockModel.h"
+
+PalClockModel::PalClockModel(double nominalRate)
+    : mNominalRate(nominalRate),
+      mHead(0),
+      mCount(0),
+      mLastOut(0),
+      mHaveOut(false)
+{
+}
+
+int64_t PalClockModel::nowUs()
+{
+    struct timespec ts = {0, 0};
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+void PalClockModel::setNominalRate(double rate)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    if (rate == mNominalRate)
+        return;
+    mNominalRate = rate;
+    reset_l();
+}
+
+void PalClockModel::reset()
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    reset_l();
+    mHaveOut = false;
+}
+
+void PalClockModel::reset_l()
+{
+    mHead = 0;
+    mCount = 0;
+}
+
+double PalClockModel::getRate_l()
+{
+    uint32_t first = (mHead + PAL_CLOCK_MODEL_MAX_SAMPLES - mCount) % PAL_CLOCK_MODEL_MAX_SAMPLES;
+    uint32_t last = (mHead + PAL_CLOCK_MODEL_MAX_SAMPLES - 1) % PAL_CLOCK_MODEL_MAX_SAMPLES;
+    double meanX = 0, meanY = 0, sxx = 0, sxy = 0;
+    double dx = 0, dy = 0;
+    uint32_t idx = 0;
+
+    if (mCount < PAL_CLOCK_MODEL_MIN_FIT_SAMPLES ||
+        mTimeUs[last] - mTimeUs[first] < PAL_CLOCK_MODEL_REFRESH_US)
+        return mNominalRate;
+
+    /* relative to the oldest sample to keep the sums well conditioned */
+    for (uint32_t i = 0; i < mCount; i++) {
+        idx = (first + i) % PAL_CLOCK_MODEL_MAX_SAMPLES;
+        meanX += mTimeUs[idx] - mTimeUs[first];
+        meanY += mValue[idx] - mValue[first];
+    }
+    meanX /= mCount;
+    meanY /= mCount;
+    for (uint32_t i = 0; i < mCount; i++) {
+        idx = (first + i) % PAL_CLOCK_MODEL_MAX_SAMPLES;
+        dx = (mTimeUs[idx] - mTimeUs[first]) - meanX;
+        dy = (mValue[idx] - mValue[first]) - meanY;
+        sxx += dx * dx;
+        sxy += dx * dy;
+    }
+
+    return sxx > 0 ? sxy / sxx : mNominalRate;
+}
+
+int64_t PalClockModel::predict_l(int64_t timeUs)
+{
+    uint32_t last = (mHead + PAL_CLOCK_MODEL_MAX_SAMPLES - 1) % PAL_CLOCK_MODEL_MAX_SAMPLES;
+
+    return mValue[last] + (int64_t)(getRate_l() * (timeUs - mTimeUs[last]));
+}
+
+void PalClockModel::addSample(int64_t timeUs, int64_t value)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    int64_t miss = 0;
+
+    if (mCount) {
+        miss = value - predict_l(timeUs);
+        if (miss < 0)
+            miss = -miss;
+        if (miss > (int64_t)(PAL_CLOCK_MODEL_TOLERANCE_US * mNominalRate)) {
+            PAL_DBG(LOG_TAG, "sample missed prediction by %lld, restart fit",
+                    (long long)miss);
+            reset_l();
+        }
+    }
+
+    mTimeUs[mHead] = timeUs;
+    mValue[mHead] = value;
+    mHead = (mHead + 1) % PAL_CLOCK_MODEL_MAX_SAMPLES;
+    if (mCount < PAL_CLOCK_MODEL_MAX_SAMPLES)
+        mCount++;
+}
+
+bool PalClockModel::predict(int64_t timeUs, int64_t *value)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    uint32_t last = (mHead + PAL_CLOCK_MODEL_MAX_SAMPLES - 1) % PAL_CLOCK_MODEL_MAX_SAMPLES;
+    int64_t pred = 0;
+    int64_t bound = 0;
+
+    if (!value || !mCount || timeUs < mTimeUs[last] ||
+        timeUs - mTimeUs[last] >= PAL_CLOCK_MODEL_REFRESH_US)
+        return false;
+
+    pred = predict_l(timeUs);
+    /* the fit may run fast, never go past what the clock could have done */
+    bound = mValue[last] + (int64_t)(mNominalRate * (timeUs - mTimeUs[last]));
+    if (pred > bound)
+        pred = bound;
+    if (pred < mValue[last])
+        pred = mValue[last];
+    if (mHaveOut && pred < mLastOut)
+        pred = mLastOut;
+    mLastOut = pred;
+    mHaveOut = true;
+    *value = pred;
+    return true;
+}
+
+int64_t PalClockModel::clamp(int64_t value)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    if (mHaveOut && value < mLastOut) {
+        PAL_DBG(LOG_TAG, "real value %lld behind last answer %lld, holding",
+                (long long)value, (long long)mLastOut);
+        value = mLastOut;
+    }
+    mLastOut = value;
+    mHaveOut = true;
+    return value;
+}
+
+bool PalClockModel::getLastSample(int64_t *timeUs, int64_t *value)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+    uint32_t last = (mHead + PAL_CLOCK_MODEL_MAX_SAMPLES - 1) % PAL_CLOCK_MODEL_MAX_SAMPLES;
+
+    if (!mCount)
+        return false;
+    if (timeUs)
+        *timeUs = mTimeUs[last];
+    if (value)
+        *value = mValue[last];
+    return true;
+}
+
+int32_t PalClockModel::getDriftPpm()
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    if (mNominalRate <= 0)
+        return 0;
+    return (int32_t)((getRate_l() / mNominalRate - 1.0) * 1000000.0);
+}
@@ -0,0 +1,428 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#define LOG_TAG "PAL: PalEventLoop"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include "PalCommon.h"
+#include "PalEventLoop.h"
+#include "PalThreadPolicy.h"
+
+#define EVENT_LOOP_WAKE_TAG  (~0ULL)
+#define EVENT_LOOP_TIMER_TAG (1ULL << 32)
+
+std::mutex PalEventLoop::sInstanceMutex;
+PalEventLoop* PalEventLoop::sInstance = nullptr;
+bool PalEventLoop::sDeinitDone = false;
+thread_local int PalEventLoop::sCurrentTimer = 0;
+
+PalEventLoop::PalEventLoop()
+    : mEpollFd(-1),
+      mWakeFd(-1),
+      mExit(false),
+      mNextTimerId(1),
+      mDispatchFd(-1),
+      mMaxQueueDepth(0),
+      mWakeups(0),
+      mFdEvents(0),
+      mTimerExpiries(0),
+      mWorkItems(0)
+{
+}
+
+PalEventLoop::~PalEventLoop()
+{
+    for (auto &timer : mTimers)
+        close(timer.second.fd);
+    if (!mFds.empty() || !mTimers.empty())
+        PAL_INFO(LOG_TAG, "%zu fds and %zu timers still registered",
+                 mFds.size(), mTimers.size());
+    if (mWakeFd >= 0)
+        close(mWakeFd);
+    if (mEpollFd >= 0)
+        close(mEpollFd);
+}
+
+PalEventLoop* PalEventLoop::getInstance()
+{
+    std::lock_guard<std::mutex> lock(sInstanceMutex);
+
+    /* late callers during teardown must not bring the loop back */
+    if (sDeinitDone)
+        return nullptr;
+
+    if (!sInstance) {
+        sInstance = new PalEventLoop();
+        if (sInstance->start()) {
+            delete sInstance;
+            sInstance = nullptr;
+        }
+    }
+    return sInstance;
+}
+
+void PalEventLoop::init()
+{
+    std::lock_guard<std::mutex> lock(sInstanceMutex);
+
+    sDeinitDone = false;
+}
+
+void PalEventLoop::deinit()
+{
+    pal_event_loop_stats_t stats;
+    PalEventLoop *loop = nullptr;
+
+    /*
+     * Unpublish under the lock but stop outside of it, a handler still
+     * running on a worker may call getInstance() and must see NULL rather
+     * than block the join below.
+     */
+    {
+        std::lock_guard<std::mutex> lock(sInstanceMutex);
+        sDeinitDone = true;
+        loop = sInstance;
+        sInstance = nullptr;
+    }
+    if (!loop)
+        return;
+
+    loop->stop();
+    loop->getStats(&stats);
+    PAL_INFO(LOG_TAG, "wakeups %llu fd events %llu timer expiries %llu work items %llu max queue %u",
+             (unsigned long long)stats.wakeups, (unsigned long long)stats.fd_events,
+             (unsigned long long)stats.timer_expiries, (unsigned long long)stats.work_items,
+             stats.max_queue_depth);
+    delete loop;
+}
+
+int PalEventLoop::start()
+{
+    struct epoll_event ev;
+    int status = 0;
+
+    mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (mEpollFd < 0) {
+        status = -errno;
+        PAL_ERR(LOG_TAG, "epoll_create1 failed, status %d", status);
+        goto exit;
+    }
+
+    mWakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (mWakeFd < 0) {
+        status = -errno;
+        PAL_ERR(LOG_TAG, "eventfd failed, status %d", status);
+        goto exit;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u64 = EVENT_LOOP_WAKE_TAG;
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mWakeFd, &ev) < 0) {
+        status = -errno;
+        PAL_ERR(LOG_TAG, "failed to add wake fd, status %d", status);
+        goto exit;
+    }
+
+    mLoopThread = std::thread(&PalEventLoop::loopThread, this);
+    for (int i = 0; i < PAL_EVENT_LOOP_NUM_WORKERS; i++)
+        mWorkers.push_back(std::thread(&PalEventLoop::workerThread, this));
+    PAL_DBG(LOG_TAG, "event loop started with %d workers", PAL_EVENT_LOOP_NUM_WORKERS);
+
+exit:
+    return status;
+}
+
+void PalEventLoop::stop()
+{
+    uint64_t val = 1;
+
+    mExit = true;
+    if (write(mWakeFd, &val, sizeof(val)) < 0)
+        PAL_ERR(LOG_TAG, "failed to wake loop thread, errno %d", errno);
+    if (mLoopThread.joinable())
+        mLoopThread.join();
+
+    {
+        std::lock_guard<std::mutex> lock(mWorkLock);
+        if (!mWork.empty())
+            PAL_INFO(LOG_TAG, "dropping %zu pending work items", mWork.size());
+        mWorkCv.notify_all();
+    }
+    for (auto &worker : mWorkers) {
+        if (worker.joinable())
+            worker.join();
+    }
+    mWorkers.clear();
+}
+
+void PalEventLoop::loopThread()
+{
+    PalThreadScope threadScope(PAL_THREAD_CLASS_EVENT_LOOP, "event_loop");
+    struct epoll_event events[PAL_EVENT_LOOP_MAX_EVENTS];
+    uint64_t val = 0;
+    int timerId = 0;
+    int fd = -1;
+    int n = 0;
+
+    PAL_VERBOSE(LOG_TAG, "Enter");
+    while (!mExit) {
+        n = epoll_wait(mEpollFd, events, PAL_EVENT_LOOP_MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            PAL_ERR(LOG_TAG, "epoll_wait failed, errno %d", errno);
+            break;
+        }
+        mWakeups++;
+
+        for (int i = 0; i < n && !mExit; i++) {
+            if (events[i].data.u64 == EVENT_LOOP_WAKE_TAG) {
+                if (read(mWakeFd, &val, sizeof(val)) < 0)
+                    PAL_VERBOSE(LOG_TAG, "wake fd read failed, errno %d", errno);
+                continue;
+            }
+
+            if (events[i].data.u64 & EVENT_LOOP_TIMER_TAG) {
+                timerId = (int)(events[i].data.u64 & ~EVENT_LOOP_TIMER_TAG);
+                {
+                    std::lock_guard<std::mutex> lock(mLock);
+                    auto it = mTimers.find(timerId);
+                    if (it == mTimers.end())
+                        continue;
+                    if (read(it->second.fd, &val, sizeof(val)) < 0)
+                        continue;
+                }
+                mTimerExpiries++;
+                post([this, timerId]() { runTimer(timerId); });
+                continue;
+            }
+
+            fd = (int)events[i].data.u64;
+            fd_handler_t handler;
+            {
+                std::lock_guard<std::mutex> lock(mLock);
+                auto it = mFds.find(fd);
+                if (it == mFds.end())
+                    continue;
+                handler = it->second;
+                mDispatchFd = fd;
+            }
+            mFdEvents++;
+            handler(events[i].events);
+            {
+                std::lock_guard<std::mutex> lock(mLock);
+                mDispatchFd = -1;
+            }
+            mDispatchCv.notify_all();
+        }
+    }
+    PAL_VERBOSE(LOG_TAG, "Exit");
+}
+
+void PalEventLoop::workerThread()
+{
+    PalThreadScope threadScope(PAL_THREAD_CLASS_EVENT_LOOP, "event_worker");
+    work_t work;
+
+    while (1) {
+        {
+            std::unique_lock<std::mutex> lock(mWorkLock);
+            mWorkCv.wait(lock, [this] { return mExit || !mWork.empty(); });
+            if (mExit)
+                break;
+            work = std::move(mWork.front());
+            mWork.pop_front();
+        }
+        mWorkItems++;
+        work();
+    }
+}
+
+void PalEventLoop::runTimer(int timerId)
+{
+    work_t handler;
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        auto it = mTimers.find(timerId);
+        if (it == mTimers.end())
+            return;
+        handler = it->second.handler;
+        mRunningTimers.insert(timerId);
+    }
+
+    sCurrentTimer = timerId;
+    handler();
+    sCurrentTimer = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mRunningTimers.erase(mRunningTimers.find(timerId));
+    }
+    mDispatchCv.notify_all();
+}
+
+int PalEventLoop::addFd(int fd, uint32_t events, fd_handler_t handler)
+{
+    struct epoll_event ev;
+    std::lock_guard<std::mutex> lock(mLock);
+
+    if (fd < 0 || !handler)
+        return -EINVAL;
+    if (mFds.count(fd))
+        return -EEXIST;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.u64 = (uint64_t)fd;
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        PAL_ERR(LOG_TAG, "failed to add fd %d, errno %d", fd, errno);
+        return -errno;
+    }
+    mFds[fd] = handler;
+    return 0;
+}
+
+int PalEventLoop::removeFd(int fd)
+{
+    std::unique_lock<std::mutex> lock(mLock);
+    auto it = mFds.find(fd);
+
+    if (it == mFds.end())
+        return -ENOENT;
+
+    epoll_ctl(mEpollFd, EPOLL_CTL_DEL, fd, NULL);
+    mFds.erase(it);
+    if (std::this_thread::get_id() != mLoopThread.get_id())
+        mDispatchCv.wait(lock, [this, fd] { return mDispatchFd != fd; });
+    return 0;
+}
+
+int PalEventLoop::addTimer(uint32_t delayMs, uint32_t periodMs, work_t handler)
+{
+    struct epoll_event ev;
+    int timerId = 0;
+    int tfd = -1;
+    int status = 0;
+
+    if (!handler)
+        return -EINVAL;
+
+    tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (tfd < 0) {
+        status = -errno;
+        PAL_ERR(LOG_TAG, "timerfd_create failed, status %d", status);
+        return status;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        timerId = mNextTimerId++;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.u64 = EVENT_LOOP_TIMER_TAG | (uint32_t)timerId;
+        if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, tfd, &ev) < 0) {
+            status = -errno;
+            PAL_ERR(LOG_TAG, "failed to add timer, status %d", status);
+            close(tfd);
+            return status;
+        }
+        mTimers[timerId] = {tfd, handler};
+    }
+
+    if (delayMs) {
+        status = armTimer(timerId, delayMs, periodMs);
+        if (status) {
+            cancelTimer(timerId);
+            return status;
+        }
+    }
+    return timerId;
+}
+
+int PalEventLoop::armTimer(int timerId, uint32_t delayMs, uint32_t periodMs)
+{
+    struct itimerspec spec;
+    std::lock_guard<std::mutex> lock(mLock);
+    auto it = mTimers.find(timerId);
+
+    if (it == mTimers.end())
+        return -ENOENT;
+
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = delayMs / 1000;
+    spec.it_value.tv_nsec = (long)(delayMs % 1000) * 1000000;
+    spec.it_interval.tv_sec = periodMs / 1000;
+    spec.it_interval.tv_nsec = (long)(periodMs % 1000) * 1000000;
+    if (timerfd_settime(it->second.fd, 0, &spec, NULL) < 0) {
+        PAL_ERR(LOG_TAG, "timerfd_settime failed for timer %d, errno %d", timerId, errno);
+        return -errno;
+    }
+    return 0;
+}
+
+int PalEventLoop::disarmTimer(int timerId)
+{
+    return armTimer(timerId, 0, 0);
+}
+
+int PalEventLoop::cancelTimer(int timerId)
+{
+    std::unique_lock<std::mutex> lock(mLock);
+    auto it = mTimers.find(timerId);
+    int status = 0;
+
+    if (it != mTimers.end()) {
+        epoll_ctl(mEpollFd, EPOLL_CTL_DEL, it->second.fd, NULL);
+        close(it->second.fd);
+        mTimers.erase(it);
+    } else {
+        status = -ENOENT;
+    }
+
+    if (sCurrentTimer != timerId)
+        mDispatchCv.wait(lock, [this, timerId] { return !mRunningTimers.count(timerId); });
+    return status;
+}
+
+int PalEventLoop::post(work_t work)
+{
+    std::lock_guard<std::mutex> lock(mWorkLock);
+
+    if (mExit || !work)
+        return -EINVAL;
+
+    mWork.push_back(std::move(work));
+    if (mWork.size() > mMaxQueueDepth)
+        mMaxQueueDepth = mWork.size();
+    mWorkCv.notify_one();
+    return 0;
+}
+
+void PalEventLoop::getStats(pal_event_loop_stats_t *stats)
+{
+    if (!stats)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        stats->num_fds = mFds.size();
+        stats->num_timers = mTimers.size();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mWorkLock);
+        stats->max_queue_depth = mMaxQueueDepth;
+    }
+    stats->wakeups = mWakeups;
+    stats->fd_events = mFdEvents;
+    stats->timer_expiries = mTimerExpiries;
+    stats->work_items = mWorkItems;
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#define LOG_TAG "PAL: PalLazyInit"
+
+#include <errno.h>
+#include <time.h>
+#include "PalCommon.h"
+#include "PalEventLoop.h"
+#include "PalLazyInit.h"
+
+static int64_t nowUs()
+{
+    struct timespec ts = {0, 0};
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+PalLazyInit::PalLazyInit(const char *name, init_t init, deinit_t deinit)
+    : mName(name),
+      mInit(init),
+      mDeinit(deinit),
+      mDone(false),
+      mClosed(false),
+      mStatus(0)
+{
+}
+
+int PalLazyInit::get()
+{
+    int64_t begin = 0;
+
+    if (mDone.load(std::memory_order_acquire))
+        return mStatus;
+
+    std::lock_guard<std::mutex> lock(mLock);
+    if (mClosed)
+        return -ENODEV;
+    if (mDone.load(std::memory_order_relaxed))
+        return mStatus;
+
+    begin = nowUs();
+    mStatus = mInit ? mInit() : 0;
+    mDone.store(true, std::memory_order_release);
+    PAL_INFO(LOG_TAG, "%s initialized in %lld us, status %d", mName.c_str(),
+             (long long)(nowUs() - begin), mStatus);
+    return mStatus;
+}
+
+bool PalLazyInit::isDone()
+{
+    return mDone.load(std::memory_order_acquire);
+}
+
+int PalLazyInit::prewarm()
+{
+    PalEventLoop *loop = NULL;
+
+    if (isDone())
+        return 0;
+
+    loop = PalEventLoop::getInstance();
+    if (!loop) {
+        PAL_ERR(LOG_TAG, "no event loop to pre-warm %s", mName.c_str());
+        return -ENODEV;
+    }
+    return loop->post([this]() { get(); });
+}
+
+void PalLazyInit::close()
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    if (mDone.load(std::memory_order_relaxed) && mDeinit)
+        mDeinit();
+    mDone.store(false, std::memory_order_release);
+    mClosed = true;
+}
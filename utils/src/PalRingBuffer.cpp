@@ -36,10 +36,99 @@
 #ifdef LINUX_ENABLED
 #include <algorithm>
 #endif
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include "PalRingBuffer.h"
 #include "PalCommon.h"
 #define LOG_TAG "PAL: PalRingBuffer"
 
+std::mutex PalRingBufferPool::mutex_;
+std::multimap<size_t, char*> PalRingBufferPool::idle_;
+
+size_t PalRingBufferPool::roundToPage(size_t size)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+    return (size + page - 1) / page * page;
+}
+
+char* PalRingBufferPool::acquire(size_t size)
+{
+    size_t mapSize = roundToPage(size);
+    void *addr = NULL;
+
+    if (!size)
+        return nullptr;
+
+    mutex_.lock();
+    auto iter = idle_.find(mapSize);
+    if (iter != idle_.end()) {
+        addr = iter->second;
+        idle_.erase(iter);
+        mutex_.unlock();
+        PAL_VERBOSE(LOG_TAG, "reuse pooled buffer %pK size %zu", addr, mapSize);
+        return (char *)addr;
+    }
+    mutex_.unlock();
+
+    /* reserve only, pages get committed as the writer reaches them */
+    addr = mmap(NULL, mapSize, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (addr == MAP_FAILED) {
+        PAL_ERR(LOG_TAG, "failed to map ring buffer of size %zu, errno %d",
+                mapSize, errno);
+        return nullptr;
+    }
+    PAL_VERBOSE(LOG_TAG, "mapped buffer %pK size %zu", addr, mapSize);
+    return (char *)addr;
+}
+
+void PalRingBufferPool::discard(char *buffer, size_t size)
+{
+    if (!buffer || !size)
+        return;
+
+    if (madvise(buffer, roundToPage(size), MADV_DONTNEED))
+        PAL_ERR(LOG_TAG, "failed to release pages of %pK, errno %d", buffer, errno);
+}
+
+void PalRingBufferPool::release(char *buffer, size_t size)
+{
+    size_t mapSize = roundToPage(size);
+
+    if (!buffer)
+        return;
+
+    discard(buffer, size);
+    mutex_.lock();
+    if (idle_.count(mapSize) < PAL_RING_BUFFER_POOL_MAX_IDLE) {
+        idle_.insert(std::make_pair(mapSize, buffer));
+        mutex_.unlock();
+        return;
+    }
+    mutex_.unlock();
+    munmap(buffer, mapSize);
+}
+
+PalRingBuffer::PalRingBuffer(size_t bufferSize)
+    : buffer_(PalRingBufferPool::acquire(bufferSize)),
+      startIndex(0),
+      endIndex(0),
+      writeOffset_(0),
+      bufferEnd_(buffer_ ? bufferSize : 0),
+      touchedSize_(0)
+{
+}
+
+PalRingBuffer::~PalRingBuffer()
+{
+    PalRingBufferPool::release(buffer_, bufferEnd_);
+
+    for (int i = 0; i < readOffsets_.size(); i++)
+        delete readOffsets_[i];
+}
+
 int32_t PalRingBuffer::removeReader(PalRingBufferReader *reader)
 {
     auto iter = std::find(readOffsets_.begin(), readOffsets_.end(), reader);
@@ -102,6 +191,11 @@ size_t PalRingBuffer::write(void* writeBuffer, size_t writeSize)
 
     PAL_DBG(LOG_TAG, "Enter. freeSize(%zu), writeOffset(%zu)", freeSize, writeOffset_);
 
+    if (!buffer_) {
+        mutex_.unlock();
+        return 0;
+    }
+
     if (writeSize <= freeSize)
         sizeToCopy = writeSize;
     else
@@ -119,11 +213,13 @@ size_t PalRingBuffer::write(void* writeBuffer, size_t writeSize)
                              sizeToCopy);
             writtenSize += sizeToCopy;
             writeOffset_ = sizeToCopy;
+            touchedSize_ = bufferEnd_;
         } else {
             ar_mem_cpy(buffer_ + writeOffset_, sizeToCopy, writeBuffer,
                              sizeToCopy);
             writeOffset_ += sizeToCopy;
             writtenSize = sizeToCopy;
+            touchedSize_ = std::max(touchedSize_, writeOffset_);
         }
     }
     updateUnReadSize(writtenSize);
@@ -141,6 +237,9 @@ void PalRingBuffer::reset()
     startIndex = 0;
     endIndex = 0;
     writeOffset_ = 0;
+    /* history is gone, give its pages back until the next detection */
+    PalRingBufferPool::discard(buffer_, touchedSize_);
+    touchedSize_ = 0;
     mutex_.unlock();
 
     /* Reset all the associated readers */
@@ -150,12 +249,13 @@ void PalRingBuffer::reset()
 
 void PalRingBuffer::resizeRingBuffer(size_t bufferSize)
 {
-    if (buffer_) {
-        delete[] buffer_;
-        buffer_ = nullptr;
-    }
-    buffer_ = (char *)new char[bufferSize];
-    bufferEnd_ = bufferSize;
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    PalRingBufferPool::release(buffer_, bufferEnd_);
+    buffer_ = PalRingBufferPool::acquire(bufferSize);
+    bufferEnd_ = buffer_ ? bufferSize : 0;
+    writeOffset_ = 0;
+    touchedSize_ = 0;
 }
 
 bool PalRingBufferReader::waitForBuffers(uint32_t buffer_size)
@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2023 Qualcomm Innovation Center, Inc. All rights reserved.
+ * SPDX-License-Identifier: BSD-3-Clause-Clear
+ */
+
+#define LOG_TAG "PAL: PalThreadPolicy"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include "PalCommon.h"
+#include "PalThreadPolicy.h"
+
+#define PAL_THREAD_MAX_CPUS 64
+
+static const char *threadClassNames[PAL_THREAD_CLASS_MAX] = {
+    "offload",
+    "lab",
+    "event",
+    "event_loop",
+    "ssr",
+    "background",
+};
+
+std::mutex PalThreadPolicy::sLock;
+std::map<pal_thread_class_t, pal_thread_policy_t> PalThreadPolicy::sPolicies;
+std::map<pid_t, pal_thread_class_t> PalThreadPolicy::sThreads;
+
+static pid_t palGetTid()
+{
+    return (pid_t)syscall(SYS_gettid);
+}
+
+int PalThreadPolicy::getClass(const char *name, pal_thread_class_t *cls)
+{
+    for (int i = 0; i < PAL_THREAD_CLASS_MAX; i++) {
+        if (!strcmp(name, threadClassNames[i])) {
+            *cls = (pal_thread_class_t)i;
+            return 0;
+        }
+    }
+    return -EINVAL;
+}
+
+int PalThreadPolicy::apply(pid_t tid, pal_thread_class_t cls,
+                           const pal_thread_policy_t &policy)
+{
+    struct sched_param param;
+    cpu_set_t cpus;
+    char buf[16];
+    int fd = -1;
+    int len = 0;
+    int status = 0;
+
+    memset(&param, 0, sizeof(param));
+    if (policy.sched_policy == SCHED_FIFO) {
+        param.sched_priority = policy.priority;
+        if (param.sched_priority < sched_get_priority_min(SCHED_FIFO))
+            param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+        if (param.sched_priority > sched_get_priority_max(SCHED_FIFO))
+            param.sched_priority = sched_get_priority_max(SCHED_FIFO);
+    }
+    if (sched_setscheduler(tid, policy.sched_policy, &param)) {
+        status = -errno;
+        PAL_ERR(LOG_TAG, "tid %d class %s: sched_setscheduler failed %d",
+                tid, threadClassNames[cls], status);
+    }
+
+    if (policy.sched_policy == SCHED_OTHER &&
+        setpriority(PRIO_PROCESS, tid, policy.nice)) {
+        status = -errno;
+        PAL_ERR(LOG_TAG, "tid %d class %s: setpriority failed %d",
+                tid, threadClassNames[cls], status);
+    }
+
+    if (policy.cpu_mask) {
+        CPU_ZERO(&cpus);
+        for (int cpu = 0; cpu < PAL_THREAD_MAX_CPUS; cpu++) {
+            if (policy.cpu_mask & (1ULL << cpu))
+                CPU_SET(cpu, &cpus);
+        }
+        if (sched_setaffinity(tid, sizeof(cpus), &cpus)) {
+            status = -errno;
+            PAL_ERR(LOG_TAG, "tid %d class %s: sched_setaffinity failed %d",
+                    tid, threadClassNames[cls], status);
+        }
+    }
+
+    if (!policy.cgroup.empty()) {
+        fd = open(policy.cgroup.c_str(), O_WRONLY | O_CLOEXEC);
+        len = snprintf(buf, sizeof(buf), "%d", tid);
+        if (fd < 0 || write(fd, buf, len) != len) {
+            status = -errno;
+            PAL_ERR(LOG_TAG, "tid %d class %s: join cgroup %s failed %d",
+                    tid, threadClassNames[cls], policy.cgroup.c_str(), status);
+        }
+        if (fd >= 0)
+            close(fd);
+    }
+
+    PAL_DBG(LOG_TAG, "tid %d class %s: policy %d prio %d nice %d mask 0x%llx",
+            tid, threadClassNames[cls], policy.sched_policy, param.sched_priority,
+            policy.nice, (unsigned long long)policy.cpu_mask);
+    return status;
+}
+
+void PalThreadPolicy::save(pid_t tid, pal_thread_state_t *state)
+{
+    state->saved = false;
+    state->sched_policy = sched_getscheduler(tid);
+    if (state->sched_policy < 0 || sched_getparam(tid, &state->param))
+        return;
+    errno = 0;
+    state->nice = getpriority(PRIO_PROCESS, tid);
+    if (errno)
+        return;
+    if (sched_getaffinity(tid, sizeof(state->cpus), &state->cpus))
+        return;
+    state->saved = true;
+}
+
+void PalThreadPolicy::restore(pid_t tid, const pal_thread_state_t &state)
+{
+    if (sched_setscheduler(tid, state.sched_policy, &state.param))
+        PAL_ERR(LOG_TAG, "tid %d: restore sched_setscheduler failed %d", tid, -errno);
+    if (state.sched_policy == SCHED_OTHER &&
+        setpriority(PRIO_PROCESS, tid, state.nice))
+        PAL_ERR(LOG_TAG, "tid %d: restore setpriority failed %d", tid, -errno);
+    if (sched_setaffinity(tid, sizeof(state.cpus), &state.cpus))
+        PAL_ERR(LOG_TAG, "tid %d: restore sched_setaffinity failed %d", tid, -errno);
+}
+
+void PalThreadPolicy::enter(pal_thread_class_t cls, const char *name,
+                            pal_thread_state_t *prev)
+{
+    std::lock_guard<std::mutex> lock(sLock);
+    pid_t tid = palGetTid();
+
+    prev->registered = false;
+    prev->saved = false;
+    if (cls >= PAL_THREAD_CLASS_MAX)
+        return;
+
+    auto cur = sThreads.find(tid);
+    if (cur != sThreads.end()) {
+        prev->registered = true;
+        prev->cls = cur->second;
+    }
+
+    sThreads[tid] = cls;
+    PAL_VERBOSE(LOG_TAG, "%s tid %d entered class %s", name ? name : "thread",
+                tid, threadClassNames[cls]);
+    auto it = sPolicies.find(cls);
+    if (it != sPolicies.end()) {
+        save(tid, prev);
+        apply(tid, cls, it->second);
+    }
+}
+
+void PalThreadPolicy::leave(const pal_thread_state_t *prev)
+{
+    std::lock_guard<std::mutex> lock(sLock);
+    pid_t tid = palGetTid();
+
+    if (!prev->registered) {
+        sThreads.erase(tid);
+    } else {
+        sThreads[tid] = prev->cls;
+        /* the outer class policy may have changed meanwhile, apply it as is */
+        auto it = sPolicies.find(prev->cls);
+        if (it != sPolicies.end()) {
+            apply(tid, prev->cls, it->second);
+            return;
+        }
+    }
+    if (prev->saved)
+        restore(tid, *prev);
+}
+
+int PalThreadPolicy::setPolicy(pal_thread_class_t cls,
+                               const pal_thread_policy_t *policy)
+{
+    std::lock_guard<std::mutex> lock(sLock);
+
+    if (cls >= PAL_THREAD_CLASS_MAX || !policy ||
+        (policy->sched_policy != SCHED_OTHER && policy->sched_policy != SCHED_FIFO))
+        return -EINVAL;
+
+    sPolicies[cls] = *policy;
+    PAL_INFO(LOG_TAG, "class %s: policy %d prio %d nice %d mask 0x%llx cgroup %s",
+             threadClassNames[cls], policy->sched_policy, policy->priority,
+             policy->nice, (unsigned long long)policy->cpu_mask,
+             policy->cgroup.c_str());
+
+    for (auto &thread : sThreads) {
+        if (thread.second == cls)
+            apply(thread.first, cls, *policy);
+    }
+    return 0;
+}
+
+int PalThreadPolicy::configure(const char **attr)
+{
+    pal_thread_policy_t policy;
+    pal_thread_class_t cls = PAL_THREAD_CLASS_MAX;
+
+    policy.sched_policy = SCHED_OTHER;
+    policy.priority = 0;
+    policy.nice = 0;
+    policy.cpu_mask = 0;
+
+    for (int i = 0; attr[i] && attr[i + 1]; i += 2) {
+        if (!strcmp(attr[i], "class")) {
+            if (getClass(attr[i + 1], &cls)) {
+                PAL_ERR(LOG_TAG, "unknown thread class %s", attr[i + 1]);
+                return -EINVAL;
+            }
+        } else if (!strcmp(attr[i], "policy")) {
+            if (!strcmp(attr[i + 1], "fifo")) {
+                policy.sched_policy = SCHED_FIFO;
+            } else if (!strcmp(attr[i + 1], "other")) {
+                policy.sched_policy = SCHED_OTHER;
+            } else {
+                PAL_ERR(LOG_TAG, "unknown sched policy %s", attr[i + 1]);
+                return -EINVAL;
+            }
+        } else if (!strcmp(attr[i], "priority")) {
+            policy.priority = atoi(attr[i + 1]);
+        } else if (!strcmp(attr[i], "nice")) {
+            policy.nice = atoi(attr[i + 1]);
+        } else if (!strcmp(attr[i], "cpu_mask")) {
+            policy.cpu_mask = strtoull(attr[i + 1], NULL, 0);
+        } else if (!strcmp(attr[i], "cgroup")) {
+            policy.cgroup = attr[i + 1];
+        } else {
+            PAL_ERR(LOG_TAG, "ignoring unknown attribute %s", attr[i]);
+        }
+    }
+
+    if (cls == PAL_THREAD_CLASS_MAX) {
+        PAL_ERR(LOG_TAG, "thread_policy without class");
+        return -EINVAL;
+    }
+
+    return setPolicy(cls, &policy);
+}